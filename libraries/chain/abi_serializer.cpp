@@ -72,14 +72,188 @@ namespace eosio { namespace chain {
       );
    }
 
+   namespace impl {
+
+      /**
+       * binary_to_variant of the types of an ABI with type names resolved to indexes once by
+       * compile_binary_to_variant_plan. Produces the same variants as the type name resolving
+       * _binary_to_variant, calls yield with the same recursion depths and keeps the path of the
+       * context the same way, so that it throws the same errors with the same paths.
+       */
+      struct binary_to_variant_plan {
+         enum class kind : uint8_t { unknown, built_in, array, optional, variant, kv_table, struct_type };
+
+         struct type_entry {
+            kind              k = kind::unknown;
+            bool              is_array = false;     ///< built_in only
+            bool              is_optional = false;  ///< built_in only
+            uint32_t          index = 0;            ///< into unpackers, types (array, optional, kv_table), variants or structs
+            std::string_view  name;                 ///< resolved type name, unknown only
+         };
+
+         struct field_entry {
+            field_name name;
+            uint32_t   type = 0;
+            bool       extension = false;
+         };
+
+         struct struct_entry {
+            map<type_name, struct_def>::const_iterator  def;
+            std::optional<uint32_t>                     base;
+            std::string_view                            unknown_base; ///< resolved name of a base which is not a struct
+            vector<field_entry>                         fields;
+         };
+
+         struct variant_entry {
+            map<type_name, variant_def>::const_iterator def;
+            vector<uint32_t>                            types;
+         };
+
+         /// path item of the context for the lifetime of the guard, without the std::function of push_to_path
+         struct path_guard {
+            vector<path_item>& path;
+            path_guard( vector<path_item>& path, path_item item ) : path( path ) { path.push_back( std::move( item ) ); }
+            ~path_guard() { path.pop_back(); }
+         };
+
+         vector<type_entry>                              types;
+         vector<struct_entry>                            structs;
+         vector<variant_entry>                           variants;
+         vector<abi_serializer::unpack_function>         unpackers;
+         vector<std::string_view>                        unpacker_names;
+         map<type_name, uint32_t, std::less<>>           type_index;     ///< resolved type name -> types
+         map<type_name, uint32_t, std::less<>>           struct_index;   ///< struct name -> structs
+         map<type_name, uint32_t, std::less<>>           unpacker_index; ///< built-in type name -> unpackers
+
+         std::optional<uint32_t> find( const std::string_view& rtype )const {
+            auto itr = type_index.find( rtype );
+            if( itr == type_index.end() ) return {};
+            return itr->second;
+         }
+
+         fc::variant unpack( uint32_t type, fc::datastream<const char*>& stream, binary_to_variant_context& ctx,
+                             const abi_serializer::yield_function_t& yield, size_t recursion_depth )const {
+            yield( ++recursion_depth );
+            const auto& t = types[type];
+            switch( t.k ) {
+               case kind::built_in:
+                  try {
+                     return unpackers[t.index]( stream, t.is_array, t.is_optional, yield );
+                  } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack ${class} type '${type}' while processing '${p}'",
+                                            ("class", t.is_array ? "array of built-in" : t.is_optional ? "optional of built-in" : "built-in")
+                                            ("type", limit_size(unpacker_names[t.index]))("p", ctx.get_path_string()) )
+               case kind::array: {
+                  ctx.hint_array_type_if_in_array();
+                  fc::unsigned_int size;
+                  try {
+                     fc::raw::unpack( stream, size );
+                  } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack size of array '${p}'", ("p", ctx.get_path_string()) )
+                  vector<fc::variant> vars;
+                  vars.reserve( std::min<size_t>( size.value, stream.remaining() ) );
+                  path_guard g( ctx.path, array_index_path_item{} );
+                  for( decltype(size.value) i = 0; i < size; ++i ) {
+                     std::get<array_index_path_item>( ctx.path.back() ).array_index = i;
+                     auto v = unpack( t.index, stream, ctx, yield, recursion_depth );
+                     EOS_ASSERT( !v.is_null(), unpack_exception, "Invalid packed array '${p}'", ("p", ctx.get_path_string()) );
+                     vars.emplace_back( std::move( v ) );
+                  }
+                  return fc::variant( std::move( vars ) );
+               }
+               case kind::optional: {
+                  char flag;
+                  try {
+                     fc::raw::unpack( stream, flag );
+                  } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack presence flag of optional '${p}'", ("p", ctx.get_path_string()) )
+                  return flag ? unpack( t.index, stream, ctx, yield, recursion_depth ) : fc::variant();
+               }
+               case kind::variant: {
+                  const auto& v = variants[t.index];
+                  ctx.hint_variant_type_if_in_array( v.def );
+                  fc::unsigned_int select;
+                  try {
+                     fc::raw::unpack( stream, select );
+                  } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack tag of variant '${p}'", ("p", ctx.get_path_string()) )
+                  EOS_ASSERT( (size_t)select < v.types.size(), unpack_exception,
+                              "Unpacked invalid tag (${select}) for variant '${p}'", ("select", select.value)("p", ctx.get_path_string()) );
+                  path_guard g( ctx.path, variant_path_item{ .variant_itr = v.def, .variant_ordinal = static_cast<uint32_t>(select) } );
+                  return vector<fc::variant>{ v.def->second.types[select], unpack( v.types[select], stream, ctx, yield, recursion_depth ) };
+               }
+               case kind::kv_table:
+                  return unpack( t.index, stream, ctx, yield, recursion_depth );
+               case kind::struct_type: {
+                  fc::mutable_variant_object mvo;
+                  unpack_struct( t.index, stream, mvo, ctx, yield, recursion_depth );
+                  EOS_ASSERT( mvo.size() > 0, unpack_exception, "Unable to unpack '${p}' from stream", ("p", ctx.get_path_string()) );
+                  return fc::variant( std::move( mvo ) );
+               }
+               case kind::unknown:
+                  break;
+            }
+            yield( ++recursion_depth );
+            EOS_THROW( invalid_type_inside_abi, "Unknown type ${type}", ("type", ctx.maybe_shorten(t.name)) );
+         }
+
+         void unpack_struct( uint32_t index, fc::datastream<const char*>& stream, fc::mutable_variant_object& obj,
+                             binary_to_variant_context& ctx, const abi_serializer::yield_function_t& yield,
+                             size_t recursion_depth )const {
+            yield( ++recursion_depth );
+            const auto& st = structs[index];
+            ctx.hint_struct_type_if_in_array( st.def );
+            if( st.base ) {
+               unpack_struct( *st.base, stream, obj, ctx, yield, recursion_depth );
+            } else if( !st.unknown_base.empty() ) {
+               yield( recursion_depth + 1 );
+               EOS_THROW( invalid_type_inside_abi, "Unknown type ${type}", ("type", ctx.maybe_shorten(st.unknown_base)) );
+            }
+            bool encountered_extension = false;
+            for( uint32_t i = 0; i < st.fields.size(); ++i ) {
+               const auto& field = st.fields[i];
+               encountered_extension |= field.extension;
+               if( !stream.remaining() ) {
+                  if( field.extension ) continue;
+                  if( encountered_extension ) {
+                     EOS_THROW( abi_exception, "Encountered field '${f}' without binary extension designation while processing struct '${p}'",
+                                ("f", ctx.maybe_shorten(field.name))("p", ctx.get_path_string()) );
+                  }
+                  EOS_THROW( unpack_exception, "Stream unexpectedly ended; unable to unpack field '${f}' of struct '${p}'",
+                             ("f", ctx.maybe_shorten(field.name))("p", ctx.get_path_string()) );
+               }
+               path_guard g( ctx.path, field_path_item{ .parent_struct_itr = st.def, .field_ordinal = i } );
+               obj( field.name, unpack( field.type, stream, ctx, yield, recursion_depth ) );
+            }
+         }
+      };
+
+   } // namespace impl
+
    abi_serializer::abi_serializer( const abi_def& abi, const yield_function_t& yield ) {
       configure_built_in_types();
       set_abi(abi, yield);
    }
 
+   abi_serializer::abi_serializer( const abi_serializer& other )
+   : typedefs( other.typedefs ), structs( other.structs ), actions( other.actions ), tables( other.tables ),
+     kv_tables( other.kv_tables ), error_messages( other.error_messages ), variants( other.variants ),
+     action_results( other.action_results ), built_in_types( other.built_in_types ) {
+      if( other.binary_to_variant_plan ) {
+         impl::abi_traverse_context ctx( []( size_t ) {} ); // the ABI was validated within its deadline when it was set
+         compile_binary_to_variant_plan( ctx );
+      }
+   }
+
+   abi_serializer& abi_serializer::operator=( const abi_serializer& other ) {
+      if( this != &other )
+         *this = abi_serializer( other );
+      return *this;
+   }
+
    void abi_serializer::add_specialized_unpack_pack( const string& name,
                                                      std::pair<abi_serializer::unpack_function, abi_serializer::pack_function> unpack_pack ) {
       built_in_types[name] = std::move( unpack_pack );
+      if( binary_to_variant_plan ) {
+         impl::abi_traverse_context ctx( []( size_t ) {} ); // built-in types are only added by our own code, no deadline
+         compile_binary_to_variant_plan( ctx );
+      }
    }
 
    void abi_serializer::configure_built_in_types() {
@@ -180,6 +354,97 @@ namespace eosio { namespace chain {
       EOS_ASSERT( action_results.size() == abi.action_results.value.size(), duplicate_abi_action_results_def_exception, "duplicate action results definition detected" );
 
       validate(ctx);
+      compile_binary_to_variant_plan(ctx);
+   }
+
+   void abi_serializer::compile_binary_to_variant_plan( impl::abi_traverse_context& ctx ) {
+      using plan_t = impl::binary_to_variant_plan;
+      auto plan = std::make_shared<plan_t>();
+
+      // mirrors the type name resolution of _binary_to_variant, rtype is already resolved
+      std::function<uint32_t(std::string_view)> compile_struct;
+      std::function<uint32_t(std::string_view)> compile_type = [&]( std::string_view rtype ) -> uint32_t {
+         if( auto existing = plan->find( rtype ) ) return *existing;
+         const uint32_t index = plan->types.size();
+         plan->types.emplace_back();
+         auto name_itr = plan->type_index.emplace( type_name( rtype ), index ).first;
+
+         plan_t::type_entry t;
+         auto ftype = fundamental_type( rtype );
+         if( auto btype = built_in_types.find( ftype ); btype != built_in_types.end() ) {
+            t.k = plan_t::kind::built_in;
+            t.is_array = is_array( rtype );
+            t.is_optional = is_optional( rtype );
+            auto [itr, inserted] = plan->unpacker_index.try_emplace( btype->first, plan->unpackers.size() );
+            if( inserted ) {
+               plan->unpackers.push_back( btype->second.first );
+               plan->unpacker_names.push_back( btype->first );
+            }
+            t.index = itr->second;
+         } else if( is_array( rtype ) ) {
+            t.k = plan_t::kind::array;
+            t.index = compile_type( resolve_type( ftype ) );
+         } else if( is_optional( rtype ) ) {
+            t.k = plan_t::kind::optional;
+            t.index = compile_type( resolve_type( ftype ) );
+         } else if( auto v_itr = variants.find( rtype ); v_itr != variants.end() ) {
+            plan_t::variant_entry v;
+            v.def = v_itr;
+            for( const auto& vt : v_itr->second.types ) {
+               v.types.push_back( compile_type( resolve_type( vt ) ) );
+            }
+            t.k = plan_t::kind::variant;
+            t.index = plan->variants.size();
+            plan->variants.push_back( std::move( v ) );
+         } else if( auto kv_itr = ( !kv_tables.empty() && is_string_valid_name( rtype ) ) ? kv_tables.find( name( rtype ) ) : kv_tables.end();
+                    kv_itr != kv_tables.end() ) {
+            t.k = plan_t::kind::kv_table;
+            t.index = compile_type( resolve_type( kv_itr->second.type ) );
+         } else if( structs.find( rtype ) != structs.end() ) {
+            t.k = plan_t::kind::struct_type;
+            t.index = compile_struct( rtype );
+         } else {
+            t.name = name_itr->first;
+         }
+         plan->types[index] = t;
+         return index;
+      };
+
+      compile_struct = [&]( std::string_view struct_name ) -> uint32_t {
+         if( auto itr = plan->struct_index.find( struct_name ); itr != plan->struct_index.end() ) return itr->second;
+         ctx.check_deadline();
+         const uint32_t index = plan->structs.size();
+         plan->structs.emplace_back();
+         plan->struct_index.emplace( type_name( struct_name ), index );
+
+         const auto s_itr = structs.find( struct_name );
+         const auto& st = s_itr->second;
+         plan_t::struct_entry s;
+         s.def = s_itr;
+         if( st.base != type_name() ) {
+            auto rbase = resolve_type( st.base );
+            if( structs.find( rbase ) != structs.end() ) s.base = compile_struct( rbase );
+            else s.unknown_base = rbase;
+         }
+         for( const auto& field : st.fields ) {
+            const bool extension = ends_with( field.type, "$" );
+            s.fields.push_back( plan_t::field_entry{ field.name,
+                                                     compile_type( resolve_type( extension ? _remove_bin_extension( field.type ) : field.type ) ),
+                                                     extension } );
+         }
+         plan->structs[index] = std::move( s );
+         return index;
+      };
+
+      for( const auto& t : typedefs )       compile_type( resolve_type( t.first ) );
+      for( const auto& s : structs )        compile_type( s.first );
+      for( const auto& v : variants )       compile_type( v.first );
+      for( const auto& a : actions )        compile_type( resolve_type( a.second ) );
+      for( const auto& t : tables )         compile_type( resolve_type( t.second ) );
+      for( const auto& r : action_results ) compile_type( resolve_type( r.second ) );
+      for( const auto& kt : kv_tables )     compile_type( resolve_type( kt.second.type ) );
+
+      binary_to_variant_plan = std::move( plan );
    }
 
    bool abi_serializer::is_builtin_type(const std::string_view& type)const {
@@ -440,7 +705,18 @@ namespace eosio { namespace chain {
    {
       auto h = ctx.enter_scope();
       fc::datastream<const char*> ds( binary.data(), binary.size() );
-      return _binary_to_variant(type, ds, ctx);
+      return _binary_to_variant_planned(type, ds, ctx);
+   }
+
+   fc::variant abi_serializer::_binary_to_variant_planned( const std::string_view& type, fc::datastream<const char*>& stream,
+                                                           impl::binary_to_variant_context& ctx )const
+   {
+      if( binary_to_variant_plan ) {
+         if( auto index = binary_to_variant_plan->find( resolve_type( type ) ) ) {
+            return binary_to_variant_plan->unpack( *index, stream, ctx, ctx.get_yield_function(), ctx.get_recursion_depth() );
+         }
+      }
+      return _binary_to_variant(type, stream, ctx);
    }
 
    fc::variant abi_serializer::binary_to_variant( const std::string_view& type, const bytes& binary, const yield_function_t& yield, bool short_path )const {
@@ -452,7 +728,7 @@ namespace eosio { namespace chain {
    fc::variant abi_serializer::binary_to_variant( const std::string_view& type, fc::datastream<const char*>& binary, const yield_function_t& yield, bool short_path )const {
       impl::binary_to_variant_context ctx(*this, yield, type);
       ctx.short_path = short_path;
-      return _binary_to_variant(type, binary, ctx);
+      return _binary_to_variant_planned(type, binary, ctx);
    }
 
    void abi_serializer::_variant_to_binary( const std::string_view& type, const fc::variant& var, fc::datastream<char *>& ds, impl::variant_to_binary_context& ctx )const
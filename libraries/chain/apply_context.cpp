@@ -45,6 +45,11 @@ apply_context::apply_context(controller& con, transaction_context& trx_ctx, uint
 ,idx256(*this)
 ,idx_double(*this)
 ,idx_long_double(*this)
+,kv_iterators(arena_allocator<std::unique_ptr<kv_iterator>>(trx_ctx.arena))
+,kv_destroyed_iterators(arena_allocator<size_t>(trx_ctx.arena))
+,_notified(arena_allocator<std::pair<account_name, uint32_t>>(trx_ctx.arena))
+,_inline_actions(arena_allocator<uint32_t>(trx_ctx.arena))
+,_cfa_inline_actions(arena_allocator<uint32_t>(trx_ctx.arena))
 {
    kv_iterators.emplace_back(); // the iterator handle with value 0 is reserved
    action_trace& trace = trx_ctx.get_action_trace(action_ordinal);
@@ -285,7 +290,7 @@ void apply_context::require_recipient( account_name recipient ) {
    if( !has_recipient(recipient) ) {
       _notified.emplace_back(
          recipient,
-         schedule_action( action_ordinal, recipient, false )
+         schedule_action( first_receiver_action_ordinal, recipient, false )
       );
 
       if (auto dm_logger = control.get_deep_mind_logger()) {
@@ -702,7 +707,7 @@ uint32_t apply_context::schedule_action( uint32_t ordinal_of_action_to_schedule,
                                                                     receiver, context_free,
                                                                     action_ordinal, first_receiver_action_ordinal );
 
-   act = &trx_context.get_action_trace( action_ordinal ).act;
+   act = &trx_context.get_action_trace( first_receiver_action_ordinal ).act;
    return scheduled_action_ordinal;
 }
 
@@ -712,7 +717,7 @@ uint32_t apply_context::schedule_action( action&& act_to_schedule, account_name
                                                                     receiver, context_free,
                                                                     action_ordinal, first_receiver_action_ordinal );
 
-   act = &trx_context.get_action_trace( action_ordinal ).act;
+   act = &trx_context.get_action_trace( first_receiver_action_ordinal ).act;
    return scheduled_action_ordinal;
 }
 
@@ -697,6 +697,18 @@ namespace eosio { namespace chain { namespace backing_store {
    }
 
    int32_t db_context_rocksdb::find_i64(name code, name scope, name table, uint64_t id, comp comparison) {
+      if (comparison == comp::equals) {
+         // point lookups are answered by the bloom filters, a seek has to visit every level that overlaps the key;
+         // the table key exists as long as the table has any entries, so it also decides between end and invalid
+         const auto old_key_value = get_primary_key_value(code, scope, table, id);
+         if (!old_key_value.value) {
+            return primary_lookup.get_end_iter(code, scope, table, primary_iter_store);
+         }
+         const unique_table t { code, scope, table };
+         const auto table_ei = primary_iter_store.cache_table(t);
+         return primary_iter_store.add(primary_key_iter(table_ei, id, payer_payload(*old_key_value.value).payer));
+      }
+
       // expanding the "in-play" iterator space to include every key type for that table, to ensure we know if
       // the key is not found, that there is anything in the table at all (and thus can return an end iterator
       // or if an invalid iterator needs to be returned
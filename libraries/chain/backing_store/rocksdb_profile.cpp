@@ -0,0 +1,87 @@
+#include <eosio/chain/backing_store/rocksdb_profile.hpp>
+#include <eosio/chain/backing_store/db_combined.hpp>
+
+#include <rocksdb/cache.h>
+#include <rocksdb/filter_policy.h>
+#include <rocksdb/table.h>
+
+namespace eosio { namespace chain { namespace backing_store {
+
+   const char* db_key_value_prefix_extractor::Name() const {
+      return prefix_level == level::table ? "eosio.db_key_value.table_prefix.v1" : "eosio.db_key_value.contract_prefix.v1";
+   }
+
+   size_t db_key_value_prefix_extractor::prefix_size(const rocksdb::Slice& key) const {
+      if (key.size() < contract_prefix_size)
+         return 0;
+      if (key[0] == rocksdb_contract_kv_prefix)
+         return contract_prefix_size;
+      if (key[0] != rocksdb_contract_db_prefix)
+         return 0;
+      if (prefix_level == level::contract)
+         return contract_prefix_size;
+      // a DB API key shorter than a table prefix is itself a prefix used to seek, it is out of the domain
+      return key.size() >= table_prefix_size ? table_prefix_size : 0;
+   }
+
+   rocksdb::Slice db_key_value_prefix_extractor::Transform(const rocksdb::Slice& key) const {
+      return rocksdb::Slice(key.data(), prefix_size(key));
+   }
+
+   bool db_key_value_prefix_extractor::InDomain(const rocksdb::Slice& key) const {
+      return prefix_size(key) != 0;
+   }
+
+   void configure_persistent_storage_profile(rocksdb::Options& options, persistent_storage_profile profile,
+                                             uint64_t block_cache_size) {
+      // Full and partitioned filters in the block-based table
+      // use an improved Bloom filter implementation, enabled
+      // with format_version 5 (or above) because previous
+      // releases cannot read this filter. This replacement is
+      // faster and more accurate, especially for high bits
+      // per key or millions of keys in a single (full) filter.
+      rocksdb::BlockBasedTableOptions table_options;
+      table_options.format_version               = 5;
+      table_options.index_block_restart_interval = 16;
+
+      // Sets the bloom filter - Given an arbitrary key,
+      // this bit array may be used to determine if the key
+      // may exist or definitely does not exist in the key set.
+      table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(15, false));
+
+      switch (profile) {
+         case persistent_storage_profile::DEFAULT:
+            table_options.index_type = rocksdb::BlockBasedTableOptions::kBinarySearch;
+            break;
+         case persistent_storage_profile::TABLE_PREFIX:
+         case persistent_storage_profile::CONTRACT_PREFIX: {
+            const auto l = profile == persistent_storage_profile::TABLE_PREFIX ? db_key_value_prefix_extractor::level::table
+                                                                               : db_key_value_prefix_extractor::level::contract;
+            // The filters hold both the whole keys (point lookups) and their prefixes (seeks within a prefix).
+            options.prefix_extractor = std::make_shared<db_key_value_prefix_extractor>(l);
+            table_options.whole_key_filtering = true;
+
+            // With a state larger than RAM, a single index and filter block per SST file is mostly
+            // read from disk for every lookup. Partitions are loaded through the block cache on
+            // demand, only the small top level index of each file stays pinned.
+            table_options.index_type = rocksdb::BlockBasedTableOptions::kTwoLevelIndexSearch;
+            table_options.partition_filters = true;
+            table_options.metadata_block_size = 4096;
+            table_options.cache_index_and_filter_blocks = true;
+            table_options.cache_index_and_filter_blocks_with_high_priority = true;
+            table_options.pin_top_level_index_and_filter = true;
+            table_options.pin_l0_filter_and_index_blocks_in_cache = true;
+            table_options.block_cache = rocksdb::NewLRUCache(block_cache_size, -1, false, 0.5);
+
+            // Lookups in the memtables are answered by a bloom filter as well
+            options.memtable_prefix_bloom_size_ratio = 0.1;
+            options.memtable_whole_key_filtering = true;
+            break;
+         }
+      }
+
+      // Incorporates the Table options into options
+      options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+   }
+
+}}} // namespace eosio::chain::backing_store
@@ -4,6 +4,8 @@
 #include <eosio/chain/kv_chainbase_objects.hpp>
 #include <eosio/chain/backing_store/kv_context_rocksdb.hpp>
 #include <eosio/chain/backing_store/kv_context_chainbase.hpp>
+#include <eosio/chain/backing_store/db_key_value_format.hpp>
+#include <eosio/chain/backing_store/rocksdb_profile.hpp>
 
 #include <b1/session/rocks_session.hpp>
 #include <b1/session/session.hpp>
@@ -30,6 +32,9 @@ struct cmd_args {
    uint32_t value_size = 1024;
    uint64_t num_runs = 1000000;
    uint32_t state_size_multiples = 1; // For Chainbase. Multiples of 1GB 
+   std::string profile = "default"; // For RocksDB. default, table-prefix or contract-prefix
+   uint64_t block_cache_size_mb = 512; // For RocksDB. Used by table-prefix and contract-prefix
+   uint32_t num_tables = 1000; // For db_find. Keys are spread over this number of tables
 };
 
 struct measurement_t {
@@ -345,10 +350,74 @@ measurement_t benchmark_it_value(const cmd_args& args, const std::unique_ptr<kv_
    return calculated_measurement(num_keys, usage_start, usage_end);
 }
 
+// DB API primary key of a benchmark key. Keys are spread over num_tables tables
+// of one scope, a key not in the key file misses in an existing table.
+eosio::session::shared_bytes db_primary_key(const cmd_args& args, const std::string& key) {
+   const uint64_t id = std::hash<std::string>{}(key);
+   const name table{id % args.num_tables + 1};
+   return backing_store::db_key_value_format::create_full_key(
+      backing_store::db_key_value_format::create_primary_key(name{1}, table, id), receiver);
+}
+
+eosio::session::shared_bytes db_table_key(const cmd_args& args, const std::string& key) {
+   const uint64_t id = std::hash<std::string>{}(key);
+   const name table{id % args.num_tables + 1};
+   return backing_store::db_key_value_format::create_full_key(
+      backing_store::db_key_value_format::create_table_key(name{1}, table), receiver);
+}
+
+// Benchmark "db_find" operation, the lookups db_find_i64 does: the primary
+// key and, if it does not exist, the table key to tell an end iterator from
+// an invalid one. Keys of the workset that are not in the key file miss.
+template<typename Session>
+measurement_t benchmark_db_find(const cmd_args& args, Session& session, uint32_t& num_keys, const std::vector<std::string>& workset, uint64_t& hits) {
+   std::ifstream key_file(args.key_file);
+
+   if (!key_file.is_open()) {
+      std::cerr << "Failed to open key file " << args.key_file << std::endl;
+      exit(2);
+   }
+
+   std::string value(args.value_size, 'a');
+   const eosio::session::shared_bytes value_bytes(value.data(), value.size());
+   std::string key;
+   num_keys = 0;
+   while (getline(key_file, key)) {
+      session.write(db_primary_key(args, key), value_bytes);
+      session.write(db_table_key(args, key), value_bytes);
+      ++num_keys;
+   }
+   key_file.close();
+
+   std::vector<std::pair<eosio::session::shared_bytes, eosio::session::shared_bytes>> lookups;
+   for (auto& key: workset) {
+      lookups.emplace_back(db_primary_key(args, key), db_table_key(args, key));
+   }
+
+   uint32_t num_loops = get_num_loops(args.num_runs, workset.size());
+   rusage usage_start, usage_end;
+   hits = 0;
+
+   getrusage(RUSAGE_SELF, &usage_start);
+   for (auto i = 0U; i < num_loops; ++i) {
+      for (auto& [primary_key, table_key]: lookups) {
+         if (session.read(primary_key)) {
+            ++hits;
+         } else {
+            session.read(table_key);
+         }
+      }
+   }
+   getrusage(RUSAGE_SELF, &usage_end);
+
+   return calculated_measurement(num_loops*workset.size(), usage_start, usage_end);
+}
+
 // Print out benchmarking results
 void print_results(const cmd_args& args, const uint32_t num_keys, const uint32_t workset_size, const measurement_t& m) {
    std::cout 
       << "backing_store: " << args.backing_store
+      << ", profile: " << args.profile
       << ", operation: " << args.operation
       << ", key_file: " << args.key_file
       << ", num_keys: " << num_keys
@@ -409,7 +478,7 @@ void benchmark_operation(const cmd_args& args, const std::unique_ptr<kv_context>
    print_results(args, num_keys, workset_size, m);
 }
 
-inline std::shared_ptr<rocksdb::DB> make_rocks_db(const std::string& name) {
+inline std::shared_ptr<rocksdb::DB> make_rocks_db(const std::string& name, const cmd_args& args) {
     rocksdb::DB* cache_ptr{ nullptr };
     auto         cache = std::shared_ptr<rocksdb::DB>{};
 
@@ -462,24 +531,14 @@ inline std::shared_ptr<rocksdb::DB> make_rocks_db(const std::string& name) {
     // smaller ones that are run simultaneously.
     options.max_subcompactions = 7;	// Default should be the # of CPUs
 
-    // Full and partitioned filters in the block-based table
-    // use an improved Bloom filter implementation, enabled
-    // with format_version 5 (or above) because previous
-    // releases cannot read this filter. This replacement is
-    // faster and more accurate, especially for high bits
-    // per key or millions of keys in a single (full) filter.
-    rocksdb::BlockBasedTableOptions table_options;
-    table_options.format_version               = 5;
-    table_options.index_block_restart_interval = 16;
-
-    // Sets the bloom filter - Given an arbitrary key, 
-    // this bit array may be used to determine if the key 
-    // may exist or definitely does not exist in the key set.
-    table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(15, false));
-    table_options.index_type = rocksdb::BlockBasedTableOptions::kBinarySearch;
-
-    // Incorporates the Table options into options
-    options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+    // Bloom filters, index layout and block cache as configured by nodeos' persistent-storage-profile
+    auto profile = persistent_storage_profile::DEFAULT;
+    if (args.profile == "table-prefix") {
+       profile = persistent_storage_profile::TABLE_PREFIX;
+    } else if (args.profile == "contract-prefix") {
+       profile = persistent_storage_profile::CONTRACT_PREFIX;
+    }
+    backing_store::configure_persistent_storage_profile(options, profile, args.block_cache_size_mb * 1024 * 1024);
 
     auto status = rocksdb::DB::Open(options, name.c_str(), &cache_ptr);
 
@@ -495,7 +554,18 @@ void benchmark(const cmd_args& args) {
       boost::filesystem::remove_all(chain::config::default_state_dir_name);
 
       constexpr size_t max_rocks_iterators = 1024;
-      auto rocks_session = eosio::session::make_session(make_rocks_db("kvrdb-tmp"), max_rocks_iterators);
+      auto rocks_session = eosio::session::make_session(make_rocks_db("kvrdb-tmp", args), max_rocks_iterators);
+
+      if (args.operation == "db_find") {
+         uint32_t num_keys {0}, workset_size {0};
+         uint64_t hits {0};
+         std::vector<std::string> workset = load_workset(args, workset_size);
+         auto m = benchmark_db_find(args, rocks_session, num_keys, workset, hits);
+         print_results(args, num_keys, workset_size, m);
+         std::cout << "db_find hits: " << hits << ", misses: " << m.actual_num_runs - hits << std::endl;
+         return;
+      }
+
       auto session = eosio::session::session<decltype(rocks_session)>{rocks_session};
 
       std::unique_ptr<kv_context> kv_context_ptr = create_kv_rocksdb_context<decltype(session), mock_resource_manager>(session, receiver, resource_manager, limits); 
@@ -525,11 +595,14 @@ int main(int argc, char* argv[]) {
    cli.add_options()
      ("key-file,k", bpo::value<string>()->required(), "the file storing all the keys, mandatory")
      ("workset,w", bpo::value<string>(), "the file storing workset keys, which must be constructed from key-file and be random; the operation is repeatedly run against the workset; mandatory for get, get_data, and set")
-     ("operation,o", bpo::value<string>()->required(), "operation to be benchmarked: get, get_data, set, create, erase, it_create, it_next, it_key, or it_value, mandatory")
+     ("operation,o", bpo::value<string>()->required(), "operation to be benchmarked: get, get_data, set, create, erase, it_create, it_next, it_key, it_value, or db_find (rocksdb only), mandatory")
      ("backing-store,b", bpo::value<string>()->required(), "the database where kay vlaues are stored, rocksdb or chainbase, mandatory")
      ("value-size,v", bpo::value<uint32_t>(), "value size for the keys")
      ("state-size-multiples,s", bpo::value<uint32_t>(), "multiples of 1GB for Chainbase state storage")
      ("num-runs,n", bpo::value<uint64_t>(), "minimum number of runs of the benchmarked operation")
+     ("profile,p", bpo::value<string>(), "rocksdb persistent storage profile: default, table-prefix or contract-prefix")
+     ("block-cache-size-mb,c", bpo::value<uint64_t>(), "rocksdb block cache size (in MiB) of the table-prefix and contract-prefix profiles")
+     ("num-tables,t", bpo::value<uint32_t>(), "number of tables the keys are spread over for db_find")
      ("help,h","microbenchmarks KV operations get, get_data, set, create (set to a new key), erase, it_create, it_next, it_key, and it_value against chainbase and rocksdb. Please note: numbers in it_key and it_value include those in it_next");
 
    try {
@@ -549,8 +622,8 @@ int main(int argc, char* argv[]) {
       }
       if (vmap.count("operation") > 0) {
          args.operation = vmap["operation"].as<std::string>();
-         if (args.operation != "get" && args.operation != "get_data" && args.operation != "set" && args.operation != "create" && args.operation != "erase" && args.operation != "it_create" && args.operation != "it_next" && args.operation != "it_key" && args.operation != "it_value") {
-            std::cerr << "\'--operation\' must be get, get_data, set, create, erase, it_create, it_next, it_key, or it_value" << std::endl;
+         if (args.operation != "get" && args.operation != "get_data" && args.operation != "set" && args.operation != "create" && args.operation != "erase" && args.operation != "it_create" && args.operation != "it_next" && args.operation != "it_key" && args.operation != "it_value" && args.operation != "db_find") {
+            std::cerr << "\'--operation\' must be get, get_data, set, create, erase, it_create, it_next, it_key, it_value, or db_find" << std::endl;
             return 1;
          }
       }
@@ -563,6 +636,24 @@ int main(int argc, char* argv[]) {
       if (vmap.count("num-runs") > 0) {
          args.num_runs = vmap["num-runs"].as<uint64_t>();
       }
+      if (vmap.count("profile") > 0) {
+         args.profile = vmap["profile"].as<std::string>();
+
+         if (args.profile != "default" && args.profile != "table-prefix" && args.profile != "contract-prefix") {
+            std::cerr << "\'--profile\' must be default, table-prefix or contract-prefix" << std::endl;
+            return 1;
+         }
+      }
+      if (vmap.count("block-cache-size-mb") > 0) {
+         args.block_cache_size_mb = vmap["block-cache-size-mb"].as<uint64_t>();
+      }
+      if (vmap.count("num-tables") > 0) {
+         args.num_tables = vmap["num-tables"].as<uint32_t>();
+         if (args.num_tables == 0) {
+            std::cerr << "\'--num-tables\' must be greater than 0" << std::endl;
+            return 1;
+         }
+      }
       if (vmap.count("backing-store") > 0) {
          args.backing_store = vmap["backing-store"].as<std::string>();
 
@@ -587,12 +678,17 @@ int main(int argc, char* argv[]) {
       return 1;
    }
 
-   if ((args.operation == "get" || args.operation == "get_data" || args.operation == "set") && args.workset_file.empty()) {
-      std::cerr << "\'--workset\' is required for get, get_data, and set" << std::endl;
+   if ((args.operation == "get" || args.operation == "get_data" || args.operation == "set" || args.operation == "db_find") && args.workset_file.empty()) {
+      std::cerr << "\'--workset\' is required for get, get_data, set, and db_find" << std::endl;
       cli.print(std::cerr);
       return 1;
    }
 
+   if (args.operation == "db_find" && args.backing_store != "rocksdb") {
+      std::cerr << "db_find is only supported by rocksdb" << std::endl;
+      return 1;
+   }
+
    kv_benchmark::benchmark(args);
 
    return 0;
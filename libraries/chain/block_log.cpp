@@ -7,9 +7,13 @@
 #include <eosio/chain/thread_utils.hpp>
 #include <fc/bitutil.hpp>
 #include <fc/io/raw.hpp>
+#include <fstream>
 #include <future>
 #include <regex>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace eosio { namespace chain {
 
    /**
@@ -398,10 +402,12 @@ namespace eosio { namespace chain {
       block_log_data  log_data;
       block_log_index log_index;
 
-      block_log_bundle(fc::path block_dir) {
-         block_file_name = block_dir / "blocks.log";
-         index_file_name = block_dir / "blocks.index";
+      block_log_bundle(fc::path block_dir)
+          : block_log_bundle(block_dir / "blocks.log", block_dir / "blocks.index") {}
 
+      block_log_bundle(fc::path block_file, fc::path index_file)
+          : block_file_name(std::move(block_file))
+          , index_file_name(std::move(index_file)) {
          log_data.open(block_file_name);
          log_index.open(index_file_name);
 
@@ -546,7 +552,7 @@ namespace eosio { namespace chain {
 
          // create futures for append, must call in order of blocks
          std::future<std::tuple<signed_block_ptr, std::vector<char>>>
-            create_append_future(boost::asio::io_context& thread_pool,
+            create_append_future(named_thread_pool& thread_pool, int priority,
                                  const signed_block_ptr& b, packed_transaction::cf_compression_type segment_compression);
          uint64_t append(std::future<std::tuple<signed_block_ptr, std::vector<char>>> f);
 
@@ -737,16 +743,16 @@ namespace eosio { namespace chain {
    }
 
    std::future<std::tuple<signed_block_ptr, std::vector<char>>>
-   block_log::create_append_future(boost::asio::io_context& thread_pool, const signed_block_ptr& b, packed_transaction::cf_compression_type segment_compression) {
-      return my->create_append_future(thread_pool, b, segment_compression);
+   block_log::create_append_future(named_thread_pool& thread_pool, int priority, const signed_block_ptr& b, packed_transaction::cf_compression_type segment_compression) {
+      return my->create_append_future(thread_pool, priority, b, segment_compression);
    }
 
    std::future<std::tuple<signed_block_ptr, std::vector<char>>>
-   detail::block_log_impl::create_append_future(boost::asio::io_context& thread_pool, const signed_block_ptr& b, packed_transaction::cf_compression_type segment_compression) {
+   detail::block_log_impl::create_append_future(named_thread_pool& thread_pool, int priority, const signed_block_ptr& b, packed_transaction::cf_compression_type segment_compression) {
       future_version = (b->block_num() % stride == 0) ? block_log::max_supported_version : future_version;
       std::promise<std::tuple<signed_block_ptr, std::vector<char>>> p;
       std::future<std::tuple<signed_block_ptr, std::vector<char>>> f = p.get_future();
-      return async_thread_pool( thread_pool, [b, version=future_version, segment_compression]() {
+      return async_thread_pool( thread_pool, priority, [b, version=future_version, segment_compression]() {
          return std::make_tuple(b, create_block_buffer(*b, version, segment_compression));
       } );
    }
@@ -1088,6 +1094,47 @@ namespace eosio { namespace chain {
       return std::clamp(version, min_supported_version, max_supported_version) == version;
    }
 
+   namespace {
+      /// write the blocks of log_bundle from truncate_at_block on as a new block log and index
+      void write_trimmed_front(const block_log_bundle& log_bundle, uint32_t truncate_at_block,
+                               const fc::path& new_block_filename, const fc::path& new_index_filename) {
+         static_assert( block_log::max_supported_version == pruned_transaction_version,
+                        "Code was written to support format of version 4 or lower, need to update this code for latest format." );
+      
+         const auto     preamble_size           = block_log_preamble::nbytes_with_chain_id;
+         const auto     num_blocks_to_truncate  = truncate_at_block - log_bundle.log_data.first_block_num();
+         const uint64_t first_kept_block_pos    = log_bundle.log_index.nth_block_position(num_blocks_to_truncate);
+         const uint64_t nbytes_to_trim          = first_kept_block_pos - preamble_size;
+         const auto     new_block_file_size     = log_bundle.log_data.size() - nbytes_to_trim;
+
+         boost::iostreams::mapped_file_sink new_block_file;
+         create_mapped_file(new_block_file, new_block_filename.generic_string(), new_block_file_size);
+         fc::datastream<char*> ds(new_block_file.data(), new_block_file.size());
+
+         block_log_preamble preamble;
+         // version 4 or above have different log entry format; therefore version 1 to 3 can only be upgrade up to version 3 format.
+         preamble.version         = log_bundle.log_data.version() < pruned_transaction_version ? genesis_state_or_chain_id_version : block_log::max_supported_version;
+         preamble.first_block_num = truncate_at_block;
+         preamble.chain_context   = log_bundle.log_data.chain_id();
+         preamble.write_to(ds);
+
+         memcpy(new_block_file.data() + preamble_size, log_bundle.log_data.data() + first_kept_block_pos, new_block_file_size - preamble_size);
+
+         index_writer index(new_index_filename, log_bundle.log_index.num_blocks() - num_blocks_to_truncate);
+
+         // walk along the block position of each block entry and decrement its value by nbytes_to_trim
+         for (auto itr = make_reverse_block_position_iterator(new_block_file, preamble_size);
+               itr.get_value() != block_log::npos; ++itr) {
+            auto new_pos = itr.get_value() - nbytes_to_trim;
+            index.write(new_pos);
+            itr.set_value(new_pos);
+         }
+
+         index.close();
+         new_block_file.close();
+      }
+   } // namespace
+
    bool block_log::trim_blocklog_front(const fc::path& block_dir, const fc::path& temp_dir, uint32_t truncate_at_block) {
       EOS_ASSERT( block_dir != temp_dir, block_log_exception, "block_dir and temp_dir need to be different directories" );
       
@@ -1108,42 +1155,8 @@ namespace eosio { namespace chain {
       // ****** create the new block log file and write out the header for the file
       fc::create_directories(temp_dir);
       fc::path new_block_filename = temp_dir / "blocks.log";
-   
-      static_assert( block_log::max_supported_version == pruned_transaction_version,
-                     "Code was written to support format of version 4 or lower, need to update this code for latest format." );
-      
-      const auto     preamble_size           = block_log_preamble::nbytes_with_chain_id;
-      const auto     num_blocks_to_truncate  = truncate_at_block - log_bundle.log_data.first_block_num();
-      const uint64_t first_kept_block_pos    = log_bundle.log_index.nth_block_position(num_blocks_to_truncate);
-      const uint64_t nbytes_to_trim          = first_kept_block_pos - preamble_size;
-      const auto     new_block_file_size     = log_bundle.log_data.size() - nbytes_to_trim;
-
-      boost::iostreams::mapped_file_sink new_block_file;
-      create_mapped_file(new_block_file, new_block_filename.generic_string(), new_block_file_size);
-      fc::datastream<char*> ds(new_block_file.data(), new_block_file.size());
-
-      block_log_preamble preamble;
-      // version 4 or above have different log entry format; therefore version 1 to 3 can only be upgrade up to version 3 format.
-      preamble.version         = log_bundle.log_data.version() < pruned_transaction_version ? genesis_state_or_chain_id_version : block_log::max_supported_version;
-      preamble.first_block_num = truncate_at_block;
-      preamble.chain_context   = log_bundle.log_data.chain_id();
-      preamble.write_to(ds);
-
-      memcpy(new_block_file.data() + preamble_size, log_bundle.log_data.data() + first_kept_block_pos, new_block_file_size - preamble_size);
-
       fc::path new_index_filename = temp_dir / "blocks.index";
-      index_writer index(new_index_filename, log_bundle.log_index.num_blocks() - num_blocks_to_truncate);
-
-      // walk along the block position of each block entry and decrement its value by nbytes_to_trim
-      for (auto itr = make_reverse_block_position_iterator(new_block_file, preamble_size);
-            itr.get_value() != block_log::npos; ++itr) {
-         auto new_pos = itr.get_value() - nbytes_to_trim;
-         index.write(new_pos);
-         itr.set_value(new_pos);
-      }
-
-      index.close();
-      new_block_file.close();
+      write_trimmed_front(log_bundle, truncate_at_block, new_block_filename, new_index_filename);
 
       fc::path old_log = temp_dir / "old.log";
       rename(log_bundle.block_file_name, old_log);
@@ -1181,21 +1194,328 @@ namespace eosio { namespace chain {
       return 0;
    }
 
+   namespace {
+      void light_validate_blocks(const block_log_bundle& log_bundle, uint32_t interval) {
+         if (interval == 0) {
+            interval = std::max((log_bundle.log_index.num_blocks() + 7) >> 3, 1);
+         }
+         uint32_t expected_block_num = log_bundle.log_data.first_block_num();
+
+         for (auto pos_itr = log_bundle.log_index.begin(); pos_itr < log_bundle.log_index.end();
+              pos_itr += interval, expected_block_num += interval) {
+            log_bundle.log_data.light_validate_block_entry_at(*pos_itr, expected_block_num);
+         }
+      }
+   } // namespace
+
    void block_log::smoke_test(fc::path block_dir, uint32_t interval) {
 
       block_log_bundle log_bundle(block_dir);
 
       ilog("blocks.log and blocks.index agree on number of blocks");
 
-      if (interval == 0) {
-         interval = std::max((log_bundle.log_index.num_blocks() + 7) >> 3, 1);
+      light_validate_blocks(log_bundle, interval);
+   }
+
+   namespace {
+      struct split_log_file {
+         bfs::path log_path;
+         bool      retained = false; ///< a stride file, otherwise blocks.log
+
+         bfs::path index_path() const { return bfs::path(log_path).replace_extension("index"); }
+      };
+
+      /// the retained stride files ordered by block number followed by blocks.log
+      std::vector<split_log_file> split_log_files(const bfs::path& block_dir, const bfs::path& retained_dir) {
+         const bfs::path dir = retained_dir.empty() ? block_dir : retained_dir.is_relative() ? block_dir / retained_dir : retained_dir;
+
+         std::vector<std::pair<uint32_t, split_log_file>> retained;
+         if (bfs::is_directory(dir)) {
+            for_each_file_in_dir_matches(dir, R"(blocks-\d+-\d+\.log)", [&retained](bfs::path p) {
+               uint32_t first = 0, last = 0;
+               if (sscanf(p.filename().string().c_str(), "blocks-%u-%u.log", &first, &last) == 2)
+                  retained.emplace_back(first, split_log_file{p, true});
+            });
+         }
+         std::sort(retained.begin(), retained.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+         std::vector<split_log_file> files;
+         for (auto& r : retained)
+            files.push_back(std::move(r.second));
+         if (bfs::exists(block_dir / "blocks.log") && bfs::file_size(block_dir / "blocks.log") > 0)
+            files.push_back({block_dir / "blocks.log", false});
+         return files;
+      }
+
+      void remove_split_log_file(const split_log_file& file) {
+         // index first, a log left without index is repaired by the next run
+         bfs::remove(file.index_path());
+         bfs::remove(file.log_path);
+      }
+
+      void fsync_file(const bfs::path& path) {
+         const int fd = ::open(path.c_str(), O_RDONLY);
+         EOS_ASSERT(fd >= 0, block_log_exception, "Unable to open ${path}", ("path", path.generic_string()));
+         const int result = ::fsync(fd);
+         ::close(fd);
+         EOS_ASSERT(result == 0, block_log_exception, "Unable to sync ${path}", ("path", path.generic_string()));
+      }
+
+      /// run f for each file on num_threads threads, then throw an exception listing all files f failed for
+      template <typename F>
+      void for_each_in_parallel(const std::vector<split_log_file>& files, uint32_t num_threads, F&& f) {
+         named_thread_pool              pool("blklog", std::max<uint32_t>(num_threads, 1));
+         std::vector<std::future<void>> futures;
+         for (const auto& file : files)
+            futures.emplace_back(async_thread_pool(pool.get_executor(), [&f, &file]() { f(file); }));
+
+         std::vector<std::string> errors;
+         for (size_t i = 0; i < futures.size(); ++i) {
+            try {
+               futures[i].get();
+            } catch (const fc::exception& e) {
+               errors.push_back(files[i].log_path.generic_string() + ": " + e.to_string());
+            } catch (const std::exception& e) {
+               errors.push_back(files[i].log_path.generic_string() + ": " + e.what());
+            }
+         }
+         EOS_ASSERT(errors.empty(), block_log_exception, "${n} of ${t} block log files failed: ${errors}",
+                    ("n", errors.size())("t", files.size())("errors", errors));
+      }
+
+      /// rebuild the entries of the index of log_path past the last one agreeing with the log
+      /// @return false if the index already agrees with the log
+      bool repair_index(const bfs::path& log_path) {
+         const bfs::path index_path  = bfs::path(log_path).replace_extension("index");
+         block_log_data  log(log_path);
+         const uint32_t  num_blocks  = log.num_blocks();
+         const uint64_t  index_size  = bfs::exists(index_path) ? bfs::file_size(index_path) : 0;
+         const uint32_t  num_entries = index_size / sizeof(uint64_t);
+
+         if (index_size == uint64_t(num_blocks) * sizeof(uint64_t)) {
+            if (num_blocks == 0 || block_log_index(index_path).back() == log.last_block_position())
+               return false;
+         }
+
+         // number of leading entries agreeing with the log, they are kept
+         uint32_t valid = 0;
+         if (index_size % sizeof(uint64_t) == 0 && num_entries > 0 && num_blocks > 0) {
+            block_log_index index(index_path);
+            auto agrees = [&](uint32_t n) {
+               const uint64_t pos = index.nth_block_position(n);
+               return pos >= log.first_block_position() &&
+                      pos + offset_to_block_start(log.version()) + 18 <= log.size() && // 18: up to the block num in previous
+                      log.block_num_at(pos) == log.first_block_num() + n;
+            };
+            const uint32_t last = std::min(num_entries, num_blocks) - 1;
+            if (agrees(last)) {
+               valid = last + 1;
+            } else if (agrees(0)) {
+               // an index is appended to or written at once, so the entries agreeing with the log are a prefix
+               uint32_t lo = 1, hi = last; // agrees(lo - 1) && !agrees(hi)
+               while (lo < hi) {
+                  const uint32_t mid = lo + (hi - lo) / 2;
+                  if (agrees(mid))
+                     lo = mid + 1;
+                  else
+                     hi = mid;
+               }
+               valid = lo;
+            }
+         }
+
+         ilog("Repairing ${index}: keeping ${valid} entries, rebuilding ${n}",
+              ("index", index_path.generic_string())("valid", valid)("n", num_blocks - valid));
+         if (!bfs::exists(index_path))
+            std::ofstream(index_path.generic_string(), std::ios::app);
+         bfs::resize_file(index_path, uint64_t(num_blocks) * sizeof(uint64_t));
+         if (valid < num_blocks) {
+            boost::iostreams::mapped_file_sink index;
+            index.open(index_path.generic_string());
+            uint32_t n = num_blocks;
+            for (auto itr = make_reverse_block_position_iterator(log); itr.get_value() != block_log::npos && n > valid; ++itr) {
+               const uint64_t pos = itr.get_value();
+               --n;
+               memcpy(index.data() + uint64_t(n) * sizeof(uint64_t), &pos, sizeof(pos));
+            }
+            EOS_ASSERT(n == valid, block_log_exception, "${log} contains fewer blocks than its last block number indicates",
+                       ("log", log_path.generic_string()));
+            index.close();
+         }
+         fsync_file(index_path);
+         return true;
       }
-      uint32_t expected_block_num = log_bundle.log_data.first_block_num();
+   } // namespace
+
+   bool block_log::trim_split_log_front(const fc::path& block_dir, const fc::path& retained_dir, const fc::path& archive_dir, uint32_t truncate_at_block) {
+      ilog("In directory ${dir} will trim all blocks before block ${n} in place", ("dir", block_dir.generic_string())("n", truncate_at_block));
 
-      for (auto pos_itr = log_bundle.log_index.begin(); pos_itr < log_bundle.log_index.end();
-           pos_itr += interval, expected_block_num += interval) {
-         log_bundle.log_data.light_validate_block_entry_at(*pos_itr, expected_block_num);
+      // a previous run may have been interrupted between replacing a log file and its index
+      repair_split_log_index(block_dir, retained_dir, 1);
+
+      bfs::path archive = archive_dir;
+      if (!archive.empty()) {
+         if (archive.is_relative())
+            archive = bfs::path(block_dir) / archive;
+         bfs::create_directories(archive);
+      }
+
+      for (const auto& file : split_log_files(block_dir, retained_dir)) {
+         uint32_t first = 0, last = 0;
+         {
+            block_log_data log(file.log_path);
+            if (log.num_blocks() == 0)
+               continue;
+            first = log.first_block_num();
+            last  = log.last_block_num();
+         }
+         // already trimmed, e.g. by an earlier run which was interrupted after its last step
+         if (first >= truncate_at_block)
+            return true;
+
+         if (last < truncate_at_block) {
+            if (!file.retained) {
+               dlog("All blocks are before block ${n} so do nothing (trim front would delete entire blocks.log).", ("n", truncate_at_block));
+               return false;
+            }
+            if (archive.empty()) {
+               remove_split_log_file(file);
+            } else {
+               // index first, a log left without index is repaired by the next run
+               bfs::rename(file.index_path(), archive / file.index_path().filename());
+               bfs::rename(file.log_path, archive / file.log_path.filename());
+            }
+            ilog("${op} ${f}", ("op", archive.empty() ? "Removed" : "Archived")("f", file.log_path.generic_string()));
+            continue;
+         }
+
+         // only the file containing truncate_at_block is rewritten
+         const bfs::path new_log = file.retained ? file.log_path.parent_path() / ("blocks-" + std::to_string(truncate_at_block) + "-" + std::to_string(last) + ".log")
+                                                 : file.log_path;
+         const bfs::path new_index = bfs::path(new_log).replace_extension("index");
+         const bfs::path tmp_log   = new_log.string() + ".tmp";
+         const bfs::path tmp_index = new_index.string() + ".tmp";
+         {
+            block_log_bundle log_bundle(file.log_path, file.index_path());
+            write_trimmed_front(log_bundle, truncate_at_block, tmp_log, tmp_index);
+         }
+         fsync_file(tmp_log);
+         fsync_file(tmp_index);
+         // the log is replaced before its index, an index which does not agree with its log is repaired by the next run
+         bfs::rename(tmp_log, new_log);
+         bfs::rename(tmp_index, new_index);
+         if (file.retained)
+            remove_split_log_file(file);
+         ilog("Rewrote ${f} as ${n}", ("f", file.log_path.generic_string())("n", new_log.generic_string()));
+         return true;
       }
+      return false;
+   }
+
+   int block_log::trim_split_log_end(const fc::path& block_dir, const fc::path& retained_dir, uint32_t n) {
+      ilog("In directory ${dir} will trim all blocks after block ${n} in place", ("dir", block_dir.generic_string())("n", n));
+
+      // a previous run may have been interrupted between truncating a log file and its index
+      repair_split_log_index(block_dir, retained_dir, 1);
+
+      const auto files = split_log_files(block_dir, retained_dir);
+      EOS_ASSERT(!files.empty(), block_log_exception, "No block log found in ${dir}", ("dir", block_dir.generic_string()));
+
+      size_t i           = 0;
+      bool   seen_blocks = false;
+      for (; i < files.size(); ++i) {
+         block_log_bundle log_bundle(files[i].log_path, files[i].index_path());
+         const auto&      log = log_bundle.log_data;
+         if (log.num_blocks() == 0)
+            continue;
+         if (n < log.first_block_num()) {
+            EOS_ASSERT(!seen_blocks, block_log_exception, "Block ${n} is missing from the block log", ("n", n));
+            dlog("All blocks are after block ${n} so do nothing (trim_end would delete entire blocks.log)", ("n", n));
+            return 1;
+         }
+         seen_blocks = true;
+         if (n <= log.last_block_num()) {
+            const uint32_t to_trim_block_index = n + 1 - log.first_block_num();
+            if (to_trim_block_index < log_bundle.log_index.num_blocks())
+               bfs::resize_file(files[i].log_path, log_bundle.log_index.nth_block_position(to_trim_block_index));
+            bfs::resize_file(files[i].index_path(), uint64_t(to_trim_block_index) * sizeof(uint64_t));
+            ilog("${f} has been trimmed after block ${n}", ("f", files[i].log_path.generic_string())("n", n));
+            break;
+         }
+      }
+      if (i == files.size()) {
+         dlog("There are no blocks after block ${n} so do nothing", ("n", n));
+         return 2;
+      }
+
+      // the newest files first, an interruption leaves a contiguous log
+      for (size_t j = files.size() - 1; j > i; --j) {
+         remove_split_log_file(files[j]);
+      }
+      if (files[i].retained) {
+         // the file containing n becomes blocks.log, like log_catalog::truncate
+         bfs::rename(files[i].index_path(), block_dir / "blocks.index");
+         bfs::rename(files[i].log_path, block_dir / "blocks.log");
+      }
+      return 0;
+   }
+
+   uint32_t block_log::repair_split_log_index(const fc::path& block_dir, const fc::path& retained_dir, uint32_t num_threads) {
+      std::atomic<uint32_t> repaired{0};
+      for_each_in_parallel(split_log_files(block_dir, retained_dir), num_threads, [&repaired](const split_log_file& file) {
+         if (repair_index(file.log_path))
+            ++repaired;
+      });
+      return repaired;
+   }
+
+   block_log::verify_stats block_log::verify_split_log(const fc::path& block_dir, const fc::path& retained_dir, uint32_t interval, uint32_t num_threads) {
+      const auto start = fc::time_point::now();
+      const auto files = split_log_files(block_dir, retained_dir);
+      EOS_ASSERT(!files.empty(), block_log_exception, "No block log found in ${dir}", ("dir", block_dir.generic_string()));
+
+      struct file_info {
+         uint32_t                     num_blocks = 0;
+         uint32_t                     first      = 0;
+         uint32_t                     last       = 0;
+         std::optional<chain_id_type> chain_id;
+      };
+      std::vector<file_info> infos(files.size());
+      std::atomic<uint64_t>  blocks{0}, bytes{0};
+
+      for_each_in_parallel(files, num_threads, [&](const split_log_file& file) {
+         block_log_bundle log_bundle(file.log_path, file.index_path());
+         light_validate_blocks(log_bundle, interval);
+
+         auto& info      = infos[&file - files.data()];
+         info.num_blocks = log_bundle.log_data.num_blocks();
+         info.first      = log_bundle.log_data.first_block_num();
+         info.last       = info.num_blocks ? log_bundle.log_data.last_block_num() : 0;
+         info.chain_id   = log_bundle.log_data.chain_id();
+         blocks += info.num_blocks;
+         bytes += log_bundle.log_data.size();
+      });
+
+      const file_info* prev = nullptr;
+      for (size_t i = 0; i < files.size(); ++i) {
+         const auto& info = infos[i];
+         if (info.num_blocks == 0)
+            continue;
+         if (prev) {
+            EOS_ASSERT(info.chain_id == prev->chain_id, block_log_exception, "${f} has a different chain id",
+                       ("f", files[i].log_path.generic_string()));
+            EOS_ASSERT(info.first == prev->last + 1, block_log_exception, "${f} starts at block ${first}, expected block ${expected}",
+                       ("f", files[i].log_path.generic_string())("first", info.first)("expected", prev->last + 1));
+         }
+         prev = &info;
+      }
+
+      verify_stats stats{ static_cast<uint32_t>(files.size()), blocks, bytes, fc::time_point::now() - start };
+      const uint64_t usecs = std::max<int64_t>(stats.elapsed.count(), 1);
+      ilog("Verified ${f} block log files with ${b} blocks (${mb} MiB) in ${ms} ms: ${bps} blocks/s, ${mbps} MiB/s",
+           ("f", stats.files)("b", stats.blocks)("mb", stats.bytes >> 20)("ms", usecs / 1000)
+           ("bps", stats.blocks * 1000000 / usecs)("mbps", (stats.bytes >> 20) * 1000000 / usecs));
+      return stats;
    }
 
    bool block_log::exists(const fc::path& data_dir) {
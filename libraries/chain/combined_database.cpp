@@ -5,11 +5,16 @@
 #include <eosio/chain/kv_chainbase_objects.hpp>
 #include <eosio/chain/backing_store/db_context.hpp>
 #include <eosio/chain/backing_store/db_key_value_format.hpp>
+#include <eosio/chain/backing_store/rocksdb_profile.hpp>
 
 namespace eosio { namespace chain {
-   combined_session::combined_session(chainbase::database& cb_database, eosio::session::undo_stack<rocks_db_type>* undo_stack)
-       : kv_undo_stack{ undo_stack } {
+   combined_session::combined_session(chainbase::database& cb_database, eosio::session::undo_stack<rocks_db_type>* undo_stack,
+                                      transaction_dedup_index* trx_dedup)
+       : kv_undo_stack{ undo_stack }, trx_dedup{ trx_dedup } {
       cb_session = std::make_unique<chainbase::database::session>(cb_database.start_undo_session(true));
+      if (trx_dedup) {
+         trx_dedup->start_session();
+      }
       try {
         try {
             if (kv_undo_stack) {
@@ -22,8 +27,9 @@ namespace eosio { namespace chain {
    }
 
    combined_session::combined_session(combined_session&& src) noexcept
-       : cb_session(std::move(src.cb_session)), kv_undo_stack(src.kv_undo_stack) {
+       : cb_session(std::move(src.cb_session)), kv_undo_stack(src.kv_undo_stack), trx_dedup(src.trx_dedup) {
       src.kv_undo_stack = nullptr;
+      src.trx_dedup = nullptr;
    }
 
    void combined_session::push() {
@@ -34,6 +40,7 @@ namespace eosio { namespace chain {
          if (kv_undo_stack) {
             kv_undo_stack = nullptr;
          }
+         trx_dedup = nullptr;
       }
    }
 
@@ -42,6 +49,11 @@ namespace eosio { namespace chain {
          cb_session->squash();
          cb_session = nullptr;
 
+         if (trx_dedup) {
+            trx_dedup->squash();
+            trx_dedup = nullptr;
+         }
+
          if (kv_undo_stack) {
             try {
                try {
@@ -60,6 +72,17 @@ namespace eosio { namespace chain {
          cb_session->undo();
          cb_session = nullptr;
 
+         if (trx_dedup) {
+            try {
+               try {
+                  trx_dedup->undo();
+                  trx_dedup = nullptr;
+               }
+               FC_LOG_AND_RETHROW()
+            }
+            CATCH_AND_EXIT_DB_FAILURE()
+         }
+
          if (kv_undo_stack) {
             try {
                try {
@@ -206,24 +229,8 @@ namespace eosio { namespace chain {
             // smaller ones that are run simultaneously.
             options.max_subcompactions = cfg.persistent_storage_num_threads;
 
-            // Full and partitioned filters in the block-based table
-            // use an improved Bloom filter implementation, enabled
-            // with format_version 5 (or above) because previous
-            // releases cannot read this filter. This replacement is
-            // faster and more accurate, especially for high bits
-            // per key or millions of keys in a single (full) filter.
-            rocksdb::BlockBasedTableOptions table_options;
-            table_options.format_version               = 5;
-            table_options.index_block_restart_interval = 16;
-
-            // Sets the bloom filter - Given an arbitrary key, 
-            // this bit array may be used to determine if the key 
-            // may exist or definitely does not exist in the key set.
-	          table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(15, false));
-	          table_options.index_type = rocksdb::BlockBasedTableOptions::kBinarySearch;
-
-            // Incorporates the Table options into options
-            options.table_factory.reset(NewBlockBasedTableFactory(table_options));
+            // Bloom filters, index layout and block cache, see persistent-storage-profile
+            backing_store::configure_persistent_storage_profile(options, cfg.persistent_storage_profile, cfg.persistent_storage_block_cache_size);
 
             rocksdb::DB* p;
             auto         status = rocksdb::DB::Open(options, (cfg.state_dir / "chain-kv").string(), &p);
@@ -254,13 +261,24 @@ namespace eosio { namespace chain {
 
       fc::remove( p / "shared_memory.bin" );
       fc::remove( p / "shared_memory.meta" );
+      fc::remove( p / transaction_dedup_index::file_name );
 
       rocks_db_type::destroy((p / "chain-kv").string());
    }
 
+   void combined_database::enable_transaction_dedup_index() {
+      EOS_ASSERT(!trx_dedup, database_exception, "transaction dedup index already enabled");
+      trx_dedup = std::make_unique<transaction_dedup_index>();
+      trx_dedup->set_revision(db.revision());
+   }
+
    void combined_database::set_revision(uint64_t revision) {
       db.set_revision(revision);
 
+      if (trx_dedup) {
+         trx_dedup->set_revision(revision);
+      }
+
       if (backing_store == backing_store_type::ROCKSDB) {
          try {
             try {
@@ -289,6 +307,16 @@ namespace eosio { namespace chain {
    void combined_database::undo() {
       db.undo();
 
+      if (trx_dedup) {
+         try {
+            try {
+               trx_dedup->undo();
+            }
+            FC_LOG_AND_RETHROW()
+         }
+         CATCH_AND_EXIT_DB_FAILURE()
+      }
+
       if (backing_store == backing_store_type::ROCKSDB) {
          try {
             try {
@@ -303,6 +331,10 @@ namespace eosio { namespace chain {
    void combined_database::commit(int64_t revision) {
       db.commit(revision);
 
+      if (trx_dedup) {
+         trx_dedup->commit(revision);
+      }
+
       if (backing_store == backing_store_type::ROCKSDB) {
          try {
             try {
@@ -366,6 +398,16 @@ namespace eosio { namespace chain {
 
          snapshot->write_section<value_t>([utils, this](auto& section) {
             walk_index(utils, db, [this, &section](const auto& row) { section.add_row(row, db); });
+
+            // ids kept out of the transaction_multi_index are written as transaction_object rows. While the dedup
+            // index is enabled no transaction_object is created, so the rows of the transaction_multi_index are all
+            // older than the ones of the dedup index and the section lists them in the same order as a node that
+            // kept every id in the transaction_multi_index
+            if constexpr (std::is_same_v<value_t, transaction_object>) {
+               if (trx_dedup) {
+                  trx_dedup->walk([this, &section](const transaction_dedup_index::row& row) { section.add_row(row, db); });
+               }
+            }
          });
       });
 
@@ -2,6 +2,7 @@
 #include <eosio/chain/transaction_context.hpp>
 
 #include <eosio/chain/block_log.hpp>
+#include <eosio/chain/reversible_block_journal.hpp>
 #include <eosio/chain/fork_database.hpp>
 #include <eosio/chain/exceptions.hpp>
 
@@ -152,6 +153,7 @@ struct controller_impl {
    std::function<void()>               shutdown;
    chainbase::database                 db;
    chainbase::database                 reversible_blocks; ///< a special database to persist blocks that have successfully been applied but are still reversible
+   std::optional<reversible_block_journal> reversible_journal; ///< replaces reversible_blocks when conf.reversible_blocks_journal
    combined_database                   kv_db;
    block_log                           blog;
    std::optional<pending_state>        pending;
@@ -168,7 +170,9 @@ struct controller_impl {
    bool                                in_trx_requiring_checks = false; ///< if true, checks that are normally skipped on replay (e.g. auth checks) cannot be skipped
    std::optional<fc::microseconds>     subjective_cpu_leeway;
    bool                                trusted_producer_light_validation = false;
+   bool                                trace_consumers = true; ///< if false, traces of validated blocks are only needed for consensus
    uint32_t                            snapshot_head_block = 0;
+   bool                                transaction_dedup_index_open = false; ///< the dedup index holds the ids of the state database and is written on shutdown
    named_thread_pool                   thread_pool;
    platform_timer                      timer;
    fc::logger*                         deep_mind_logger = nullptr;
@@ -188,10 +192,7 @@ struct controller_impl {
          prev = fork_db.root();
       }
 
-      if( const auto* b = reversible_blocks.find<reversible_block_object,by_num>(head->block_num) )
-      {
-         reversible_blocks.remove( *b );
-      }
+      remove_reversible_blocks_after( head->block_num - 1 );
 
       if ( read_mode == db_read_mode::SPECULATIVE ) {
          EOS_ASSERT( head->block, block_validate_exception, "attempting to pop a block that was sparsely loaded from a snapshot");
@@ -244,7 +245,7 @@ struct controller_impl {
     conf( cfg ),
     chain_id( chain_id ),
     read_mode( cfg.read_mode ),
-    thread_pool( "chain", cfg.thread_pool_size )
+    thread_pool( "chain", cfg.thread_pool_size, cfg.thread_pool_cpus )
    {
       fork_db.open( [this]( block_timestamp_type timestamp,
                             const flat_set<digest_type>& cur_features,
@@ -266,6 +267,10 @@ struct controller_impl {
          wasmif.current_lib(bsp->block_num);
       });
 
+      if( cfg.transaction_dedup_index ) {
+         kv_db.enable_transaction_dedup_index();
+      }
+
 #define SET_APP_HANDLER( receiver, contract, action) \
    set_apply_handler( account_name(#receiver), account_name(#contract), action_name(#action), \
                       &BOOST_PP_CAT(apply_, BOOST_PP_CAT(contract, BOOST_PP_CAT(_,action) ) ) )
@@ -341,12 +346,10 @@ struct controller_impl {
 
       auto branch = fork_db.fetch_branch( fork_head->id, fork_head->dpos_irreversible_blocknum );
       try {
-         const auto& rbi = reversible_blocks.get_index<reversible_block_index,by_num>();
-
          std::vector<std::future<std::tuple<signed_block_ptr, std::vector<char>>>> v;
          v.reserve( branch.size() );
          for( auto bitr = branch.rbegin(); bitr != branch.rend(); ++bitr ) {
-            v.emplace_back( blog.create_append_future( thread_pool.get_executor(), (*bitr)->block,
+            v.emplace_back( blog.create_append_future( thread_pool, named_thread_pool::priority::medium, (*bitr)->block,
                                                        packed_transaction::cf_compression_type::none ) );
          }
          auto it = v.begin();
@@ -368,11 +371,7 @@ struct controller_impl {
             kv_db.commit( (*bitr)->block_num );
             root_id = (*bitr)->id;
 
-            auto rbitr = rbi.begin();
-            while( rbitr != rbi.end() && rbitr->blocknum <= (*bitr)->block_num ) {
-               reversible_blocks.remove( *rbitr );
-               rbitr = rbi.begin();
-            }
+            remove_reversible_blocks_through( (*bitr)->block_num );
          }
       } catch( std::exception& ) {
          if( root_id != fork_db.root()->id ) {
@@ -387,7 +386,7 @@ struct controller_impl {
       }
 
       // delete branch in thread pool
-      boost::asio::post( thread_pool.get_executor(), [branch{std::move(branch)}]() {} );
+      thread_pool.post( named_thread_pool::priority::low, [branch{std::move(branch)}]() {} );
    }
 
    /**
@@ -466,10 +465,10 @@ struct controller_impl {
 
       if( !except_ptr && !check_shutdown() ) {
          int rev = 0;
-         while( auto obj = reversible_blocks.find<reversible_block_object,by_num>(head->block_num+1) ) {
+         while( auto b = fetch_reversible_block( head->block_num+1 ) ) {
             if( check_shutdown() ) break;
             ++rev;
-            replay_push_block( obj->get_block(), controller::block_status::validated );
+            replay_push_block( b, controller::block_status::validated );
          }
          ilog( "${n} reversible blocks replayed", ("n",rev) );
       }
@@ -621,6 +620,7 @@ struct controller_impl {
       }
 
       kv_db.check_backing_store_setting( clean_startup );
+      open_transaction_dedup_index( clean_startup );
 
       // At this point head != nullptr && fork_db.head() != nullptr && fork_db.root() != nullptr.
       // Furthermore, fork_db.root()->block_num <= lib_num.
@@ -641,31 +641,29 @@ struct controller_impl {
 
       protocol_features.init( db );
 
-      const auto& rbi = reversible_blocks.get_index<reversible_block_index,by_num>();
+      open_reversible_blocks();
+
       auto last_block_num = lib_num;
 
       if( read_mode == db_read_mode::IRREVERSIBLE ) {
          // ensure there are no reversible blocks
-         auto itr = rbi.begin();
-         if( itr != rbi.end() ) {
+         if( first_reversible_block_num() ) {
             wlog( "read_mode has changed to irreversible: erasing reversible blocks" );
          }
-         for( ; itr != rbi.end(); itr = rbi.begin() )
-            reversible_blocks.remove( *itr );
+         remove_reversible_blocks_after( 0 );
       } else {
-         auto itr = rbi.begin();
-         for( ; itr != rbi.end() && itr->blocknum <= lib_num; itr = rbi.begin() )
-            reversible_blocks.remove( *itr );
+         remove_reversible_blocks_through( lib_num );
 
-         EOS_ASSERT( itr == rbi.end() || itr->blocknum == lib_num + 1, reversible_blocks_exception,
+         const auto first_reversible = first_reversible_block_num();
+         EOS_ASSERT( !first_reversible || *first_reversible == lib_num + 1, reversible_blocks_exception,
                      "gap exists between last irreversible block (${lib}) and first reversible block (${first_reversible_block_num})",
-                     ("lib", lib_num)("first_reversible_block_num", itr->blocknum)
+                     ("lib", lib_num)("first_reversible_block_num", *first_reversible)
          );
 
-         auto ritr = rbi.rbegin();
+         const auto last_reversible = last_reversible_block_num();
 
-         if( ritr != rbi.rend() ) {
-            last_block_num = ritr->blocknum;
+         if( last_reversible ) {
+            last_block_num = *last_reversible;
          }
 
          EOS_ASSERT( head->block_num <= last_block_num, reversible_blocks_exception,
@@ -675,24 +673,23 @@ struct controller_impl {
 
          auto pending_head = fork_db.pending_head();
 
-         if( ritr != rbi.rend()
+         if( last_reversible
              && lib_num < pending_head->block_num
              && pending_head->block_num <= last_block_num
          ) {
-            auto rbitr = rbi.find( pending_head->block_num );
-            EOS_ASSERT( rbitr != rbi.end(), reversible_blocks_exception, "pending head block not found in reversible blocks");
-            auto rev_id = rbitr->get_block_id();
-            EOS_ASSERT( rev_id == pending_head->id,
+            auto rev_id = reversible_block_id( pending_head->block_num );
+            EOS_ASSERT( rev_id, reversible_blocks_exception, "pending head block not found in reversible blocks");
+            EOS_ASSERT( *rev_id == pending_head->id,
                         reversible_blocks_exception,
                         "mismatch in block id of pending head block ${num} in reversible blocks database: "
                         "expected: ${expected}, actual: ${actual}",
-                        ("num", pending_head->block_num)("expected", pending_head->id)("actual", rev_id)
+                        ("num", pending_head->block_num)("expected", pending_head->id)("actual", *rev_id)
             );
-         } else if( ritr != rbi.rend() && last_block_num < pending_head->block_num ) {
+         } else if( last_reversible && last_block_num < pending_head->block_num ) {
             const auto b = fork_db.search_on_branch( pending_head->id, last_block_num );
             FC_ASSERT( b, "unexpected violation of invariants" );
-            auto rev_id = ritr->get_block_id();
-            EOS_ASSERT( rev_id == b->id,
+            auto rev_id = reversible_block_id( last_block_num );
+            EOS_ASSERT( rev_id && *rev_id == b->id,
                         reversible_blocks_exception,
                         "mismatch in block id of last block (${num}) in reversible blocks database: "
                         "expected: ${expected}, actual: ${actual}",
@@ -747,6 +744,166 @@ struct controller_impl {
    ~controller_impl() {
       thread_pool.stop();
       pending.reset();
+      close_transaction_dedup_index();
+   }
+
+   /**
+    *  Reads the transaction dedup index written on the last shutdown. Since it is not part of the shared memory
+    *  state, it has to be at the same revision as the state database, including the undo layers of the reversible
+    *  blocks. The file stays in the state directory for as long as the state database keeps ids in it, so its
+    *  presence marks where the ids are and a missing or stale file stops the startup instead of silently forgetting
+    *  them. Like the backing store, the setting can only be changed with a new state database; ids loaded from a
+    *  snapshot stay in the transaction_multi_index until they expire.
+    */
+   void open_transaction_dedup_index( bool clean_startup ) {
+      const auto path = conf.state_dir / transaction_dedup_index::file_name;
+      auto* trx_dedup = kv_db.get_transaction_dedup_index();
+      if( clean_startup ) {
+         if( trx_dedup ) {
+            trx_dedup->set_revision( db.revision() );
+            if( !conf.read_only ) trx_dedup->write( path );
+            transaction_dedup_index_open = true;
+         } else if( fc::exists( path ) ) {
+            fc::remove( path );
+         }
+         return;
+      }
+
+      if( !trx_dedup ) {
+         EOS_ASSERT( !fc::exists( path ), database_exception,
+                     "Existing state keeps input transaction ids in ${p}; use replay or restore from snapshot to disable "
+                     "the transaction dedup index", ("p", path.generic_string()) );
+         return;
+      }
+
+      EOS_ASSERT( fc::exists( path ), database_exception,
+                  "Existing state does not keep input transaction ids in ${p}; use replay or restore from snapshot to "
+                  "enable the transaction dedup index or to recover a lost file", ("p", path.generic_string()) );
+      trx_dedup->read( path );
+      EOS_ASSERT( trx_dedup->revision() == db.revision(), database_revision_mismatch_exception,
+                  "chainbase is at revision ${a}, but the transaction dedup index ${p} is at revision ${b}; "
+                  "use replay or restore from snapshot to recover",
+                  ("a", db.revision())("b", trx_dedup->revision())("p", path.generic_string()) );
+      ilog( "loaded ${n} unexpired transaction ids from ${p}", ("n", trx_dedup->size())("p", path.generic_string()) );
+      transaction_dedup_index_open = true;
+   }
+
+   /// losing the ids would let transactions be applied twice, so failing to write them is fatal
+   void close_transaction_dedup_index() {
+      auto* trx_dedup = kv_db.get_transaction_dedup_index();
+      if( !trx_dedup || !transaction_dedup_index_open || conf.read_only ) return;
+      try {
+         try {
+            EOS_ASSERT( trx_dedup->revision() == db.revision(), database_revision_mismatch_exception,
+                        "chainbase is at revision ${a}, but the transaction dedup index is at revision ${b}",
+                        ("a", db.revision())("b", trx_dedup->revision()) );
+            trx_dedup->write( conf.state_dir / transaction_dedup_index::file_name );
+         } FC_LOG_AND_RETHROW()
+      } CATCH_AND_EXIT_DB_FAILURE()
+   }
+
+   /**
+    *  Opens the reversible block journal when configured and moves reversible blocks over from the storage that
+    *  was used before, so that switching between the two does not lose the blocks needed for recovery.
+    */
+   void open_reversible_blocks() {
+      const auto dir = conf.blog.log_dir / config::reversible_blocks_dir_name;
+      const auto& rbi = reversible_blocks.get_index<reversible_block_index,by_num>();
+      if( conf.reversible_blocks_journal ) {
+         reversible_journal.emplace( dir );
+         if( rbi.begin() != rbi.end() ) {
+            if( reversible_journal->empty() ) {
+               ilog( "moving ${n} reversible blocks into the reversible block journal", ("n", rbi.size()) );
+               for( const auto& obj : rbi ) {
+                  auto b = obj.get_block();
+                  reversible_journal->append( *b, b->calculate_id() );
+               }
+            }
+            for( auto itr = rbi.begin(); itr != rbi.end(); itr = rbi.begin() )
+               reversible_blocks.remove( *itr );
+         }
+      } else if( reversible_block_journal::exists( dir ) ) {
+         {
+            reversible_block_journal journal( dir );
+            if( !journal.empty() && rbi.begin() == rbi.end() ) {
+               ilog( "moving ${n} reversible blocks out of the reversible block journal", ("n", journal.size()) );
+               for( uint32_t n = journal.first_block_num(); n <= journal.last_block_num(); ++n ) {
+                  auto b = journal.read_block( n );
+                  reversible_blocks.create<reversible_block_object>( [&]( auto& ubo ) {
+                     ubo.blocknum = n;
+                     ubo.set_block( b );
+                  });
+               }
+            }
+         }
+         fc::remove( dir / reversible_block_journal::file_name );
+      }
+   }
+
+   void add_reversible_block( const block_state_ptr& bsp ) {
+      if( reversible_journal ) {
+         reversible_journal->append( *bsp->block, bsp->id );
+         return;
+      }
+      reversible_blocks.create<reversible_block_object>( [&]( auto& ubo ) {
+         ubo.blocknum = bsp->block_num;
+         ubo.set_block( bsp->block );
+      });
+   }
+
+   void remove_reversible_blocks_after( uint32_t block_num ) {
+      if( reversible_journal ) {
+         reversible_journal->remove_after( block_num );
+         return;
+      }
+      const auto& rbi = reversible_blocks.get_index<reversible_block_index,by_num>();
+      for( auto itr = rbi.upper_bound( block_num ); itr != rbi.end(); itr = rbi.upper_bound( block_num ) )
+         reversible_blocks.remove( *itr );
+   }
+
+   void remove_reversible_blocks_through( uint32_t block_num ) {
+      if( reversible_journal ) {
+         reversible_journal->remove_through( block_num );
+         return;
+      }
+      const auto& rbi = reversible_blocks.get_index<reversible_block_index,by_num>();
+      for( auto itr = rbi.begin(); itr != rbi.end() && itr->blocknum <= block_num; itr = rbi.begin() )
+         reversible_blocks.remove( *itr );
+   }
+
+   std::optional<uint32_t> first_reversible_block_num()const {
+      if( reversible_journal ) {
+         if( reversible_journal->empty() ) return {};
+         return reversible_journal->first_block_num();
+      }
+      const auto& rbi = reversible_blocks.get_index<reversible_block_index,by_num>();
+      if( rbi.begin() == rbi.end() ) return {};
+      return rbi.begin()->blocknum;
+   }
+
+   std::optional<uint32_t> last_reversible_block_num()const {
+      if( reversible_journal ) {
+         if( reversible_journal->empty() ) return {};
+         return reversible_journal->last_block_num();
+      }
+      const auto& rbi = reversible_blocks.get_index<reversible_block_index,by_num>();
+      if( rbi.rbegin() == rbi.rend() ) return {};
+      return rbi.rbegin()->blocknum;
+   }
+
+   std::optional<block_id_type> reversible_block_id( uint32_t block_num )const {
+      if( reversible_journal ) return reversible_journal->block_id( block_num );
+      const auto& rbi = reversible_blocks.get_index<reversible_block_index,by_num>();
+      auto itr = rbi.find( block_num );
+      if( itr == rbi.end() ) return {};
+      return itr->get_block_id();
+   }
+
+   signed_block_ptr fetch_reversible_block( uint32_t block_num )const {
+      if( reversible_journal ) return reversible_journal->read_block( block_num );
+      if( const auto* obj = reversible_blocks.find<reversible_block_object,by_num>( block_num ) )
+         return obj->get_block();
+      return {};
    }
 
    void add_indices() {
@@ -1271,6 +1428,8 @@ struct controller_impl {
          trx_context.explicit_billed_cpu_time = explicit_billed_cpu_time;
          trx_context.billed_cpu_time_us = billed_cpu_time_us;
          trx_context.subjective_cpu_bill_us = subjective_cpu_bill_us;
+         // speculative and produced transactions hand their trace back to the caller
+         trx_context.compact_notification_traces = !trace_consumers && pending->_block_status != controller::block_status::incomplete;
          trace = trx_context.trace;
 
          auto handle_exception =[&](const auto& e)
@@ -1279,6 +1438,9 @@ struct controller_impl {
             trace->except = e;
             trace->except_ptr = std::current_exception();
             trace->elapsed = fc::time_point::now() - trx_context.start;
+            if( trx_context.compact_notification_traces ) {
+               materialize_action_traces( *trace );
+            }
          };
 
          try {
@@ -1543,14 +1705,14 @@ struct controller_impl {
 
       auto& bb = std::get<building_block>(pending->_block_stage);
 
-      auto action_merkle_fut = async_thread_pool( thread_pool.get_executor(),
+      auto action_merkle_fut = async_thread_pool( thread_pool, named_thread_pool::priority::high,
                                                   [ids{std::move( bb._action_receipt_digests )}]() mutable {
                                                      return merkle( std::move( ids ) );
                                                   } );
       const bool calc_trx_merkle = !std::holds_alternative<checksum256_type>(bb._trx_mroot_or_receipt_digests);
       std::future<checksum256_type> trx_merkle_fut;
       if( calc_trx_merkle ) {
-         trx_merkle_fut = async_thread_pool( thread_pool.get_executor(),
+         trx_merkle_fut = async_thread_pool( thread_pool, named_thread_pool::priority::high,
                                              [ids{std::move( std::get<digests_t>(bb._trx_mroot_or_receipt_digests) )}]() mutable {
                                                 return merkle( std::move( ids ) );
                                              } );
@@ -1628,10 +1790,7 @@ struct controller_impl {
          }
 
          if( !replay_head_time && read_mode != db_read_mode::IRREVERSIBLE ) {
-            reversible_blocks.create<reversible_block_object>( [&]( auto& ubo ) {
-               ubo.blocknum = bsp->block_num;
-               ubo.set_block( bsp->block );
-            });
+            add_reversible_block( bsp );
          }
 
          emit( self.accepted_block, bsp );
@@ -1747,7 +1906,7 @@ struct controller_impl {
                   } else {
                      packed_transaction_ptr ptrx( b, &pt ); // alias signed_block_ptr
                      auto fut = transaction_metadata::start_recover_keys(
-                           std::move( ptrx ), thread_pool.get_executor(), chain_id, microseconds::maximum() );
+                           std::move( ptrx ), thread_pool, named_thread_pool::priority::medium, chain_id, microseconds::maximum() );
                      trx_metas.emplace_back( transaction_metadata_ptr{}, std::move( fut ) );
                   }
                }
@@ -1842,7 +2001,8 @@ struct controller_impl {
       EOS_ASSERT( prev, unlinkable_block_exception,
                   "unlinkable block ${id}", ("id", id)("previous", b->previous) );
 
-      return async_thread_pool( thread_pool.get_executor(), [b, prev, id, control=this]() {
+      // block signature recovery gates relaying and applying the block, let it overtake queued transaction work
+      return async_thread_pool( thread_pool, named_thread_pool::priority::high, [b, prev, id, control=this]() {
          const bool skip_validate_signee = false;
 
          auto trx_mroot = calculate_trx_merkle( b->transactions );
@@ -2122,6 +2282,9 @@ struct controller_impl {
       while( (!dedupe_index.empty()) && ( now > fc::time_point(dedupe_index.begin()->expiration) ) ) {
          transaction_idx.remove(*dedupe_index.begin());
       }
+      if( auto* trx_dedup = kv_db.get_transaction_dedup_index() ) {
+         trx_dedup->remove_expired( now );
+      }
    }
 
    bool sender_avoids_whitelist_blacklist_enforcement( account_name sender )const {
@@ -2390,6 +2553,10 @@ eosio::chain::combined_database& controller::kv_db() const { return my->kv_db; }
 
 const chainbase::database& controller::reversible_db()const { return my->reversible_blocks; }
 
+const reversible_block_journal* controller::reversible_journal()const {
+   return my->reversible_journal ? &*my->reversible_journal : nullptr;
+}
+
 void controller::preactivate_feature( uint32_t action_id, const digest_type& feature_digest ) {
    const auto& pfs = my->protocol_features.get_protocol_feature_set();
    auto cur_time = pending_block_time();
@@ -2804,10 +2971,9 @@ block_state_ptr controller::fetch_block_state_by_id( block_id_type id )const {
 }
 
 block_state_ptr controller::fetch_block_state_by_number( uint32_t block_num )const  { try {
-   const auto& rev_blocks = my->reversible_blocks.get_index<reversible_block_index,by_num>();
-   auto objitr = rev_blocks.find(block_num);
+   auto rev_id = my->reversible_block_id( block_num );
 
-   if( objitr == rev_blocks.end() ) {
+   if( !rev_id ) {
       if( my->read_mode == db_read_mode::IRREVERSIBLE ) {
          return my->fork_db.search_on_branch( my->fork_db.pending_head()->id, block_num );
       } else {
@@ -2815,7 +2981,7 @@ block_state_ptr controller::fetch_block_state_by_number( uint32_t block_num )con
       }
    }
 
-   return my->fork_db.get_block( objitr->get_block_id() );
+   return my->fork_db.get_block( *rev_id );
 } FC_CAPTURE_AND_RETHROW( (block_num) ) }
 
 block_id_type controller::get_block_id_for_num( uint32_t block_num )const { try {
@@ -2830,10 +2996,8 @@ block_id_type controller::get_block_id_for_num( uint32_t block_num )const { try
 
    if( !find_in_blog ) {
       if( my->read_mode != db_read_mode::IRREVERSIBLE ) {
-         const auto& rev_blocks = my->reversible_blocks.get_index<reversible_block_index,by_num>();
-         auto objitr = rev_blocks.find(block_num);
-         if( objitr != rev_blocks.end() ) {
-            return objitr->get_block_id();
+         if( auto rev_id = my->reversible_block_id( block_num ) ) {
+            return *rev_id;
          }
       } else {
          auto bsp = my->fork_db.search_on_branch( my->fork_db.pending_head()->id, block_num );
@@ -3133,9 +3297,19 @@ bool controller::is_builtin_activated( builtin_protocol_feature_t f )const {
 }
 
 bool controller::is_known_unexpired_transaction( const transaction_id_type& id) const {
+   if( auto* trx_dedup = my->kv_db.get_transaction_dedup_index(); trx_dedup && trx_dedup->contains(id) )
+      return true;
    return db().find<transaction_object, by_trx_id>(id);
 }
 
+void controller::set_trace_consumers( bool has_consumers ) {
+   my->trace_consumers = has_consumers;
+}
+
+bool controller::has_trace_consumers()const {
+   return my->trace_consumers;
+}
+
 void controller::set_subjective_cpu_leeway(fc::microseconds leeway) {
    my->subjective_cpu_leeway = leeway;
 }
@@ -2,6 +2,7 @@
 #include <eosio/chain/abi_def.hpp>
 #include <eosio/chain/trace.hpp>
 #include <eosio/chain/exceptions.hpp>
+#include <memory>
 #include <utility>
 #include <fc/variant_object.hpp>
 #include <fc/scoped_exit.hpp>
@@ -22,6 +23,8 @@ namespace impl {
    struct abi_traverse_context_with_path;
    struct binary_to_variant_context;
    struct variant_to_binary_context;
+
+   struct binary_to_variant_plan;
 }
 
 /**
@@ -35,6 +38,10 @@ struct abi_serializer {
 
    abi_serializer(){ configure_built_in_types(); }
    abi_serializer( const abi_def& abi, const yield_function_t& yield );
+   abi_serializer( const abi_serializer& other );
+   abi_serializer( abi_serializer&& ) = default;
+   abi_serializer& operator=( const abi_serializer& other );
+   abi_serializer& operator=( abi_serializer&& ) = default;
    void set_abi( const abi_def& abi, const yield_function_t& yield );
 
    /// @return string_view of `t` or internal string type
@@ -128,10 +135,19 @@ private:
    map<type_name, pair<unpack_function, pack_function>, std::less<>> built_in_types;
    void configure_built_in_types();
 
+   /// types of the ABI compiled into index addressed entries, so binary_to_variant does not resolve type names for
+   /// every value; refers to the definitions above, so a copy of the abi_serializer compiles a plan of its own while
+   /// a move keeps the plan with the definitions
+   std::shared_ptr<const impl::binary_to_variant_plan> binary_to_variant_plan;
+   void compile_binary_to_variant_plan( impl::abi_traverse_context& ctx );
+
    fc::variant _binary_to_variant( const std::string_view& type, const bytes& binary, impl::binary_to_variant_context& ctx )const;
    fc::variant _binary_to_variant( const std::string_view& type, fc::datastream<const char*>& binary, impl::binary_to_variant_context& ctx )const;
    void        _binary_to_variant( const std::string_view& type, fc::datastream<const char*>& stream,
                                    fc::mutable_variant_object& obj, impl::binary_to_variant_context& ctx )const;
+   /// uses binary_to_variant_plan if the type is part of the ABI, otherwise the type name resolving conversion above
+   fc::variant _binary_to_variant_planned( const std::string_view& type, fc::datastream<const char*>& stream,
+                                           impl::binary_to_variant_context& ctx )const;
 
    bytes       _variant_to_binary( const std::string_view& type, const fc::variant& var, impl::variant_to_binary_context& ctx )const;
    void        _variant_to_binary( const std::string_view& type, const fc::variant& var,
@@ -158,6 +174,7 @@ namespace impl {
 
       void check_deadline()const { yield( recursion_depth ); }
       abi_serializer::yield_function_t get_yield_function() { return yield; }
+      size_t get_recursion_depth()const { return recursion_depth; }
 
       fc::scoped_exit<std::function<void()>> enter_scope();
 
@@ -227,6 +244,8 @@ namespace impl {
       string maybe_shorten( const std::string_view& str );
 
    protected:
+      friend struct binary_to_variant_plan; // keeps the path without the std::function of push_to_path
+
       const abi_serializer&  abis;
       path_root              root_of_path;
       vector<path_item>      path;
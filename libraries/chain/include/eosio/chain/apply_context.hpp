@@ -6,6 +6,7 @@
 #include <eosio/chain/backing_store/db_context.hpp>
 #include <eosio/chain/backing_store/db_chainbase_iter_store.hpp>
 #include <eosio/chain/backing_store/db_secondary_key_helper.hpp>
+#include <eosio/chain/monotonic_arena.hpp>
 #include <fc/utility.hpp>
 #include <sstream>
 #include <algorithm>
@@ -472,6 +473,7 @@ class apply_context {
    private:
       const action*                 act = nullptr; ///< action being applied
       // act pointer may be invalidated on call to trx_context.schedule_action
+      // act always points into the trace of the first receiver, notification traces may be compact
       account_name                  receiver; ///< the code that is currently running
       uint32_t                      recurse_depth; ///< how deep inline actions can recurse
       uint32_t                      first_receiver_action_ordinal = 0;
@@ -488,15 +490,16 @@ class apply_context {
       generic_index<index_long_double_object>                        idx_long_double;
 
       std::unique_ptr<kv_context>                                    kv_backing_store;
-      std::vector<std::unique_ptr<kv_iterator>>                      kv_iterators;
-      std::vector<size_t>                                            kv_destroyed_iterators;
+      arena_vector<std::unique_ptr<kv_iterator>>                     kv_iterators;
+      arena_vector<size_t>                                           kv_destroyed_iterators;
 
    private:
 
       backing_store::db_chainbase_iter_store<key_value_object> db_iter_store;
-      vector< std::pair<account_name, uint32_t> >              _notified; ///< keeps track of new accounts to be notifed of current message
-      vector<uint32_t>                                         _inline_actions; ///< action_ordinals of queued inline actions
-      vector<uint32_t>                                         _cfa_inline_actions; ///< action_ordinals of queued inline context-free actions
+      // the following are allocated from the arena of the transaction context
+      arena_vector< std::pair<account_name, uint32_t> >        _notified; ///< keeps track of new accounts to be notifed of current message
+      arena_vector<uint32_t>                                   _inline_actions; ///< action_ordinals of queued inline actions
+      arena_vector<uint32_t>                                   _cfa_inline_actions; ///< action_ordinals of queued inline context-free actions
       std::string                                              _pending_console_output;
       flat_set<account_delta>                                  _account_ram_deltas; ///< flat_set of account_delta so json is an array of objects
 
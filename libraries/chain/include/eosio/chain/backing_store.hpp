@@ -10,6 +10,13 @@ namespace eosio { namespace chain {
       ROCKSDB
    };
 
+   // How RocksDB tables of the persistent storage are laid out, see configure_persistent_storage_profile
+   enum class persistent_storage_profile {
+      DEFAULT,         // whole-key bloom filters and a binary search index
+      TABLE_PREFIX,    // prefix bloom filters on contract/scope/table, partitioned index and filters
+      CONTRACT_PREFIX  // prefix bloom filters on the contract, partitioned index and filters
+   };
+
 }} // namespace eosio::chain
 
 namespace fc {
@@ -26,4 +33,18 @@ inline void from_variant(const fc::variant& v, eosio::chain::backing_store_type&
    }
    throw std::runtime_error("Invalid backing store name: " + v.as_string());
 }
+template <>
+inline void to_variant(const eosio::chain::persistent_storage_profile& profile, fc::variant& v) {
+   v = (uint64_t)profile;
+}
+template <>
+inline void from_variant(const fc::variant& v, eosio::chain::persistent_storage_profile& profile) {
+   switch (profile = (eosio::chain::persistent_storage_profile)v.as_uint64()) {
+      case eosio::chain::persistent_storage_profile::DEFAULT:
+      case eosio::chain::persistent_storage_profile::TABLE_PREFIX:
+      case eosio::chain::persistent_storage_profile::CONTRACT_PREFIX:
+         return;
+   }
+   throw std::runtime_error("Invalid persistent storage profile: " + v.as_string());
+}
 } // namespace fc
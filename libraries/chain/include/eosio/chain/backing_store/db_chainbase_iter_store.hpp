@@ -1,5 +1,6 @@
 #pragma once
 #include <eosio/chain/contract_table_objects.hpp>
+#include <eosio/chain/backing_store/flat_iterator_index.hpp>
 #include <fc/utility.hpp>
 #include <sstream>
 #include <algorithm>
@@ -7,36 +8,44 @@
 
 namespace eosio { namespace chain { namespace backing_store {
 
+/**
+ * Iterators of the db intrinsics over chainbase.
+ *
+ * Same layout as db_key_value_iter_store: a slab of objects indexed by iterator, iterators are never reused within
+ * the store's lifetime, and flat hash indexes from objects and tables to their slots.
+ */
 template<typename T>
 class db_chainbase_iter_store {
    public:
       db_chainbase_iter_store(){
          _end_iterator_to_table.reserve(8);
+         _end_iterator_to_table_id.reserve(8);
          _iterator_to_object.reserve(32);
       }
 
       /// Returns end iterator of the table.
       int cache_table( const table_id_object& tobj ) {
-         auto itr = _table_cache.find(tobj.id);
-         if( itr != _table_cache.end() )
-            return itr->second.second;
+         const auto indx = find_table_index(tobj.id);
+         if( indx != flat_iterator_index::not_found )
+            return index_to_end_iterator(indx);
 
          auto ei = index_to_end_iterator(_end_iterator_to_table.size());
+         _table_cache.insert( table_hash(tobj.id), _end_iterator_to_table.size() );
          _end_iterator_to_table.push_back( &tobj );
-         _table_cache.emplace( tobj.id, make_pair(&tobj, ei) );
+         _end_iterator_to_table_id.push_back( tobj.id );
          return ei;
       }
 
       const table_id_object& get_table( table_id_object::id_type i )const {
-         auto itr = _table_cache.find(i);
-         EOS_ASSERT( itr != _table_cache.end(), table_not_in_cache, "an invariant was broken, table should be in cache" );
-         return *itr->second.first;
+         const auto indx = find_table_index(i);
+         EOS_ASSERT( indx != flat_iterator_index::not_found, table_not_in_cache, "an invariant was broken, table should be in cache" );
+         return *_end_iterator_to_table[indx];
       }
 
       int get_end_iterator_by_table_id( table_id_object::id_type i )const {
-         auto itr = _table_cache.find(i);
-         EOS_ASSERT( itr != _table_cache.end(), table_not_in_cache, "an invariant was broken, table should be in cache" );
-         return itr->second.second;
+         const auto indx = find_table_index(i);
+         EOS_ASSERT( indx != flat_iterator_index::not_found, table_not_in_cache, "an invariant was broken, table should be in cache" );
+         return index_to_end_iterator(indx);
       }
 
       const table_id_object* find_table_by_end_iterator( int ei )const {
@@ -62,26 +71,36 @@ class db_chainbase_iter_store {
 
          auto obj_ptr = _iterator_to_object[iterator];
          if( !obj_ptr ) return;
+         _object_to_iterator.erase( object_hash(obj_ptr), [&](int32_t itr) { return _iterator_to_object[itr] == obj_ptr; } );
          _iterator_to_object[iterator] = nullptr;
-         _object_to_iterator.erase( obj_ptr );
       }
 
       int add( const T& obj ) {
-         auto itr = _object_to_iterator.find( &obj );
-         if( itr != _object_to_iterator.end() )
-              return itr->second;
+         const auto hash = object_hash(&obj);
+         auto itr = _object_to_iterator.find( hash, [&](int32_t itr) { return _iterator_to_object[itr] == &obj; } );
+         if( itr != flat_iterator_index::not_found )
+              return itr;
 
+         _object_to_iterator.insert( hash, _iterator_to_object.size() );
          _iterator_to_object.push_back( &obj );
-         _object_to_iterator[&obj] = _iterator_to_object.size() - 1;
 
          return _iterator_to_object.size() - 1;
       }
 
    private:
-      map<table_id_object::id_type, pair<const table_id_object*, int>> _table_cache;
+      static uint64_t table_hash( table_id_object::id_type i ) { return detail::hash_mix(i._id); }
+      static uint64_t object_hash( const T* obj ) { return detail::hash_mix(reinterpret_cast<uintptr_t>(obj)); }
+
+      // by id, the table object may already have been removed
+      int32_t find_table_index( table_id_object::id_type i )const {
+         return _table_cache.find( table_hash(i), [&](int32_t indx) { return _end_iterator_to_table_id[indx] == i; } );
+      }
+
+      flat_iterator_index                                              _table_cache{8};
       vector<const table_id_object*>                                   _end_iterator_to_table;
+      vector<table_id_object::id_type>                                 _end_iterator_to_table_id;
       vector<const T*>                                                 _iterator_to_object;
-      map<const T*,int>                                                _object_to_iterator;
+      flat_iterator_index                                              _object_to_iterator{32};
 
       /// Precondition: std::numeric_limits<int>::min() < ei < -1
       /// Iterator of -1 is reserved for invalid iterators (i.e. when the appropriate table has not yet been created).
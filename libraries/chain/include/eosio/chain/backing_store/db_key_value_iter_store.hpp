@@ -1,7 +1,11 @@
 #pragma once
+#include <eosio/chain/backing_store/flat_iterator_index.hpp>
+#include <eosio/chain/types.hpp>
+#include <softfloat.hpp>
 #include <fc/utility.hpp>
 #include <sstream>
 #include <algorithm>
+#include <array>
 #include <set>
 
 namespace eosio { namespace chain { namespace backing_store {
@@ -32,6 +36,53 @@ bool operator<(const secondary_key<T>& lhs, const secondary_key<T>& rhs) {
    // ignoring payer, it does not contribute to uniqueness
 }
 
+namespace detail {
+   inline uint64_t hash_value(const unique_table& t) {
+      return hash_combine(hash_combine(hash_mix(t.contract.to_uint64_t()), t.scope.to_uint64_t()), t.table.to_uint64_t());
+   }
+
+   inline bool equivalent(const unique_table& lhs, const unique_table& rhs) {
+      return lhs.contract == rhs.contract && lhs.scope == rhs.scope && lhs.table == rhs.table;
+   }
+
+   inline uint64_t hash_value(uint64_t v) { return v; }
+
+   inline uint64_t hash_value(const eosio::chain::uint128_t& v) {
+      return hash_combine(static_cast<uint64_t>(v), static_cast<uint64_t>(v >> 64));
+   }
+
+   inline uint64_t hash_value(const std::array<eosio::chain::uint128_t, 2>& v) {
+      return hash_combine(hash_value(v[0]), hash_value(v[1]));
+   }
+
+   // secondary keys are ordered as floats, -0 and +0 are the same key (NaN is not an allowed secondary key),
+   // leave the sign out of the hash
+   inline uint64_t hash_value(const float64_t& v) { return v.v & ~(uint64_t(1) << 63); }
+
+   inline uint64_t hash_value(const float128_t& v) {
+      return hash_combine(v.v[0], v.v[1] & ~(uint64_t(1) << 63));
+   }
+
+   template<typename T>
+   uint64_t hash_value(const secondary_key<T>& obj) {
+      // payer does not contribute to uniqueness
+      return hash_combine(hash_combine(hash_mix(static_cast<uint32_t>(obj.table_ei)), obj.primary), hash_value(obj.secondary));
+   }
+
+   // same equivalence as operator< above
+   template<typename T>
+   bool equivalent(const secondary_key<T>& lhs, const secondary_key<T>& rhs) {
+      return !(lhs < rhs) && !(rhs < lhs);
+   }
+} // namespace detail
+
+/**
+ * Iterators of the db intrinsics over the key value backing store.
+ *
+ * Objects are kept in a slab indexed by iterator, iterators are handed out in order and never reused within the
+ * store's lifetime (an action), so an iterator is valid as long as it is in range and its slot was not removed.
+ * Objects and tables are found through flat hash indexes on the slab instead of ordered maps of copied keys.
+ */
 template<typename SecondaryKey>
 class db_key_value_iter_store {
    public:
@@ -47,20 +98,21 @@ class db_key_value_iter_store {
 
       /// Returns end iterator of the table.
       int cache_table( const unique_table& tobj ) {
-         auto itr = _table_cache.find(tobj);
-         if( itr != _table_cache.end() )
-            return itr->second;
+         const auto hash = detail::hash_value(tobj);
+         const auto indx = find_table_index(tobj, hash);
+         if( indx != flat_iterator_index::not_found )
+            return index_to_end_iterator(indx);
 
          auto ei = index_to_end_iterator(_end_iterator_to_table.size());
+         _table_cache.insert( hash, _end_iterator_to_table.size() );
          _end_iterator_to_table.push_back( tobj );
-         _table_cache.emplace( tobj, ei );
          return ei;
       }
 
       int get_end_iterator_by_table( const unique_table& tobj )const {
-         auto itr = _table_cache.find(tobj);
-         EOS_ASSERT( itr != _table_cache.end(), table_not_in_cache, "an invariant was broken, table should be in cache" );
-         return itr->second;
+         const auto indx = find_table_index(tobj, detail::hash_value(tobj));
+         EOS_ASSERT( indx != flat_iterator_index::not_found, table_not_in_cache, "an invariant was broken, table should be in cache" );
+         return index_to_end_iterator(indx);
       }
 
       const unique_table* find_table_by_end_iterator( int ei )const {
@@ -89,11 +141,11 @@ class db_key_value_iter_store {
       void remove( int iterator ) {
          validate_object_iterator(iterator, "cannot call remove on end iterators");
 
-         auto optional_obj = _iterator_to_object[iterator];
+         auto& optional_obj = _iterator_to_object[iterator];
          if( !optional_obj ) return;
-         _object_to_iterator.erase( *optional_obj );
+         erase_object( *optional_obj );
 
-         _iterator_to_object[iterator].reset();
+         optional_obj.reset();
       }
 
       void swap( int iterator, const secondary_key_type& secondary, account_name payer ) {
@@ -105,34 +157,35 @@ class db_key_value_iter_store {
          if(optional_obj->payer == payer && optional_obj->secondary == secondary) return;
          const bool map_key_change = optional_obj->secondary != secondary;
          if (map_key_change) {
-            // edit object and swap out the map entry
-            _object_to_iterator.erase( *optional_obj );
+            // edit object and swap out the index entry
+            erase_object( *optional_obj );
             optional_obj->secondary = secondary;
          }
          optional_obj->payer = payer;
 
          if (map_key_change) {
-            _object_to_iterator.insert({ *optional_obj, iterator });
+            const auto hash = detail::hash_value(*optional_obj);
+            // an equivalent object already in the index keeps its iterator
+            if( find_object(*optional_obj, hash) == flat_iterator_index::not_found )
+               _object_to_iterator.insert( hash, iterator );
          }
       }
 
       int find( const secondary_obj_type& obj ) const {
-         auto itr = _object_to_iterator.find( obj );
-         if( itr != _object_to_iterator.end() )
-            return itr->second;
-
-         return invalid_iterator();
+         const auto itr = find_object( obj, detail::hash_value(obj) );
+         return itr != flat_iterator_index::not_found ? itr : invalid_iterator();
       }
 
       int add( const secondary_obj_type& obj ) {
-         auto itr = find( obj );
-         if( itr != invalid_iterator() )
+         const auto hash = detail::hash_value(obj);
+         auto itr = find_object( obj, hash );
+         if( itr != flat_iterator_index::not_found )
               return itr;
 
          EOS_ASSERT( obj.table_ei < invalid_iterator(), invalid_table_iterator, "not an end iterator" );
          const auto indx = end_iterator_to_index(obj.table_ei);
          EOS_ASSERT( indx < _end_iterator_to_table.size(), invalid_table_iterator, "an invariant was broken, table should be in cache" );
-         _object_to_iterator.insert({ obj, _iterator_to_object.size() });
+         _object_to_iterator.insert( hash, _iterator_to_object.size() );
          _iterator_to_object.emplace_back( obj );
 
          return _iterator_to_object.size() - 1;
@@ -145,10 +198,24 @@ class db_key_value_iter_store {
          EOS_ASSERT( (size_t)iterator < _iterator_to_object.size(), invalid_table_iterator, "iterator out of range" );
       }
 
-      map<unique_table, int>                    _table_cache;
+      int32_t find_table_index( const unique_table& tobj, uint64_t hash )const {
+         return _table_cache.find( hash, [&](int32_t indx) { return detail::equivalent(_end_iterator_to_table[indx], tobj); } );
+      }
+
+      // only objects that were not removed are in the index
+      int32_t find_object( const secondary_obj_type& obj, uint64_t hash )const {
+         return _object_to_iterator.find( hash, [&](int32_t itr) { return detail::equivalent(*_iterator_to_object[itr], obj); } );
+      }
+
+      void erase_object( const secondary_obj_type& obj ) {
+         _object_to_iterator.erase( detail::hash_value(obj),
+                                    [&](int32_t itr) { return detail::equivalent(*_iterator_to_object[itr], obj); } );
+      }
+
+      flat_iterator_index                       _table_cache{8};
       vector<unique_table>                      _end_iterator_to_table;
       vector<std::optional<secondary_obj_type>> _iterator_to_object;
-      map<secondary_obj_type, int>              _object_to_iterator;
+      flat_iterator_index                       _object_to_iterator{32};
 
       /// Precondition: std::numeric_limits<int>::min() < ei < -1
       /// Iterator of -1 is reserved for invalid iterators (i.e. when the appropriate table has not yet been created).
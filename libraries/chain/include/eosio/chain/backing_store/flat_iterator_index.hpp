@@ -0,0 +1,117 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace eosio { namespace chain { namespace backing_store {
+
+/**
+ * Open addressing hash index from the objects of an iterator store to the slot (iterator or table index) they are
+ * stored at. Buckets only hold the slot and the hash of the object, matching objects are compared in place in the
+ * store through the predicate passed to find and erase, so lookups neither copy keys nor allocate.
+ *
+ * Like the maps it replaces, there is at most one slot for each distinct object: callers find before they insert and
+ * erase whichever slot is recorded for an object.
+ *
+ * Linear probing over a power of two number of buckets, erased buckets are reused by inserts and purged on growth.
+ */
+class flat_iterator_index {
+   public:
+      static constexpr int32_t not_found = -1;
+
+      explicit flat_iterator_index(size_t initial_capacity = 32) {
+         size_t capacity = 8;
+         while (capacity < initial_capacity) capacity *= 2;
+         _buckets.resize(capacity);
+      }
+
+      size_t size() const { return _size; }
+
+      /// @param match bool(int32_t slot), true if the object at slot is the one searched for
+      /// @return slot of the object, not_found if there is none
+      template<typename Match>
+      int32_t find(uint64_t hash, Match&& match) const {
+         const size_t mask = _buckets.size() - 1;
+         for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            const auto& b = _buckets[i];
+            if (b.slot == empty) return not_found;
+            if (b.slot != erased && b.hash == hash && match(b.slot)) return b.slot;
+         }
+      }
+
+      /// Precondition: no object matching the one at slot is in the index
+      void insert(uint64_t hash, int32_t slot) {
+         if ((_size + _erased + 1) * 4 > _buckets.size() * 3) {
+            rehash((_size + 1) * 2 > _buckets.size() ? _buckets.size() * 2 : _buckets.size());
+         }
+         if (place(_buckets, hash, slot)) --_erased;
+         ++_size;
+      }
+
+      /// @param match bool(int32_t slot), true if the object at slot is the one to erase
+      /// @return slot that was erased, not_found if there was none
+      template<typename Match>
+      int32_t erase(uint64_t hash, Match&& match) {
+         const size_t mask = _buckets.size() - 1;
+         for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            auto& b = _buckets[i];
+            if (b.slot == empty) return not_found;
+            if (b.slot != erased && b.hash == hash && match(b.slot)) {
+               const auto slot = b.slot;
+               b.slot = erased;
+               --_size;
+               ++_erased;
+               return slot;
+            }
+         }
+      }
+
+   private:
+      static constexpr int32_t empty  = -1;
+      static constexpr int32_t erased = -2;
+
+      struct bucket {
+         uint64_t hash = 0;
+         int32_t  slot = empty;
+      };
+
+      // returns true if an erased bucket was reused
+      static bool place(std::vector<bucket>& buckets, uint64_t hash, int32_t slot) {
+         const size_t mask = buckets.size() - 1;
+         size_t i = hash & mask;
+         while (buckets[i].slot >= 0) i = (i + 1) & mask;
+         const bool reused = buckets[i].slot == erased;
+         buckets[i] = bucket{ hash, slot };
+         return reused;
+      }
+
+      void rehash(size_t capacity) {
+         std::vector<bucket> buckets(capacity);
+         for (const auto& b : _buckets) {
+            if (b.slot >= 0) place(buckets, b.hash, b.slot);
+         }
+         _buckets = std::move(buckets);
+         _erased = 0;
+      }
+
+      std::vector<bucket> _buckets;
+      size_t              _size   = 0;
+      size_t              _erased = 0;
+};
+
+namespace detail {
+   // splitmix64 finalizer, spreads keys that only differ in a few bits (ids, table names) over the buckets
+   constexpr uint64_t hash_mix(uint64_t h) {
+      h ^= h >> 30;
+      h *= 0xbf58476d1ce4e5b9ull;
+      h ^= h >> 27;
+      h *= 0x94d049bb133111ebull;
+      h ^= h >> 31;
+      return h;
+   }
+
+   constexpr uint64_t hash_combine(uint64_t seed, uint64_t v) {
+      return hash_mix(seed ^ (v + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2)));
+   }
+} // namespace detail
+
+}}} // namespace eosio::chain::backing_store
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <eosio/chain/backing_store.hpp>
+#include <eosio/chain/backing_store/db_key_value_format.hpp>
+
+#include <rocksdb/options.h>
+#include <rocksdb/slice_transform.h>
+
+namespace eosio { namespace chain { namespace backing_store {
+
+   // Prefix extractor following the layout of the keys written by the DB and KV APIs:
+   //   DB API: db type (1) | contract (8) | scope (8) | table (8) | key type (1) | key
+   //   KV API: db type (1) | contract (8) | key
+   // level::table extracts db type, contract, scope and table from DB API keys and db type and contract from KV API
+   // keys (which have no notion of scope or table), level::contract extracts db type and contract from both.
+   // Any other key is out of the domain and is only covered by the whole-key filters.
+   class db_key_value_prefix_extractor : public rocksdb::SliceTransform {
+    public:
+      enum class level { contract, table };
+
+      static constexpr size_t contract_prefix_size = db_key_value_format::db_type_and_code_size;
+      static constexpr size_t table_prefix_size    = contract_prefix_size + sizeof(name) + sizeof(name); // + scope + table
+
+      explicit db_key_value_prefix_extractor(level l) : prefix_level(l) {}
+
+      // stored in the SST files, filters built with another extractor are ignored for prefix checks
+      const char* Name() const override;
+
+      rocksdb::Slice Transform(const rocksdb::Slice& key) const override;
+      bool InDomain(const rocksdb::Slice& key) const override;
+
+    private:
+      size_t prefix_size(const rocksdb::Slice& key) const;
+
+      const level prefix_level;
+   };
+
+   // Sets the table factory, prefix extractor and memtable filters of options for profile.
+   // block_cache_size is only used by the partitioned profiles which keep their index and filters in the block cache.
+   void configure_persistent_storage_profile(rocksdb::Options& options, persistent_storage_profile profile,
+                                             uint64_t block_cache_size);
+
+}}} // namespace eosio::chain::backing_store
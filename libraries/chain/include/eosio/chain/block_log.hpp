@@ -3,6 +3,7 @@
 #include <eosio/chain/block.hpp>
 #include <eosio/chain/genesis_state.hpp>
 #include <eosio/chain/block_log_config.hpp>
+#include <eosio/chain/thread_utils.hpp>
 #include <future>
 
 namespace eosio { namespace chain {
@@ -49,7 +50,7 @@ namespace eosio { namespace chain {
 
          // create futures for append, must call in order of blocks
          std::future<std::tuple<signed_block_ptr, std::vector<char>>>
-            create_append_future(boost::asio::io_context& thread_pool,
+            create_append_future(named_thread_pool& thread_pool, int priority,
                                  const signed_block_ptr& b, packed_transaction::cf_compression_type segment_compression);
          uint64_t append(std::future<std::tuple<signed_block_ptr, std::vector<char>>> f);
 
@@ -103,6 +104,40 @@ namespace eosio { namespace chain {
           */
          static void smoke_test(fc::path block_dir, uint32_t n);
 
+         /**
+          * The following operate on a block log split into log_catalog stride files: blocks-<first>-<last>.log/.index in
+          * retained_dir (relative to block_dir, block_dir when empty) followed by blocks.log/.index in block_dir.
+          *
+          * Unlike trim_blocklog_front/trim_blocklog_end they work in place: only the file containing the trim point is
+          * rewritten or truncated, files trimmed as a whole are moved to archive_dir or deleted when it is empty.
+          * Every step leaves the files in a state from which running the same call again completes the operation, so
+          * they can simply be repeated after a crash.
+          *
+          * trim_split_log_front returns true once the log starts at truncate_at_block or later, including when it already
+          * did before the call, and false when there is no log or the trim would remove every block.
+          */
+         static bool trim_split_log_front(const fc::path& block_dir, const fc::path& retained_dir, const fc::path& archive_dir, uint32_t truncate_at_block);
+         static int  trim_split_log_end(const fc::path& block_dir, const fc::path& retained_dir, uint32_t n);
+
+         /**
+          * Rebuild the entries past the last valid one of every index that does not agree with its log file.
+          * @returns The number of indices repaired
+          */
+         static uint32_t repair_split_log_index(const fc::path& block_dir, const fc::path& retained_dir, uint32_t num_threads);
+
+         struct verify_stats {
+            uint32_t         files  = 0;
+            uint64_t         blocks = 0;
+            uint64_t         bytes  = 0;
+            fc::microseconds elapsed;
+         };
+
+         /**
+          * smoke_test of each file on num_threads threads, then check that the files are contiguous and of the same chain.
+          * @param n Only test 1 block out of every n blocks of each file, see smoke_test.
+          */
+         static verify_stats verify_split_log(const fc::path& block_dir, const fc::path& retained_dir, uint32_t n, uint32_t num_threads);
+
    private:
          std::unique_ptr<detail::block_log_impl> my;
    };
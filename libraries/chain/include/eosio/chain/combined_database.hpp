@@ -21,6 +21,7 @@
 #include <eosio/chain/kv_chainbase_objects.hpp>
 #include <eosio/chain/protocol_state_object.hpp>
 #include <eosio/chain/reversible_block_object.hpp>
+#include <eosio/chain/transaction_dedup_index.hpp>
 #include <eosio/chain/transaction_object.hpp>
 #include <eosio/chain/whitelisted_intrinsics.hpp>
 #include <eosio/chain/controller.hpp>
@@ -62,7 +63,8 @@ namespace eosio { namespace chain {
     public:
       combined_session() = default;
 
-      combined_session(chainbase::database& cb_database, eosio::session::undo_stack<rocks_db_type>* undo_stack);
+      combined_session(chainbase::database& cb_database, eosio::session::undo_stack<rocks_db_type>* undo_stack,
+                       transaction_dedup_index* trx_dedup = nullptr);
 
       combined_session(combined_session&& src) noexcept;
 
@@ -79,6 +81,7 @@ namespace eosio { namespace chain {
     private:
       std::unique_ptr<chainbase::database::session> cb_session    = {};
       eosio::session::undo_stack<rocks_db_type>*     kv_undo_stack = nullptr;
+      transaction_dedup_index*                       trx_dedup     = nullptr;
    };
 
    class combined_database {
@@ -100,9 +103,16 @@ namespace eosio { namespace chain {
       static combined_session make_no_op_session() { return combined_session(); }
 
       combined_session make_session() {
-         return combined_session(db, kv_undo_stack.get());
+         return combined_session(db, kv_undo_stack.get(), trx_dedup.get());
       }
 
+      // Keep the ids of input transactions in a transaction_dedup_index instead of the transaction_multi_index.
+      // Must be called before the first session is started.
+      void enable_transaction_dedup_index();
+
+      /// nullptr unless enable_transaction_dedup_index was called
+      transaction_dedup_index* get_transaction_dedup_index() const { return trx_dedup.get(); }
+
       void set_revision(uint64_t revision);
 
       int64_t revision();
@@ -142,6 +152,7 @@ namespace eosio { namespace chain {
       chainbase::database&                                       db;
       std::unique_ptr<rocks_db_type>                             kv_database;
       kv_undo_stack_ptr                                          kv_undo_stack;
+      std::unique_ptr<transaction_dedup_index>                   trx_dedup;
       const uint64_t                                             kv_snapshot_batch_threashold;
    };
 
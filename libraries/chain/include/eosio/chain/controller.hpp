@@ -51,6 +51,7 @@ namespace eosio { namespace chain {
    using trx_meta_cache_lookup = std::function<transaction_metadata_ptr( const transaction_id_type&)>;
 
    class fork_database;
+   class reversible_block_journal;
 
    enum class db_read_mode {
       SPECULATIVE,
@@ -80,8 +81,11 @@ namespace eosio { namespace chain {
             uint64_t                 state_guard_size           = chain::config::default_state_guard_size;
             uint64_t                 reversible_cache_size      = chain::config::default_reversible_cache_size;
             uint64_t                 reversible_guard_size      = chain::config::default_reversible_guard_size;
+            bool                     reversible_blocks_journal  = false; ///< keep reversible blocks in a reversible_block_journal instead of the reversible blocks database
+            bool                     transaction_dedup_index    = false; ///< keep ids of input transactions in a transaction_dedup_index instead of the transaction_multi_index
             uint32_t                 sig_cpu_bill_pct           = chain::config::default_sig_cpu_bill_pct;
             uint16_t                 thread_pool_size           = chain::config::default_controller_thread_pool_size;
+            std::vector<uint32_t>    thread_pool_cpus;          ///< cpus the controller thread pool is bound to, empty for no binding
             uint16_t                 max_retained_block_files   = chain::config::default_max_retained_block_files;
             uint64_t                 blocks_log_stride          = chain::config::default_blocks_log_stride;
             backing_store_type       backing_store              = backing_store_type::CHAINBASE;
@@ -90,6 +94,8 @@ namespace eosio { namespace chain {
             uint64_t                 persistent_storage_write_buffer_size = chain::config::default_persistent_storage_write_buffer_size;
             uint64_t                 persistent_storage_bytes_per_sync = chain::config::default_persistent_storage_bytes_per_sync;
             uint32_t                 persistent_storage_mbytes_batch = chain::config::default_persistent_storage_mbytes_batch;
+            chain::persistent_storage_profile persistent_storage_profile = chain::persistent_storage_profile::DEFAULT;
+            uint64_t                 persistent_storage_block_cache_size = chain::config::default_persistent_storage_block_cache_size;
             fc::microseconds         abi_serializer_max_time_us = fc::microseconds(chain::config::default_abi_serializer_max_time_us);
             uint32_t   max_nonprivileged_inline_action_size =  chain::config::default_max_nonprivileged_inline_action_size;
             bool                     read_only                  = false;
@@ -193,6 +199,8 @@ namespace eosio { namespace chain {
 
          const chainbase::database& db()const;
          const chainbase::database& reversible_db() const;
+         /// the journal holding the reversible blocks instead of reversible_db, nullptr unless reversible_blocks_journal
+         const reversible_block_journal* reversible_journal() const;
 
          const fork_database& fork_db()const;
 
@@ -313,6 +321,13 @@ namespace eosio { namespace chain {
          const flat_set<account_name>& get_trusted_producers()const;
          uint32_t get_terminate_at_block()const;
 
+         /**
+          * Advertise whether anything outside of consensus reads transaction traces of applied blocks. When there
+          * is none, notification action traces are recorded without authorization and data.
+          */
+         void set_trace_consumers( bool has_consumers );
+         bool has_trace_consumers()const;
+
          void set_subjective_cpu_leeway(fc::microseconds leeway);
          std::optional<fc::microseconds> get_subjective_cpu_leeway() const;
          void set_greylist_limit( uint32_t limit );
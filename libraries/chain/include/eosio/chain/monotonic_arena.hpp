@@ -0,0 +1,116 @@
+#pragma once
+
+#include <boost/container/flat_set.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace eosio { namespace chain {
+
+   /**
+    * Bump allocator for short lived temporaries whose lifetime is bounded by a single transaction.
+    * The first `inline_size` bytes are served from storage embedded in the arena itself, so an arena living on the
+    * stack of the transaction does not touch the heap at all for typical transactions. Larger demands are served
+    * from heap blocks of doubling size which are all released together when the arena is destroyed.
+    * Deallocation is a no-op; containers using the arena must not outlive it, and anything that escapes the
+    * transaction (traces, receipts, block state) has to be copied out into regularly allocated storage.
+    * Not thread safe.
+    */
+   class monotonic_arena {
+   public:
+      static constexpr size_t inline_size = 4096;
+
+      monotonic_arena() = default;
+      monotonic_arena(const monotonic_arena&) = delete;
+      monotonic_arena& operator=(const monotonic_arena&) = delete;
+
+      ~monotonic_arena() {
+         while( _blocks ) {
+            block_header* prev = _blocks->prev;
+            std::free( _blocks );
+            _blocks = prev;
+         }
+      }
+
+      void* allocate( size_t bytes, size_t alignment ) {
+         void* p = _current;
+         size_t space = _remaining;
+         if( !std::align( alignment, bytes, p, space ) ) {
+            grow( bytes + alignment );
+            p = _current;
+            space = _remaining;
+            std::align( alignment, bytes, p, space );
+         }
+         _current   = static_cast<char*>(p) + bytes;
+         _remaining = space - bytes;
+         return p;
+      }
+
+      /// total bytes requested from the heap, 0 when the inline storage was sufficient
+      size_t heap_bytes()const { return _heap_bytes; }
+
+   private:
+      struct alignas(std::max_align_t) block_header {
+         block_header* prev = nullptr;
+      };
+
+      void grow( size_t min_bytes ) {
+         size_t size = std::max( _next_block_size, min_bytes + sizeof(block_header) );
+         void* mem = std::malloc( size );
+         if( !mem ) throw std::bad_alloc();
+         auto* header = new (mem) block_header{ _blocks };
+         _blocks      = header;
+         _current     = reinterpret_cast<char*>(header + 1);
+         _remaining   = size - sizeof(block_header);
+         _heap_bytes += size;
+         _next_block_size = size * 2;
+      }
+
+      alignas(std::max_align_t) char _inline[inline_size];
+      char*          _current         = _inline;
+      size_t         _remaining       = inline_size;
+      block_header*  _blocks          = nullptr;
+      size_t         _next_block_size = 4 * inline_size;
+      size_t         _heap_bytes      = 0;
+   };
+
+   /**
+    * Standard allocator drawing from a monotonic_arena
+    */
+   template<typename T>
+   class arena_allocator {
+   public:
+      using value_type = T;
+
+      explicit arena_allocator( monotonic_arena& arena ) : _arena(&arena) {}
+
+      template<typename U>
+      arena_allocator( const arena_allocator<U>& other ) : _arena(other._arena) {}
+
+      T* allocate( size_t n ) {
+         return static_cast<T*>( _arena->allocate( n * sizeof(T), alignof(T) ) );
+      }
+
+      void deallocate( T*, size_t ) {}
+
+      template<typename U>
+      bool operator==( const arena_allocator<U>& other )const { return _arena == other._arena; }
+      template<typename U>
+      bool operator!=( const arena_allocator<U>& other )const { return _arena != other._arena; }
+
+   private:
+      template<typename U> friend class arena_allocator;
+      monotonic_arena* _arena;
+   };
+
+   template<typename T>
+   using arena_vector = std::vector<T, arena_allocator<T>>;
+
+   template<typename T>
+   using arena_flat_set = boost::container::flat_set<T, std::less<T>, arena_allocator<T>>;
+
+} } // eosio::chain
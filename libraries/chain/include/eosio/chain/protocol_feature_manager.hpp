@@ -342,7 +342,22 @@ public:
    const_iterator upper_bound( uint32_t block_num )const;
 
 
-   bool is_builtin_activated( builtin_protocol_feature_t feature_codename, uint32_t current_block_num )const;
+   bool is_builtin_activated( builtin_protocol_feature_t feature_codename, uint32_t current_block_num )const {
+      const auto indx = static_cast<uint32_t>( feature_codename );
+      if( indx >= max_builtin_protocol_features ) return false;
+      return (activated_builtins_at( current_block_num ) >> indx) & 1;
+   }
+
+   /// Bit i is set if the builtin feature with codename i is activated at current_block_num
+   uint64_t activated_builtins_at( uint32_t current_block_num )const {
+      // features are activated at or below the block being built, so the latest entry almost always answers
+      if( _builtin_activation_masks.empty() ) return 0;
+      if( _builtin_activation_masks.back().activation_block_num <= current_block_num )
+         return _builtin_activation_masks.back().activated;
+      return activated_builtins_before( current_block_num );
+   }
+
+   static constexpr uint32_t max_builtin_protocol_features = 64;
 
    void activate_feature( const digest_type& feature_digest, uint32_t current_block_num );
    void popped_blocks_to( uint32_t block_num );
@@ -362,11 +377,20 @@ protected:
       uint32_t                             activation_block_num = not_active;
    };
 
+   /// Builtin features activated as of a block, one entry per block that activated any
+   struct builtin_activation_mask {
+      uint32_t                             activation_block_num = 0;
+      uint64_t                             activated = 0;
+   };
+
+   uint64_t activated_builtins_before( uint32_t current_block_num )const;
+
 protected:
    protocol_feature_set                   _protocol_feature_set;
    vector<protocol_feature_entry>         _activated_protocol_features;
    vector<builtin_protocol_feature_entry> _builtin_protocol_features;
    size_t                                 _head_of_builtin_activation_list = builtin_protocol_feature_entry::no_previous;
+   vector<builtin_activation_mask>        _builtin_activation_masks; ///< ascending activation_block_num
    bool                                   _initialized = false;
 
 private:
@@ -0,0 +1,81 @@
+#pragma once
+#include <eosio/chain/block.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/io/cfile.hpp>
+
+#include <deque>
+#include <optional>
+
+namespace eosio { namespace chain {
+
+   /**
+    * Append only journal of the blocks that have been applied but are not yet irreversible. It is an alternative to
+    * keeping a serialized copy of every reversible block in the reversible blocks chainbase database.
+    *
+    * +--------------------+---------------+-------------------+-----+--------------------+---------------+-------------------+
+    * | Header of Block n  | Packed Block n| Pos of Block n    | ... | Header of Block m  | Packed Block m| Pos of Block m    |
+    * +--------------------+---------------+-------------------+-----+--------------------+---------------+-------------------+
+    *
+    * where a header is the magic number, the block id and the size of the packed block. Blocks are kept in consecutive
+    * block number order. Removing blocks from the end (forks) truncates the file, removing blocks from the front
+    * (irreversibility) only advances an in memory index; the dead prefix is compacted away once it outgrows the live
+    * blocks. The front of the journal is not persisted since the controller drops blocks at or below the last
+    * irreversible block on startup.
+    *
+    * On open the journal is scanned and cut at the first incomplete or inconsistent record, which covers a crash in
+    * the middle of an append.
+    */
+   class reversible_block_journal {
+      public:
+         static constexpr uint32_t magic_number = 0x4A42524Eu;
+         static constexpr uint64_t min_compaction_bytes = 16*1024*1024;
+         static constexpr const char* file_name = "reversible_blocks.journal";
+
+         explicit reversible_block_journal( const fc::path& dir );
+         ~reversible_block_journal();
+
+         reversible_block_journal( const reversible_block_journal& ) = delete;
+         reversible_block_journal& operator=( const reversible_block_journal& ) = delete;
+
+         /// a block with a number at or below the last block in the journal replaces it and every block after it
+         void append( const signed_block& b, const block_id_type& id );
+
+         /// remove all blocks with a number greater than block_num
+         void remove_after( uint32_t block_num );
+         /// remove all blocks with a number less than or equal to block_num
+         void remove_through( uint32_t block_num );
+         void clear();
+
+         bool     empty()const { return _entries.empty(); }
+         size_t   size()const  { return _entries.size(); }
+         uint32_t first_block_num()const; ///< undefined when empty
+         uint32_t last_block_num()const;  ///< undefined when empty
+
+         std::optional<block_id_type> block_id( uint32_t block_num )const;
+         signed_block_ptr             read_block( uint32_t block_num )const;
+
+         /// bytes of the file in use, including a not yet compacted prefix
+         uint64_t file_size()const { return _end; }
+
+         static bool exists( const fc::path& dir );
+
+      private:
+         struct entry {
+            block_id_type id;
+            uint64_t      pos  = 0;
+            uint32_t      size = 0;
+         };
+         static constexpr uint64_t header_size = sizeof(uint32_t) + sizeof(block_id_type) + sizeof(uint32_t);
+
+         const entry* find( uint32_t block_num )const;
+         void recover();
+         void truncate_file( uint64_t size );
+         void compact();
+
+         fc::path             _path;
+         mutable fc::cfile    _file;
+         std::deque<entry>    _entries;
+         uint64_t             _end = 0;
+   };
+
+} } // eosio::chain
@@ -3,39 +3,95 @@
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/thread_pool.hpp>
 #include <boost/asio/post.hpp>
+#include <functional>
 #include <future>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <queue>
+#include <string>
+#include <vector>
 
 namespace eosio { namespace chain {
 
    /**
     * Wrapper class for boost asio thread pool and io_context run.
     * Also names threads so that tools like htop can see thread name.
+    *
+    * Tasks submitted with post(priority, f) are kept in a priority queue and every submission posts one runner to the
+    * io_context which executes the highest priority task queued at the time it runs, so latency critical work
+    * overtakes bulk work already waiting in the pool. Handlers posted directly to get_executor(), like socket
+    * operations, run in FIFO order along with the runners.
     */
    class named_thread_pool {
    public:
+      struct priority {
+         static constexpr int high   = 100; ///< on the critical path of block validation or production
+         static constexpr int medium = 50;
+         static constexpr int low    = 10;  ///< background work nobody waits for
+      };
+
       // name_prefix is name appended with -## of thread.
       // short name_prefix (6 chars or under) is recommended as console_appender uses 9 chars for thread name
-      named_thread_pool( std::string name_prefix, size_t num_threads );
+      // cpus, when not empty, is the set of CPUs every thread of the pool is bound to, see parse_cpu_affinity
+      named_thread_pool( std::string name_prefix, size_t num_threads, std::vector<uint32_t> cpus = {} );
 
       // calls stop()
       ~named_thread_pool();
 
       boost::asio::io_context& get_executor() { return _ioc; }
 
+      // run f on the pool before any queued task of lower priority, tasks of equal priority run in FIFO order
+      template<typename F>
+      void post( int prio, F&& f ) {
+         {
+            std::lock_guard<std::mutex> g( _queue_mtx );
+            _queue.push( prioritized_task{ prio, _order++, std::function<void()>( std::forward<F>( f ) ) } );
+         }
+         boost::asio::post( _ioc, [this]() { run_highest_priority_task(); } );
+      }
+
       // destroy work guard, stop io_context, join thread_pool, and stop thread_pool
+      // tasks still queued by post() are then run on the calling thread, so that every future of async_thread_pool
+      // gets its value; this includes tasks posted after a previous stop()
       void stop();
 
    private:
       using ioc_work_t = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
 
-      boost::asio::thread_pool       _thread_pool;
-      boost::asio::io_context        _ioc;
-      std::optional<ioc_work_t>      _ioc_work;
+      struct prioritized_task {
+         int                           prio  = 0;
+         uint64_t                      order = 0;
+         mutable std::function<void()> task; // moved out of the top of the queue, which is only accessible as const
+
+         // lower priority, or same priority but submitted later
+         bool operator<( const prioritized_task& other ) const {
+            return prio < other.prio || (prio == other.prio && order > other.order);
+         }
+      };
+
+      // @return false if the queue was empty
+      bool run_highest_priority_task();
+
+      boost::asio::thread_pool                 _thread_pool;
+      boost::asio::io_context                  _ioc;
+      std::optional<ioc_work_t>                _ioc_work;
+      std::mutex                               _queue_mtx;
+      std::priority_queue<prioritized_task>    _queue; // protected by _queue_mtx
+      uint64_t                                 _order = 0; // protected by _queue_mtx
    };
 
 
+   /**
+    * Parse the CPU placement of a named_thread_pool: either a list of CPUs and CPU ranges such as "0-3,8,10-11", or
+    * "node:N" for all CPUs of NUMA node N. Threads bound to the CPUs of a node get their memory from that node under
+    * the default first-touch policy of Linux.
+    * The CPUs of a NUMA node are read from sysfs; when the topology is not available, or for an empty spec, an empty
+    * set is returned which leaves placement to the operating system.
+    * Throws plugin_config_exception for a malformed spec.
+    */
+   std::vector<uint32_t> parse_cpu_affinity( const std::string& spec );
+
    // async on thread_pool and return future
    template<typename F>
    auto async_thread_pool( boost::asio::io_context& thread_pool, F&& f ) {
@@ -44,6 +100,14 @@ namespace eosio { namespace chain {
       return task->get_future();
    }
 
+   // async on thread_pool with priority, see named_thread_pool::priority, and return future
+   template<typename F>
+   auto async_thread_pool( named_thread_pool& thread_pool, int priority, F&& f ) {
+      auto task = std::make_shared<std::packaged_task<decltype( f() )()>>( std::forward<F>( f ) );
+      thread_pool.post( priority, [task]() { (*task)(); } );
+      return task->get_future();
+   }
+
 } } // eosio::chain
 
 
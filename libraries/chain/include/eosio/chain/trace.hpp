@@ -81,6 +81,13 @@ namespace eosio { namespace chain {
              auth.permission == eosio::chain::config::active_name;
    }
 
+   /**
+    * Fill in the action of every notification trace that was recorded in compact form (account and name only,
+    * see transaction_context::compact_notification_traces) from its closest unnotified ancestor.
+    * A notified receiver always executes the very same action as the first receiver so no information is lost.
+    */
+   void materialize_action_traces( transaction_trace& tt );
+
    #define STORAGE_EVENT_ID( FORMAT, ... ) \
       fc::format_string( FORMAT, fc::mutable_variant_object()__VA_ARGS__ )
 
@@ -3,6 +3,7 @@
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/trace.hpp>
 #include <eosio/chain/platform_timer.hpp>
+#include <eosio/chain/monotonic_arena.hpp>
 #include <signal.h>
 
 namespace eosio { namespace chain {
@@ -160,11 +161,13 @@ namespace eosio { namespace chain {
 
          fc::time_point                published;
 
+         /// backs temporaries that die with the transaction, see monotonic_arena
+         monotonic_arena               arena;
 
          deque<digest_type>            executed_action_receipt_digests;
          flat_set<account_name>        bill_to_accounts;
-         flat_set<account_name>        validate_ram_usage;
-         flat_set<account_name>        validate_disk_usage;
+         arena_flat_set<account_name>  validate_ram_usage;
+         arena_flat_set<account_name>  validate_disk_usage;
 
          /// the maximum number of virtual CPU instructions of the transaction that can be safely billed to the billable accounts
          uint64_t                      initial_max_billable_cpu = 0;
@@ -173,6 +176,8 @@ namespace eosio { namespace chain {
          bool                          is_input           = false;
          bool                          apply_context_free = true;
          bool                          enforce_whiteblacklist = true;
+         /// record notification action traces without authorization and data, see materialize_action_traces
+         bool                          compact_notification_traces = false;
 
          fc::time_point                deadline = fc::time_point::maximum();
          fc::microseconds              leeway = fc::microseconds( config::default_subjective_cpu_leeway_us );
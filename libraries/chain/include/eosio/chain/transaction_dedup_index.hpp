@@ -0,0 +1,105 @@
+#pragma once
+#include <eosio/chain/types.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace eosio { namespace chain {
+
+   /**
+    * Ids of the input transactions that were included in a block and have not yet expired, used to detect duplicate
+    * transactions. It is an alternative to keeping a transaction_object per id in the transaction_multi_index of the
+    * state database.
+    *
+    * Ids are kept in a hash index and in buckets by expiration second, so inserting and looking up an id does not
+    * walk or rebalance ordered trees and expiring transactions drops whole buckets in expiration order. Each id also
+    * keeps the sequence number of its insertion, the order in which the transaction_multi_index would have assigned
+    * object ids, so that snapshots list the ids in the same order as a node without this index.
+    *
+    * Changes are recorded in undo layers that are started, squashed, undone and committed together with the sessions
+    * of the state database (see combined_session and combined_database), so forks and failed transactions revert it
+    * exactly like the state database. Since it is not part of the shared memory state, it is written to a file in the
+    * state directory on shutdown and read back on startup.
+    *
+    * Not thread safe.
+    */
+   class transaction_dedup_index {
+      public:
+         static constexpr uint32_t    magic_number          = 0x54444458;
+         static constexpr uint32_t    min_supported_version = 2;
+         static constexpr uint32_t    max_supported_version = 2;
+         static constexpr const char* file_name             = "transaction_dedup.dat";
+
+         /// same layout as transaction_object in snapshots
+         struct row {
+            time_point_sec       expiration;
+            transaction_id_type  trx_id;
+         };
+
+         bool contains( const transaction_id_type& id )const { return _ids.count( id ) > 0; }
+
+         /// @return false if the id is already present
+         bool insert( const transaction_id_type& id, time_point_sec expiration );
+
+         /// remove the ids of all transactions that expire before now
+         /// @return number of ids removed
+         size_t remove_expired( const fc::time_point& now );
+
+         size_t size()const { return _ids.size(); }
+
+         /// visit all ids as rows in the order they were inserted
+         template<typename F>
+         void walk( F&& f )const {
+            std::vector<const std::pair<const transaction_id_type, entry>*> rows;
+            rows.reserve( _ids.size() );
+            for( const auto& i : _ids ) {
+               rows.push_back( &i );
+            }
+            std::sort( rows.begin(), rows.end(), []( const auto* a, const auto* b ) { return a->second.seq < b->second.seq; } );
+            for( const auto* r : rows ) {
+               f( row{ time_point_sec( r->second.expiration ), r->first } );
+            }
+         }
+
+         void    start_session();
+         void    squash();
+         void    undo();
+         void    commit( int64_t revision );
+         int64_t revision()const { return _revision; }
+         /// only valid when there are no undo layers
+         void    set_revision( int64_t revision );
+         size_t  undo_depth()const { return _undo_stack.size(); }
+
+         /// write ids and undo layers to the file, see file_name
+         void write( const fc::path& p )const;
+         /// replace the content with the one written by write
+         void read( const fc::path& p );
+
+      private:
+         struct entry {
+            uint32_t expiration = 0;
+            uint64_t seq        = 0;
+         };
+         struct undo_op {
+            transaction_id_type id;
+            uint32_t            expiration = 0;
+            uint64_t            seq        = 0;
+            bool                expired    = false; ///< otherwise inserted
+         };
+         using bucket = std::vector<transaction_id_type>;
+
+         std::unordered_map<transaction_id_type, entry> _ids;         ///< id -> expiration second and insertion sequence
+         std::map<uint32_t, bucket>                      _buckets;     ///< expiration second -> ids in insertion order
+         std::deque<std::vector<undo_op>>                _undo_stack;
+         int64_t                                         _revision = 0;
+         uint64_t                                        _next_seq = 0;
+   };
+
+} } // eosio::chain
+
+FC_REFLECT(eosio::chain::transaction_dedup_index::row, (expiration)(trx_id))
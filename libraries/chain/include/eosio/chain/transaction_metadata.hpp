@@ -2,6 +2,7 @@
 #include <eosio/chain/transaction.hpp>
 #include <eosio/chain/types.hpp>
 #include <boost/asio/io_context.hpp>
+#include <functional>
 #include <future>
 
 namespace boost { namespace asio {
@@ -10,6 +11,7 @@ namespace boost { namespace asio {
 
 namespace eosio { namespace chain {
 
+class named_thread_pool;
 class transaction_metadata;
 using transaction_metadata_ptr = std::shared_ptr<transaction_metadata>;
 using recover_keys_future = std::future<transaction_metadata_ptr>;
@@ -49,6 +51,10 @@ class transaction_metadata {
          return *sigs;
       }
 
+      static std::function<transaction_metadata_ptr()>
+      make_recover_keys_task( packed_transaction_ptr trx, const chain_id_type& chain_id,
+                              fc::microseconds time_limit, uint32_t max_variable_sig_size );
+
    public:
       // creation of tranaction_metadata restricted to start_recover_keys and create_no_recover_keys below, public for make_shared
       explicit transaction_metadata( const private_type& pt, packed_transaction_ptr ptrx,
@@ -81,6 +87,13 @@ class transaction_metadata {
                           const chain_id_type& chain_id, fc::microseconds time_limit,
                           uint32_t max_variable_sig_size = UINT32_MAX );
 
+      /// Thread safe.
+      /// Same as above but queued with a named_thread_pool::priority.
+      static recover_keys_future
+      start_recover_keys( packed_transaction_ptr trx, named_thread_pool& thread_pool, int priority,
+                          const chain_id_type& chain_id, fc::microseconds time_limit,
+                          uint32_t max_variable_sig_size = UINT32_MAX );
+
       /// @returns constructed transaction_metadata with no key recovery (sig_cpu_usage=0, recovered_pub_keys=empty)
       static transaction_metadata_ptr
       create_no_recover_keys( packed_transaction_ptr trx, trx_type t ) {
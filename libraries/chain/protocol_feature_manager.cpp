@@ -667,14 +667,16 @@ Allows privileged contracts to get and set subsets of blockchain parameters.
       return const_iterator{this, static_cast<std::size_t>(itr - begin)};
    }
 
-   bool protocol_feature_manager::is_builtin_activated( builtin_protocol_feature_t feature_codename,
-                                                        uint32_t current_block_num )const
-   {
-      uint32_t indx = static_cast<uint32_t>( feature_codename );
+   uint64_t protocol_feature_manager::activated_builtins_before( uint32_t current_block_num )const {
+      const auto begin = _builtin_activation_masks.cbegin();
+      const auto end   = _builtin_activation_masks.cend();
+      auto itr = std::upper_bound( begin, end, current_block_num, []( uint32_t lhs, const builtin_activation_mask& rhs ) {
+         return lhs < rhs.activation_block_num;
+      } );
 
-      if( indx >= _builtin_protocol_features.size() ) return false;
+      if( itr == begin ) return 0;
 
-      return (_builtin_protocol_features[indx].activation_block_num <= current_block_num);
+      return (--itr)->activated;
    }
 
    void protocol_feature_manager::activate_feature( const digest_type& feature_digest,
@@ -713,6 +715,13 @@ Allows privileged contracts to get and set subsets of blockchain parameters.
                   ("codename", indx)
       );
 
+      EOS_ASSERT( indx < max_builtin_protocol_features, protocol_feature_exception,
+                  "invariant failure while trying to activate feature with digest '${digest}': "
+                  "builtin_protocol_feature_t ${codename} does not fit the activation mask",
+                  ("digest", feature_digest)
+                  ("codename", indx)
+      );
+
       EOS_ASSERT( _builtin_protocol_features[indx].activation_block_num == builtin_protocol_feature_entry::not_active,
                   protocol_feature_exception,
                   "cannot activate already activated builtin feature with digest: ${digest}",
@@ -730,6 +739,12 @@ Allows privileged contracts to get and set subsets of blockchain parameters.
       _builtin_protocol_features[indx].previous = _head_of_builtin_activation_list;
       _builtin_protocol_features[indx].activation_block_num = current_block_num;
       _head_of_builtin_activation_list = indx;
+
+      if( _builtin_activation_masks.empty() || _builtin_activation_masks.back().activation_block_num < current_block_num ) {
+         const uint64_t previous = _builtin_activation_masks.empty() ? 0 : _builtin_activation_masks.back().activated;
+         _builtin_activation_masks.push_back( builtin_activation_mask{current_block_num, previous} );
+      }
+      _builtin_activation_masks.back().activated |= uint64_t(1) << indx;
    }
 
    void protocol_feature_manager::popped_blocks_to( uint32_t block_num ) {
@@ -749,6 +764,12 @@ Allows privileged contracts to get and set subsets of blockchain parameters.
       {
          _activated_protocol_features.pop_back();
       }
+
+      while( _builtin_activation_masks.size() > 0
+              && block_num < _builtin_activation_masks.back().activation_block_num )
+      {
+         _builtin_activation_masks.pop_back();
+      }
    }
 
 } }  // eosio::chain
@@ -0,0 +1,199 @@
+#include <eosio/chain/reversible_block_journal.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <fc/io/raw.hpp>
+#include <boost/filesystem.hpp>
+
+namespace eosio { namespace chain {
+
+   reversible_block_journal::reversible_block_journal( const fc::path& dir )
+   :_path( dir / file_name )
+   {
+      if( !fc::is_directory( dir ) )
+         fc::create_directories( dir );
+
+      _file.set_file_path( _path );
+      _file.open( fc::cfile::create_or_update_rw_mode );
+      recover();
+   }
+
+   reversible_block_journal::~reversible_block_journal() {
+      if( _file.is_open() ) {
+         _file.flush();
+         _file.close();
+      }
+   }
+
+   bool reversible_block_journal::exists( const fc::path& dir ) {
+      return fc::exists( dir / file_name );
+   }
+
+   uint32_t reversible_block_journal::first_block_num()const {
+      return block_header::num_from_id( _entries.front().id );
+   }
+
+   uint32_t reversible_block_journal::last_block_num()const {
+      return block_header::num_from_id( _entries.back().id );
+   }
+
+   const reversible_block_journal::entry* reversible_block_journal::find( uint32_t block_num )const {
+      if( _entries.empty() ) return nullptr;
+      const uint32_t first = first_block_num();
+      if( block_num < first || block_num - first >= _entries.size() ) return nullptr;
+      return &_entries[block_num - first];
+   }
+
+   std::optional<block_id_type> reversible_block_journal::block_id( uint32_t block_num )const {
+      if( const auto* e = find( block_num ) ) return e->id;
+      return {};
+   }
+
+   signed_block_ptr reversible_block_journal::read_block( uint32_t block_num )const {
+      const auto* e = find( block_num );
+      if( !e ) return {};
+
+      std::vector<char> packed( e->size );
+      _file.seek( e->pos + header_size );
+      _file.read( packed.data(), packed.size() );
+
+      auto b = std::make_shared<signed_block>();
+      fc::datastream<const char*> ds( packed.data(), packed.size() );
+      fc::raw::unpack( ds, *b );
+      return b;
+   }
+
+   void reversible_block_journal::append( const signed_block& b, const block_id_type& id ) {
+      const uint32_t block_num = block_header::num_from_id( id );
+      if( !_entries.empty() ) {
+         if( block_num <= last_block_num() ) {
+            remove_after( block_num - 1 );
+         }
+         if( !_entries.empty() ) {
+            EOS_ASSERT( block_num == last_block_num() + 1, reversible_blocks_exception,
+                        "gap in reversible block journal, appending block ${n} after ${last}",
+                        ("n", block_num)("last", last_block_num()) );
+         }
+      }
+
+      const std::vector<char> packed = fc::raw::pack( b );
+      const uint32_t size = packed.size();
+      const uint64_t pos = _end;
+
+      _file.seek( pos );
+      _file.write( reinterpret_cast<const char*>(&magic_number), sizeof(magic_number) );
+      _file.write( id.data(), sizeof(block_id_type) );
+      _file.write( reinterpret_cast<const char*>(&size), sizeof(size) );
+      _file.write( packed.data(), packed.size() );
+      _file.write( reinterpret_cast<const char*>(&pos), sizeof(pos) );
+      _file.flush();
+
+      _entries.push_back( entry{ id, pos, size } );
+      _end = pos + header_size + size + sizeof(pos);
+   }
+
+   void reversible_block_journal::remove_after( uint32_t block_num ) {
+      if( _entries.empty() || last_block_num() <= block_num ) return;
+      while( !_entries.empty() && last_block_num() > block_num ) {
+         _end = _entries.back().pos;
+         _entries.pop_back();
+      }
+      if( _entries.empty() ) _end = 0;
+      truncate_file( _end );
+   }
+
+   void reversible_block_journal::remove_through( uint32_t block_num ) {
+      while( !_entries.empty() && first_block_num() <= block_num ) {
+         _entries.pop_front();
+      }
+      if( _entries.empty() ) {
+         if( _end > 0 ) {
+            _end = 0;
+            truncate_file( 0 );
+         }
+         return;
+      }
+      const uint64_t dead = _entries.front().pos;
+      if( dead >= min_compaction_bytes && dead >= _end - dead ) {
+         compact();
+      }
+   }
+
+   void reversible_block_journal::clear() {
+      _entries.clear();
+      _end = 0;
+      truncate_file( 0 );
+   }
+
+   void reversible_block_journal::truncate_file( uint64_t size ) {
+      _file.flush();
+      boost::filesystem::resize_file( _path, size );
+   }
+
+   void reversible_block_journal::recover() {
+      _entries.clear();
+      _end = 0;
+
+      const uint64_t file_size = boost::filesystem::file_size( _path );
+      uint64_t pos = 0;
+      while( file_size - pos >= header_size + sizeof(uint64_t) ) {
+         uint32_t magic = 0;
+         block_id_type id;
+         uint32_t size = 0;
+         _file.seek( pos );
+         _file.read( reinterpret_cast<char*>(&magic), sizeof(magic) );
+         _file.read( id.data(), sizeof(block_id_type) );
+         _file.read( reinterpret_cast<char*>(&size), sizeof(size) );
+         if( magic != magic_number ) break;
+         if( file_size - pos - header_size - sizeof(uint64_t) < size ) break;
+
+         uint64_t trailing_pos = 0;
+         _file.seek( pos + header_size + size );
+         _file.read( reinterpret_cast<char*>(&trailing_pos), sizeof(trailing_pos) );
+         if( trailing_pos != pos ) break;
+
+         const uint32_t block_num = block_header::num_from_id( id );
+         if( !_entries.empty() && block_num != last_block_num() + 1 ) break;
+
+         _entries.push_back( entry{ id, pos, size } );
+         pos += header_size + size + sizeof(uint64_t);
+      }
+      _end = pos;
+
+      if( _end != file_size ) {
+         wlog( "reversible block journal ${p}: discarding ${n} bytes of incomplete or inconsistent records after block ${b}",
+               ("p", _path.generic_string())("n", file_size - _end)("b", _entries.empty() ? 0 : last_block_num()) );
+         truncate_file( _end );
+      }
+   }
+
+   void reversible_block_journal::compact() {
+      const fc::path tmp_path = _path.generic_string() + ".tmp";
+      const uint64_t dead = _entries.front().pos;
+      {
+         fc::cfile tmp;
+         tmp.set_file_path( tmp_path );
+         tmp.open( fc::cfile::truncate_rw_mode );
+
+         std::vector<char> record;
+         for( auto& e : _entries ) {
+            const uint64_t record_size = header_size + e.size;
+            record.resize( record_size );
+            _file.seek( e.pos );
+            _file.read( record.data(), record.size() );
+            const uint64_t new_pos = e.pos - dead;
+            tmp.write( record.data(), record.size() );
+            tmp.write( reinterpret_cast<const char*>(&new_pos), sizeof(new_pos) );
+         }
+         tmp.flush();
+         tmp.sync();
+         tmp.close();
+      }
+
+      _file.close();
+      fc::rename( tmp_path, _path );
+      _file.open( fc::cfile::update_rw_mode );
+
+      for( auto& e : _entries ) e.pos -= dead;
+      _end -= dead;
+   }
+
+} } // eosio::chain
@@ -1,21 +1,111 @@
 #include <eosio/chain/thread_utils.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <fc/io/fstream.hpp>
 #include <fc/log/logger_config.hpp>
 
+#include <boost/algorithm/string.hpp>
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#endif
+
 namespace eosio { namespace chain {
 
+static void set_thread_affinity( const std::string& thread_name, const std::vector<uint32_t>& cpus ) {
+#ifdef __linux__
+   cpu_set_t set;
+   CPU_ZERO( &set );
+   for( auto cpu : cpus ) {
+      if( cpu < CPU_SETSIZE ) CPU_SET( cpu, &set );
+   }
+   int r = pthread_setaffinity_np( pthread_self(), sizeof(set), &set );
+   if( r != 0 ) {
+      wlog( "unable to bind thread ${t} to cpus: ${e}", ("t", thread_name)("e", strerror( r )) );
+      return;
+   }
+
+   // report what the kernel actually applied, cpus that are offline or outside of the cpuset of the process are dropped
+   CPU_ZERO( &set );
+   pthread_getaffinity_np( pthread_self(), sizeof(set), &set );
+   std::string placed;
+   for( int cpu = 0; cpu < CPU_SETSIZE; ++cpu ) {
+      if( CPU_ISSET( cpu, &set ) ) {
+         if( !placed.empty() ) placed += ",";
+         placed += std::to_string( cpu );
+      }
+   }
+   ilog( "thread ${t} bound to cpus ${c}, running on cpu ${r}", ("t", thread_name)("c", placed)("r", sched_getcpu()) );
+#else
+   wlog( "cpu affinity is not supported on this platform, placement of thread ${t} is left to the operating system",
+         ("t", thread_name) );
+#endif
+}
+
+static uint32_t parse_cpu( const std::string& s, const std::string& spec ) {
+   EOS_ASSERT( !s.empty() && s.size() <= 5 && std::all_of( s.begin(), s.end(), []( char c ) { return c >= '0' && c <= '9'; } ),
+               plugin_config_exception, "invalid cpu ${c} in cpu affinity \"${s}\"", ("c", s)("s", spec) );
+   return std::stoul( s );
+}
+
+static std::vector<uint32_t> parse_cpu_list( const std::string& list, const std::string& spec ) {
+   std::vector<uint32_t> cpus;
+   std::vector<std::string> ranges;
+   boost::split( ranges, list, boost::is_any_of( "," ) );
+   for( auto& range : ranges ) {
+      boost::trim( range );
+      auto dash = range.find( '-' );
+      if( dash == std::string::npos ) {
+         cpus.push_back( parse_cpu( range, spec ) );
+      } else {
+         const uint32_t first = parse_cpu( range.substr( 0, dash ), spec );
+         const uint32_t last  = parse_cpu( range.substr( dash + 1 ), spec );
+         EOS_ASSERT( first <= last, plugin_config_exception, "invalid cpu range ${r} in cpu affinity \"${s}\"", ("r", range)("s", spec) );
+         for( uint32_t cpu = first; cpu <= last; ++cpu ) cpus.push_back( cpu );
+      }
+   }
+   std::sort( cpus.begin(), cpus.end() );
+   cpus.erase( std::unique( cpus.begin(), cpus.end() ), cpus.end() );
+   return cpus;
+}
+
+std::vector<uint32_t> parse_cpu_affinity( const std::string& spec ) {
+   const std::string node_prefix = "node:";
+   if( spec.empty() ) return {};
+   if( spec.compare( 0, node_prefix.size(), node_prefix ) != 0 ) return parse_cpu_list( spec, spec );
+
+   const uint32_t node = parse_cpu( spec.substr( node_prefix.size() ), spec );
+   const fc::path cpulist = fc::path( "/sys/devices/system/node" ) / ("node" + std::to_string( node )) / "cpulist";
+   if( !fc::exists( cpulist ) ) {
+      wlog( "NUMA topology of node ${n} is not available, placement is left to the operating system", ("n", node) );
+      return {};
+   }
+   std::string list;
+   fc::read_file_contents( cpulist, list );
+   boost::trim( list );
+   if( list.empty() ) {
+      wlog( "NUMA node ${n} has no cpus, placement is left to the operating system", ("n", node) );
+      return {};
+   }
+   return parse_cpu_list( list, spec );
+}
 
 //
 // named_thread_pool
 //
-named_thread_pool::named_thread_pool( std::string name_prefix, size_t num_threads )
+named_thread_pool::named_thread_pool( std::string name_prefix, size_t num_threads, std::vector<uint32_t> cpus )
 : _thread_pool( num_threads )
 , _ioc( num_threads )
 {
    _ioc_work.emplace( boost::asio::make_work_guard( _ioc ) );
    for( size_t i = 0; i < num_threads; ++i ) {
-      boost::asio::post( _thread_pool, [&ioc = _ioc, name_prefix, i]() {
+      boost::asio::post( _thread_pool, [&ioc = _ioc, name_prefix, i, cpus]() {
          std::string tn = name_prefix + "-" + std::to_string( i );
          fc::set_os_thread_name( tn );
+         if( !cpus.empty() ) set_thread_affinity( tn, cpus );
          ioc.run();
       } );
    }
@@ -25,12 +115,28 @@ named_thread_pool::~named_thread_pool() {
    stop();
 }
 
+bool named_thread_pool::run_highest_priority_task() {
+   std::function<void()> task;
+   {
+      std::lock_guard<std::mutex> g( _queue_mtx );
+      if( _queue.empty() ) return false;
+      task = std::move( _queue.top().task );
+      _queue.pop();
+   }
+   task();
+   return true;
+}
+
 void named_thread_pool::stop() {
    _ioc_work.reset();
    _ioc.stop();
    _thread_pool.join();
    _thread_pool.stop();
+   // the runners of queued tasks were dropped with the io_context, dropping the tasks as well would break the promises
+   // of their futures
+   while( run_highest_priority_task() )
+      ;
 }
 
 
-} } // eosio::chain
\ No newline at end of file
+} } // eosio::chain
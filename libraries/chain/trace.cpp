@@ -35,4 +35,17 @@ action_trace::action_trace(
 ,producer_block_id( trace.producer_block_id )
 {}
 
+void materialize_action_traces( transaction_trace& tt ) {
+   for( auto& at : tt.action_traces ) {
+      if( at.receiver == at.act.account || !at.act.authorization.empty() || !at.act.data.empty() )
+         continue;
+      const uint32_t ancestor = at.closest_unnotified_ancestor_action_ordinal;
+      if( ancestor == 0 || ancestor > tt.action_traces.size() )
+         continue;
+      const action& provided_action = tt.action_traces[ancestor-1].act;
+      at.act.authorization = provided_action.authorization;
+      at.act.data          = provided_action.data;
+   }
+}
+
 } } // eosio::chain
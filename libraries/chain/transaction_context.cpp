@@ -52,6 +52,8 @@ namespace eosio { namespace chain {
    ,undo_session(!c.skip_db_sessions() ? c.kv_db().make_session() : c.kv_db().make_no_op_session())
    ,trace(std::make_shared<transaction_trace>())
    ,start(s)
+   ,validate_ram_usage(arena_allocator<account_name>(arena))
+   ,validate_disk_usage(arena_allocator<account_name>(arena))
    ,transaction_timer(std::move(tmr))
    ,net_usage(trace->net_usage)
    ,pseudo_start(s)
@@ -633,9 +635,20 @@ namespace eosio { namespace chain {
 
       // The reserve above is required so that the emplace_back below does not invalidate the provided_action reference.
 
-      trace->action_traces.emplace_back( *trace, provided_action, receiver, context_free,
-                                         new_action_ordinal, creator_action_ordinal,
-                                         closest_unnotified_ancestor_action_ordinal );
+      if( compact_notification_traces ) {
+         // nothing on the execution path reads the action of a notification trace beyond its account and name,
+         // apply_context keeps reading the action of the first receiver
+         action compact_action;
+         compact_action.account = provided_action.account;
+         compact_action.name    = provided_action.name;
+         trace->action_traces.emplace_back( *trace, std::move(compact_action), receiver, context_free,
+                                            new_action_ordinal, creator_action_ordinal,
+                                            closest_unnotified_ancestor_action_ordinal );
+      } else {
+         trace->action_traces.emplace_back( *trace, provided_action, receiver, context_free,
+                                            new_action_ordinal, creator_action_ordinal,
+                                            closest_unnotified_ancestor_action_ordinal );
+      }
 
       return new_action_ordinal;
    }
@@ -703,6 +716,12 @@ namespace eosio { namespace chain {
    }
 
    void transaction_context::record_transaction( const transaction_id_type& id, fc::time_point_sec expire ) {
+      if( auto* trx_dedup = control.kv_db().get_transaction_dedup_index() ) {
+         // ids recorded before the dedup index was enabled remain in the transaction_multi_index until they expire
+         EOS_ASSERT( !control.db().find<transaction_object, by_trx_id>( id ) && trx_dedup->insert( id, expire ),
+                     tx_duplicate, "duplicate transaction ${id}", ("id", id ) );
+         return;
+      }
       try {
           control.mutable_db().create<transaction_object>([&](transaction_object& transaction) {
               transaction.trx_id = id;
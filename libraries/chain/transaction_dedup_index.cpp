@@ -0,0 +1,186 @@
+#include <eosio/chain/transaction_dedup_index.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <fc/io/fstream.hpp>
+#include <fc/io/raw.hpp>
+
+#include <fstream>
+
+namespace eosio { namespace chain {
+
+   bool transaction_dedup_index::insert( const transaction_id_type& id, time_point_sec expiration ) {
+      const uint32_t sec = expiration.sec_since_epoch();
+      if( !_ids.try_emplace( id, entry{ sec, _next_seq } ).second ) return false;
+
+      _buckets[sec].push_back( id );
+      if( !_undo_stack.empty() ) {
+         _undo_stack.back().push_back( undo_op{ id, sec, _next_seq, false } );
+      }
+      ++_next_seq;
+      return true;
+   }
+
+   size_t transaction_dedup_index::remove_expired( const fc::time_point& now ) {
+      size_t removed = 0;
+      while( !_buckets.empty() && now > fc::time_point( time_point_sec( _buckets.begin()->first ) ) ) {
+         const auto& [sec, ids] = *_buckets.begin();
+         // recorded last to first so that undo, which replays in reverse, restores the bucket in its original order
+         for( auto itr = ids.rbegin(); itr != ids.rend(); ++itr ) {
+            auto i = _ids.find( *itr );
+            if( !_undo_stack.empty() ) {
+               _undo_stack.back().push_back( undo_op{ *itr, sec, i->second.seq, true } );
+            }
+            _ids.erase( i );
+         }
+         removed += ids.size();
+         _buckets.erase( _buckets.begin() );
+      }
+      return removed;
+   }
+
+   void transaction_dedup_index::start_session() {
+      _undo_stack.emplace_back();
+      ++_revision;
+   }
+
+   void transaction_dedup_index::squash() {
+      if( _undo_stack.empty() ) return;
+      if( _undo_stack.size() > 1 ) {
+         auto& top   = _undo_stack.back();
+         auto& below = _undo_stack[_undo_stack.size() - 2];
+         below.insert( below.end(), top.begin(), top.end() );
+      }
+      _undo_stack.pop_back();
+      --_revision;
+   }
+
+   void transaction_dedup_index::undo() {
+      if( _undo_stack.empty() ) return;
+      const auto& ops = _undo_stack.back();
+      for( auto itr = ops.rbegin(); itr != ops.rend(); ++itr ) {
+         if( itr->expired ) {
+            _ids.emplace( itr->id, entry{ itr->expiration, itr->seq } );
+            _buckets[itr->expiration].push_back( itr->id );
+         } else {
+            // ids are undone in reverse order of insertion, so the id is always the last one of its bucket
+            _ids.erase( itr->id );
+            auto b = _buckets.find( itr->expiration );
+            EOS_ASSERT( b != _buckets.end() && !b->second.empty() && b->second.back() == itr->id, database_exception,
+                        "transaction dedup index is inconsistent with its undo stack" );
+            b->second.pop_back();
+            if( b->second.empty() ) _buckets.erase( b );
+            // the sequence numbers of undone ids are handed out again, as chainbase does with the ids of undone objects
+            _next_seq = itr->seq;
+         }
+      }
+      _undo_stack.pop_back();
+      --_revision;
+   }
+
+   void transaction_dedup_index::commit( int64_t revision ) {
+      while( !_undo_stack.empty() && _revision - static_cast<int64_t>(_undo_stack.size()) + 1 <= revision ) {
+         _undo_stack.pop_front();
+      }
+   }
+
+   void transaction_dedup_index::set_revision( int64_t revision ) {
+      EOS_ASSERT( _undo_stack.empty(), database_exception,
+                  "cannot set revision of transaction dedup index while it has undo layers" );
+      _revision = revision;
+   }
+
+   void transaction_dedup_index::write( const fc::path& p )const {
+      // the file marks that the state database keeps its ids here, so it is replaced in one step
+      const auto tmp = p.generic_string() + ".tmp";
+      std::ofstream out( tmp.c_str(), std::ios::out | std::ios::binary | std::ofstream::trunc );
+      fc::raw::pack( out, magic_number );
+      fc::raw::pack( out, max_supported_version );
+      fc::raw::pack( out, _revision );
+      fc::raw::pack( out, _next_seq );
+
+      fc::raw::pack( out, _buckets.size() );
+      for( const auto& [sec, ids] : _buckets ) {
+         fc::raw::pack( out, sec );
+         fc::raw::pack( out, ids.size() );
+         for( const auto& id : ids ) {
+            fc::raw::pack( out, id );
+            fc::raw::pack( out, _ids.at( id ).seq );
+         }
+      }
+
+      fc::raw::pack( out, _undo_stack.size() );
+      for( const auto& ops : _undo_stack ) {
+         fc::raw::pack( out, ops.size() );
+         for( const auto& op : ops ) {
+            fc::raw::pack( out, op.id );
+            fc::raw::pack( out, op.expiration );
+            fc::raw::pack( out, op.seq );
+            fc::raw::pack( out, op.expired );
+         }
+      }
+      out.close();
+      EOS_ASSERT( out.good(), database_exception, "failed to write transaction dedup index to ${p}", ("p", tmp) );
+      fc::rename( tmp, p );
+   }
+
+   void transaction_dedup_index::read( const fc::path& p ) {
+      try {
+         std::string content;
+         fc::read_file_contents( p, content );
+         fc::datastream<const char*> ds( content.data(), content.size() );
+
+         uint32_t totem = 0;
+         fc::raw::unpack( ds, totem );
+         EOS_ASSERT( totem == magic_number, database_exception,
+                     "Transaction dedup file '${filename}' has unexpected magic number: ${actual_totem}. Expected ${expected_totem}",
+                     ("filename", p.generic_string())("actual_totem", totem)("expected_totem", magic_number) );
+
+         uint32_t version = 0;
+         fc::raw::unpack( ds, version );
+         EOS_ASSERT( version >= min_supported_version && version <= max_supported_version, database_exception,
+                     "Unsupported version of transaction dedup file '${filename}'. "
+                     "Transaction dedup data version is ${version} while code supports version(s) [${min},${max}]",
+                     ("filename", p.generic_string())("version", version)
+                     ("min", min_supported_version)("max", max_supported_version) );
+
+         _ids.clear();
+         _buckets.clear();
+         _undo_stack.clear();
+
+         fc::raw::unpack( ds, _revision );
+         fc::raw::unpack( ds, _next_seq );
+
+         size_t num_buckets = 0;
+         fc::raw::unpack( ds, num_buckets );
+         for( size_t i = 0; i < num_buckets; ++i ) {
+            uint32_t sec = 0;
+            fc::raw::unpack( ds, sec );
+            auto& ids = _buckets[sec];
+            size_t num_ids = 0;
+            fc::raw::unpack( ds, num_ids );
+            ids.resize( num_ids );
+            for( auto& id : ids ) {
+               entry e{ sec, 0 };
+               fc::raw::unpack( ds, id );
+               fc::raw::unpack( ds, e.seq );
+               _ids.emplace( id, e );
+            }
+         }
+
+         size_t num_layers = 0;
+         fc::raw::unpack( ds, num_layers );
+         for( size_t i = 0; i < num_layers; ++i ) {
+            auto& ops = _undo_stack.emplace_back();
+            size_t num_ops = 0;
+            fc::raw::unpack( ds, num_ops );
+            ops.resize( num_ops );
+            for( auto& op : ops ) {
+               fc::raw::unpack( ds, op.id );
+               fc::raw::unpack( ds, op.expiration );
+               fc::raw::unpack( ds, op.seq );
+               fc::raw::unpack( ds, op.expired );
+            }
+         }
+      } FC_CAPTURE_AND_RETHROW( (p) )
+   }
+
+} } // eosio::chain
@@ -4,13 +4,11 @@
 
 namespace eosio { namespace chain {
 
-recover_keys_future transaction_metadata::start_recover_keys( packed_transaction_ptr trx,
-                                                              boost::asio::io_context& thread_pool,
-                                                              const chain_id_type& chain_id,
-                                                              fc::microseconds time_limit,
-                                                              uint32_t max_variable_sig_size )
+std::function<transaction_metadata_ptr()>
+transaction_metadata::make_recover_keys_task( packed_transaction_ptr trx, const chain_id_type& chain_id,
+                                              fc::microseconds time_limit, uint32_t max_variable_sig_size )
 {
-   return async_thread_pool( thread_pool, [trx{std::move(trx)}, chain_id, time_limit, max_variable_sig_size]() mutable {
+   return [trx{std::move(trx)}, chain_id, time_limit, max_variable_sig_size]() mutable {
          fc::time_point deadline = time_limit == fc::microseconds::maximum() ?
                                    fc::time_point::maximum() : fc::time_point::now() + time_limit;
          const vector<signature_type>& sigs = check_variable_sig_size( trx, max_variable_sig_size );
@@ -21,8 +19,27 @@ recover_keys_future transaction_metadata::start_recover_keys( packed_transaction
          fc::microseconds cpu_usage =
                trx->get_transaction().get_signature_keys(sigs, chain_id, deadline, *context_free_data, recovered_pub_keys, allow_duplicate_keys);
          return std::make_shared<transaction_metadata>( private_type(), std::move( trx ), cpu_usage, std::move( recovered_pub_keys ) );
-      }
-   );
+      };
+}
+
+recover_keys_future transaction_metadata::start_recover_keys( packed_transaction_ptr trx,
+                                                              boost::asio::io_context& thread_pool,
+                                                              const chain_id_type& chain_id,
+                                                              fc::microseconds time_limit,
+                                                              uint32_t max_variable_sig_size )
+{
+   return async_thread_pool( thread_pool, make_recover_keys_task( std::move(trx), chain_id, time_limit, max_variable_sig_size ) );
+}
+
+recover_keys_future transaction_metadata::start_recover_keys( packed_transaction_ptr trx,
+                                                              named_thread_pool& thread_pool,
+                                                              int priority,
+                                                              const chain_id_type& chain_id,
+                                                              fc::microseconds time_limit,
+                                                              uint32_t max_variable_sig_size )
+{
+   return async_thread_pool( thread_pool, priority,
+                             make_recover_keys_task( std::move(trx), chain_id, time_limit, max_variable_sig_size ) );
 }
 
 uint32_t transaction_metadata::get_estimated_size() const {
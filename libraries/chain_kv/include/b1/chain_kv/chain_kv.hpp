@@ -1,6 +1,8 @@
 #pragma once
 
 #include <fc/io/raw.hpp>
+#include <deque>
+#include <mutex>
 #include <optional>
 #include <rocksdb/db.h>
 #include <rocksdb/table.h>
@@ -421,6 +423,83 @@ void pack_undo_segment(Stream& s, const bytes& key, const bytes* old_value, cons
    pack_optional_bytes(s, new_value);
 }
 
+// Read-only snapshots of the database at the end of recent revisions, for readers which query a past revision while
+// undo_stack moves on. Thread safe; undo_stack adds and drops snapshots, readers on other threads get them.
+//
+// undo_stack takes the snapshot of a revision when it pushes the next one, so everything written for the revision
+// must be written before the push. Snapshots of revisions which are undone (e.g. on a fork switch) or squashed are
+// dropped. Only the `retention` newest revisions are kept: a snapshot keeps rocksdb from compacting away the values
+// it sees, so retention bounds the extra disk use. A reader keeps a consistent view until it releases its
+// snapshot_ptr, even after the snapshot left the window. snapshot_ptrs must be released before the database closes.
+class revision_snapshots {
+ public:
+   using snapshot_ptr = std::shared_ptr<const rocksdb::Snapshot>;
+
+   revision_snapshots(database& db, uint32_t retention) : db{ db }, retention{ retention } {}
+
+   revision_snapshots(const revision_snapshots&) = delete;
+   revision_snapshots& operator=(const revision_snapshots&) = delete;
+
+   uint32_t get_retention() const {
+      std::lock_guard<std::mutex> lock{ mutex };
+      return retention;
+   }
+
+   void set_retention(uint32_t r) {
+      std::lock_guard<std::mutex> lock{ mutex };
+      retention = r;
+      trim();
+   }
+
+   // Snapshot of the database at the end of revision. nullptr if it isn't retained.
+   snapshot_ptr get(int64_t revision) const {
+      std::lock_guard<std::mutex> lock{ mutex };
+      if (snapshots.empty() || revision < snapshots.front().first || revision > snapshots.back().first)
+         return nullptr;
+      return snapshots[revision - snapshots.front().first].second;
+   }
+
+   // Oldest and newest retained revisions. nullopt if none are retained.
+   std::optional<std::pair<int64_t, int64_t>> range() const {
+      std::lock_guard<std::mutex> lock{ mutex };
+      if (snapshots.empty())
+         return {};
+      return std::make_pair(snapshots.front().first, snapshots.back().first);
+   }
+
+   // Snapshot the current state of the database as the end of revision
+   void add(int64_t revision) {
+      std::lock_guard<std::mutex> lock{ mutex };
+      if (!retention)
+         return;
+      // retained revisions are consecutive
+      if (!snapshots.empty() && revision != snapshots.back().first + 1)
+         snapshots.clear();
+      auto* rdb = db.rdb.get();
+      snapshots.emplace_back(revision,
+                             snapshot_ptr{ rdb->GetSnapshot(), [rdb](const rocksdb::Snapshot* s) { rdb->ReleaseSnapshot(s); } });
+      trim();
+   }
+
+   // Drop the snapshots of revision and later
+   void drop_from(int64_t revision) {
+      std::lock_guard<std::mutex> lock{ mutex };
+      while (!snapshots.empty() && snapshots.back().first >= revision) //
+         snapshots.pop_back();
+   }
+
+ private:
+   void trim() {
+      while (snapshots.size() > retention) //
+         snapshots.pop_front();
+   }
+
+   database&                                    db;
+   mutable std::mutex                           mutex;
+   uint32_t                                     retention;
+   std::deque<std::pair<int64_t, snapshot_ptr>> snapshots; // ascending, consecutive revisions
+}; // revision_snapshots
+
 class undo_stack {
  private:
    database&  db;
@@ -430,6 +509,7 @@ class undo_stack {
    bytes      segment_prefix;
    bytes      segment_next_prefix;
    undo_state state;
+   std::shared_ptr<revision_snapshots> snapshots;
 
  public:
    undo_stack(database& db, const bytes& undo_prefix, uint64_t target_segment_size = 64 * 1024 * 1024)
@@ -463,6 +543,11 @@ class undo_stack {
    int64_t revision() const { return state.revision; }
    int64_t first_revision() const { return state.revision - state.undo_stack.size(); }
 
+   // Keep snapshots of the revisions this stack goes through in s. nullptr stops keeping them.
+   void retain_snapshots(std::shared_ptr<revision_snapshots> s) { snapshots = std::move(s); }
+
+   const std::shared_ptr<revision_snapshots>& get_snapshots() const { return snapshots; }
+
    void set_revision(uint64_t revision, bool write_now = true) {
       if (state.undo_stack.size() != 0)
          throw exception("cannot set revision while there is an existing undo stack");
@@ -477,6 +562,8 @@ class undo_stack {
 
    // Create a new entry on the undo stack
    void push(bool write_now = true) {
+      if (snapshots)
+         snapshots->add(state.revision);
       state.undo_stack.push_back(0);
       ++state.revision;
       if (write_now)
@@ -494,6 +581,8 @@ class undo_stack {
                "undo_stack::squash: rocksdb::WriteBatch::DeleteRange: ");
          state.undo_stack.clear();
          --state.revision;
+         if (snapshots)
+            snapshots->drop_from(state.revision);
          write_state(batch);
          db.write(batch);
          return;
@@ -502,6 +591,8 @@ class undo_stack {
       state.undo_stack.pop_back();
       state.undo_stack.back() += n;
       --state.revision;
+      if (snapshots)
+         snapshots->drop_from(state.revision);
       if (write_now)
          write_state();
    }
@@ -543,6 +634,9 @@ class undo_stack {
       state.next_undo_segment -= state.undo_stack.back();
       state.undo_stack.pop_back();
       --state.revision;
+      // the revision is being written again
+      if (snapshots)
+         snapshots->drop_from(state.revision);
       if (write_now) {
          write_state(batch);
          db.write(batch);
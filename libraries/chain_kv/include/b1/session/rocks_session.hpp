@@ -198,6 +198,8 @@ inline session<rocksdb_t>::session(std::shared_ptr<rocksdb::DB> db, size_t max_i
          read_options.verify_checksums                     = false;
          read_options.fill_cache                           = false;
          read_options.background_purge_on_iterator_cleanup = true;
+         // iterators are reused for any key and walk past the end of a prefix, ignore a prefix extractor if any
+         read_options.total_order_seek                     = true;
          return read_options;
       }() },
       m_iterators{ [&]() {
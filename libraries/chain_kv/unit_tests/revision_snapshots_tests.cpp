@@ -0,0 +1,179 @@
+#include "chain_kv_tests.hpp"
+#include <boost/filesystem.hpp>
+
+#include <atomic>
+#include <thread>
+
+using chain_kv::bytes;
+using chain_kv::to_slice;
+
+BOOST_AUTO_TEST_SUITE(revision_snapshots_tests)
+
+namespace {
+
+void write(chain_kv::database& db, chain_kv::undo_stack& undo_stack, char value) {
+   chain_kv::write_session session{ db };
+   session.set({ 0x20, 0x00 }, to_slice({ value }));
+   session.set({ 0x20, value }, to_slice({ value }));
+   session.write_changes(undo_stack);
+}
+
+// values at the end of the revision which wrote value
+kv_values expected(char value) {
+   kv_values result{ { { { 0x20, 0x00 }, { value } } } };
+   for (char v = 1; v <= value; ++v) result.values.push_back({ { 0x20, v }, { v } });
+   return result;
+}
+
+std::vector<bytes> keys() {
+   std::vector<bytes> result;
+   for (char v = 0; v < 16; ++v) result.push_back({ 0x20, v });
+   return result;
+}
+
+kv_values read(chain_kv::database& db, const chain_kv::revision_snapshots::snapshot_ptr& snap) {
+   BOOST_REQUIRE(snap);
+   chain_kv::write_session session{ db, snap.get() };
+   return get_values(session, keys());
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(test_retained_revisions) {
+   boost::filesystem::remove_all("test-revision-snapshots-db");
+   chain_kv::database   db{ "test-revision-snapshots-db", true };
+   chain_kv::undo_stack undo_stack{ db, bytes{ 0x10 } };
+   auto                 snapshots = std::make_shared<chain_kv::revision_snapshots>(db, 3);
+   undo_stack.retain_snapshots(snapshots);
+
+   // revision r writes value r, its snapshot is taken when r + 1 is pushed
+   undo_stack.set_revision(1);
+   write(db, undo_stack, 1);
+   BOOST_REQUIRE(!snapshots->range());
+   for (char r = 2; r <= 5; ++r) {
+      undo_stack.push();
+      write(db, undo_stack, r);
+   }
+   BOOST_REQUIRE_EQUAL(undo_stack.revision(), 5);
+   BOOST_REQUIRE(snapshots->range() == std::make_pair(int64_t(2), int64_t(4)));
+   BOOST_REQUIRE(!snapshots->get(1));
+   BOOST_REQUIRE(!snapshots->get(5));
+   for (char r = 2; r <= 4; ++r) BOOST_REQUIRE_EQUAL(read(db, snapshots->get(r)), expected(r));
+
+   // a held snapshot outlives the window
+   auto held = snapshots->get(2);
+   snapshots->set_retention(1);
+   BOOST_REQUIRE(snapshots->range() == std::make_pair(int64_t(4), int64_t(4)));
+   BOOST_REQUIRE(!snapshots->get(2));
+   BOOST_REQUIRE_EQUAL(read(db, held), expected(2));
+   held.reset();
+
+   // retention 0 keeps nothing
+   snapshots->set_retention(0);
+   undo_stack.push();
+   BOOST_REQUIRE(!snapshots->range());
+}
+
+BOOST_AUTO_TEST_CASE(test_fork_switch) {
+   boost::filesystem::remove_all("test-revision-snapshots-db");
+   chain_kv::database   db{ "test-revision-snapshots-db", true };
+   chain_kv::undo_stack undo_stack{ db, bytes{ 0x10 } };
+   auto                 snapshots = std::make_shared<chain_kv::revision_snapshots>(db, 10);
+   undo_stack.retain_snapshots(snapshots);
+
+   undo_stack.set_revision(1);
+   write(db, undo_stack, 1);
+   for (char r = 2; r <= 5; ++r) {
+      undo_stack.push();
+      write(db, undo_stack, r);
+   }
+   undo_stack.push();
+   BOOST_REQUIRE(snapshots->range() == std::make_pair(int64_t(1), int64_t(5)));
+
+   // a reader of revision 4 keeps seeing it while revisions 4 and 5 are undone and rewritten by another fork
+   auto old_fork = snapshots->get(4);
+   undo_stack.undo();
+   undo_stack.undo();
+   undo_stack.undo();
+   BOOST_REQUIRE_EQUAL(undo_stack.revision(), 3);
+   BOOST_REQUIRE(snapshots->range() == std::make_pair(int64_t(1), int64_t(2)));
+   BOOST_REQUIRE(!snapshots->get(3));
+   {
+      chain_kv::write_session session{ db };
+      session.set({ 0x20, 0x00 }, to_slice({ 0x40 }));
+      session.write_changes(undo_stack);
+   }
+   undo_stack.push();
+   write(db, undo_stack, 4);
+   undo_stack.push();
+   BOOST_REQUIRE(snapshots->range() == std::make_pair(int64_t(1), int64_t(4)));
+   BOOST_REQUIRE_EQUAL(read(db, old_fork), expected(4));
+   BOOST_REQUIRE_EQUAL(read(db, snapshots->get(3)), (kv_values{ {
+                                                             { { 0x20, 0x00 }, { 0x40 } },
+                                                             { { 0x20, 0x01 }, { 0x01 } },
+                                                             { { 0x20, 0x02 }, { 0x02 } },
+                                                             { { 0x20, 0x03 }, { 0x03 } },
+                                                       } }));
+   BOOST_REQUIRE_EQUAL(read(db, snapshots->get(4)), expected(4));
+   old_fork.reset();
+
+   // squashed revisions are no longer a state of their own
+   undo_stack.squash();
+   BOOST_REQUIRE_EQUAL(undo_stack.revision(), 4);
+   BOOST_REQUIRE(snapshots->range() == std::make_pair(int64_t(1), int64_t(3)));
+
+   // commit keeps the snapshots
+   undo_stack.commit(4);
+   BOOST_REQUIRE(snapshots->range() == std::make_pair(int64_t(1), int64_t(3)));
+}
+
+BOOST_AUTO_TEST_CASE(test_concurrent_readers) {
+   boost::filesystem::remove_all("test-revision-snapshots-db");
+   chain_kv::database   db{ "test-revision-snapshots-db", true };
+   chain_kv::undo_stack undo_stack{ db, bytes{ 0x10 } };
+   auto                 snapshots = std::make_shared<chain_kv::revision_snapshots>(db, 4);
+   undo_stack.retain_snapshots(snapshots);
+
+   // the writer goes back and forth between revisions 1 - 15, replaying the same values; readers check that every
+   // retained revision they find reads as written
+   std::atomic<bool>     done{ false };
+   std::atomic<uint64_t> reads{ 0 };
+   std::atomic<uint64_t> failures{ 0 };
+   std::vector<std::thread> readers;
+   for (int i = 0; i < 4; ++i) {
+      readers.emplace_back([&] {
+         while (!done) {
+            auto range = snapshots->range();
+            if (!range)
+               continue;
+            for (auto r = range->first; r <= range->second; ++r) {
+               auto snap = snapshots->get(r);
+               if (!snap)
+                  continue;
+               chain_kv::write_session session{ db, snap.get() };
+               if (!(get_values(session, keys()) == expected(char(r))))
+                  ++failures;
+               ++reads;
+            }
+         }
+      });
+   }
+
+   undo_stack.set_revision(1);
+   write(db, undo_stack, 1);
+   for (int round = 0; round < 50; ++round) {
+      while (undo_stack.revision() < 15) {
+         undo_stack.push();
+         write(db, undo_stack, char(undo_stack.revision()));
+      }
+      while (undo_stack.revision() > 2 + round % 10) undo_stack.undo();
+   }
+   undo_stack.push();
+   while (!reads) std::this_thread::yield();
+   done = true;
+   for (auto& t : readers) t.join();
+
+   BOOST_REQUIRE_EQUAL(failures.load(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
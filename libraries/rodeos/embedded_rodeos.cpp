@@ -229,6 +229,7 @@ extern "C" rodeos_query_handler* rodeos_create_query_handler(rodeos_error* error
       shared_state->wasm_cache_size  = wasm_cache_size;
       shared_state->max_exec_time_ms = max_exec_time_ms;
       shared_state->contract_dir     = contract_dir ? contract_dir : "";
+      shared_state->partition        = partition->obj;
       return std::make_unique<rodeos_query_handler>(partition->obj, shared_state).release();
    });
 }
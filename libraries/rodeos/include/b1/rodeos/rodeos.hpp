@@ -15,14 +15,17 @@ struct rodeos_context {
 };
 
 struct rodeos_db_partition {
-   const std::shared_ptr<chain_kv::database> db;
-   const std::vector<char>                   undo_prefix;
-   const std::vector<char>                   contract_kv_prefix;
+   const std::shared_ptr<chain_kv::database>           db;
+   const std::vector<char>                             undo_prefix;
+   const std::vector<char>                             contract_kv_prefix;
+   const std::shared_ptr<chain_kv::revision_snapshots> snapshots; // states at the end of recent blocks
 
    // todo: move rocksdb::ManagedSnapshot to here to prevent optimization in cloner from
    //       defeating non-persistent snapshots.
 
-   rodeos_db_partition(std::shared_ptr<chain_kv::database> db, const std::vector<char>& prefix)
+   // snapshots: shared with the partitions which write or read the same blocks; if empty no block states are kept
+   rodeos_db_partition(std::shared_ptr<chain_kv::database> db, const std::vector<char>& prefix,
+                       std::shared_ptr<chain_kv::revision_snapshots> snapshots = {})
        : db{ std::move(db) }, //
          undo_prefix{ [&] {
             auto x = prefix;
@@ -33,14 +36,21 @@ struct rodeos_db_partition {
             auto x = prefix;
             x.push_back(contract_kv_prefix_byte);
             return x;
-         }() } {}
+         }() },
+         snapshots{ snapshots ? std::move(snapshots) : std::make_shared<chain_kv::revision_snapshots>(*this->db, 0) } {}
+};
+
+// Selects the read-only rodeos_db_snapshot of the state at the end of block_num
+struct at_block {
+   uint32_t block_num = 0;
 };
 
 struct rodeos_db_snapshot {
    std::shared_ptr<rodeos_db_partition>    partition       = {};
    std::shared_ptr<chain_kv::database>     db              = {};
    std::optional<chain_kv::undo_stack>     undo_stack      = {}; // only if persistent
-   std::optional<rocksdb::ManagedSnapshot> snap            = {}; // only if !persistent
+   std::optional<rocksdb::ManagedSnapshot> snap            = {}; // only if !persistent and not at a block
+   chain_kv::revision_snapshots::snapshot_ptr block_snap   = {}; // only if at a block
    std::optional<chain_kv::write_session>  write_session   = {};
    eosio::checksum256                      chain_id        = {};
    uint32_t                                head            = 0;
@@ -52,6 +62,10 @@ struct rodeos_db_snapshot {
 
    rodeos_db_snapshot(std::shared_ptr<rodeos_db_partition> partition, bool persistent);
 
+   // Read-only state at the end of a recent block, as retained by partition->snapshots. It stays consistent while the
+   // persistent snapshot writes later blocks or switches forks. Throws if the block's state isn't retained.
+   rodeos_db_snapshot(std::shared_ptr<rodeos_db_partition> partition, at_block block);
+
    void refresh();
    void end_write(bool write_fill);
    void start_block(const eosio::ship_protocol::get_blocks_result_base& result);
@@ -67,6 +81,7 @@ struct rodeos_db_snapshot {
                          const eosio::ship_protocol::signed_block_header& block);
    void write_deltas(uint32_t block_num, eosio::opaque<std::vector<eosio::ship_protocol::table_delta>> deltas, std::function<bool()> shutdown);
    void write_fill_status();
+   void read_fill_status();
 };
 
 struct rodeos_filter {
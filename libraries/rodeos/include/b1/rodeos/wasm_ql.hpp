@@ -6,6 +6,10 @@
 #include <b1/rodeos/callbacks/query.hpp>
 #include <eosio/ship_protocol.hpp>
 
+namespace b1::rodeos {
+struct rodeos_db_partition;
+}
+
 namespace b1::rodeos::wasm_ql {
 
 class backend_cache;
@@ -18,6 +22,7 @@ struct shared_state {
    std::string                             contract_dir     = {};
    std::shared_ptr<wasm_ql::backend_cache> backend_cache    = {};
    std::shared_ptr<chain_kv::database>     db;
+   std::shared_ptr<rodeos_db_partition>    partition        = {}; // serves queries at a recent block, if set
 
    shared_state(std::shared_ptr<chain_kv::database> db);
    shared_state(const shared_state&) = delete;
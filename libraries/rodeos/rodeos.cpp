@@ -18,12 +18,31 @@ rodeos_db_snapshot::rodeos_db_snapshot(std::shared_ptr<rodeos_db_partition> part
     : partition{ std::move(partition) }, db{ this->partition->db } {
    if (persistent) {
       undo_stack.emplace(*db, this->partition->undo_prefix);
+      undo_stack->retain_snapshots(this->partition->snapshots);
       write_session.emplace(*db);
    } else {
       snap.emplace(db->rdb.get());
       write_session.emplace(*db, snap->snapshot());
    }
+   read_fill_status();
+}
+
+rodeos_db_snapshot::rodeos_db_snapshot(std::shared_ptr<rodeos_db_partition> partition, at_block block)
+    : partition{ std::move(partition) }, db{ this->partition->db } {
+   // revisions are block numbers
+   block_snap = this->partition->snapshots->get(block.block_num);
+   if (!block_snap) {
+      auto range = this->partition->snapshots->range();
+      throw std::runtime_error("state of block " + std::to_string(block.block_num) + " is not retained" +
+                               (range ? "; retained blocks are " + std::to_string(range->first) + " - " +
+                                              std::to_string(range->second)
+                                      : std::string{}));
+   }
+   write_session.emplace(*db, block_snap.get());
+   read_fill_status();
+}
 
+void rodeos_db_snapshot::read_fill_status() {
    db_view_state    view_state{ state_account, *db, *write_session, this->partition->contract_kv_prefix };
    fill_status_sing sing{ state_account, view_state, false };
    if (sing.exists()) {
@@ -40,6 +59,8 @@ rodeos_db_snapshot::rodeos_db_snapshot(std::shared_ptr<rodeos_db_partition> part
 void rodeos_db_snapshot::refresh() {
    if (undo_stack)
       throw std::runtime_error("can not refresh a persistent snapshot");
+   if (block_snap)
+      throw std::runtime_error("can not refresh a snapshot at a block");
    snap.emplace(db->rdb.get());
    write_session->snapshot = snap->snapshot();
    write_session->wipe_cache();
@@ -5,6 +5,7 @@
 #include <b1/rodeos/callbacks/console.hpp>
 #include <b1/rodeos/callbacks/memory.hpp>
 #include <b1/rodeos/callbacks/unimplemented.hpp>
+#include <b1/rodeos/rodeos.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/sequenced_index.hpp>
@@ -524,9 +525,10 @@ struct send_transaction_params {
    std::string                   compression              = {};
    eosio::bytes                  packed_context_free_data = {};
    eosio::bytes                  packed_trx               = {};
+   std::optional<uint32_t>       block_num                = {}; // run against the state at the end of this block
 };
 
-EOSIO_REFLECT(send_transaction_params, signatures, compression, packed_context_free_data, packed_trx)
+EOSIO_REFLECT(send_transaction_params, signatures, compression, packed_context_free_data, packed_trx, block_num)
 
 struct send_transaction_results {
    eosio::checksum256   transaction_id; // todo: redundant with processed.id
@@ -555,12 +557,23 @@ const std::vector<char>& query_send_transaction(wasm_ql::thread_state&   thread_
                                                 std::move(params.signatures), params.packed_context_free_data.data } },
                                           params.packed_trx.data };
 
-   rocksdb::ManagedSnapshot snapshot{ thread_state.shared->db->rdb.get() };
+   std::optional<rocksdb::ManagedSnapshot> head_snapshot;
+   std::optional<rodeos_db_snapshot>       block_snapshot;
+   const rocksdb::Snapshot*                snapshot = nullptr;
+   if (params.block_num) {
+      if (!thread_state.shared->partition)
+         throw std::runtime_error("block_num is not supported by this query handler");
+      block_snapshot.emplace(thread_state.shared->partition, at_block{ *params.block_num });
+      snapshot = block_snapshot->block_snap.get();
+   } else {
+      head_snapshot.emplace(thread_state.shared->db->rdb.get());
+      snapshot = head_snapshot->snapshot();
+   }
 
    std::vector<std::vector<char>> memory;
    send_transaction_results       results;
-   results.processed = query_send_transaction(thread_state, contract_kv_prefix, trx, snapshot.snapshot(), memory,
-                                              return_trace_on_except);
+   results.processed =
+         query_send_transaction(thread_state, contract_kv_prefix, trx, snapshot, memory, return_trace_on_except);
 
    // todo: hide variants during json conversion
    // todo: avoid the extra copy
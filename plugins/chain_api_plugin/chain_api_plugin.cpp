@@ -117,7 +117,6 @@ void chain_api_plugin::plugin_startup() {
       CHAIN_RO_CALL(get_abi, 200, http_params_types::params_required),
       CHAIN_RO_CALL(get_raw_code_and_abi, 200, http_params_types::params_required),
       CHAIN_RO_CALL(get_raw_abi, 200, http_params_types::params_required),
-      CHAIN_RO_CALL(get_table_rows, 200, http_params_types::params_required),
       CHAIN_RO_CALL(get_kv_table_rows, 200, http_params_types::params_required),
       CHAIN_RO_CALL(get_table_by_scope, 200, http_params_types::params_required),
       CHAIN_RO_CALL(get_currency_balance, 200, http_params_types::params_required),
@@ -135,6 +134,26 @@ void chain_api_plugin::plugin_startup() {
       CHAIN_RW_CALL_ASYNC(send_transaction, chain_apis::read_write::send_transaction_results, 202, http_params_types::params_required)
    });
    
+   // get_table_rows by a mirrored secondary index is served on the http thread, any other query on the main thread
+   _http_plugin.add_async_handler("/v1/chain/get_table_rows", [ro_api](string, string body, url_response_callback cb) mutable {
+      try {
+         auto params = parse_params<chain_apis::read_only::get_table_rows_params, http_params_types::params_required>(body);
+         if( auto result = ro_api.get_mirrored_table_rows( params ) ) {
+            cb( 200, fc::variant( std::move( *result ) ) );
+            return;
+         }
+         app().post( appbase::priority::medium_low, [ro_api, params=std::move(params), body=std::move(body), cb=std::move(cb)]() mutable {
+            try {
+               cb( 200, fc::variant( ro_api.get_table_rows( params ) ) );
+            } catch (...) {
+               http_plugin::handle_exception("chain", "get_table_rows", body, cb);
+            }
+         });
+      } catch (...) {
+         http_plugin::handle_exception("chain", "get_table_rows", body, cb);
+      }
+   });
+
    if (chain.account_queries_enabled()) {
       _http_plugin.add_async_api({
          CHAIN_RO_CALL_WITH_400(get_accounts_by_authorizers, 200, http_params_types::params_required),
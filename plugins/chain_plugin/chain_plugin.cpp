@@ -9,10 +9,12 @@
 #include <eosio/chain/wasm_interface.hpp>
 #include <eosio/chain/resource_limits.hpp>
 #include <eosio/chain/reversible_block_object.hpp>
+#include <eosio/chain/reversible_block_journal.hpp>
 #include <eosio/chain/controller.hpp>
 #include <eosio/chain/generated_transaction_object.hpp>
 #include <eosio/chain/global_property_object.hpp>
 #include <eosio/chain/snapshot.hpp>
+#include <eosio/chain/thread_utils.hpp>
 #include <eosio/chain/combined_database.hpp>
 #include <eosio/chain/backing_store/kv_context.hpp>
 #include <eosio/to_key.hpp>
@@ -155,6 +157,43 @@ void validate(boost::any& v,
      throw validation_error(validation_error::invalid_option_value);
   }
 }
+
+std::ostream& operator<<(std::ostream& osm, eosio::chain::persistent_storage_profile p) {
+   if ( p == eosio::chain::persistent_storage_profile::DEFAULT ) {
+      osm << "default";
+   } else if ( p == eosio::chain::persistent_storage_profile::TABLE_PREFIX ) {
+      osm << "table-prefix";
+   } else if ( p == eosio::chain::persistent_storage_profile::CONTRACT_PREFIX ) {
+      osm << "contract-prefix";
+   }
+
+   return osm;
+}
+
+void validate(boost::any& v,
+              const std::vector<std::string>& values,
+              eosio::chain::persistent_storage_profile* /* target_type */,
+              int)
+{
+  using namespace boost::program_options;
+
+  // Make sure no previous assignment to 'v' was made.
+  validators::check_first_occurrence(v);
+
+  // Extract the first string from 'values'. If there is more than
+  // one string, it's an error, and exception will be thrown.
+  std::string const& s = validators::get_single_string(values);
+
+  if ( s == "default" ) {
+     v = boost::any(eosio::chain::persistent_storage_profile::DEFAULT);
+  } else if ( s == "table-prefix" ) {
+     v = boost::any(eosio::chain::persistent_storage_profile::TABLE_PREFIX);
+  } else if ( s == "contract-prefix" ) {
+     v = boost::any(eosio::chain::persistent_storage_profile::CONTRACT_PREFIX);
+  } else {
+     throw validation_error(validation_error::invalid_option_value);
+  }
+}
 }
 
 using namespace eosio;
@@ -187,6 +226,7 @@ public:
    bool                             accept_transactions = false;
    bool                             api_accept_transactions = true;
    bool                             account_queries_enabled = false;
+   std::vector<chain_apis::secondary_index_mirror::index_spec> mirrored_secondary_indices;
 
    std::optional<fork_database>      fork_db;
    std::optional<controller::config> chain_config;
@@ -227,6 +267,7 @@ public:
    std::optional<scoped_connection>                                   applied_transaction_connection;
 
    std::optional<chain_apis::account_query_db>                        _account_query_db;
+   std::optional<chain_apis::secondary_index_mirror>                  _secondary_index_mirror;
 
    void do_non_snapshot_startup(std::function<void()> shutdown, std::function<bool()> check_shutdown) {
        if (genesis) {
@@ -242,6 +283,7 @@ chain_plugin::chain_plugin()
    app().register_config_type<eosio::chain::db_read_mode>();
    app().register_config_type<eosio::chain::validation_mode>();
    app().register_config_type<eosio::chain::backing_store_type>();
+   app().register_config_type<eosio::chain::persistent_storage_profile>();
    app().register_config_type<chainbase::pinnable_mapped_file::map_mode>();
    app().register_config_type<eosio::chain::wasm_interface::vm_type>();
 }
@@ -325,13 +367,28 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
           "Rocksdb write rate of flushes and compactions.")
          ("persistent-storage-mbytes-snapshot-batch", bpo::value<uint32_t>()->default_value(config::default_persistent_storage_mbytes_batch),
           "Rocksdb batch size threshold before writing read in snapshot data to database.")
+         ("persistent-storage-profile", boost::program_options::value<eosio::chain::persistent_storage_profile>()->default_value(eosio::chain::persistent_storage_profile::DEFAULT),
+          "Rocksdb filter and index layout of the persistent storage:\n"
+          "\"default\" - whole-key bloom filters and a single index per file\n"
+          "\"table-prefix\" - whole-key and contract/scope/table prefix bloom filters, partitioned index and filters\n"
+          "\"contract-prefix\" - whole-key and contract prefix bloom filters, partitioned index and filters")
+         ("persistent-storage-block-cache-size-mb", bpo::value<uint64_t>()->default_value(config::default_persistent_storage_block_cache_size / (1024  * 1024)),
+          "Size of the rocksdb block cache holding the index and filter partitions (in MiB), used by the table-prefix and contract-prefix profiles")
 
          ("reversible-blocks-db-size-mb", bpo::value<uint64_t>()->default_value(config::default_reversible_cache_size / (1024  * 1024)), "Maximum size (in MiB) of the reversible blocks database")
          ("reversible-blocks-db-guard-size-mb", bpo::value<uint64_t>()->default_value(config::default_reversible_guard_size / (1024  * 1024)), "Safely shut down node when free space remaining in the reverseible blocks database drops below this size (in MiB).")
+         ("reversible-blocks-journal", bpo::value<bool>()->default_value(false),
+          "Keep reversible blocks in an append-only journal file instead of the reversible blocks database. Existing reversible blocks are moved over on startup in either direction. "
+          "The fix-, import- and export-reversible-blocks options only operate on the reversible blocks database.")
+         ("transaction-dedup-index", bpo::value<bool>()->default_value(false),
+          "Keep the ids of unexpired input transactions in a hash index bucketed by expiration instead of the state database. "
+          "The index is written to the state directory on shutdown. Enabling or disabling it requires a replay or a restore from snapshot.")
          ("signature-cpu-billable-pct", bpo::value<uint32_t>()->default_value(config::default_sig_cpu_bill_pct / config::percent_1),
           "Percentage of actual signature recovery cpu to bill. Whole number percentages, e.g. 50 for 50%")
          ("chain-threads", bpo::value<uint16_t>()->default_value(config::default_controller_thread_pool_size),
           "Number of worker threads in controller thread pool")
+         ("chain-threads-cpus", bpo::value<string>(),
+          "CPUs to bind the controller thread pool to, either a list of CPUs and CPU ranges such as 0-3,8 or node:N for the CPUs of NUMA node N")
          ("contracts-console", bpo::bool_switch()->default_value(false),
           "print contract's output to console")
          ("deep-mind", bpo::bool_switch()->default_value(false),
@@ -397,6 +454,10 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
          ("eos-vm-oc-enable", bpo::bool_switch(), "Enable EOS VM OC tier-up runtime")
 #endif
          ("enable-account-queries", bpo::value<bool>()->default_value(false), "enable queries to find accounts by various metadata.")
+         ("mirror-secondary-index", bpo::value<vector<string>>()->composing()->multitoken(),
+          "Keep an in-memory columnar copy of a contract table secondary index to serve get_table_rows by that index on the http threads, "
+          "in the form <code>:<table>:<index_position>:<key_type> where key_type is i64, name or i128 (may specify multiple times). "
+          "Only supported with the chainbase backing store.")
          ("max-nonprivileged-inline-action-size", bpo::value<uint32_t>()->default_value(config::default_max_nonprivileged_inline_action_size), "maximum allowed size (in bytes) of an inline action for a nonprivileged account")
          ;
 
@@ -703,6 +764,17 @@ chain_plugin::do_hard_replay(const variables_map& options) {
                          my->chain_config->blog.log_dir / config::reversible_blocks_dir_name / "shared_memory.bin" );
             }
          }
+         if( reversible_block_journal::exists( backup_dir / config::reversible_blocks_dir_name ) ) {
+            // the journal drops incomplete records itself when opened
+            const auto reversible_dir = my->chain_config->blog.log_dir / config::reversible_blocks_dir_name;
+            fc::create_directories( reversible_dir );
+            fc::copy( backup_dir / config::reversible_blocks_dir_name / reversible_block_journal::file_name,
+                      reversible_dir / reversible_block_journal::file_name );
+            if( const auto truncate_at_block = options.at( "truncate-at-block" ).as<uint32_t>() ) {
+               reversible_block_journal journal( reversible_dir );
+               journal.remove_after( truncate_at_block );
+            }
+         }
 }
 
 void chain_plugin::plugin_initialize(const variables_map& options) {
@@ -865,6 +937,12 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       EOS_ASSERT( my->chain_config->persistent_storage_mbytes_batch > 0, plugin_config_exception,
                   "persistent-storage-mbytes-snapshot-batch ${num} must be greater than 0", ("num", my->chain_config->persistent_storage_mbytes_batch) );
 
+      my->chain_config->persistent_storage_profile = options.at( "persistent-storage-profile" ).as<persistent_storage_profile>();
+
+      my->chain_config->persistent_storage_block_cache_size = options.at( "persistent-storage-block-cache-size-mb" ).as<uint64_t>() * 1024 * 1024;
+      EOS_ASSERT( my->chain_config->persistent_storage_block_cache_size > 0, plugin_config_exception,
+                  "persistent-storage-block-cache-size-mb ${num} must be greater than 0", ("num", my->chain_config->persistent_storage_block_cache_size) );
+
       if( options.count( "reversible-blocks-db-size-mb" ))
          my->chain_config->reversible_cache_size =
                options.at( "reversible-blocks-db-size-mb" ).as<uint64_t>() * 1024 * 1024;
@@ -872,6 +950,14 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       if( options.count( "reversible-blocks-db-guard-size-mb" ))
          my->chain_config->reversible_guard_size = options.at( "reversible-blocks-db-guard-size-mb" ).as<uint64_t>() * 1024 * 1024;
 
+      my->chain_config->reversible_blocks_journal = options.at( "reversible-blocks-journal" ).as<bool>();
+      EOS_ASSERT( !my->chain_config->reversible_blocks_journal ||
+                  !(options.count( "export-reversible-blocks" ) || options.count( "import-reversible-blocks" ) || options.at( "fix-reversible-blocks" ).as<bool>()),
+                  plugin_config_exception,
+                  "reversible-blocks-journal cannot be combined with fix-, import- or export-reversible-blocks" );
+
+      my->chain_config->transaction_dedup_index = options.at( "transaction-dedup-index" ).as<bool>();
+
       if( options.count( "max-nonprivileged-inline-action-size" ))
          my->chain_config->max_nonprivileged_inline_action_size = options.at( "max-nonprivileged-inline-action-size" ).as<uint32_t>();
 
@@ -880,6 +966,8 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
          EOS_ASSERT( my->chain_config->thread_pool_size > 0, plugin_config_exception,
                      "chain-threads ${num} must be greater than 0", ("num", my->chain_config->thread_pool_size) );
       }
+      if( options.count( "chain-threads-cpus" ))
+         my->chain_config->thread_pool_cpus = parse_cpu_affinity( options.at( "chain-threads-cpus" ).as<string>() );
 
       my->chain_config->sig_cpu_bill_pct = options.at("signature-cpu-billable-pct").as<uint32_t>();
       EOS_ASSERT( my->chain_config->sig_cpu_bill_pct >= 0 && my->chain_config->sig_cpu_bill_pct <= 100, plugin_config_exception,
@@ -1196,6 +1284,13 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
 
       my->account_queries_enabled = options.at("enable-account-queries").as<bool>();
 
+      if( options.count( "mirror-secondary-index" )) {
+         const std::vector<std::string> specs = options["mirror-secondary-index"].as<std::vector<std::string>>();
+         for( const auto& spec : specs ) {
+            my->mirrored_secondary_indices.emplace_back( chain_apis::secondary_index_mirror::index_spec::from_string( spec ) );
+         }
+      }
+
       my->chain.emplace( *my->chain_config, std::move(pfs), *chain_id );
 
       // initialize deep mind logging
@@ -1287,10 +1382,18 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
             my->_account_query_db->commit_block(blk);
           }
 
+          if (my->_secondary_index_mirror) {
+            my->_secondary_index_mirror->commit_block(blk);
+          }
+
          my->accepted_block_channel.publish( priority::high, blk );
       } );
 
       my->irreversible_block_connection = my->chain->irreversible_block.connect( [this]( const block_state_ptr& blk ) {
+         if (my->_secondary_index_mirror) {
+            my->_secondary_index_mirror->irreversible_block(blk);
+         }
+
          my->irreversible_block_channel.publish( priority::low, blk );
       } );
 
@@ -1313,6 +1416,10 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
                if (my->_account_query_db) {
                   my->_account_query_db->cache_transaction_trace(std::get<0>(t));
                }
+
+               if (my->_secondary_index_mirror) {
+                  my->_secondary_index_mirror->cache_transaction_trace(std::get<0>(t));
+               }
                
                my->applied_transaction_channel.publish( priority::low, std::get<0>(t) );
             } );
@@ -1328,6 +1435,17 @@ void chain_plugin::plugin_startup()
 
    EOS_ASSERT( my->chain_config->read_mode != db_read_mode::IRREVERSIBLE || !accept_transactions(), plugin_config_exception,
                "read-mode = irreversible. transactions should not be enabled by enable_accept_transactions" );
+
+   // other plugins connect to applied_transaction in plugin_initialize, the forwarding connection above is always present
+   const bool trace_consumers = my->chain->applied_transaction.num_slots() > 1
+                                || my->applied_transaction_channel.has_subscribers()
+                                || my->chain->get_deep_mind_logger() != nullptr
+                                || my->account_queries_enabled
+                                || !my->mirrored_secondary_indices.empty();
+   my->chain->set_trace_consumers( trace_consumers );
+   if( !trace_consumers ) {
+      ilog( "no transaction trace consumers, notification traces of validated blocks are recorded in compact form" );
+   }
    try {
       auto shutdown = [](){ return app().quit(); };
       auto check_shutdown = [](){ return app().is_quiting(); };
@@ -1373,6 +1491,17 @@ void chain_plugin::plugin_startup()
       } FC_LOG_AND_DROP(("Unable to enable account queries"));
    }
 
+   if (!my->mirrored_secondary_indices.empty()) {
+      if (my->chain->kv_db().get_backing_store() != backing_store_type::CHAINBASE) {
+         wlog("mirror-secondary-index is only supported with the chainbase backing store, ignoring");
+      } else {
+         try {
+            my->_secondary_index_mirror.emplace(*my->chain, std::move(my->mirrored_secondary_indices));
+         } FC_LOG_AND_DROP(("Unable to enable secondary index mirror"));
+      }
+      my->mirrored_secondary_indices.clear();
+   }
+
 
 
 } FC_CAPTURE_AND_RETHROW() }
@@ -1404,10 +1533,18 @@ chain_apis::read_write::read_write(controller& db, const fc::microseconds& abi_s
 void chain_apis::read_write::validate() const {
    EOS_ASSERT( api_accept_transactions, missing_chain_api_plugin_exception,
                "Not allowed, node has api-accept-transactions = false" );
+   if( auto resmon_plugin = app().find_plugin<resource_monitor_plugin>() ) {
+      EOS_ASSERT( !resmon_plugin->api_writes_rejected(), resource_exhausted_exception,
+                  "Not allowed, node is under resource pressure" );
+   }
 }
 
 chain_apis::read_only chain_plugin::get_read_only_api() const {
-   return chain_apis::read_only(chain(), my->_account_query_db, get_abi_serializer_max_time());
+   chain_apis::read_only ro(chain(), my->_account_query_db, get_abi_serializer_max_time());
+   if (my->_secondary_index_mirror) {
+      ro.set_secondary_index_mirror(&*my->_secondary_index_mirror);
+   }
+   return ro;
 }
 
   
@@ -2010,6 +2147,27 @@ read_only::get_table_rows_result read_only::get_table_rows( const read_only::get
 #pragma GCC diagnostic pop
 }
 
+std::optional<read_only::get_table_rows_result> read_only::get_mirrored_table_rows( const read_only::get_table_rows_params& p )const {
+   if( !simirror )
+      return {};
+   bool primary = false;
+   const auto table_with_index = get_table_index_name( p, primary );
+   if( primary || !simirror->is_mirrored( p.code, name(table_with_index), p.key_type ) )
+      return {};
+   // the ABI as of the block the mirror is at, instead of the account object in chainbase
+   const auto abi = simirror->get_abi( p.code );
+   if( !abi )
+      return {};
+   if( p.key_type == chain_apis::i128 ) {
+      return get_table_rows_by_seckey<index128_index, uint128_t>(p, *abi, [](uint128_t v)->uint128_t {
+         return v;
+      });
+   }
+   return get_table_rows_by_seckey<index64_index, uint64_t>(p, *abi, [](uint64_t v)->uint64_t {
+      return v;
+   });
+}
+
 /// short_string is intended to optimize the string equality comparison where one of the operand is
 /// no greater than 8 bytes long.
 struct short_string {
@@ -2474,6 +2632,46 @@ read_only::get_table_rows_result read_only::get_kv_table_rows(const read_only::g
       return kv_get_rows(kv_reverse_range(context, upper_bound, lower_bound));
 }
 
+// Cursors of the paged reads are the position of the next row in the index walked, packed and hex encoded so that
+// clients treat them as opaque. Resuming from one seeks that position, so a page costs a lookup and its rows however
+// far the paging has gone, and rows that stay in the index are returned exactly once whether or not the next row was
+// removed in between. The first byte tells the reads apart.
+enum class cursor_kind : uint8_t {
+   table_by_scope         = 1,
+   scheduled_transactions = 2,
+};
+
+template<typename... T>
+string pack_cursor(cursor_kind kind, const T&... fields) {
+   fc::datastream<size_t> ps;
+   fc::raw::pack(ps, static_cast<uint8_t>(kind));
+   (fc::raw::pack(ps, fields), ...);
+   vector<char> data(ps.tellp());
+   fc::datastream<char*> ds(data.data(), data.size());
+   fc::raw::pack(ds, static_cast<uint8_t>(kind));
+   (fc::raw::pack(ds, fields), ...);
+   return fc::to_hex(data);
+}
+
+// returns false if cursor isn't a cursor of kind
+template<typename... T>
+bool unpack_cursor(const string& cursor, cursor_kind kind, T&... fields) {
+   try {
+      vector<char> data(cursor.size() / 2);
+      if (cursor.size() % 2 || fc::from_hex(cursor, data.data(), data.size()) != data.size())
+         return false;
+      fc::datastream<const char*> ds(data.data(), data.size());
+      uint8_t k = 0;
+      fc::raw::unpack(ds, k);
+      if (k != static_cast<uint8_t>(kind))
+         return false;
+      (fc::raw::unpack(ds, fields), ...);
+      return ds.remaining() == 0;
+   } catch (...) {
+      return false;
+   }
+}
+
 struct table_receiver
   : chain::backing_store::table_only_error_receiver<table_receiver, chain::contract_table_query_exception> {
    table_receiver(read_only::get_table_by_scope_result& result, const read_only::get_table_by_scope_params& params)
@@ -2522,13 +2720,29 @@ read_only::get_table_by_scope_result read_only::get_table_by_scope( const read_o
       std::get<1>(upper_bound_lookup_tuple) = name(scope);
    }
 
+   const bool reverse = p.reverse && *p.reverse;
+   if( p.cursor.size() ) {
+      name code, scope, table;
+      bool cursor_reverse = false;
+      EOS_ASSERT( unpack_cursor(p.cursor, cursor_kind::table_by_scope, code, scope, table, cursor_reverse) &&
+                  code == p.code && cursor_reverse == reverse,
+                  chain::contract_table_query_exception, "Invalid cursor for this code and direction: ${c}", ("c", p.cursor) );
+      // the row the previous page stopped at is the first one of this page
+      if( reverse )
+         upper_bound_lookup_tuple = std::make_tuple( code, scope, table );
+      else
+         lower_bound_lookup_tuple = std::make_tuple( code, scope, table );
+   }
+
    if( upper_bound_lookup_tuple < lower_bound_lookup_tuple )
       return result;
 
-   const bool reverse = p.reverse && *p.reverse;
+   const auto make_cursor = [reverse]( const auto& row ) {
+      return pack_cursor( cursor_kind::table_by_scope, row.code, row.scope, row.table, reverse );
+   };
    const auto db_backing_store = get_backing_store();
    if (db_backing_store == eosio::chain::backing_store_type::CHAINBASE) {
-      auto walk_table_range = [&result,&p]( auto itr, auto end_itr ) {
+      auto walk_table_range = [&result,&p,&make_cursor]( auto itr, auto end_itr ) {
          keep_processing kp;
          for( unsigned int count = 0; kp() && count < p.limit && itr != end_itr; ++itr ) {
             if( p.table && itr->table != p.table ) continue;
@@ -2539,6 +2753,7 @@ read_only::get_table_by_scope_result read_only::get_table_by_scope( const read_o
          }
          if( itr != end_itr ) {
             result.more = itr->scope.to_string();
+            result.next_cursor = make_cursor( *itr );
          }
       };
 
@@ -2578,6 +2793,7 @@ read_only::get_table_by_scope_result read_only::get_table_by_scope( const read_o
       const auto stopped_at = writer.stopped_at();
       if (stopped_at) {
          result.more = stopped_at->scope.to_string();
+         result.next_cursor = make_cursor( *stopped_at );
       }
    }
 
@@ -2834,7 +3050,13 @@ read_only::get_scheduled_transactions( const read_only::get_scheduled_transactio
 
    const auto& idx_by_delay = d.get_index<generated_transaction_multi_index,by_delay>();
    auto itr = ([&](){
-      if (!p.lower_bound.empty()) {
+      if (!p.cursor.empty()) {
+         time_point delay_until;
+         int64_t id = 0;
+         EOS_ASSERT( unpack_cursor(p.cursor, cursor_kind::scheduled_transactions, delay_until, id),
+                     transaction_exception, "Invalid cursor: ${c}", ("c", p.cursor) );
+         return idx_by_delay.lower_bound(boost::make_tuple(delay_until, generated_transaction_object::id_type(id)));
+      } else if (!p.lower_bound.empty()) {
          try {
             auto when = time_point::from_iso_string( p.lower_bound );
             return idx_by_delay.lower_bound(boost::make_tuple(when));
@@ -2896,6 +3118,7 @@ read_only::get_scheduled_transactions( const read_only::get_scheduled_transactio
 
    if (itr != idx_by_delay.end()) {
       result.more = string(itr->trx_id);
+      result.next_cursor = pack_cursor(cursor_kind::scheduled_transactions, itr->delay_until, itr->id._id);
    }
 
    return result;
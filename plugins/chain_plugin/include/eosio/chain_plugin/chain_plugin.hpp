@@ -23,6 +23,7 @@
 #include <boost/multiprecision/cpp_int.hpp>
 
 #include <eosio/chain_plugin/account_query_db.hpp>
+#include <eosio/chain_plugin/secondary_index_mirror.hpp>
 
 #include <fc/static_variant.hpp>
 #include <eosio/blockvault_client_plugin/blockvault_client_plugin.hpp>
@@ -103,6 +104,7 @@ class read_only {
    const std::optional<account_query_db>& aqdb;
    const fc::microseconds abi_serializer_max_time;
    bool  shorten_abi_errors = true;
+   const secondary_index_mirror* simirror = nullptr;
 
 public:
    static const string KEYi64;
@@ -113,6 +115,7 @@ public:
    void validate() const {}
 
    void set_shorten_abi_errors( bool f ) { shorten_abi_errors = f; }
+   void set_secondary_index_mirror( const secondary_index_mirror* m ) { simirror = m; }
 
    using get_info_params = empty;
 
@@ -369,6 +372,9 @@ public:
    };
 
    get_table_rows_result get_table_rows( const get_table_rows_params& params )const;
+   /// get_table_rows by an index of the secondary index mirror, thread safe since chainbase is not read;
+   /// empty if the query is not for a mirrored index
+   std::optional<get_table_rows_result> get_mirrored_table_rows( const get_table_rows_params& params )const;
 
    get_table_rows_result get_kv_table_rows( const get_kv_table_rows_params& params )const;
 
@@ -379,6 +385,7 @@ public:
       string               upper_bound; // upper bound of scope, optional
       uint32_t             limit = 10;
       std::optional<bool>  reverse;
+      string               cursor; ///< next_cursor of the previous call, replaces lower_bound (upper_bound if reverse)
    };
    struct get_table_by_scope_result_row {
       name        code;
@@ -390,6 +397,7 @@ public:
    struct get_table_by_scope_result {
       vector<get_table_by_scope_result_row> rows;
       string      more; ///< fill lower_bound with this value to fetch more rows
+      string      next_cursor; ///< fill cursor with this value to fetch more rows, resumes at the exact next row
    };
 
    get_table_by_scope_result get_table_by_scope( const get_table_by_scope_params& params )const;
@@ -445,11 +453,13 @@ public:
       bool        json = false;
       string      lower_bound;  /// timestamp OR transaction ID
       uint32_t    limit = 50;
+      string      cursor;       ///< next_cursor of the previous call, replaces lower_bound
    };
 
    struct get_scheduled_transactions_result {
       fc::variants  transactions;
       string        more; ///< fill lower_bound with this to fetch next set of transactions
+      string        next_cursor; ///< fill cursor with this to fetch next set of transactions
    };
 
    get_scheduled_transactions_result get_scheduled_transactions( const get_scheduled_transactions_params& params ) const;
@@ -722,8 +732,25 @@ public:
          return result;
 
       const bool reverse = p.reverse && *p.reverse;
-      const auto db_backing_store = get_backing_store();
       auto get_prim_key_val = get_primary_key_value(p.table, abis, p.json, p.show_payer);
+      if constexpr (std::is_same_v<secondary_key_type, uint64_t> || std::is_same_v<secondary_key_type, chain::uint128_t>) {
+         if( simirror && simirror->is_mirrored(p.code, name(table_with_index), p.key_type) ) {
+            // served entirely from the mirror's own images, chainbase is not touched
+            keep_processing kp;
+            auto walked = simirror->walk_range( p.code, scope, name(table_with_index), secondary_key_lower, secondary_key_upper,
+                                                reverse, p.limit, [&]( const secondary_index_mirror::row_view& row ) {
+               if( !kp() ) return false;
+               result.rows.emplace_back( get_prim_key_val(row) );
+               return true;
+            });
+            if( walked.more ) {
+               result.more = true;
+               result.next_key = convert_to_string(*walked.next_key, p.key_type, p.encode_type, "next_key - next lower bound");
+            }
+            return result;
+         }
+      }
+      const auto db_backing_store = get_backing_store();
       if (db_backing_store == eosio::chain::backing_store_type::CHAINBASE) {
          const auto* t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(p.code, scope, p.table));
          const auto* index_t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(p.code, scope, name(table_with_index)));
@@ -1097,9 +1124,9 @@ FC_REFLECT( eosio::chain_apis::read_only::get_table_rows_params, (json)(code)(sc
 FC_REFLECT( eosio::chain_apis::read_only::get_kv_table_rows_params, (json)(code)(table)(index_name)(encode_type)(index_value)(lower_bound)(upper_bound)(limit)(reverse)(show_payer) )
 FC_REFLECT( eosio::chain_apis::read_only::get_table_rows_result, (rows)(more)(next_key)(next_key_bytes) );
 
-FC_REFLECT( eosio::chain_apis::read_only::get_table_by_scope_params, (code)(table)(lower_bound)(upper_bound)(limit)(reverse) )
+FC_REFLECT( eosio::chain_apis::read_only::get_table_by_scope_params, (code)(table)(lower_bound)(upper_bound)(limit)(reverse)(cursor) )
 FC_REFLECT( eosio::chain_apis::read_only::get_table_by_scope_result_row, (code)(scope)(table)(payer)(count));
-FC_REFLECT( eosio::chain_apis::read_only::get_table_by_scope_result, (rows)(more) );
+FC_REFLECT( eosio::chain_apis::read_only::get_table_by_scope_result, (rows)(more)(next_cursor) );
 
 FC_REFLECT( eosio::chain_apis::read_only::get_currency_balance_params, (code)(account)(symbol));
 FC_REFLECT( eosio::chain_apis::read_only::get_currency_stats_params, (code)(symbol));
@@ -1111,8 +1138,8 @@ FC_REFLECT( eosio::chain_apis::read_only::get_producers_result, (rows)(total_pro
 FC_REFLECT_EMPTY( eosio::chain_apis::read_only::get_producer_schedule_params )
 FC_REFLECT( eosio::chain_apis::read_only::get_producer_schedule_result, (active)(pending)(proposed) );
 
-FC_REFLECT( eosio::chain_apis::read_only::get_scheduled_transactions_params, (json)(lower_bound)(limit) )
-FC_REFLECT( eosio::chain_apis::read_only::get_scheduled_transactions_result, (transactions)(more) );
+FC_REFLECT( eosio::chain_apis::read_only::get_scheduled_transactions_params, (json)(lower_bound)(limit)(cursor) )
+FC_REFLECT( eosio::chain_apis::read_only::get_scheduled_transactions_result, (transactions)(more)(next_cursor) );
 
 FC_REFLECT( eosio::chain_apis::read_only::account_resource_info, (used)(available)(max)(last_usage_update_time)(current_used) )
 FC_REFLECT( eosio::chain_apis::read_only::get_account_results,
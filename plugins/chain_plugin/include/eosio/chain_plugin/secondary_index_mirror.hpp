@@ -0,0 +1,126 @@
+#pragma once
+#include <eosio/chain/types.hpp>
+#include <eosio/chain/abi_def.hpp>
+#include <eosio/chain/block_state.hpp>
+#include <eosio/chain/trace.hpp>
+
+#include <functional>
+#include <string_view>
+
+namespace eosio::chain_apis {
+   /**
+    * This class manages an ephemeral, read-optimized copy of selected contract table secondary indices used to
+    * serve `get_table_rows` by secondary key without walking chainbase.  Each mirrored index is held in a
+    * columnar layout: the secondary keys of a scope are kept in one sorted array (with parallel arrays of
+    * primary keys and row ordinals) and the row payloads are packed into a separate byte arena.
+    *
+    * There is no persistence; the mirror is built from the current state of the chain when the class is
+    * instantiated.  From then on every committed block only applies the rows it changed, read from the block's undo
+    * session like the state history deltas, so the work per block follows the number of changed rows rather than the
+    * size of the mirrored tables.  The changes of reversible blocks are kept to take them back on a fork switch.
+    * The columns of a scope are split into chunks of bounded size so that a changed row only moves the entries of
+    * one chunk.
+    *
+    * Queries may be served from any thread, they copy the rows they return out of the mirror under a shared lock.
+    * The ABIs of the mirrored contracts are kept along with the rows so that a query does not read chainbase at all.
+    */
+   class secondary_index_mirror {
+   public:
+
+      /**
+       * A single mirrored index, configured as `<code>:<table>:<index_position>:<key_type>`
+       */
+      struct index_spec {
+         chain::name    code;
+         chain::name    table;
+         uint32_t       index_position = 2; ///< 1-based position as used by `get_table_rows`, secondary is 2
+         std::string    key_type;           ///< one of "i64", "name" or "i128"
+
+         /**
+          * the name of the chainbase table that holds this secondary index (see multi_index packing of index name)
+          */
+         chain::name index_table() const {
+            return chain::name( (table.to_uint64_t() & 0xFFFFFFFFFFFFFFF0ULL) | ((index_position - 2) & 0x000000000000000FULL) );
+         }
+
+         static index_spec from_string( const std::string& spec );
+      };
+
+      /**
+       * A row served out of the mirror, shaped like a `key_value_object` so that it can be passed to the same
+       * row formatting code as the chainbase and rocksdb paths
+       */
+      struct row_view {
+         uint64_t          primary_key = 0;
+         chain::name       payer;
+         std::string_view  value;
+      };
+
+      template<typename SecondaryKey>
+      struct query_result {
+         bool                          more = false;
+         std::optional<SecondaryKey>   next_key;
+      };
+
+      /**
+       * Instantiate a new secondary index mirror from the given chain controller
+       * The caller is expected to manage lifetimes such that this controller reference does not go stale
+       * for the life of the mirror
+       * @param chain - controller to read data from
+       * @param specs - the indices to mirror
+       */
+      secondary_index_mirror( const class eosio::chain::controller& chain, std::vector<index_spec> specs );
+      ~secondary_index_mirror();
+
+      secondary_index_mirror(secondary_index_mirror&&);
+      secondary_index_mirror& operator=(secondary_index_mirror&&);
+
+      /**
+       * Note the receivers of an applied transaction so that mirrored tables touched by it are refreshed when the
+       * containing block is committed
+       * @param trace
+       */
+      void cache_transaction_trace( const chain::transaction_trace_ptr& trace );
+
+      /**
+       * Apply the rows of mirrored tables changed by the block.  When the block does not extend the previously
+       * committed head (fork switch) the changes of the blocks which are no longer on the chain are undone first.
+       * @param block
+       */
+      void commit_block( const chain::block_state_ptr& block );
+
+      /**
+       * Drop the changes kept to undo the blocks up to and including the given one
+       * @param block
+       */
+      void irreversible_block( const chain::block_state_ptr& block );
+
+      /**
+       * @return true if the given code and (packed) index table is served by this mirror for the given key type
+       */
+      bool is_mirrored( chain::name code, chain::name index_table, const std::string& key_type ) const;
+
+      /**
+       * @return the ABI of a contract with a mirrored index as of the block the mirror is at, nullptr if it has none
+       */
+      std::shared_ptr<const chain::abi_def> get_abi( chain::name code ) const;
+
+      using row_callback = std::function<bool(const row_view&)>;
+
+      /**
+       * Walk the rows of a mirrored index whose secondary key is within [lower, upper]
+       * @param f - invoked for each row in order, return false to stop early
+       * @return whether rows remained in the range when the walk stopped and the secondary key to resume at
+       */
+      query_result<uint64_t> walk_range( chain::name code, chain::name scope, chain::name index_table,
+                                         uint64_t lower, uint64_t upper, bool reverse, uint32_t limit,
+                                         const row_callback& f ) const;
+      query_result<chain::uint128_t> walk_range( chain::name code, chain::name scope, chain::name index_table,
+                                                 const chain::uint128_t& lower, const chain::uint128_t& upper,
+                                                 bool reverse, uint32_t limit, const row_callback& f ) const;
+
+   private:
+      std::unique_ptr<struct secondary_index_mirror_impl> _impl;
+   };
+
+}
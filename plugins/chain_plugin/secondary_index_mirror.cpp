@@ -0,0 +1,680 @@
+#include <eosio/chain_plugin/secondary_index_mirror.hpp>
+
+#include <eosio/chain/abi_serializer.hpp>
+#include <eosio/chain/account_object.hpp>
+#include <eosio/chain/contract_table_objects.hpp>
+#include <eosio/chain/controller.hpp>
+#include <eosio/chain/exceptions.hpp>
+
+#include <boost/algorithm/string.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <shared_mutex>
+#include <tuple>
+
+using namespace eosio;
+
+namespace {
+   /**
+    * A run of consecutive entries of one scope of a secondary index, ordered by {secondary, primary} as in chainbase.
+    * Each column holds one field of the entries and the row payloads are packed into a byte arena.
+    */
+   template<typename Key>
+   struct column_chunk {
+      std::vector<Key>           secondary;
+      std::vector<uint64_t>      primary;
+      std::vector<chain::name>   payer;
+      std::vector<std::size_t>   offset = { 0 };   ///< one entry per row plus the end of the arena
+      std::vector<char>          arena;
+
+      std::size_t size() const { return secondary.size(); }
+
+      std::string_view value( std::size_t i ) const {
+         return std::string_view( arena.data() + offset[i], offset[i + 1] - offset[i] );
+      }
+
+      void insert( std::size_t i, const Key& sec, uint64_t pk, chain::name row_payer, std::string_view v ) {
+         const std::size_t at = offset[i];
+         secondary.insert( secondary.begin() + i, sec );
+         primary.insert( primary.begin() + i, pk );
+         payer.insert( payer.begin() + i, row_payer );
+         arena.insert( arena.begin() + at, v.begin(), v.end() );
+         for( std::size_t j = i; j < offset.size(); ++j ) offset[j] += v.size();
+         offset.insert( offset.begin() + i, at );
+      }
+
+      void erase( std::size_t i ) {
+         const std::size_t at = offset[i];
+         const std::size_t len = offset[i + 1] - at;
+         secondary.erase( secondary.begin() + i );
+         primary.erase( primary.begin() + i );
+         payer.erase( payer.begin() + i );
+         arena.erase( arena.begin() + at, arena.begin() + at + len );
+         offset.erase( offset.begin() + i );
+         for( std::size_t j = i; j < offset.size(); ++j ) offset[j] -= len;
+      }
+   };
+
+   /// entries per chunk when a scope is built, a chunk is split in two once it holds twice as many
+   constexpr std::size_t chunk_rows = 256;
+
+   /**
+    * The mirrored state of one scope of a secondary index.
+    *
+    * The secondary key of the last entry of each chunk is kept in its own column so that a range lookup is a binary
+    * search over it followed by one within a chunk, both over contiguous memory.  Chunks are never empty.
+    */
+   template<typename Key>
+   struct scope_columns {
+      using key_type = Key;
+
+      std::vector<column_chunk<Key>>   chunks;
+      std::vector<Key>                 last_secondary;
+
+      /// index of the first chunk whose last entry is not before {sec, pk}, chunks.size() if there is none
+      std::size_t find_chunk( const Key& sec, uint64_t pk ) const {
+         const auto itr = std::partition_point( chunks.begin(), chunks.end(), [&]( const column_chunk<Key>& c ) {
+            return std::tie( c.secondary.back(), c.primary.back() ) < std::tie( sec, pk );
+         } );
+         return static_cast<std::size_t>( itr - chunks.begin() );
+      }
+
+      static std::size_t find_in_chunk( const column_chunk<Key>& c, const Key& sec, uint64_t pk ) {
+         std::size_t lo = 0, hi = c.size();
+         while( lo < hi ) {
+            const std::size_t mid = (lo + hi) / 2;
+            if( std::tie( c.secondary[mid], c.primary[mid] ) < std::tie( sec, pk ) ) lo = mid + 1;
+            else hi = mid;
+         }
+         return lo;
+      }
+
+      void insert( const Key& sec, uint64_t pk, chain::name row_payer, std::string_view v ) {
+         if( chunks.empty() ) {
+            chunks.emplace_back();
+            last_secondary.emplace_back();
+         }
+         const std::size_t c = std::min( find_chunk( sec, pk ), chunks.size() - 1 );
+         auto& chunk = chunks[c];
+         chunk.insert( find_in_chunk( chunk, sec, pk ), sec, pk, row_payer, v );
+         last_secondary[c] = chunk.secondary.back();
+         if( chunk.size() >= 2 * chunk_rows ) split( c );
+      }
+
+      /// @return false if there was no such entry
+      bool erase( const Key& sec, uint64_t pk ) {
+         const std::size_t c = find_chunk( sec, pk );
+         if( c == chunks.size() ) return false;
+         auto& chunk = chunks[c];
+         const std::size_t i = find_in_chunk( chunk, sec, pk );
+         if( i == chunk.size() || chunk.secondary[i] != sec || chunk.primary[i] != pk ) return false;
+         chunk.erase( i );
+         if( chunk.size() == 0 ) {
+            chunks.erase( chunks.begin() + c );
+            last_secondary.erase( last_secondary.begin() + c );
+         } else {
+            last_secondary[c] = chunk.secondary.back();
+         }
+         return true;
+      }
+
+      /// append an entry ordered after all the others
+      void push_back( const Key& sec, uint64_t pk, chain::name row_payer, std::string_view v ) {
+         if( chunks.empty() || chunks.back().size() >= chunk_rows ) {
+            chunks.emplace_back();
+            last_secondary.emplace_back();
+         }
+         auto& chunk = chunks.back();
+         chunk.insert( chunk.size(), sec, pk, row_payer, v );
+         last_secondary.back() = sec;
+      }
+
+      bool empty() const { return chunks.empty(); }
+
+   private:
+      void split( std::size_t c ) {
+         column_chunk<Key> lower, upper;
+         const auto& full = chunks[c];
+         const std::size_t half = full.size() / 2;
+         for( std::size_t i = 0; i < full.size(); ++i ) {
+            auto& to = i < half ? lower : upper;
+            to.insert( to.size(), full.secondary[i], full.primary[i], full.payer[i], full.value(i) );
+         }
+         last_secondary[c] = lower.secondary.back();
+         chunks[c] = std::move(lower);
+         last_secondary.insert( last_secondary.begin() + c + 1, upper.secondary.back() );
+         chunks.insert( chunks.begin() + c + 1, std::move(upper) );
+      }
+   };
+
+   template<typename Key>
+   using table_image = std::map<chain::name, scope_columns<Key>>;
+
+   /// a row of a mirrored index, as stored in the columns
+   template<typename Key>
+   struct mirrored_row {
+      Key           secondary{};
+      uint64_t      primary = 0;
+      chain::name   payer;
+      std::string   value;
+   };
+
+   /// how one block changed one row of a mirrored index
+   template<typename Key>
+   struct row_change {
+      chain::name                        scope;
+      std::optional<mirrored_row<Key>>   before;
+      std::optional<mirrored_row<Key>>   after;
+   };
+
+   template<typename Key>
+   using index_changes = std::vector<row_change<Key>>;
+
+   /// number of trailing entries resolved by a linear count rather than further bisection; the count has no
+   /// data dependent branches so for 64-bit keys it is emitted as packed compares
+   constexpr std::size_t linear_scan_width = 32;
+
+   /**
+    * Branch-free partition point over a sorted column: returns the number of leading entries for which `pred`
+    * holds.  Bisection narrows the range with conditional moves and the final window is summed.
+    */
+   template<typename Key, typename Pred>
+   std::size_t column_partition_point( const std::vector<Key>& col, Pred&& pred ) {
+      const Key* base = col.data();
+      std::size_t n = col.size();
+      while( n > linear_scan_width ) {
+         const std::size_t half = n / 2;
+         base = pred( base[half - 1] ) ? base + half : base;
+         n -= half;
+      }
+      std::size_t count = 0;
+      for( std::size_t i = 0; i < n; ++i ) {
+         count += pred( base[i] ) ? 1 : 0;
+      }
+      return static_cast<std::size_t>( base - col.data() ) + count;
+   }
+}
+
+namespace eosio::chain_apis {
+   using index_spec = secondary_index_mirror::index_spec;
+   using row_view   = secondary_index_mirror::row_view;
+
+   secondary_index_mirror::index_spec secondary_index_mirror::index_spec::from_string( const std::string& spec ) {
+      std::vector<std::string> parts;
+      boost::split( parts, spec, boost::is_any_of( ":" ) );
+      EOS_ASSERT( parts.size() == 4, chain::plugin_config_exception,
+                  "Invalid mirrored secondary index \"${s}\", expected <code>:<table>:<index_position>:<key_type>", ("s", spec) );
+
+      index_spec result;
+      result.code = chain::name( parts[0] );
+      result.table = chain::name( parts[1] );
+      EOS_ASSERT( result.table.to_uint64_t() == (result.table.to_uint64_t() & 0xFFFFFFFFFFFFFFF0ULL), chain::plugin_config_exception,
+                  "Unsupported table name ${t} in mirrored secondary index", ("t", result.table) );
+      try {
+         result.index_position = std::stoul( parts[2] );
+      } catch( ... ) {
+         EOS_ASSERT( false, chain::plugin_config_exception, "Invalid index position \"${p}\" in mirrored secondary index", ("p", parts[2]) );
+      }
+      EOS_ASSERT( result.index_position >= 2 && result.index_position <= 17, chain::plugin_config_exception,
+                  "Mirrored index position must be a secondary index (2 to 17), got ${p}", ("p", result.index_position) );
+      result.key_type = parts[3];
+      EOS_ASSERT( result.key_type == "i64" || result.key_type == "name" || result.key_type == "i128", chain::plugin_config_exception,
+                  "Unsupported key type \"${k}\" in mirrored secondary index, expected i64, name or i128", ("k", result.key_type) );
+      return result;
+   }
+
+   /// the chainbase index holding the secondary keys of a mirrored index
+   template<typename Key> struct chainbase_index;
+   template<> struct chainbase_index<uint64_t>         { using type = chain::index64_index; };
+   template<> struct chainbase_index<chain::uint128_t> { using type = chain::index128_index; };
+
+   /**
+    * Implementation details of the secondary index mirror
+    */
+   struct secondary_index_mirror_impl {
+      using image_variant = std::variant<table_image<uint64_t>, table_image<chain::uint128_t>>;
+      using index_key     = std::pair<chain::name, chain::name>;   ///< code, packed index table
+
+      struct mirrored_index {
+         index_spec      spec;
+         image_variant   image;
+      };
+
+      struct mirrored_abi {
+         uint64_t                               abi_sequence = 0;
+         std::shared_ptr<const chain::abi_def>  abi;
+      };
+
+      struct applied_block {
+         uint32_t                                                                                   block_num = 0;
+         chain::block_id_type                                                                       id;
+         std::map<index_key, std::variant<index_changes<uint64_t>, index_changes<chain::uint128_t>>>   changes; ///< of the indices it changed
+      };
+
+      secondary_index_mirror_impl( const chain::controller& controller, std::vector<index_spec> specs )
+      :controller(controller)
+      {
+         for( auto& s : specs ) {
+            mirrored_codes.insert( s.code );
+            const auto key = index_key( s.code, s.index_table() );
+            EOS_ASSERT( indices.count( key ) == 0, chain::plugin_config_exception,
+                        "Duplicate mirrored secondary index ${c}:${t}:${p}", ("c", s.code)("t", s.table)("p", s.index_position) );
+            mirrored_index mi{ std::move(s), {} };
+            if( mi.spec.key_type == "i128" ) {
+               mi.image = table_image<chain::uint128_t>{};
+            }
+            indices.emplace( key, std::move(mi) );
+         }
+      }
+
+      /**
+       * Build every mirrored index from the chain controller at the current HEAD
+       */
+      void build_all() {
+         ilog( "Building secondary index mirror for ${n} indices", ("n", indices.size()) );
+         auto start = fc::time_point::now();
+         std::vector<image_variant> images;
+         for( const auto& i : indices ) {
+            std::visit( [&]( const auto& image ) {
+               using key_type = typename std::decay_t<decltype(image)>::mapped_type::key_type;
+               images.emplace_back( build_image<key_type>( i.second.spec ) );
+            }, i.second.image );
+         }
+         {
+            std::unique_lock write_lock( rw_mutex );
+            auto image = images.begin();
+            for( auto& i : indices ) {
+               i.second.image = std::move( *image++ );
+            }
+         }
+         applied.clear();
+         base_id = head_id = controller.head_block_id();
+         refresh_abis( true );
+         auto duration = fc::time_point::now() - start;
+         ilog( "Finished building secondary index mirror in ${sec}", ("sec", (duration.count() / 1'000'000.0 )) );
+      }
+
+      /**
+       * Read the ABIs of the mirrored contracts whose abi_sequence changed, or all of them when forced (a fork switch
+       * may have replaced one ABI by another with the same sequence)
+       */
+      void refresh_abis( bool force ) {
+         const auto& d = controller.db();
+         std::map<chain::name, mirrored_abi> changed;
+         for( auto code : mirrored_codes ) {
+            const auto* meta = d.find<chain::account_metadata_object, chain::by_name>( code );
+            const uint64_t abi_sequence = meta ? meta->abi_sequence : 0;
+            auto itr = abis.find( code );
+            if( !force && itr != abis.end() && itr->second.abi_sequence == abi_sequence ) continue;
+            mirrored_abi a{ abi_sequence, nullptr };
+            if( const auto* account = d.find<chain::account_object, chain::by_name>( code ) ) {
+               chain::abi_def abi;
+               if( chain::abi_serializer::to_abi( account->abi, abi ) ) a.abi = std::make_shared<const chain::abi_def>( std::move(abi) );
+            }
+            changed.emplace( code, std::move(a) );
+         }
+         if( changed.empty() ) return;
+         std::unique_lock write_lock( rw_mutex );
+         for( auto& c : changed ) abis[c.first] = std::move( c.second );
+      }
+
+      /**
+       * Read one mirrored index out of chainbase
+       */
+      template<typename Key>
+      table_image<Key> build_image( const index_spec& spec ) const {
+         using index_type = typename chainbase_index<Key>::type;
+         table_image<Key> image;
+
+         const auto& d = controller.db();
+         const auto& tables = d.get_index<chain::table_id_multi_index, chain::by_code_scope_table>();
+         const auto& secidx = d.get_index<index_type, chain::by_secondary>();
+         const auto index_table = spec.index_table();
+
+         for( auto titr = tables.lower_bound( boost::make_tuple( spec.code ) ); titr != tables.end() && titr->code == spec.code; ++titr ) {
+            if( titr->table != index_table ) continue;
+            const auto* t_id = d.find<chain::table_id_object, chain::by_code_scope_table>( boost::make_tuple( spec.code, titr->scope, spec.table ) );
+            if( t_id == nullptr ) continue;
+
+            auto& cols = image[titr->scope];
+            for( auto itr = secidx.lower_bound( boost::make_tuple( titr->id ) ); itr != secidx.end() && itr->t_id == titr->id; ++itr ) {
+               const auto* row = d.find<chain::key_value_object, chain::by_scope_primary>( boost::make_tuple( t_id->id, itr->primary_key ) );
+               if( row == nullptr ) continue;
+               cols.push_back( itr->secondary_key, row->primary_key, row->payer, std::string_view( row->value.data(), row->value.size() ) );
+            }
+            if( cols.empty() ) image.erase( titr->scope );
+         }
+         return image;
+      }
+
+      /**
+       * The rows of a mirrored index changed by the block being committed, from the last undo session of chainbase
+       * (see state_history::create_deltas)
+       */
+      template<typename Key>
+      index_changes<Key> collect_changes( const index_spec& spec ) const {
+         using index_type  = typename chainbase_index<Key>::type;
+         using entry_type  = typename index_type::value_type;
+         using row_key     = std::pair<chain::name, uint64_t>;   // scope, primary key
+
+         const auto& d = controller.db();
+         const auto& table_id_index = d.get_index<chain::table_id_multi_index>();
+         auto table_undo = table_id_index.last_undo_session();
+         std::map<uint64_t, const chain::table_id_object*> removed_table_id;
+         for( const auto& rem : table_undo.removed_values )
+            removed_table_id[rem.id._id] = &rem;
+
+         auto get_table = [&]( chain::table_id tid ) -> const chain::table_id_object& {
+            if( const auto* t = table_id_index.find( tid ) ) return *t;
+            auto it = removed_table_id.find( tid._id );
+            EOS_ASSERT( it != removed_table_id.end(), chain::plugin_exception, "can not find table id ${tid}", ("tid", tid) );
+            return *it->second;
+         };
+
+         // the objects as they were before the block, nullptr for the ones it created
+         auto note_old = [&]( auto& old, const auto& undo, chain::name table ) {
+            auto note = [&]( const auto& o, auto* value ) {
+               const auto& t = get_table( o.t_id );
+               if( t.code == spec.code && t.table == table ) old[row_key( t.scope, o.primary_key )] = value;
+            };
+            // an object can be removed and another one created with the same primary key in the same block
+            for( const auto& o : undo.new_values )     note( o, decltype(&o){} );
+            for( const auto& o : undo.old_values )     note( o, &o );
+            for( const auto& o : undo.removed_values ) note( o, &o );
+         };
+         auto row_undo = d.get_index<chain::key_value_index>().last_undo_session();
+         auto entry_undo = d.get_index<index_type>().last_undo_session();
+         std::map<row_key, const chain::key_value_object*> old_rows;
+         std::map<row_key, const entry_type*> old_entries;
+         note_old( old_rows, row_undo, spec.table );
+         note_old( old_entries, entry_undo, spec.index_table() );
+
+         auto current_row = [&]( const row_key& k ) -> const chain::key_value_object* {
+            const auto* t = d.find<chain::table_id_object, chain::by_code_scope_table>( boost::make_tuple( spec.code, k.first, spec.table ) );
+            return t ? d.find<chain::key_value_object, chain::by_scope_primary>( boost::make_tuple( t->id, k.second ) ) : nullptr;
+         };
+         auto current_entry = [&]( const row_key& k ) -> const entry_type* {
+            const auto* t = d.find<chain::table_id_object, chain::by_code_scope_table>( boost::make_tuple( spec.code, k.first, spec.index_table() ) );
+            return t ? d.find<entry_type, chain::by_primary>( boost::make_tuple( t->id, k.second ) ) : nullptr;
+         };
+         auto mirrored = []( const chain::key_value_object* row, const entry_type* entry ) -> std::optional<mirrored_row<Key>> {
+            if( row == nullptr || entry == nullptr ) return {};
+            return mirrored_row<Key>{ entry->secondary_key, row->primary_key, row->payer, std::string( row->value.data(), row->value.size() ) };
+         };
+
+         std::set<row_key> changed;
+         for( const auto& o : old_rows ) changed.insert( o.first );
+         for( const auto& o : old_entries ) changed.insert( o.first );
+
+         index_changes<Key> result;
+         for( const auto& k : changed ) {
+            auto old_row = old_rows.find( k );
+            auto old_entry = old_entries.find( k );
+            row_change<Key> c{ k.first,
+                               mirrored( old_row != old_rows.end() ? old_row->second : current_row( k ),
+                                         old_entry != old_entries.end() ? old_entry->second : current_entry( k ) ),
+                               mirrored( current_row( k ), current_entry( k ) ) };
+            if( c.before || c.after ) result.push_back( std::move(c) );
+         }
+         return result;
+      }
+
+      /**
+       * Apply the changes of a block to an image, or take them back
+       */
+      template<typename Key>
+      static void apply( table_image<Key>& image, const index_changes<Key>& changes, bool undo ) {
+         auto erase = [&]( chain::name scope, const mirrored_row<Key>& r ) {
+            auto sitr = image.find( scope );
+            EOS_ASSERT( sitr != image.end() && sitr->second.erase( r.secondary, r.primary ), chain::plugin_exception,
+                        "secondary index mirror is missing row ${p} of scope ${s}", ("p", r.primary)("s", scope) );
+            if( sitr->second.empty() ) image.erase( sitr );
+         };
+         auto insert = [&]( chain::name scope, const mirrored_row<Key>& r ) {
+            image[scope].insert( r.secondary, r.primary, r.payer, r.value );
+         };
+         if( !undo ) {
+            for( const auto& c : changes ) {
+               if( c.before ) erase( c.scope, *c.before );
+               if( c.after ) insert( c.scope, *c.after );
+            }
+         } else {
+            for( auto itr = changes.rbegin(); itr != changes.rend(); ++itr ) {
+               if( itr->after ) erase( itr->scope, *itr->after );
+               if( itr->before ) insert( itr->scope, *itr->before );
+            }
+         }
+      }
+
+      /// precondition: rw_mutex is held exclusively
+      void apply( const applied_block& block, bool undo ) {
+         for( const auto& c : block.changes ) {
+            std::visit( [&]( auto& image ) {
+               using key_type = typename std::decay_t<decltype(image)>::mapped_type::key_type;
+               apply( image, std::get<index_changes<key_type>>( c.second ), undo );
+            }, indices.at( c.first ).image );
+         }
+      }
+
+      void cache_transaction_trace( const chain::transaction_trace_ptr& trace ) {
+         for( const auto& at : trace->action_traces ) {
+            if( mirrored_codes.count( at.receiver ) ) {
+               touched_codes.insert( at.receiver );
+            }
+         }
+      }
+
+      void commit_block( const chain::block_state_ptr& bsp ) {
+         try {
+            apply_block( bsp );
+         } catch( const fc::exception& e ) {
+            wlog( "secondary index mirror failed to apply block ${n}, building it again: ${e}",
+                  ("n", bsp->block_num)("e", e.to_detail_string()) );
+            touched_codes.clear();
+            build_all();
+         }
+      }
+
+      void apply_block( const chain::block_state_ptr& bsp ) {
+         const auto& previous = bsp->header.previous;
+         const bool fork_switch = previous != head_id;
+         if( fork_switch ) {
+            // fork switch, the controller has undone the blocks of the other branch
+            std::unique_lock write_lock( rw_mutex );
+            while( !applied.empty() && applied.back().id != previous ) {
+               apply( applied.back(), true );
+               applied.pop_back();
+            }
+            if( applied.empty() && base_id != previous ) {
+               write_lock.unlock();
+               wlog( "fork switch to block ${n} goes past the blocks the secondary index mirror kept, building it again",
+                     ("n", bsp->block_num) );
+               touched_codes.clear();
+               build_all();
+               return;
+            }
+         }
+
+         // only the receiver of an action writes to its tables
+         applied_block block{ bsp->block_num, bsp->id, {} };
+         for( const auto& i : indices ) {
+            if( !touched_codes.count( i.second.spec.code ) ) continue;
+            std::visit( [&]( const auto& image ) {
+               using key_type = typename std::decay_t<decltype(image)>::mapped_type::key_type;
+               auto changes = collect_changes<key_type>( i.second.spec );
+               if( !changes.empty() ) block.changes.emplace( i.first, std::move(changes) );
+            }, i.second.image );
+         }
+         touched_codes.clear();
+         if( !block.changes.empty() ) {
+            std::unique_lock write_lock( rw_mutex );
+            apply( block, false );
+         }
+         applied.push_back( std::move(block) );
+         head_id = bsp->id;
+         refresh_abis( fork_switch );
+      }
+
+      void irreversible_block( const chain::block_state_ptr& bsp ) {
+         while( !applied.empty() && applied.front().block_num <= bsp->block_num ) {
+            base_id = applied.front().id;
+            applied.pop_front();
+         }
+      }
+
+      bool is_mirrored( chain::name code, chain::name index_table, const std::string& key_type ) const {
+         auto itr = indices.find( index_key( code, index_table ) );
+         if( itr == indices.end() ) return false;
+         if( key_type == "i128" ) return itr->second.spec.key_type == "i128";
+         return itr->second.spec.key_type != "i128" && (key_type == "i64" || key_type == "name");
+      }
+
+      std::shared_ptr<const chain::abi_def> get_abi( chain::name code ) const {
+         std::shared_lock read_lock( rw_mutex );
+         auto itr = abis.find( code );
+         return itr != abis.end() ? itr->second.abi : nullptr;
+      }
+
+      template<typename Key>
+      secondary_index_mirror::query_result<Key> walk_range( chain::name code, chain::name scope, chain::name index_table,
+                                                            const Key& lower, const Key& upper, bool reverse, uint32_t limit,
+                                                            const secondary_index_mirror::row_callback& f ) const {
+         secondary_index_mirror::query_result<Key> result;
+         auto itr = indices.find( index_key( code, index_table ) );
+         EOS_ASSERT( itr != indices.end(), chain::contract_table_query_exception, "Index ${c}:${t} is not mirrored", ("c", code)("t", index_table) );
+
+         // rows are copied out under the lock so that formatting them does not hold up the writer
+         std::vector<mirrored_row<Key>> rows;
+         std::optional<Key> next_key;
+         {
+            std::shared_lock read_lock( rw_mutex );
+            const auto* image = std::get_if<table_image<Key>>( &itr->second.image );
+            EOS_ASSERT( image != nullptr, chain::contract_table_query_exception, "Index ${c}:${t} is mirrored with a different key type", ("c", code)("t", index_table) );
+
+            auto sitr = image->find( scope );
+            if( sitr == image->end() ) return result;
+            const auto& cols = sitr->second;
+
+            // positions are {chunk, entry}, the end is {chunks.size(), 0}
+            using position = std::pair<std::size_t, std::size_t>;
+            auto position_of = [&]( auto&& pred ) {
+               const std::size_t c = column_partition_point( cols.last_secondary, pred );
+               if( c == cols.chunks.size() ) return position( c, 0 );
+               return position( c, column_partition_point( cols.chunks[c].secondary, pred ) );
+            };
+            const position lo = position_of( [&lower]( const Key& k ) { return k < lower; } );
+            const position hi = position_of( [&upper]( const Key& k ) { return !(upper < k); } );
+            if( !(lo < hi) ) return result;
+
+            auto take = [&]( const position& p ) {
+               const auto& chunk = cols.chunks[p.first];
+               if( rows.size() >= limit ) {
+                  next_key = chunk.secondary[p.second];
+                  return false;
+               }
+               rows.push_back( mirrored_row<Key>{ chunk.secondary[p.second], chunk.primary[p.second], chunk.payer[p.second],
+                                                  std::string( chunk.value( p.second ) ) } );
+               return true;
+            };
+            if( reverse ) {
+               for( position p = hi; lo < p; ) {
+                  if( p.second == 0 ) {
+                     --p.first;
+                     p.second = cols.chunks[p.first].size();
+                  }
+                  --p.second;
+                  if( !take( p ) ) break;
+               }
+            } else {
+               for( position p = lo; p < hi; ) {
+                  if( !take( p ) ) break;
+                  if( ++p.second == cols.chunks[p.first].size() ) {
+                     ++p.first;
+                     p.second = 0;
+                  }
+               }
+            }
+         }
+
+         for( const auto& r : rows ) {
+            if( !f( row_view{ r.primary, r.payer, r.value } ) ) {
+               result.more = true;
+               result.next_key = r.secondary;
+               return result;
+            }
+         }
+         if( next_key ) {
+            result.more = true;
+            result.next_key = next_key;
+         }
+         return result;
+      }
+
+      const chain::controller&                                         controller;    ///< the controller to read data from
+      std::set<chain::name>                                            mirrored_codes;///< contracts with at least one mirrored index
+      std::set<chain::name>                                            touched_codes; ///< mirrored contracts that received actions since the last block
+      std::deque<applied_block>                                        applied;       ///< reversible blocks on top of base_id
+      chain::block_id_type                                             base_id;       ///< the block the changes in applied start from
+      chain::block_id_type                                             head_id;       ///< the block the images are at
+
+      /*
+       * The set of indices is fixed at construction; the images are only changed by the writing thread and only
+       * while it holds the `rw_mutex` exclusively
+       */
+      std::map<index_key, mirrored_index>                              indices;
+      std::map<chain::name, mirrored_abi>                              abis;          ///< of mirrored_codes, changed like the images
+      mutable std::shared_mutex                                        rw_mutex;
+   };
+
+   secondary_index_mirror::secondary_index_mirror( const chain::controller& controller, std::vector<index_spec> specs )
+   :_impl(std::make_unique<secondary_index_mirror_impl>(controller, std::move(specs)))
+   {
+      _impl->build_all();
+   }
+
+   secondary_index_mirror::~secondary_index_mirror() = default;
+   secondary_index_mirror::secondary_index_mirror(secondary_index_mirror&&) = default;
+   secondary_index_mirror& secondary_index_mirror::operator=(secondary_index_mirror&&) = default;
+
+   void secondary_index_mirror::cache_transaction_trace( const chain::transaction_trace_ptr& trace ) {
+      try {
+         _impl->cache_transaction_trace(trace);
+      } FC_LOG_AND_DROP(("SECONDARY INDEX MIRROR cache_transaction_trace ERROR"));
+   }
+
+   void secondary_index_mirror::commit_block( const chain::block_state_ptr& block ) {
+      try {
+         _impl->commit_block(block);
+      } FC_LOG_AND_DROP(("SECONDARY INDEX MIRROR commit_block ERROR"));
+   }
+
+   void secondary_index_mirror::irreversible_block( const chain::block_state_ptr& block ) {
+      try {
+         _impl->irreversible_block(block);
+      } FC_LOG_AND_DROP(("SECONDARY INDEX MIRROR irreversible_block ERROR"));
+   }
+
+   bool secondary_index_mirror::is_mirrored( chain::name code, chain::name index_table, const std::string& key_type ) const {
+      return _impl->is_mirrored(code, index_table, key_type);
+   }
+
+   std::shared_ptr<const chain::abi_def> secondary_index_mirror::get_abi( chain::name code ) const {
+      return _impl->get_abi(code);
+   }
+
+   secondary_index_mirror::query_result<uint64_t>
+   secondary_index_mirror::walk_range( chain::name code, chain::name scope, chain::name index_table,
+                                       uint64_t lower, uint64_t upper, bool reverse, uint32_t limit,
+                                       const row_callback& f ) const {
+      return _impl->walk_range<uint64_t>(code, scope, index_table, lower, upper, reverse, limit, f);
+   }
+
+   secondary_index_mirror::query_result<chain::uint128_t>
+   secondary_index_mirror::walk_range( chain::name code, chain::name scope, chain::name index_table,
+                                       const chain::uint128_t& lower, const chain::uint128_t& upper,
+                                       bool reverse, uint32_t limit, const row_callback& f ) const {
+      return _impl->walk_range<chain::uint128_t>(code, scope, index_table, lower, upper, reverse, limit, f);
+   }
+
+}
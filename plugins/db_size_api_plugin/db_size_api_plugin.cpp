@@ -2,6 +2,7 @@
 #include <fc/io/json.hpp>
 #include <eosio/db_size_api_plugin/db_size_api_plugin.hpp>
 #include <eosio/http_plugin/http_plugin.hpp>
+#include <eosio/chain/reversible_block_journal.hpp>
 
 namespace eosio {
 
@@ -21,17 +22,71 @@ using namespace eosio;
           } \
        }}
 
+#define CALL_WITH_400_PARAMS(api_name, api_handle, call_name, params_type, http_response_code) \
+{std::string("/v1/" #api_name "/" #call_name), \
+   [api_handle](string, string body, url_response_callback cb) mutable { \
+          try { \
+             auto params = parse_params<call_name ## _params, params_type>(body); \
+             auto result = api_handle->call_name(params); \
+             cb(http_response_code, fc::variant(result)); \
+          } catch (...) { \
+             http_plugin::handle_exception(#api_name, #call_name, body, cb); \
+          } \
+       }}
+
 #define INVOKE_R_V(api_handle, call_name) \
      auto result = api_handle->call_name();
 
 
+void db_size_api_plugin::set_program_options(options_description& cli, options_description& cfg) {
+   cfg.add_options()
+         ("track-state-sizes", bpo::bool_switch()->default_value(false),
+          "Keep row and byte counts of the contract state per contract and table, served by /v1/db_size/get_contract_sizes "
+          "and /v1/db_size/get_table_sizes. The state is counted once at startup and then updated from the changes of "
+          "every block.")
+         ;
+}
+
+void db_size_api_plugin::plugin_initialize(const variables_map& options) {
+   try {
+      track_state_sizes = options.at("track-state-sizes").as<bool>();
+      if (track_state_sizes) {
+         // the block changes are read from the undo sessions, which irreversible mode only keeps with this option
+         const auto& chain = app().get_plugin<chain_plugin>().chain();
+         EOS_ASSERT(chain.get_read_mode() != chain::db_read_mode::IRREVERSIBLE || options.at("disable-replay-opts").as<bool>(),
+                    chain::plugin_config_exception,
+                    "track-state-sizes in irreversible read mode requires --disable-replay-opts");
+      }
+   }
+   FC_LOG_AND_RETHROW()
+}
+
 void db_size_api_plugin::plugin_startup() {
+   if (track_state_sizes) {
+      auto& chain = app().get_plugin<chain_plugin>().chain();
+      tracker = std::make_unique<state_size_tracker>(chain);
+      accepted_block_connection.emplace(chain.accepted_block.connect([this](const chain::block_state_ptr& b) {
+         tracker->on_accepted_block(b);
+      }));
+      irreversible_block_connection.emplace(chain.irreversible_block.connect([this](const chain::block_state_ptr& b) {
+         tracker->on_irreversible_block(b);
+      }));
+   }
+
    app().get_plugin<http_plugin>().add_api({
        CALL_WITH_400(db_size, this, get,  INVOKE_R_V(this, get), 200),
        CALL_WITH_400(db_size, this, get_reversible, INVOKE_R_V(this, get_reversible), 200),
+       CALL_WITH_400_PARAMS(db_size, this, get_contract_sizes, http_params_types::possible_no_params, 200),
+       CALL_WITH_400_PARAMS(db_size, this, get_table_sizes, http_params_types::params_required, 200),
    });
 }
 
+void db_size_api_plugin::plugin_shutdown() {
+   accepted_block_connection.reset();
+   irreversible_block_connection.reset();
+   tracker.reset();
+}
+
 db_size_stats db_size_api_plugin::get_db_stats(const chainbase::database& db) {
    db_size_stats ret;
 
@@ -51,10 +106,31 @@ db_size_stats db_size_api_plugin::get() {
 }
 
 db_size_stats db_size_api_plugin::get_reversible() {
-   return get_db_stats(app().get_plugin<chain_plugin>().chain().reversible_db());
+   const auto& chain = app().get_plugin<chain_plugin>().chain();
+   if (const auto* journal = chain.reversible_journal()) {
+      // the reversible blocks database is unused, report the blocks held in the journal file
+      db_size_stats ret;
+      ret.size       = journal->file_size();
+      ret.used_bytes = journal->file_size();
+      ret.free_bytes = 0;
+      ret.indices.emplace_back(db_size_index_count{chain::reversible_block_journal::file_name, journal->size()});
+      return ret;
+   }
+   return get_db_stats(chain.reversible_db());
+}
+
+get_contract_sizes_results db_size_api_plugin::get_contract_sizes(const get_contract_sizes_params& params) {
+   EOS_ASSERT(tracker, chain::plugin_config_exception, "State sizes are not tracked, enable track-state-sizes");
+   return tracker->get_contract_sizes(params);
+}
+
+get_table_sizes_results db_size_api_plugin::get_table_sizes(const get_table_sizes_params& params) {
+   EOS_ASSERT(tracker, chain::plugin_config_exception, "State sizes are not tracked, enable track-state-sizes");
+   return tracker->get_table_sizes(params);
 }
 
 #undef INVOKE_R_V
+#undef CALL_WITH_400_PARAMS
 #undef CALL
 
 }
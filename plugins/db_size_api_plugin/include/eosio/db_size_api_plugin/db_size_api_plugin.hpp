@@ -2,6 +2,7 @@
 
 #include <eosio/http_plugin/http_plugin.hpp>
 #include <eosio/chain_plugin/chain_plugin.hpp>
+#include <eosio/db_size_api_plugin/state_size_tracker.hpp>
 
 #include <appbase/application.hpp>
 
@@ -32,16 +33,24 @@ public:
    db_size_api_plugin& operator=(db_size_api_plugin&&) = delete;
    virtual ~db_size_api_plugin() override = default;
 
-   virtual void set_program_options(options_description& cli, options_description& cfg) override {}
-   void plugin_initialize(const variables_map& vm) {}
+   virtual void set_program_options(options_description& cli, options_description& cfg) override;
+   void plugin_initialize(const variables_map& vm);
    void plugin_startup();
-   void plugin_shutdown() {}
+   void plugin_shutdown();
 
    db_size_stats get();
    db_size_stats get_reversible();
 
+   get_contract_sizes_results get_contract_sizes(const get_contract_sizes_params& params);
+   get_table_sizes_results get_table_sizes(const get_table_sizes_params& params);
+
 private:
    db_size_stats get_db_stats(const chainbase::database& );
+
+   bool                                           track_state_sizes = false;
+   std::unique_ptr<state_size_tracker>            tracker;
+   std::optional<boost::signals2::scoped_connection> accepted_block_connection;
+   std::optional<boost::signals2::scoped_connection> irreversible_block_connection;
 };
 
 }
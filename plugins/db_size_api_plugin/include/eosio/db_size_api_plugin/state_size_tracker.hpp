@@ -0,0 +1,139 @@
+#pragma once
+
+#include <eosio/chain/backing_store.hpp>
+#include <eosio/chain/block_state.hpp>
+#include <eosio/chain/controller.hpp>
+#include <eosio/chain/name.hpp>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace eosio {
+
+struct state_size {
+   int64_t row_count                 = 0;
+   int64_t secondary_index_row_count = 0;
+   int64_t bytes                     = 0;
+
+   void add(const state_size& s, int64_t sign) {
+      row_count                 += sign * s.row_count;
+      secondary_index_row_count += sign * s.secondary_index_row_count;
+      bytes                     += sign * s.bytes;
+   }
+
+   bool empty() const { return row_count == 0 && secondary_index_row_count == 0 && bytes == 0; }
+
+   friend bool operator==(const state_size& a, const state_size& b) {
+      return a.row_count == b.row_count && a.secondary_index_row_count == b.secondary_index_row_count && a.bytes == b.bytes;
+   }
+   friend bool operator!=(const state_size& a, const state_size& b) { return !(a == b); }
+};
+
+struct get_contract_sizes_params {
+   chain::name lower_bound;   ///< first contract to return
+   uint32_t    limit = 100;
+};
+
+struct contract_size {
+   chain::name contract;
+   std::string backing_store;
+   uint32_t    table_count = 0;
+   state_size  size;
+};
+
+struct get_contract_sizes_results {
+   uint32_t                   block_num = 0;   ///< block the sizes are as of
+   std::vector<contract_size> rows;
+   std::string                more;            ///< lower_bound of the next page, empty if there is none
+};
+
+struct get_table_sizes_params {
+   chain::name code;
+   chain::name lower_bound;   ///< first table of code to return
+   uint32_t    limit = 100;
+};
+
+struct table_size {
+   chain::name table;
+   std::string backing_store;
+   state_size  size;
+};
+
+struct get_table_sizes_results {
+   uint32_t                block_num = 0;   ///< block the sizes are as of
+   std::vector<table_size> rows;
+   std::string             more;            ///< lower_bound of the next page, empty if there is none
+};
+
+/**
+ * Row and byte counters of the contract state, per contract, table and backing store.
+ *
+ * The counters are built by a full count of the state when the tracker is created, which after a start from a
+ * snapshot is the state loaded from it, or at the first accepted block if a block is being built at that time. From then on every accepted block only adds the changes recorded in its undo
+ * sessions, the same ones state history reads its deltas from, so the counters follow the head block without scanning
+ * the database. The changes of the reversible blocks are kept to take them back on a fork switch, if a fork goes deeper
+ * than them the state is counted again.
+ *
+ * DB API rows are counted in their table, KV API rows, which have no table, under an empty table name. Bytes are what
+ * the rows and their secondary index entries bill in chainbase, and the size of their keys and values in RocksDB.
+ *
+ * Not thread safe, the tracker is used on the main thread like the controller it reads.
+ */
+class state_size_tracker {
+   public:
+      using table_key      = std::tuple<chain::name, chain::name, chain::backing_store_type>; // contract, table, store
+      using table_size_map = std::map<table_key, state_size>;
+
+      explicit state_size_tracker(const chain::controller& chain);
+
+      void on_accepted_block(const chain::block_state_ptr& block);
+      void on_irreversible_block(const chain::block_state_ptr& block);
+
+      get_contract_sizes_results get_contract_sizes(const get_contract_sizes_params& params) const;
+      get_table_sizes_results    get_table_sizes(const get_table_sizes_params& params) const;
+
+      const table_size_map& table_sizes() const { return _tables; }
+      uint32_t              block_num() const { return _head_num; }
+
+      /// Counts the current state of chain by walking all of it
+      static table_size_map count(const chain::controller& chain);
+
+      static constexpr uint32_t max_limit = 1000;
+
+   private:
+      struct contract_totals {
+         uint32_t   table_count = 0;
+         state_size size;
+      };
+      using contract_key = std::pair<chain::name, chain::backing_store_type>;
+
+      struct applied_block {
+         uint32_t             block_num = 0;
+         chain::block_id_type id;
+         table_size_map       delta;
+      };
+
+      void reset(uint32_t block_num, const chain::block_id_type& id);
+      void apply(const table_size_map& delta, int64_t sign);
+
+      const chain::controller&                _chain;
+      table_size_map                          _tables;
+      std::map<contract_key, contract_totals> _contracts;
+      std::deque<applied_block>               _applied;   ///< reversible blocks on top of _base_id
+      chain::block_id_type                    _base_id;
+      chain::block_id_type                    _head_id;
+      uint32_t                                _head_num = 0;   ///< 0 until the state is counted
+};
+
+}
+
+FC_REFLECT( eosio::state_size, (row_count)(secondary_index_row_count)(bytes) )
+FC_REFLECT( eosio::get_contract_sizes_params, (lower_bound)(limit) )
+FC_REFLECT( eosio::contract_size, (contract)(backing_store)(table_count)(size) )
+FC_REFLECT( eosio::get_contract_sizes_results, (block_num)(rows)(more) )
+FC_REFLECT( eosio::get_table_sizes_params, (code)(lower_bound)(limit) )
+FC_REFLECT( eosio::table_size, (table)(backing_store)(size) )
+FC_REFLECT( eosio::get_table_sizes_results, (block_num)(rows)(more) )
@@ -0,0 +1,351 @@
+#include <eosio/db_size_api_plugin/state_size_tracker.hpp>
+
+#include <eosio/chain/backing_store/db_combined.hpp>
+#include <eosio/chain/backing_store/db_key_value_format.hpp>
+#include <eosio/chain/combined_database.hpp>
+#include <eosio/chain/contract_table_objects.hpp>
+#include <eosio/chain/kv_chainbase_objects.hpp>
+
+#include <algorithm>
+
+namespace eosio {
+
+using namespace eosio::chain;
+namespace bs = eosio::chain::backing_store;
+
+namespace {
+
+   std::string backing_store_name(backing_store_type store) {
+      return store == backing_store_type::ROCKSDB ? "rocksdb" : "chainbase";
+   }
+
+   bool uses_rocksdb(const controller& chain) {
+      const auto& kv_db = chain.kv_db();
+      return kv_db.get_kv_undo_stack() && chain.db().get<kv_db_config_object>().backing_store == backing_store_type::ROCKSDB;
+   }
+
+   // chainbase
+
+   state_size table_id_size() { return {0, 0, static_cast<int64_t>(config::billable_size_v<table_id_object>)}; }
+
+   state_size row_size(const key_value_object& row) {
+      return {1, 0, static_cast<int64_t>(config::billable_size_v<key_value_object> + row.value.size())};
+   }
+
+   state_size row_size(const kv_object& row) {
+      return {1, 0, static_cast<int64_t>(config::billable_size_v<kv_object> + row.kv_key.size() + row.kv_value.size())};
+   }
+
+   template<typename Object>
+   state_size secondary_size() { return {0, 1, static_cast<int64_t>(config::billable_size_v<Object>)}; }
+
+   state_size_tracker::table_key chainbase_key(const table_id_object& t) {
+      return {t.code, t.table, backing_store_type::CHAINBASE};
+   }
+
+   state_size_tracker::table_key chainbase_key(const kv_object& row) {
+      return {row.contract, name(), backing_store_type::CHAINBASE};
+   }
+
+   template<typename Index, typename TableKey>
+   void count_secondary_index(const chainbase::database& db, TableKey&& table_key, state_size_tracker::table_size_map& sizes) {
+      using object_type = typename Index::value_type;
+      for (const auto& row : db.get_index<Index>().indices())
+         sizes[table_key(row.t_id)].add(secondary_size<object_type>(), 1);
+   }
+
+   template<typename Index, typename TableKey>
+   void add_secondary_index_delta(const chainbase::database& db, TableKey&& table_key, state_size_tracker::table_size_map& delta) {
+      using object_type = typename Index::value_type;
+      // a secondary index entry cannot move to another table, modifying it does not change its size
+      auto undo = db.get_index<Index>().last_undo_session();
+      for (const auto& row : undo.new_values)
+         delta[table_key(row.t_id)].add(secondary_size<object_type>(), 1);
+      for (const auto& row : undo.removed_values)
+         delta[table_key(row.t_id)].add(secondary_size<object_type>(), -1);
+   }
+
+   template<typename F>
+   void for_each_secondary_index(F&& f) {
+      f(static_cast<const index64_index*>(nullptr));
+      f(static_cast<const index128_index*>(nullptr));
+      f(static_cast<const index256_index*>(nullptr));
+      f(static_cast<const index_double_index*>(nullptr));
+      f(static_cast<const index_long_double_index*>(nullptr));
+   }
+
+   void count_chainbase(const chainbase::database& db, state_size_tracker::table_size_map& sizes) {
+      auto table_key = [&](table_id tid) { return chainbase_key(db.get<table_id_object>(tid)); };
+
+      for (const auto& t : db.get_index<table_id_multi_index>().indices())
+         sizes[chainbase_key(t)].add(table_id_size(), 1);
+      for (const auto& row : db.get_index<key_value_index>().indices())
+         sizes[table_key(row.t_id)].add(row_size(row), 1);
+      for_each_secondary_index([&](auto* index) {
+         count_secondary_index<std::remove_cv_t<std::remove_pointer_t<decltype(index)>>>(db, table_key, sizes);
+      });
+      for (const auto& row : db.get_index<kv_index>().indices())
+         sizes[chainbase_key(row)].add(row_size(row), 1);
+   }
+
+   // changes of the last undo session, see state_history::create_deltas
+   void add_chainbase_delta(const chainbase::database& db, state_size_tracker::table_size_map& delta) {
+      const auto& table_id_index = db.get_index<table_id_multi_index>();
+      auto table_undo = table_id_index.last_undo_session();
+      std::map<uint64_t, const table_id_object*> removed_table_id;
+      for (const auto& rem : table_undo.removed_values)
+         removed_table_id[rem.id._id] = &rem;
+
+      auto table_key = [&](table_id tid) {
+         if (const auto* t = table_id_index.find(tid))
+            return chainbase_key(*t);
+         auto it = removed_table_id.find(tid._id);
+         EOS_ASSERT(it != removed_table_id.end(), plugin_exception, "can not find table id ${tid}", ("tid", tid));
+         return chainbase_key(*it->second);
+      };
+
+      // code, scope and table of a table id object are never modified
+      for (const auto& t : table_undo.new_values)
+         delta[chainbase_key(t)].add(table_id_size(), 1);
+      for (const auto& t : table_undo.removed_values)
+         delta[chainbase_key(t)].add(table_id_size(), -1);
+
+      const auto& kv_rows = db.get_index<key_value_index>();
+      auto row_undo = kv_rows.last_undo_session();
+      for (const auto& old : row_undo.old_values) {
+         auto& d = delta[table_key(old.t_id)];
+         d.add(row_size(kv_rows.get(old.id)), 1);
+         d.add(row_size(old), -1);
+      }
+      for (const auto& row : row_undo.removed_values)
+         delta[table_key(row.t_id)].add(row_size(row), -1);
+      for (const auto& row : row_undo.new_values)
+         delta[table_key(row.t_id)].add(row_size(row), 1);
+
+      for_each_secondary_index([&](auto* index) {
+         add_secondary_index_delta<std::remove_cv_t<std::remove_pointer_t<decltype(index)>>>(db, table_key, delta);
+      });
+
+      const auto& kv_index_rows = db.get_index<kv_index>();
+      auto kv_undo = kv_index_rows.last_undo_session();
+      for (const auto& old : kv_undo.old_values) {
+         auto& d = delta[chainbase_key(old)];
+         d.add(row_size(kv_index_rows.get(old.id)), 1);
+         d.add(row_size(old), -1);
+      }
+      for (const auto& row : kv_undo.removed_values)
+         delta[chainbase_key(row)].add(row_size(row), -1);
+      for (const auto& row : kv_undo.new_values)
+         delta[chainbase_key(row)].add(row_size(row), 1);
+   }
+
+   // RocksDB
+
+   constexpr std::size_t rocksdb_prefix_size = 1 + sizeof(uint64_t); // db type + contract
+
+   // key is the part of an entry following db type and contract
+   void add_rocksdb_entry(state_size_tracker::table_size_map& sizes, char db_type, uint64_t contract,
+                          const char* key, std::size_t key_size, std::size_t value_size, int64_t sign) {
+      state_size s{0, 0, static_cast<int64_t>(rocksdb_prefix_size + key_size + value_size)};
+      name table;
+      if (db_type == bs::rocksdb_contract_kv_prefix) {
+         s.row_count = 1;
+      } else {
+         const b1::chain_kv::bytes legacy_key{key, key + key_size};
+         const auto [scope, key_table, type_end, kt] = bs::db_key_value_format::get_prefix_thru_key_type(legacy_key);
+         table = key_table;
+         switch (kt) {
+            case bs::db_key_value_format::key_type::primary:
+               s.row_count = 1;
+               break;
+            case bs::db_key_value_format::key_type::sec_i64:
+            case bs::db_key_value_format::key_type::sec_i128:
+            case bs::db_key_value_format::key_type::sec_i256:
+            case bs::db_key_value_format::key_type::sec_double:
+            case bs::db_key_value_format::key_type::sec_long_double:
+               s.secondary_index_row_count = 1;
+               break;
+            case bs::db_key_value_format::key_type::primary_to_sec: // other half of a secondary index entry
+            case bs::db_key_value_format::key_type::table:
+               break;
+         }
+      }
+      sizes[{name(contract), table, backing_store_type::ROCKSDB}].add(s, sign);
+   }
+
+   void add_rocksdb_entry(state_size_tracker::table_size_map& sizes, const eosio::session::shared_bytes& full_key,
+                          std::size_t value_size, int64_t sign) {
+      if (full_key.size() < rocksdb_prefix_size)
+         return;
+      const char db_type = full_key[0];
+      if (db_type != bs::rocksdb_contract_kv_prefix && db_type != bs::rocksdb_contract_db_prefix)
+         return;
+      const b1::chain_kv::bytes contract_key{full_key.data() + 1, full_key.data() + rocksdb_prefix_size};
+      auto begin = contract_key.cbegin();
+      uint64_t contract = 0;
+      b1::chain_kv::extract_key(begin, contract_key.cend(), contract);
+      add_rocksdb_entry(sizes, db_type, contract, full_key.data() + rocksdb_prefix_size,
+                        full_key.size() - rocksdb_prefix_size, value_size, sign);
+   }
+
+   void count_rocksdb(const bs::kv_undo_stack_ptr& kv_undo_stack, state_size_tracker::table_size_map& sizes) {
+      for (const char db_type : {bs::rocksdb_contract_kv_prefix, bs::rocksdb_contract_db_prefix}) {
+         auto counter = [&](uint64_t contract, const char* key, std::size_t key_size, const char*, std::size_t value_size) {
+            add_rocksdb_entry(sizes, db_type, contract, key, key_size, value_size, 1);
+            return true;
+         };
+         const auto begin_key = eosio::session::shared_bytes(&db_type, 1);
+         const auto end_key   = begin_key.next();
+         bs::walk_rocksdb_entries_with_prefix(kv_undo_stack, begin_key, end_key, counter);
+      }
+   }
+
+   // changes of the top session against its parent, see state_history::create_deltas_rocksdb
+   void add_rocksdb_delta(const bs::kv_undo_stack_ptr& kv_undo_stack, state_size_tracker::table_size_map& delta) {
+      auto* session = std::visit(eosio::session::overloaded{
+         [](bs::kv_undo_stack_ptr::element_type::session_type* session) {
+            return session;
+         }, [](auto*) {
+            EOS_ASSERT(false, plugin_exception, "undo_stack is empty");
+            static bs::kv_undo_stack_ptr::element_type::session_type* invalid = nullptr;
+            return invalid;
+         }}, kv_undo_stack->top().holder());
+
+      auto previous_value = [&](const eosio::session::shared_bytes& key) {
+         return std::visit([&](auto* p) { return p->read(key); }, session->parent());
+      };
+
+      for (const auto& updated_key : session->updated_keys()) {
+         if (auto prev = previous_value(updated_key))
+            add_rocksdb_entry(delta, updated_key, prev->size(), -1);
+         if (auto curr = session->read(updated_key))
+            add_rocksdb_entry(delta, updated_key, curr->size(), 1);
+      }
+      for (const auto& deleted_key : session->deleted_keys()) {
+         if (auto prev = previous_value(deleted_key))
+            add_rocksdb_entry(delta, deleted_key, prev->size(), -1);
+      }
+   }
+
+} // namespace
+
+state_size_tracker::state_size_tracker(const controller& chain)
+   : _chain(chain) {
+   // the state of a pending block is not the state of any block, it is counted at the next accepted block instead
+   if (!chain.is_building_block())
+      reset(chain.head_block_num(), chain.head_block_id());
+}
+
+state_size_tracker::table_size_map state_size_tracker::count(const controller& chain) {
+   table_size_map sizes;
+   count_chainbase(chain.db(), sizes);
+   if (uses_rocksdb(chain))
+      count_rocksdb(chain.kv_db().get_kv_undo_stack(), sizes);
+   return sizes;
+}
+
+void state_size_tracker::reset(uint32_t block_num, const block_id_type& id) {
+   _tables.clear();
+   _contracts.clear();
+   _applied.clear();
+   apply(count(_chain), 1);
+   _base_id  = id;
+   _head_id  = id;
+   _head_num = block_num;
+}
+
+void state_size_tracker::apply(const table_size_map& delta, int64_t sign) {
+   for (const auto& [key, d] : delta) {
+      if (d.empty())
+         continue;
+      const contract_key ckey{std::get<0>(key), std::get<2>(key)};
+      auto& contract = _contracts[ckey];
+      contract.size.add(d, sign);
+
+      auto& table = _tables[key];
+      const bool existed = !table.empty();
+      table.add(d, sign);
+      if (table.empty()) {
+         _tables.erase(key);
+         if (existed)
+            --contract.table_count;
+      } else if (!existed) {
+         ++contract.table_count;
+      }
+      if (contract.table_count == 0 && contract.size.empty())
+         _contracts.erase(ckey);
+   }
+}
+
+void state_size_tracker::on_accepted_block(const block_state_ptr& block) {
+   if (_head_num == 0) {
+      reset(block->block_num, block->id);
+      return;
+   }
+
+   const auto& previous = block->header.previous;
+   if (previous != _head_id) {
+      // fork switch, the controller has undone the blocks of the other branch
+      while (!_applied.empty() && _applied.back().id != previous) {
+         apply(_applied.back().delta, -1);
+         _applied.pop_back();
+      }
+      if (_applied.empty() && _base_id != previous) {
+         wlog("fork switch to block ${n} goes past the blocks sizes were tracked from, counting the state again",
+              ("n", block->block_num));
+         reset(block->block_num, block->id);
+         return;
+      }
+   }
+
+   table_size_map delta;
+   add_chainbase_delta(_chain.db(), delta);
+   if (uses_rocksdb(_chain))
+      add_rocksdb_delta(_chain.kv_db().get_kv_undo_stack(), delta);
+   apply(delta, 1);
+
+   _applied.push_back({block->block_num, block->id, std::move(delta)});
+   _head_id  = block->id;
+   _head_num = block->block_num;
+}
+
+void state_size_tracker::on_irreversible_block(const block_state_ptr& block) {
+   while (!_applied.empty() && _applied.front().block_num <= block->block_num) {
+      _base_id = _applied.front().id;
+      _applied.pop_front();
+   }
+}
+
+get_contract_sizes_results state_size_tracker::get_contract_sizes(const get_contract_sizes_params& params) const {
+   get_contract_sizes_results result;
+   result.block_num = _head_num;
+   const auto limit = std::clamp(params.limit, 1u, max_limit);
+   for (auto itr = _contracts.lower_bound({params.lower_bound, backing_store_type::CHAINBASE}); itr != _contracts.end(); ++itr) {
+      const auto& [contract, store] = itr->first;
+      // the stores of a contract are never split across pages
+      if (result.rows.size() >= limit && contract != result.rows.back().contract) {
+         result.more = contract.to_string();
+         break;
+      }
+      result.rows.push_back({contract, backing_store_name(store), itr->second.table_count, itr->second.size});
+   }
+   return result;
+}
+
+get_table_sizes_results state_size_tracker::get_table_sizes(const get_table_sizes_params& params) const {
+   get_table_sizes_results result;
+   result.block_num = _head_num;
+   const auto limit = std::clamp(params.limit, 1u, max_limit);
+   for (auto itr = _tables.lower_bound({params.code, params.lower_bound, backing_store_type::CHAINBASE});
+        itr != _tables.end() && std::get<0>(itr->first) == params.code; ++itr) {
+      const auto& table = std::get<1>(itr->first);
+      if (result.rows.size() >= limit && table != result.rows.back().table) {
+         result.more = table.to_string();
+         break;
+      }
+      result.rows.push_back({table, backing_store_name(std::get<2>(itr->first)), itr->second});
+   }
+   return result;
+}
+
+}
@@ -137,6 +137,9 @@ namespace eosio {
          virtual void handle_exception() = 0;
 
          virtual void send_response(std::optional<std::string> body, int code) = 0;
+
+         // IP address of the client without port
+         virtual std::string client_address() const = 0;
       };
 
       using abstract_conn_ptr = std::shared_ptr<abstract_conn>;
@@ -220,6 +223,7 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
          websocket_server_type    server;
 
          uint16_t                                       thread_pool_size = 2;
+         std::vector<uint32_t>                          thread_pool_cpus;
          std::optional<eosio::chain::named_thread_pool> thread_pool;
          std::atomic<size_t>                            bytes_in_flight{0};
          std::atomic<int32_t>                           requests_in_flight{0};
@@ -437,6 +441,18 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
                _conn->send_http_response();
             }
 
+            std::string client_address() const override {
+               // "address:port" or "[address]:port", unix socket connections have a fixed name without port
+               std::string endpoint = _conn->get_remote_endpoint();
+               const auto colon = endpoint.rfind(':');
+               if( colon == std::string::npos || endpoint.find(' ') != std::string::npos )
+                  return endpoint;
+               endpoint.resize(colon);
+               if( endpoint.size() >= 2 && endpoint.front() == '[' && endpoint.back() == ']' )
+                  endpoint = endpoint.substr(1, endpoint.size() - 2);
+               return endpoint;
+            }
+
             detail::connection_ptr<T> _conn;
             http_plugin_impl_ptr _impl;
          };
@@ -576,6 +592,23 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
              };
          }
 
+         /**
+          * Make an internal_url_handler that will run the url_handler_with_client directly
+          *
+          * @pre b.size() has been added to bytes_in_flight by caller
+          * @param next - the next handler for responses
+          * @return the constructed internal_url_handler
+          */
+         static detail::internal_url_handler make_http_thread_url_handler(url_handler_with_client next) {
+            return [next=std::move(next)]( const detail::abstract_conn_ptr& conn, string r, string b, url_response_callback then ) {
+               try {
+                  next(conn->client_address(), std::move(r), std::move(b), std::move(then));
+               } catch( ... ) {
+                  conn->handle_exception();
+               }
+             };
+         }
+
          /**
           * Construct a lambda appropriate for url_response_callback that will
           * JSON-stringify the provided response
@@ -777,6 +810,8 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
              "Additionaly acceptable values for the \"Host\" header of incoming HTTP requests, can be specified multiple times.  Includes http/s_server_address by default.")
             ("http-threads", bpo::value<uint16_t>()->default_value( my->thread_pool_size ),
              "Number of worker threads in http thread pool")
+            ("http-threads-cpus", bpo::value<string>(),
+             "CPUs to bind the http thread pool to, either a list of CPUs and CPU ranges such as 0-3,8 or node:N for the CPUs of NUMA node N")
             ;
    }
 
@@ -854,6 +889,8 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
          my->thread_pool_size = options.at( "http-threads" ).as<uint16_t>();
          EOS_ASSERT( my->thread_pool_size > 0, chain::plugin_config_exception,
                      "http-threads ${num} must be greater than 0", ("num", my->thread_pool_size));
+         if( options.count( "http-threads-cpus" ))
+            my->thread_pool_cpus = chain::parse_cpu_affinity( options.at( "http-threads-cpus" ).as<string>() );
 
          my->max_bytes_in_flight = options.at( "http-max-bytes-in-flight-mb" ).as<uint32_t>() * 1024 * 1024;
          my->max_requests_in_flight = options.at( "http-max-in-flight-requests" ).as<int32_t>();
@@ -869,7 +906,7 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
       app().post(appbase::priority::high, [this] ()
       {
          try {
-            my->thread_pool.emplace( "http", my->thread_pool_size );
+            my->thread_pool.emplace( "http", my->thread_pool_size, my->thread_pool_cpus );
             if(my->listen_endpoint) {
                try {
                   my->create_server_for_endpoint(*my->listen_endpoint, my->server);
@@ -989,6 +1026,11 @@ class http_plugin_impl : public std::enable_shared_from_this<http_plugin_impl> {
       my->url_handlers[url] = my->make_http_thread_url_handler(handler);
    }
 
+   void http_plugin::add_async_client_handler(const string& url, const url_handler_with_client& handler) {
+      fc_ilog( logger, "add api url: ${c}", ("c", url) );
+      my->url_handlers[url] = my->make_http_thread_url_handler(handler);
+   }
+
    void http_plugin::handle_exception( const char *api_name, const char *call_name, const string& body, url_response_callback cb ) {
       try {
          try {
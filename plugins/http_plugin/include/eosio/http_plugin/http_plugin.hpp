@@ -28,6 +28,15 @@ namespace eosio {
     **/
    using url_handler = std::function<void(string,string,url_response_callback)>;
 
+   /**
+    * @brief Callback type for a URL handler which also gets the address of the client
+    *
+    * Arguments: client_address, url, request_body, response_callback
+    *
+    * client_address is the IP address of the client without port, or a fixed name for unix socket clients
+    **/
+   using url_handler_with_client = std::function<void(string,string,string,url_response_callback)>;
+
    /**
     * @brief An API, containing URLs and handlers
     *
@@ -85,6 +94,8 @@ namespace eosio {
         }
 
         void add_async_handler(const string& url, const url_handler& handler);
+        // handler is called on an http thread, like add_async_handler, and also gets the address of the client
+        void add_async_client_handler(const string& url, const url_handler_with_client& handler);
         void add_async_api(const api_description& api) {
            for (const auto& call : api)
               add_handler(call.first, call.second);
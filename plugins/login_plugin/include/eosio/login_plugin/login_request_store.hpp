@@ -0,0 +1,199 @@
+#pragma once
+
+#include <eosio/chain/types.hpp>
+#include <eosio/chain/exceptions.hpp>
+
+#include <fc/io/raw.hpp>
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace eosio {
+
+/**
+ * Pending login requests of login_plugin, keyed by the server ephemeral public key.
+ *
+ * Requests are spread over shards, each guarded by its own mutex, so that requests can be started and finalized
+ * from the http threads without going through the main thread. Requests are expired through an expiry wheel of one
+ * second slots; keys are removed from the wheel lazily, a key whose request was already finalized is dropped when
+ * its slot is processed. Only one thread expires at a time, others skip expiring instead of waiting.
+ *
+ * The number of pending requests is capped and each client address may optionally only start a limited number of
+ * requests per second (token bucket with a burst of one second's worth of requests).
+ *
+ * Locks are always taken in the order wheel, request shard and never more than one of each. Client shards are never
+ * locked together with any other lock.
+ */
+class login_request_store {
+public:
+   struct request {
+      chain::private_key_type server_ephemeral_priv_key{};
+      chain::public_key_type  server_ephemeral_pub_key{};
+      chain::time_point_sec   expiration_time;
+   };
+
+   struct config {
+      uint32_t max_requests = 1000000;
+      uint32_t max_timeout_sec = 60;
+      uint32_t rate_limit_per_client = 0; ///< requests per second and client address, 0 for no limit
+   };
+
+private:
+   static constexpr size_t num_shards = 16;
+
+   struct request_shard {
+      std::mutex                                       mtx;
+      std::map<chain::public_key_type, request>        requests;
+   };
+
+   struct client_bucket {
+      double         tokens = 0;
+      fc::time_point last_refill;
+   };
+
+   struct client_shard {
+      std::mutex                                       mtx;
+      std::unordered_map<std::string, client_bucket>   clients;
+   };
+
+   struct expiry_wheel {
+      std::mutex                                                     mtx;
+      std::map<uint32_t, std::vector<chain::public_key_type>>        slots; ///< expiration second -> keys
+      uint32_t                                                       last_client_sweep = 0;
+   };
+
+   config                                  _config;
+   std::array<request_shard, num_shards>   _request_shards;
+   std::array<client_shard, num_shards>    _client_shards;
+   expiry_wheel                            _expiry_wheel;
+   std::atomic<size_t>                     _size{0};
+
+   request_shard& request_shard_for( const chain::public_key_type& key ) {
+      const auto packed = fc::raw::pack( key );
+      return _request_shards[std::hash<std::string_view>{}( std::string_view( packed.data(), packed.size() ) ) % num_shards];
+   }
+
+   client_shard& client_shard_for( const std::string& client ) {
+      return _client_shards[std::hash<std::string>{}( client ) % num_shards];
+   }
+
+   // drop the buckets of clients that have been idle long enough for their bucket to be full again
+   void sweep_clients( const fc::time_point& now ) {
+      for( auto& shard : _client_shards ) {
+         std::lock_guard g( shard.mtx );
+         for( auto itr = shard.clients.begin(); itr != shard.clients.end(); ) {
+            if( now - itr->second.last_refill >= fc::seconds( 1 ) ) itr = shard.clients.erase( itr );
+            else ++itr;
+         }
+      }
+   }
+
+public:
+   explicit login_request_store( const config& cfg = config() )
+   : _config( cfg ) {}
+
+   const config& get_config() const { return _config; }
+
+   /// number of pending requests, including expired ones not yet removed by expire
+   size_t size() const { return _size; }
+
+   /**
+    * Account for a new request of client, call before the request key is generated.
+    * @throws fc::timeout_exception if client exceeds its rate limit or there are too many pending requests
+    */
+   void admit( const std::string& client, const fc::time_point& now ) {
+      EOS_ASSERT( _size < _config.max_requests, fc::timeout_exception, "Too many pending login requests" );
+      if( _config.rate_limit_per_client == 0 ) return;
+
+      const double rate = _config.rate_limit_per_client;
+      auto& shard = client_shard_for( client );
+      std::lock_guard g( shard.mtx );
+      auto [itr, inserted] = shard.clients.try_emplace( client, client_bucket{ rate, now } );
+      auto& bucket = itr->second;
+      if( !inserted && now > bucket.last_refill ) {
+         bucket.tokens = std::min( rate, bucket.tokens + rate * ( now - bucket.last_refill ).count() / 1000000.0 );
+         bucket.last_refill = now;
+      }
+      EOS_ASSERT( bucket.tokens >= 1, fc::timeout_exception,
+                  "Too many login requests from ${client}", ("client", client) );
+      bucket.tokens -= 1;
+   }
+
+   /**
+    * Add a request, its expiration_time is limited to max_timeout_sec from now
+    * @throws fc::timeout_exception if there are too many pending requests
+    */
+   void insert( request r, const fc::time_point& now ) {
+      if( ++_size > _config.max_requests ) {
+         --_size;
+         EOS_THROW( fc::timeout_exception, "Too many pending login requests" );
+      }
+      r.expiration_time = std::min( r.expiration_time, chain::time_point_sec{ now } + _config.max_timeout_sec );
+      const auto key = r.server_ephemeral_pub_key;
+      const auto slot = r.expiration_time.sec_since_epoch();
+      {
+         std::lock_guard g( _expiry_wheel.mtx );
+         _expiry_wheel.slots[slot].push_back( key );
+      }
+      auto& shard = request_shard_for( key );
+      std::lock_guard g( shard.mtx );
+      if( !shard.requests.emplace( key, std::move( r ) ).second ) --_size; // generated keys do not collide
+   }
+
+   /// remove and return the request of key, nothing if there is none or it has expired
+   std::optional<request> take( const chain::public_key_type& key, const fc::time_point& now ) {
+      auto& shard = request_shard_for( key );
+      std::lock_guard g( shard.mtx );
+      auto itr = shard.requests.find( key );
+      if( itr == shard.requests.end() ) return {};
+      std::optional<request> result;
+      if( !( itr->second.expiration_time < now ) ) result = std::move( itr->second );
+      shard.requests.erase( itr );
+      --_size;
+      return result;
+   }
+
+   /**
+    * Remove the requests that expired before now and the rate limit state of idle clients.
+    * Returns right away if another thread is already expiring.
+    * @return number of requests removed
+    */
+   size_t expire( const fc::time_point& now ) {
+      std::unique_lock wheel_lock( _expiry_wheel.mtx, std::try_to_lock );
+      if( !wheel_lock.owns_lock() ) return 0;
+
+      const uint32_t now_sec = chain::time_point_sec( now ).sec_since_epoch();
+      size_t removed = 0;
+      auto& slots = _expiry_wheel.slots;
+      // a slot is due once all of its second has passed, requests expiring in the current second are left to take
+      while( !slots.empty() && slots.begin()->first < now_sec ) {
+         for( const auto& key : slots.begin()->second ) {
+            auto& shard = request_shard_for( key );
+            std::lock_guard g( shard.mtx );
+            auto itr = shard.requests.find( key );
+            if( itr != shard.requests.end() && itr->second.expiration_time < now ) {
+               shard.requests.erase( itr );
+               --_size;
+               ++removed;
+            }
+         }
+         slots.erase( slots.begin() );
+      }
+
+      if( _config.rate_limit_per_client != 0 && now_sec != _expiry_wheel.last_client_sweep ) {
+         _expiry_wheel.last_client_sweep = now_sec;
+         wheel_lock.unlock();
+         sweep_clients( now );
+      }
+      return removed;
+   }
+};
+
+} // namespace eosio
@@ -1,6 +1,7 @@
 #include <eosio/chain/authorization_manager.hpp>
 #include <eosio/chain/exceptions.hpp>
 #include <eosio/login_plugin/login_plugin.hpp>
+#include <eosio/login_plugin/login_request_store.hpp>
 
 #include <fc/io/json.hpp>
 
@@ -10,35 +11,66 @@ static appbase::abstract_plugin& _login_plugin = app().register_plugin<login_plu
 
 using namespace eosio;
 
-struct login_request {
-   chain::private_key_type server_ephemeral_priv_key{};
-   chain::public_key_type server_ephemeral_pub_key{};
-   chain::time_point_sec expiration_time;
-};
-
-struct login_request_pub_key_index {};
-struct login_request_time_index {};
-
-using login_request_container = boost::multi_index_container<
-    login_request,
-    indexed_by< //
-        ordered_unique<tag<login_request_pub_key_index>,
-                       member<login_request, chain::public_key_type, &login_request::server_ephemeral_pub_key>>,
-        ordered_non_unique<tag<login_request_time_index>,
-                           member<login_request, chain::time_point_sec, &login_request::expiration_time>> //
-        >>;
-
 class login_plugin_impl {
  public:
-   login_request_container requests{};
-   uint32_t max_login_requests = 1000000;
-   uint32_t max_login_timeout = 60;
-
-   void expire_requests() {
-      auto& index = requests.get<login_request_time_index>();
-      auto now = fc::time_point::now();
-      for (auto it = index.begin(); it != index.end() && it->expiration_time < now; it = index.erase(it))
-         ;
+   std::unique_ptr<login_request_store> requests;
+
+   login_plugin::start_login_request_results
+   start_login_request(const std::string& client, const login_plugin::start_login_request_params& params) {
+      const auto now = fc::time_point::now();
+      requests->expire(now);
+      EOS_ASSERT(params.expiration_time > now, fc::timeout_exception,
+                 "Requested expiration time ${expiration_time} is in the past",
+                 ("expiration_time", params.expiration_time));
+      requests->admit(client, now);
+      login_request_store::request request;
+      request.server_ephemeral_priv_key = chain::private_key_type::generate_r1();
+      request.server_ephemeral_pub_key = request.server_ephemeral_priv_key.get_public_key();
+      request.expiration_time = params.expiration_time;
+      auto pub_key = request.server_ephemeral_pub_key;
+      requests->insert(std::move(request), now);
+      return {pub_key};
+   }
+
+   // everything but the authorization check, which needs the main thread; false if there is nothing left to check
+   bool prepare_finalize_login_request(const login_plugin::finalize_login_request_params& params,
+                                       login_plugin::finalize_login_request_results& result) {
+      const auto now = fc::time_point::now();
+      requests->expire(now);
+      auto request = requests->take(params.server_ephemeral_pub_key, now);
+      if (!request) {
+         result.error = "server_ephemeral_pub_key expired or not found";
+         return false;
+      }
+
+      auto shared_secret = request->server_ephemeral_priv_key.generate_shared_secret(params.client_ephemeral_pub_key);
+
+      chain::bytes combined_data(1024 * 1024);
+      chain::datastream<char*> sig_data_ds{combined_data.data(), combined_data.size()};
+      fc::raw::pack(sig_data_ds, params.permission);
+      fc::raw::pack(sig_data_ds, shared_secret);
+      fc::raw::pack(sig_data_ds, params.data);
+      combined_data.resize(sig_data_ds.tellp());
+
+      result.digest = chain::sha256::hash(combined_data);
+      for (auto& sig : params.signatures)
+         result.recovered_keys.insert(chain::public_key_type{sig, result.digest});
+      return true;
+   }
+
+   // main thread only
+   static void check_authorization(const login_plugin::finalize_login_request_params& params,
+                                   login_plugin::finalize_login_request_results& result) {
+      try {
+         auto noop_checktime = [] {};
+         auto& chain = app().get_plugin<chain_plugin>().chain();
+         chain.get_authorization_manager().check_authorization( //
+             params.permission.actor, params.permission.permission, result.recovered_keys, {}, fc::microseconds(0),
+             noop_checktime, true);
+         result.permission_satisfied = true;
+      } catch (...) {
+         result.error = "keys do not satisfy permission";
+      }
    }
 };
 
@@ -50,94 +82,74 @@ void login_plugin::set_program_options(options_description&, options_description
        ("max-login-requests", bpo::value<uint32_t>()->default_value(1000000),
         "The maximum number of pending login requests") //
        ("max-login-timeout", bpo::value<uint32_t>()->default_value(60),
-        "The maximum timeout for pending login requests (in seconds)");
+        "The maximum timeout for pending login requests (in seconds)") //
+       ("login-rate-limit-per-client", bpo::value<uint32_t>()->default_value(0),
+        "The maximum number of login requests a client address may start per second, 0 for no limit");
 }
 
 void login_plugin::plugin_initialize(const variables_map& options) {
-   my->max_login_requests = options.at("max-login-requests").as<uint32_t>();
-   my->max_login_timeout = options.at("max-login-timeout").as<uint32_t>();
+   login_request_store::config cfg;
+   cfg.max_requests = options.at("max-login-requests").as<uint32_t>();
+   cfg.max_timeout_sec = options.at("max-login-timeout").as<uint32_t>();
+   cfg.rate_limit_per_client = options.at("login-rate-limit-per-client").as<uint32_t>();
+   my->requests = std::make_unique<login_request_store>(cfg);
 }
 
-#define CALL(call_name, http_response_code)                                                                            \
-   {                                                                                                                   \
-      std::string("/v1/login/" #call_name), [this](string, string body, url_response_callback cb) mutable {            \
-         try {                                                                                                         \
-            if (body.empty())                                                                                          \
-               body = "{}";                                                                                            \
-            fc::variant result( call_name(fc::json::from_string(body).as<login_plugin::call_name##_params>()) );       \
-            cb(http_response_code, std::move(result));                                                                 \
-         } catch (...) {                                                                                               \
-            http_plugin::handle_exception("login", #call_name, body, cb);                                              \
-         }                                                                                                             \
-      }                                                                                                                \
-   }
-
+// the login requests are kept by login_request_store, so both calls are handled on the http threads and only the
+// authorization check of finalize_login_request is posted to the main thread
 void login_plugin::plugin_startup() {
    ilog("starting login_plugin");
-   app().get_plugin<http_plugin>().add_api({
-       CALL(start_login_request, 200), //
-       CALL(finalize_login_request, 200),
-       // CALL(do_not_use_gen_r1_key, 200),  //
-       // CALL(do_not_use_sign, 200),        //
-       // CALL(do_not_use_get_secret, 200),  //
-   });
+   auto& http = app().get_plugin<http_plugin>();
+   http.add_async_client_handler("/v1/login/start_login_request",
+      [this](string client, string, string body, url_response_callback cb) {
+         try {
+            if (body.empty())
+               body = "{}";
+            auto params = fc::json::from_string(body).as<login_plugin::start_login_request_params>();
+            fc::variant result( my->start_login_request(client, params) );
+            cb(200, std::move(result));
+         } catch (...) {
+            http_plugin::handle_exception("login", "start_login_request", body, cb);
+         }
+      });
+   http.add_async_handler("/v1/login/finalize_login_request",
+      [this](string, string body, url_response_callback cb) {
+         try {
+            if (body.empty())
+               body = "{}";
+            auto params = std::make_shared<finalize_login_request_params>(
+                fc::json::from_string(body).as<login_plugin::finalize_login_request_params>());
+            auto result = std::make_shared<finalize_login_request_results>();
+            if (!my->prepare_finalize_login_request(*params, *result)) {
+               cb(200, fc::variant(*result));
+               return;
+            }
+            app().post(priority::medium_low, [params, result, body=std::move(body), cb=std::move(cb)]() mutable {
+               try {
+                  login_plugin_impl::check_authorization(*params, *result);
+                  cb(200, fc::variant(*result));
+               } catch (...) {
+                  http_plugin::handle_exception("login", "finalize_login_request", body, cb);
+               }
+            });
+         } catch (...) {
+            http_plugin::handle_exception("login", "finalize_login_request", body, cb);
+         }
+      });
 }
 
 void login_plugin::plugin_shutdown() {}
 
 login_plugin::start_login_request_results
 login_plugin::start_login_request(const login_plugin::start_login_request_params& params) {
-   my->expire_requests();
-   EOS_ASSERT(params.expiration_time > fc::time_point::now(), fc::timeout_exception,
-              "Requested expiration time ${expiration_time} is in the past",
-              ("expiration_time", params.expiration_time));
-   EOS_ASSERT(my->requests.size() < my->max_login_requests, fc::timeout_exception, "Too many pending login requests");
-   login_request request;
-   request.server_ephemeral_priv_key = chain::private_key_type::generate_r1();
-   request.server_ephemeral_pub_key = request.server_ephemeral_priv_key.get_public_key();
-   request.expiration_time =
-       std::min(params.expiration_time, fc::time_point_sec{fc::time_point::now()} + my->max_login_timeout);
-   my->requests.insert(request);
-   return {request.server_ephemeral_pub_key};
+   return my->start_login_request(std::string(), params);
 }
 
 login_plugin::finalize_login_request_results
 login_plugin::finalize_login_request(const login_plugin::finalize_login_request_params& params) {
    finalize_login_request_results result;
-   my->expire_requests();
-   auto& index = my->requests.get<login_request_pub_key_index>();
-   auto it = index.find(params.server_ephemeral_pub_key);
-   if (it == index.end()) {
-      result.error = "server_ephemeral_pub_key expired or not found";
-      return result;
-   }
-   auto request = *it;
-   index.erase(it);
-
-   auto shared_secret = request.server_ephemeral_priv_key.generate_shared_secret(params.client_ephemeral_pub_key);
-
-   chain::bytes combined_data(1024 * 1024);
-   chain::datastream<char*> sig_data_ds{combined_data.data(), combined_data.size()};
-   fc::raw::pack(sig_data_ds, params.permission);
-   fc::raw::pack(sig_data_ds, shared_secret);
-   fc::raw::pack(sig_data_ds, params.data);
-   combined_data.resize(sig_data_ds.tellp());
-
-   result.digest = chain::sha256::hash(combined_data);
-   for (auto& sig : params.signatures)
-      result.recovered_keys.insert(chain::public_key_type{sig, result.digest});
-
-   try {
-      auto noop_checktime = [] {};
-      auto& chain = app().get_plugin<chain_plugin>().chain();
-      chain.get_authorization_manager().check_authorization( //
-          params.permission.actor, params.permission.permission, result.recovered_keys, {}, fc::microseconds(0),
-          noop_checktime, true);
-      result.permission_satisfied = true;
-   } catch (...) {
-      result.error = "keys do not satisfy permission";
-   }
-
+   if (my->prepare_finalize_login_request(params, result))
+      login_plugin_impl::check_authorization(params, result);
    return result;
 }
 
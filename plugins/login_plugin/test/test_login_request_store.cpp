@@ -0,0 +1,127 @@
+#define BOOST_TEST_MODULE login_request_store
+#include <boost/test/included/unit_test.hpp>
+
+#include <eosio/login_plugin/login_request_store.hpp>
+
+#include <atomic>
+#include <thread>
+
+namespace {
+
+using namespace eosio;
+using namespace eosio::chain;
+
+login_request_store::request make_request( const fc::time_point_sec& expiration ) {
+   login_request_store::request r;
+   r.server_ephemeral_priv_key = private_key_type::generate_r1();
+   r.server_ephemeral_pub_key = r.server_ephemeral_priv_key.get_public_key();
+   r.expiration_time = expiration;
+   return r;
+}
+
+BOOST_AUTO_TEST_SUITE( login_request_store_test )
+
+BOOST_AUTO_TEST_CASE( expire_test ) {
+   const fc::time_point now = fc::time_point_sec( fc::time_point::now() );
+   login_request_store store( { 100, 60, 0 } );
+
+   auto r1 = make_request( fc::time_point_sec( now ) + 1 );
+   auto r2 = make_request( fc::time_point_sec( now ) + 10 );
+   auto r3 = make_request( fc::time_point_sec( now ) + 3600 ); // limited to max_timeout_sec
+   store.insert( r1, now );
+   store.insert( r2, now );
+   store.insert( r3, now );
+   BOOST_CHECK_EQUAL( 3, store.size() );
+
+   BOOST_CHECK_EQUAL( 0, store.expire( now + fc::seconds( 1 ) ) );
+   BOOST_CHECK_EQUAL( 1, store.expire( now + fc::seconds( 2 ) ) );
+   BOOST_CHECK( !store.take( r1.server_ephemeral_pub_key, now + fc::seconds( 2 ) ) );
+
+   // expired but not yet removed by expire
+   BOOST_CHECK( !store.take( r2.server_ephemeral_pub_key, now + fc::seconds( 10 ) + fc::milliseconds( 1 ) ) );
+   BOOST_CHECK_EQUAL( 1, store.size() );
+
+   BOOST_CHECK( !store.take( r3.server_ephemeral_pub_key, now + fc::seconds( 61 ) ) );
+   BOOST_CHECK_EQUAL( 0, store.size() );
+
+   // finalized requests are dropped from the expiry wheel without counting them
+   auto r4 = make_request( fc::time_point_sec( now ) + 5 );
+   store.insert( r4, now );
+   auto taken = store.take( r4.server_ephemeral_pub_key, now );
+   BOOST_REQUIRE( taken );
+   BOOST_CHECK( taken->server_ephemeral_priv_key == r4.server_ephemeral_priv_key );
+   BOOST_CHECK_EQUAL( 0, store.expire( now + fc::seconds( 100 ) ) );
+   BOOST_CHECK_EQUAL( 0, store.size() );
+}
+
+BOOST_AUTO_TEST_CASE( max_requests_test ) {
+   const auto now = fc::time_point::now();
+   login_request_store store( { 2, 60, 0 } );
+
+   auto r1 = make_request( fc::time_point_sec( now ) + 10 );
+   store.insert( r1, now );
+   store.insert( make_request( fc::time_point_sec( now ) + 10 ), now );
+   BOOST_CHECK_THROW( store.admit( "1.2.3.4", now ), fc::timeout_exception );
+   BOOST_CHECK_THROW( store.insert( make_request( fc::time_point_sec( now ) + 10 ), now ), fc::timeout_exception );
+   BOOST_CHECK_EQUAL( 2, store.size() );
+
+   BOOST_CHECK( store.take( r1.server_ephemeral_pub_key, now ) );
+   store.admit( "1.2.3.4", now );
+}
+
+BOOST_AUTO_TEST_CASE( rate_limit_test ) {
+   const auto now = fc::time_point::now();
+   login_request_store store( { 100, 60, 2 } );
+
+   store.admit( "1.2.3.4", now );
+   store.admit( "1.2.3.4", now );
+   BOOST_CHECK_THROW( store.admit( "1.2.3.4", now ), fc::timeout_exception );
+   store.admit( "::1", now ); // other clients are not affected
+
+   BOOST_CHECK_THROW( store.admit( "1.2.3.4", now + fc::milliseconds( 100 ) ), fc::timeout_exception );
+   store.admit( "1.2.3.4", now + fc::milliseconds( 600 ) );
+   BOOST_CHECK_THROW( store.admit( "1.2.3.4", now + fc::milliseconds( 600 ) ), fc::timeout_exception );
+
+   // idle clients are forgotten by expire and start with a full bucket
+   store.expire( now + fc::seconds( 2 ) );
+   store.admit( "1.2.3.4", now + fc::seconds( 2 ) );
+   store.admit( "1.2.3.4", now + fc::seconds( 2 ) );
+   BOOST_CHECK_THROW( store.admit( "1.2.3.4", now + fc::seconds( 2 ) ), fc::timeout_exception );
+}
+
+BOOST_AUTO_TEST_CASE( concurrent_test ) {
+   const fc::time_point now = fc::time_point_sec( fc::time_point::now() );
+   constexpr uint32_t requests_per_thread = 250;
+   constexpr uint32_t num_threads = 4;
+
+   login_request_store store( { num_threads * requests_per_thread, 60, 0 } );
+   std::vector<std::vector<login_request_store::request>> requests( num_threads );
+   std::atomic<uint32_t> taken = 0;
+   std::vector<std::thread> threads;
+   for( uint32_t t = 0; t < num_threads; ++t ) {
+      threads.emplace_back( [&, t]() {
+         for( uint32_t i = 0; i < requests_per_thread; ++i ) {
+            store.admit( std::to_string( t ), now );
+            // spread expirations over several slots of the expiry wheel
+            auto r = make_request( fc::time_point_sec( now ) + 1 + i % 10 );
+            store.insert( r, now );
+            requests[t].push_back( r );
+            store.expire( now );
+         }
+         // finalize every other request
+         for( size_t i = 0; i < requests[t].size(); i += 2 ) {
+            if( store.take( requests[t][i].server_ephemeral_pub_key, now ) ) ++taken;
+         }
+      } );
+   }
+   for( auto& t : threads ) t.join();
+
+   BOOST_CHECK_EQUAL( num_threads * requests_per_thread / 2, taken );
+   BOOST_CHECK_EQUAL( num_threads * requests_per_thread / 2, store.size() );
+   BOOST_CHECK_EQUAL( num_threads * requests_per_thread / 2, store.expire( now + fc::seconds( 12 ) ) );
+   BOOST_CHECK_EQUAL( 0, store.size() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -272,6 +272,7 @@ namespace eosio {
       compat::channels::transaction_ack::channel_type::handle  incoming_transaction_ack_subscription;
 
       uint16_t                                       thread_pool_size = 2;
+      std::vector<uint32_t>                          thread_pool_cpus;
       std::optional<eosio::chain::named_thread_pool> thread_pool;
 
    private:
@@ -3649,6 +3650,8 @@ namespace eosio {
          ( "max-cleanup-time-msec", bpo::value<int>()->default_value(10), "max connection cleanup time per cleanup call in millisec")
          ( "net-threads", bpo::value<uint16_t>()->default_value(my->thread_pool_size),
            "Number of worker threads in net_plugin thread pool" )
+         ( "net-threads-cpus", bpo::value<string>(),
+           "CPUs to bind the net_plugin thread pool to, either a list of CPUs and CPU ranges such as 0-3,8 or node:N for the CPUs of NUMA node N" )
          ( "sync-fetch-span", bpo::value<uint32_t>()->default_value(def_sync_fetch_span), "number of blocks to retrieve in a chunk from any individual peer during synchronization")
          ( "use-socket-read-watermark", bpo::value<bool>()->default_value(false), "Enable experimental socket read watermark optimization")
          ( "peer-log-format", bpo::value<string>()->default_value( "[\"${_name}\" ${_ip}:${_port}]" ),
@@ -3710,6 +3713,8 @@ namespace eosio {
          my->thread_pool_size = options.at( "net-threads" ).as<uint16_t>();
          EOS_ASSERT( my->thread_pool_size > 0, chain::plugin_config_exception,
                      "net-threads ${num} must be greater than 0", ("num", my->thread_pool_size) );
+         if( options.count( "net-threads-cpus" ))
+            my->thread_pool_cpus = eosio::chain::parse_cpu_affinity( options.at( "net-threads-cpus" ).as<string>() );
 
          if( options.count( "p2p-peer-address" )) {
             my->supplied_peers = options.at( "p2p-peer-address" ).as<vector<string> >();
@@ -3783,7 +3788,7 @@ namespace eosio {
 
       my->producer_plug = app().find_plugin<producer_plugin>();
 
-      my->thread_pool.emplace( "net", my->thread_pool_size );
+      my->thread_pool.emplace( "net", my->thread_pool_size, my->thread_pool_cpus );
 
       my->dispatcher.reset( new dispatch_manager( my_impl->thread_pool->get_executor() ) );
 
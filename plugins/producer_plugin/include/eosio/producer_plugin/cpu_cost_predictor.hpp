@@ -0,0 +1,166 @@
+#pragma once
+
+#include <eosio/chain/types.hpp>
+#include <eosio/chain/trace.hpp>
+#include <eosio/chain/transaction.hpp>
+
+#include <fc/log/logger.hpp>
+
+#include <cmath>
+#include <map>
+#include <optional>
+
+namespace eosio {
+
+using chain::account_name;
+using chain::action_name;
+
+/**
+ * Learns the CPU time of actions per (contract, action) from the traces of successfully applied transactions and
+ * predicts the CPU time a transaction will need before it is executed. The estimate of each (contract, action) is an
+ * exponentially weighted moving mean and variance of the time spent in the action including all of its inline
+ * actions and notifications.
+ *
+ * Used by the producer to leave transactions in the queue that are predicted not to fit into what remains of the
+ * block, instead of running them until they fail with a deadline or tx_cpu_usage_exceeded.
+ *
+ * Not thread safe, only used from the main thread.
+ */
+class cpu_cost_predictor {
+private:
+   struct cost_estimate {
+      double    mean_us     = 0;
+      double    variance_us = 0; ///< in us^2
+      uint32_t  samples     = 0;
+      uint64_t  last_seen   = 0; ///< observation counter of the last sample
+
+      void add( double us, double alpha ) {
+         if( samples == 0 ) {
+            mean_us = us;
+            variance_us = 0;
+         } else {
+            const double diff = us - mean_us;
+            const double incr = alpha * diff;
+            mean_us += incr;
+            variance_us = (1 - alpha) * (variance_us + diff * incr);
+         }
+         ++samples;
+      }
+   };
+
+   using cost_key = std::pair<account_name, action_name>;
+
+   bool                              _disabled = false;
+   double                            _stddevs = 2.0;
+   std::map<cost_key, cost_estimate> _estimates;
+   uint64_t                          _observations = 0;
+
+   // stats since last report
+   uint64_t                          _predicted = 0;
+   double                            _abs_error_us = 0;
+   uint64_t                          _skipped = 0;
+   int64_t                           _skipped_us = 0;
+
+   void evict_stale() {
+      if( _estimates.size() <= max_estimates ) return;
+      const uint64_t threshold = _observations > max_estimates / 2 ? _observations - max_estimates / 2 : 0;
+      for( auto itr = _estimates.begin(); itr != _estimates.end(); ) {
+         if( itr->second.last_seen < threshold ) itr = _estimates.erase( itr );
+         else ++itr;
+      }
+   }
+
+   template<typename F>
+   std::optional<double> sum_estimates( const chain::transaction& trx, F&& f ) const {
+      double total = 0;
+      for( const auto* actions : { &trx.context_free_actions, &trx.actions } ) {
+         for( const auto& act : *actions ) {
+            auto itr = _estimates.find( cost_key{act.account, act.name} );
+            if( itr == _estimates.end() || itr->second.samples < min_samples ) return {};
+            total += f( itr->second );
+         }
+      }
+      return total;
+   }
+
+public: // public for tests
+   static constexpr double   alpha         = 0.125;
+   static constexpr uint32_t min_samples   = 4;
+   static constexpr size_t   max_estimates = 16 * 1024;
+
+   size_t size() const { return _estimates.size(); }
+
+public:
+   void disable() { _disabled = true; }
+   bool is_disabled() const { return _disabled; }
+
+   /// number of standard deviations added to the mean for the upper bound returned by predict
+   void set_stddevs( double stddevs ) { _stddevs = stddevs; }
+
+   /**
+    * @return upper bound of the CPU time the transaction is expected to take, empty when any of its actions has not
+    *         been observed often enough
+    */
+   std::optional<fc::microseconds> predict( const chain::transaction& trx ) const {
+      if( _disabled ) return {};
+      const double stddevs = _stddevs;
+      auto us = sum_estimates( trx, [stddevs]( const cost_estimate& e ) {
+         return e.mean_us + stddevs * std::sqrt( e.variance_us );
+      } );
+      if( !us ) return {};
+      return fc::microseconds( static_cast<int64_t>( std::ceil( *us ) ) );
+   }
+
+   /**
+    * Learn from the trace of a successfully applied transaction
+    */
+   void observe( const chain::transaction& trx, const chain::transaction_trace& trace ) {
+      if( _disabled || trace.except || trace.action_traces.empty() ) return;
+
+      if( auto mean = sum_estimates( trx, []( const cost_estimate& e ) { return e.mean_us; } ) ) {
+         ++_predicted;
+         _abs_error_us += std::abs( static_cast<double>( trace.elapsed.count() ) - *mean );
+      }
+
+      // attribute the time of every trace to the top level action it descends from
+      std::vector<uint32_t> root( trace.action_traces.size() + 1, 0 );
+      std::map<uint32_t, int64_t> root_us;
+      for( const auto& at : trace.action_traces ) {
+         const uint32_t ordinal = at.action_ordinal;
+         const uint32_t creator = at.creator_action_ordinal;
+         if( ordinal >= root.size() ) continue;
+         root[ordinal] = ( creator == 0 || creator >= ordinal ) ? ordinal : root[creator];
+         root_us[root[ordinal]] += at.elapsed.count();
+      }
+
+      ++_observations;
+      for( const auto& [ordinal, us] : root_us ) {
+         const auto& act = trace.action_traces[ordinal - 1].act;
+         auto& e = _estimates[cost_key{act.account, act.name}];
+         e.add( static_cast<double>( us ), alpha );
+         e.last_seen = _observations;
+      }
+      evict_stale();
+   }
+
+   /**
+    * Record that a transaction was not attempted because its predicted cost did not fit
+    */
+   void skipped( const fc::microseconds& predicted ) {
+      ++_skipped;
+      _skipped_us += predicted.count();
+   }
+
+   void report( fc::logger& log ) {
+      if( _predicted == 0 && _skipped == 0 ) return;
+      fc_dlog( log, "CPU cost prediction: ${p} predicted trxs, mean abs error ${e}us, ${s} trxs skipped, ${w}us of execution saved, ${n} estimates",
+               ("p", _predicted)("e", _predicted ? static_cast<int64_t>( _abs_error_us / _predicted ) : 0)
+               ("s", _skipped)("w", _skipped_us)("n", _estimates.size()) );
+      _predicted = 0;
+      _abs_error_us = 0;
+      _skipped = 0;
+      _skipped_us = 0;
+   }
+};
+
+} //eosio
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <eosio/chain/types.hpp>
+
+#include <fc/log/logger.hpp>
+
+#include <boost/tuple/tuple.hpp>
+
+#include <list>
+#include <map>
+#include <vector>
+
+namespace eosio {
+
+using chain::account_name;
+using chain::transaction_id_type;
+
+/**
+ * Queue of the due generated (deferred) transactions the producer retires at the start of each block.
+ *
+ * Instead of walking generated_transaction_multi_index by_delay from the beginning for every block, due transactions
+ * are moved into per payer queues by a scan that resumes where the previous one stopped and is bounded per block.
+ * Transactions are retired round robin over the payers, so a payer that floods deferred transactions delays its own
+ * transactions instead of the ones of everybody else. Which deferred transactions a block retires has always been
+ * up to the producer, so this only changes the order, not the objective result of any of them.
+ *
+ * The queues mirror the state of the head block:
+ *  - transactions removed while building the pending block are restored by abort_block and dropped by on_block,
+ *  - a block that does not extend the previous one (fork switch) resets the queues and the scan.
+ *
+ * Not thread safe, only used from the main thread.
+ */
+class deferred_trx_scheduler {
+public:
+   struct entry {
+      transaction_id_type  trx_id;
+      account_name         payer;
+      fc::time_point       delay_until;
+      fc::time_point       expiration;
+   };
+
+   enum class result {
+      keep,   ///< leave the transaction in its queue and continue with the next payer
+      remove, ///< the transaction was retired or no longer exists
+      park,   ///< leave the transaction out until a block after its expiration, e.g. when it is blacklisted
+      stop    ///< leave the transaction in its queue and stop processing
+   };
+
+private:
+   struct payer_queue {
+      std::list<entry>           trxs;  ///< in by_delay order
+      std::list<entry>::iterator next;  ///< next transaction to visit in the current block
+   };
+   using queue_map = std::map<account_name, payer_queue>;
+
+   queue_map                                _queues;
+   size_t                                   _size = 0;
+   account_name                             _next_payer;         ///< payer to start with in the next block
+   std::multimap<fc::time_point, entry>     _parked;             ///< by expiration
+   std::vector<entry>                       _removed_in_block;   ///< removed since the last block, restored on abort
+
+   // position of the scan of the by_delay index, the last (delay_until, id) moved into the queues
+   bool                                     _scan_started = false;
+   fc::time_point                           _cursor_delay_until;
+   int64_t                                  _cursor_id = 0;
+   uint32_t                                 _last_block_num = 0;
+
+   // stats since last report
+   size_t                                   _scanned = 0;
+   size_t                                   _visited = 0;
+
+   void enqueue( const entry& e, bool front ) {
+      auto& q = _queues[e.payer].trxs;
+      if( front ) q.push_front( e );
+      else q.push_back( e );
+      ++_size;
+   }
+
+   void unpark( const fc::time_point& pending_block_time ) {
+      // expiration is the expiry of a blacklisted transaction, it can be retired (as expired) in any later block
+      while( !_parked.empty() && _parked.begin()->first < pending_block_time ) {
+         enqueue( _parked.begin()->second, true );
+         _parked.erase( _parked.begin() );
+      }
+   }
+
+public:
+   size_t size() const { return _size; }
+   size_t parked() const { return _parked.size(); }
+   size_t payers() const { return _queues.size(); }
+
+   /// delay_until of the oldest due transaction in the queues, maximum when empty
+   fc::time_point oldest() const {
+      fc::time_point t = fc::time_point::maximum();
+      for( const auto& q : _queues ) {
+         if( !q.second.trxs.empty() ) t = std::min( t, q.second.trxs.front().delay_until );
+      }
+      return t;
+   }
+
+   void reset() {
+      _queues.clear();
+      _size = 0;
+      _next_payer = account_name();
+      _parked.clear();
+      _removed_in_block.clear();
+      _scan_started = false;
+      _cursor_delay_until = fc::time_point();
+      _cursor_id = 0;
+   }
+
+   /// call for every accepted block
+   void on_block( uint32_t block_num ) {
+      if( _last_block_num != 0 && block_num != _last_block_num + 1 ) {
+         reset();
+      }
+      _last_block_num = block_num;
+      _removed_in_block.clear();
+   }
+
+   /// call when the pending block is aborted
+   void abort_block() {
+      for( auto itr = _removed_in_block.rbegin(); itr != _removed_in_block.rend(); ++itr ) {
+         enqueue( *itr, true );
+      }
+      _removed_in_block.clear();
+   }
+
+   /**
+    * Move at most max_scan due transactions (0 for no limit) from the by_delay index of
+    * generated_transaction_multi_index into the queues.
+    * @return number of index entries visited
+    */
+   template<typename DelayIndex>
+   size_t refill( const DelayIndex& idx, const fc::time_point& pending_block_time, size_t max_scan ) {
+      using id_type = typename DelayIndex::value_type::id_type;
+      unpark( pending_block_time );
+
+      auto itr = _scan_started ? idx.lower_bound( boost::make_tuple( _cursor_delay_until, id_type( _cursor_id + 1 ) ) )
+                               : idx.begin();
+      size_t scanned = 0;
+      for( ; itr != idx.end() && ( max_scan == 0 || scanned < max_scan ); ++itr ) {
+         if( itr->delay_until > pending_block_time ) break; // not scheduled yet
+         // created by the pending block, which may be aborted, and all entries after it as well
+         if( itr->published >= pending_block_time ) break;
+         enqueue( entry{ itr->trx_id, itr->payer, itr->delay_until, itr->expiration }, false );
+         _scan_started = true;
+         _cursor_delay_until = itr->delay_until;
+         _cursor_id = itr->id._id;
+         ++scanned;
+      }
+      _scanned += scanned;
+      return scanned;
+   }
+
+   /**
+    * Visit the queued transactions round robin over the payers, at most once each, until f returns result::stop
+    * @param f result(const entry&)
+    * @return number of transactions visited
+    */
+   template<typename F>
+   size_t process( F&& f ) {
+      std::vector<queue_map::iterator> active;
+      active.reserve( _queues.size() );
+      for( auto itr = _queues.lower_bound( _next_payer ); itr != _queues.end(); ++itr ) active.push_back( itr );
+      for( auto itr = _queues.begin(); itr != _queues.end() && itr->first < _next_payer; ++itr ) active.push_back( itr );
+      for( auto& q : active ) q->second.next = q->second.trxs.begin();
+
+      size_t visited = 0;
+      size_t i = 0;
+      while( !active.empty() ) {
+         if( i >= active.size() ) i = 0;
+         auto qitr = active[i];
+         auto& q = qitr->second;
+         if( q.next == q.trxs.end() ) {
+            active.erase( active.begin() + i );
+            continue;
+         }
+
+         const auto r = f( static_cast<const entry&>( *q.next ) );
+         if( r == result::stop ) {
+            _next_payer = qitr->first;
+            break;
+         }
+         ++visited;
+         if( r == result::keep ) {
+            ++q.next;
+         } else {
+            if( r == result::remove ) _removed_in_block.push_back( *q.next );
+            else _parked.emplace( q.next->expiration, *q.next );
+            q.next = q.trxs.erase( q.next );
+            --_size;
+         }
+         ++i;
+      }
+
+      for( auto itr = _queues.begin(); itr != _queues.end(); ) {
+         if( itr->second.trxs.empty() ) itr = _queues.erase( itr );
+         else ++itr;
+      }
+      _visited += visited;
+      return visited;
+   }
+
+   void report( fc::logger& log, const fc::time_point& pending_block_time ) {
+      if( _size == 0 && _parked.empty() && _scanned == 0 ) return;
+      const auto oldest_due = oldest();
+      fc_dlog( log, "Deferred transaction backlog: ${n} due for ${p} payers, oldest due ${a}ms ago, ${k} parked, "
+                    "${s} scanned, ${v} visited",
+               ("n", _size)("p", _queues.size())
+               ("a", oldest_due == fc::time_point::maximum() ? 0 : (pending_block_time - oldest_due).count() / 1000)
+               ("k", _parked.size())("s", _scanned)("v", _visited) );
+      _scanned = 0;
+      _visited = 0;
+   }
+};
+
+} //eosio
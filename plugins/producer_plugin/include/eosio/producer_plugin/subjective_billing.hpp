@@ -8,41 +8,46 @@
 #include <eosio/chain/resource_limits_private.hpp>
 #include <eosio/chain/config.hpp>
 
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
 #include <unordered_map>
+#include <vector>
 
 namespace eosio {
 
-namespace bmi = boost::multi_index;
 using chain::transaction_id_type;
 using chain::account_name;
 using chain::block_state_ptr;
 using chain::packed_transaction;
 namespace config = chain::config;
 
+/**
+ * Subjective CPU billing of speculatively executed transactions by first authorizer.
+ *
+ * Accounts and transactions are spread over shards, each guarded by its own mutex, so that billing lookups and
+ * updates from transaction validation worker threads only contend when they hit the same shard. Transactions are
+ * expired through an expiry wheel of one second slots instead of an index ordered by expiry; a slot is only looked
+ * at once its second has been reached. Transaction ids are removed from the wheel lazily: an id whose transaction
+ * was already removed (e.g. because it was included in a block) is dropped when its slot is processed. Since a
+ * removed transaction can be billed again, a slot may hold the same id more than once; duplicates are dropped when
+ * the slot is taken. The number of cached transactions is kept in an atomic so that checking for an empty cache does
+ * not lock the shards.
+ *
+ * Locks are always taken in the order wheel, transaction shard, account shard and never more than one of each.
+ */
 class subjective_billing {
 private:
+   static constexpr size_t num_shards = 16;
 
    struct trx_cache_entry {
-      transaction_id_type     trx_id;
       account_name            account;
       uint32_t                subjective_cpu_bill;
       fc::time_point          expiry;
    };
-   struct by_id;
-   struct by_expiry;
-
-   using trx_cache_index = bmi::multi_index_container<
-         trx_cache_entry,
-         indexed_by<
-               bmi::hashed_unique<tag<by_id>, BOOST_MULTI_INDEX_MEMBER( trx_cache_entry, transaction_id_type, trx_id ) >,
-               ordered_non_unique<tag<by_expiry>, BOOST_MULTI_INDEX_MEMBER( trx_cache_entry, fc::time_point, expiry ) >
-         >
-   >;
 
    using decaying_accumulator = chain::resource_limits::impl::exponential_decay_accumulator<>;
 
@@ -55,13 +60,33 @@ private:
       }
    };
 
+   using trx_cache = std::unordered_map<transaction_id_type, trx_cache_entry>;
    using account_subjective_bill_cache = std::unordered_map<account_name, subjective_billing_info>;
    using block_subjective_bill_cache = std::unordered_map<account_name, uint64_t>;
 
+   struct trx_shard {
+      mutable std::mutex                     mtx;
+      trx_cache                              trxs;
+   };
+
+   struct account_shard {
+      mutable std::mutex                     mtx;
+      account_subjective_bill_cache          accounts;
+      block_subjective_bill_cache            block;
+   };
+
+   struct expiry_wheel {
+      std::mutex                                                     mtx;
+      std::map<int64_t, std::vector<transaction_id_type>>            slots; ///< expiry second -> ids
+   };
+
+   enum class expire_result { expired, pending, removed };
+
    bool                                      _disabled = false;
-   trx_cache_index                           _trx_cache_index;
-   account_subjective_bill_cache             _account_subjective_bill_cache;
-   block_subjective_bill_cache               _block_subjective_bill_cache;
+   std::array<trx_shard, num_shards>         _trx_shards;
+   std::atomic<size_t>                       _trx_count{0}; ///< number of transactions over all _trx_shards
+   std::array<account_shard, num_shards>     _account_shards;
+   expiry_wheel                              _expiry_wheel;
    std::set<chain::account_name>             _disabled_accounts;
 
 private:
@@ -71,26 +96,91 @@ private:
       return ordinal;
    }
 
+   static int64_t expiry_slot_for( const fc::time_point& t ) {
+      return t.sec_since_epoch();
+   }
+
+   trx_shard& trx_shard_for( const transaction_id_type& id ) {
+      return _trx_shards[id._hash[0] % num_shards];
+   }
+
+   account_shard& account_shard_for( const account_name& a ) {
+      return _account_shards[shard_index( a )];
+   }
+
+   const account_shard& account_shard_for( const account_name& a ) const {
+      return _account_shards[shard_index( a )];
+   }
+
+   static size_t shard_index( const account_name& a ) {
+      // the low bits of a name encode its 13th character, which is rarely used, so mix before picking a shard
+      return ( a.to_uint64_t() * 0x9E3779B97F4A7C15ull ) >> 60;
+   }
+   static_assert( num_shards == 16, "shard_index takes the top 4 bits" );
+
+   size_t trx_cache_size() const {
+      return _trx_count.load( std::memory_order_relaxed );
+   }
+
    void remove_subjective_billing( const trx_cache_entry& entry, uint32_t time_ordinal ) {
-      auto aitr = _account_subjective_bill_cache.find( entry.account );
-      if( aitr != _account_subjective_bill_cache.end() ) {
+      auto& shard = account_shard_for( entry.account );
+      std::lock_guard g( shard.mtx );
+      auto aitr = shard.accounts.find( entry.account );
+      if( aitr != shard.accounts.end() ) {
          aitr->second.pending_cpu_us -= entry.subjective_cpu_bill;
          EOS_ASSERT( aitr->second.pending_cpu_us >= 0, chain::tx_resource_exhaustion,
                      "Logic error in subjective account billing ${a}", ("a", entry.account) );
-         if( aitr->second.empty(time_ordinal) ) _account_subjective_bill_cache.erase( aitr );
+         if( aitr->second.empty(time_ordinal) ) shard.accounts.erase( aitr );
       }
    }
 
    void transition_to_expired( const trx_cache_entry& entry, uint32_t time_ordinal ) {
-      auto aitr = _account_subjective_bill_cache.find( entry.account );
-      if( aitr != _account_subjective_bill_cache.end() ) {
+      auto& shard = account_shard_for( entry.account );
+      std::lock_guard g( shard.mtx );
+      auto aitr = shard.accounts.find( entry.account );
+      if( aitr != shard.accounts.end() ) {
          aitr->second.pending_cpu_us -= entry.subjective_cpu_bill;
          aitr->second.expired_accumulator.add(entry.subjective_cpu_bill, time_ordinal, expired_accumulator_average_window);
       }
    }
 
+   expire_result expire( const transaction_id_type& id, const fc::time_point& pending_block_time, uint32_t time_ordinal ) {
+      auto& shard = trx_shard_for( id );
+      std::lock_guard g( shard.mtx );
+      auto itr = shard.trxs.find( id );
+      if( itr == shard.trxs.end() ) return expire_result::removed;
+      if( itr->second.expiry > pending_block_time ) return expire_result::pending;
+      transition_to_expired( itr->second, time_ordinal );
+      shard.trxs.erase( itr );
+      --_trx_count;
+      return expire_result::expired;
+   }
+
+   /// take the ids of the earliest slot of the wheel if its second is at or before pending_block_time
+   bool take_expiry_slot( const fc::time_point& pending_block_time, int64_t& slot, std::vector<transaction_id_type>& ids ) {
+      std::lock_guard g( _expiry_wheel.mtx );
+      auto& slots = _expiry_wheel.slots;
+      if( slots.empty() || fc::time_point( fc::seconds( slots.begin()->first ) ) > pending_block_time ) return false;
+      slot = slots.begin()->first;
+      ids = std::move( slots.begin()->second );
+      slots.erase( slots.begin() );
+      std::sort( ids.begin(), ids.end() );
+      ids.erase( std::unique( ids.begin(), ids.end() ), ids.end() );
+      return true;
+   }
+
+   void return_expiry_slot( int64_t slot, std::vector<transaction_id_type>&& ids ) {
+      std::lock_guard g( _expiry_wheel.mtx );
+      auto& s = _expiry_wheel.slots[slot];
+      if( s.empty() ) {
+         s = std::move( ids );
+      } else {
+         s.insert( s.end(), ids.begin(), ids.end() );
+      }
+   }
+
    void remove_subjective_billing( const block_state_ptr& bsp, uint32_t time_ordinal ) {
-      if( !_trx_cache_index.empty() ) {
+      if( trx_cache_size() > 0 ) {
          for( const auto& receipt : bsp->block->transactions ) {
             if( std::holds_alternative<packed_transaction>(receipt.trx) ) {
                const auto& pt = std::get<packed_transaction>(receipt.trx);
@@ -105,14 +195,18 @@ public: // public for tests
    static constexpr uint32_t expired_accumulator_average_window = config::account_cpu_usage_average_window_ms / subjective_time_interval_ms;
 
    void remove_subjective_billing( const transaction_id_type& trx_id, uint32_t time_ordinal ) {
-      auto& idx = _trx_cache_index.get<by_id>();
-      auto itr = idx.find( trx_id );
-      if( itr != idx.end() ) {
-         remove_subjective_billing( *itr, time_ordinal );
-         idx.erase( itr );
+      auto& shard = trx_shard_for( trx_id );
+      std::lock_guard g( shard.mtx );
+      auto itr = shard.trxs.find( trx_id );
+      if( itr != shard.trxs.end() ) {
+         remove_subjective_billing( itr->second, time_ordinal );
+         shard.trxs.erase( itr );
+         --_trx_count;
       }
    }
 
+   size_t size() const { return trx_cache_size(); }
+
 public:
    void disable() { _disabled = true; }
    bool is_disabled() const { return _disabled; }
@@ -124,17 +218,22 @@ public:
    {
       if( !_disabled && !_disabled_accounts.count( first_auth ) ) {
          uint32_t bill = std::max<int64_t>( 0, elapsed.count() );
-         auto p = _trx_cache_index.emplace(
-               trx_cache_entry{id,
-                               first_auth,
-                               bill,
-                               expire} );
-         if( p.second ) {
-            _account_subjective_bill_cache[first_auth].pending_cpu_us += bill;
+         {
+            auto& shard = trx_shard_for( id );
+            std::lock_guard g( shard.mtx );
+            auto p = shard.trxs.try_emplace( id, trx_cache_entry{first_auth, bill, expire} );
+            if( !p.second ) return;
+            ++_trx_count;
+
+            auto& ashard = account_shard_for( first_auth );
+            std::lock_guard ag( ashard.mtx );
+            ashard.accounts[first_auth].pending_cpu_us += bill;
             if( in_pending_block ) {
-               _block_subjective_bill_cache[first_auth] += bill;
+               ashard.block[first_auth] += bill;
             }
          }
+         std::lock_guard g( _expiry_wheel.mtx );
+         _expiry_wheel.slots[expiry_slot_for( expire )].push_back( id );
       }
    }
 
@@ -143,21 +242,25 @@ public:
       if( !_disabled && !_disabled_accounts.count( first_auth ) ) {
          uint32_t bill = std::max<int64_t>( 0, elapsed.count() );
          const auto time_ordinal = time_ordinal_for(now);
-         _account_subjective_bill_cache[first_auth].expired_accumulator.add(bill, time_ordinal, expired_accumulator_average_window);
+         auto& shard = account_shard_for( first_auth );
+         std::lock_guard g( shard.mtx );
+         shard.accounts[first_auth].expired_accumulator.add(bill, time_ordinal, expired_accumulator_average_window);
       }
    }
 
    uint32_t get_subjective_bill( const account_name& first_auth, const fc::time_point& now ) const {
       if( _disabled || _disabled_accounts.count( first_auth ) ) return 0;
       const auto time_ordinal = time_ordinal_for(now);
+      const auto& shard = account_shard_for( first_auth );
+      std::lock_guard g( shard.mtx );
       const subjective_billing_info* sub_bill_info = nullptr;
-      auto aitr = _account_subjective_bill_cache.find( first_auth );
-      if( aitr != _account_subjective_bill_cache.end() ) {
+      auto aitr = shard.accounts.find( first_auth );
+      if( aitr != shard.accounts.end() ) {
          sub_bill_info = &aitr->second;
       }
       uint64_t in_block_pending_cpu_us = 0;
-      auto bitr = _block_subjective_bill_cache.find( first_auth );
-      if( bitr != _block_subjective_bill_cache.end() ) {
+      auto bitr = shard.block.find( first_auth );
+      if( bitr != shard.block.end() ) {
          in_block_pending_cpu_us = bitr->second;
       }
 
@@ -171,7 +274,10 @@ public:
    }
 
    void abort_block() {
-      _block_subjective_bill_cache.clear();
+      for( auto& shard : _account_shards ) {
+         std::lock_guard g( shard.mtx );
+         shard.block.clear();
+      }
    }
 
    void on_block( const block_state_ptr& bsp, const fc::time_point& now ) {
@@ -182,22 +288,38 @@ public:
 
    bool remove_expired( fc::logger& log, const fc::time_point& pending_block_time, const fc::time_point& now, const fc::time_point& deadline ) {
       bool exhausted = false;
-      auto& idx = _trx_cache_index.get<by_expiry>();
-      if( !idx.empty() ) {
+      const auto orig_count = trx_cache_size();
+      if( orig_count > 0 ) {
          const auto time_ordinal = time_ordinal_for(now);
-         const auto orig_count = _trx_cache_index.size();
          uint32_t num_expired = 0;
 
-         while( !idx.empty() ) {
-            if( deadline <= fc::time_point::now() ) {
-               exhausted = true;
-               break;
+         int64_t slot = 0;
+         std::vector<transaction_id_type> ids;
+         while( take_expiry_slot( pending_block_time, slot, ids ) ) {
+            // ids of the slot that expire after pending_block_time or that were not reached before the deadline
+            std::vector<transaction_id_type> keep;
+            bool pending = false;
+            for( size_t i = 0; i < ids.size(); ++i ) {
+               if( deadline <= fc::time_point::now() ) {
+                  exhausted = true;
+                  keep.insert( keep.end(), ids.begin() + i, ids.end() );
+                  break;
+               }
+               switch( expire( ids[i], pending_block_time, time_ordinal ) ) {
+                  case expire_result::expired:
+                     num_expired++;
+                     break;
+                  case expire_result::pending:
+                     pending = true;
+                     keep.push_back( ids[i] );
+                     break;
+                  case expire_result::removed:
+                     break;
+               }
             }
-            auto b = idx.begin();
-            if( b->expiry > pending_block_time ) break;
-            transition_to_expired( *b, time_ordinal );
-            idx.erase( b );
-            num_expired++;
+            if( !keep.empty() ) return_expiry_slot( slot, std::move( keep ) );
+            // a slot with unexpired transactions is the one of pending_block_time, all later slots expire after it
+            if( exhausted || pending ) break;
          }
 
          fc_dlog( log, "Processed ${n} subjective billed transactions, Expired ${expired}",
@@ -1,6 +1,8 @@
 #include <eosio/producer_plugin/producer_plugin.hpp>
 #include <eosio/producer_plugin/pending_snapshot.hpp>
 #include <eosio/producer_plugin/subjective_billing.hpp>
+#include <eosio/producer_plugin/cpu_cost_predictor.hpp>
+#include <eosio/producer_plugin/deferred_trx_scheduler.hpp>
 #include <eosio/chain/plugin_interface.hpp>
 #include <eosio/chain/global_property_object.hpp>
 #include <eosio/chain/generated_transaction_object.hpp>
@@ -154,6 +156,7 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
       bool maybe_produce_block();
       bool remove_expired_trxs( const fc::time_point& deadline );
       bool block_is_exhausted() const;
+      bool predicted_to_fit( const transaction_metadata& trx, const fc::time_point& block_deadline );
       bool remove_expired_blacklisted_trxs( const fc::time_point& deadline );
       bool process_unapplied_trxs( const fc::time_point& deadline );
       void process_scheduled_and_incoming_trxs( const fc::time_point& deadline, size_t& pending_incoming_process_limit );
@@ -181,6 +184,7 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
       uint32_t                                                  _max_block_cpu_usage_threshold_us = 0;
       uint32_t                                                  _max_block_net_usage_threshold_bytes = 0;
       int32_t                                                   _max_scheduled_transaction_time_per_block_ms = 0;
+      uint32_t                                                  _max_scheduled_transaction_scan_per_block = 0;
       bool                                                      _disable_persist_until_expired = false;
       bool                                                      _disable_subjective_p2p_billing = true;
       bool                                                      _disable_subjective_api_billing = true;
@@ -191,6 +195,7 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
 
       chain_plugin*                                             chain_plug = nullptr;
       eosio::blockvault::block_vault_interface*                 blockvault = nullptr;
+      resource_monitor_plugin*                                  _resmon_plugin = nullptr;
       uint32_t                                                  _latest_rejected_block_num = 0;
 
       incoming::channels::block::channel_type::handle           _incoming_block_subscription;
@@ -205,6 +210,8 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
       transaction_id_with_expiry_index                          _blacklisted_transactions;
       pending_snapshot_index                                    _pending_snapshot_index;
       subjective_billing                                        _subjective_billing;
+      cpu_cost_predictor                                        _cpu_cost_predictor;
+      deferred_trx_scheduler                                    _deferred_trx_scheduler;
 
       std::optional<scoped_connection>                          _accepted_block_connection;
       std::optional<scoped_connection>                          _accepted_block_header_connection;
@@ -250,6 +257,7 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
          auto before = _unapplied_transactions.size();
          _unapplied_transactions.clear_applied( bsp );
          _subjective_billing.on_block( bsp, fc::time_point::now() );
+         _deferred_trx_scheduler.on_block( bsp->block_num );
          fc_dlog( _log, "Removed applied transactions before: ${before}, after: ${after}",
                   ("before", before)("after", _unapplied_transactions.size()) );
       }
@@ -283,6 +291,7 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
 
          _unapplied_transactions.add_aborted( chain.abort_block() );
          _subjective_billing.abort_block();
+         _deferred_trx_scheduler.abort_block();
       }
 
       bool on_sync_block(const signed_block_ptr& block, bool check_connectivity) {
@@ -545,6 +554,15 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
                                               || ( persist_until_expired && _disable_subjective_api_billing )
                                               || ( !persist_until_expired && _disable_subjective_p2p_billing );
 
+            if( _pending_block_mode == pending_block_mode::producing && !predicted_to_fit( *trx, block_deadline ) ) {
+               _unapplied_transactions.add_incoming( trx, persist_until_expired, next );
+               fc_dlog(_log, "[TRX_TRACE] Block ${block_num} for producer ${prod} PREDICTED NOT TO FIT, tx: ${txid} RETRYING",
+                       ("block_num", chain.head_block_num() + 1)
+                       ("prod", get_pending_block_producer())
+                       ("txid", trx->id()));
+               return true;
+            }
+
             auto first_auth = trx->packed_trx()->get_transaction().first_authorizer();
             uint32_t sub_bill = 0;
             if( !disable_subjective_billing )
@@ -571,6 +589,7 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
                   send_response( e_ptr );
                }
             } else {
+               _cpu_cost_predictor.observe( trx->packed_trx()->get_transaction(), *trace );
                if( persist_until_expired && !_disable_persist_until_expired ) {
                   // if this trx didnt fail/soft-fail and the persist flag is set, store its ID so that we can
                   // ensure its applied to all future speculative blocks as well.
@@ -705,8 +724,14 @@ void producer_plugin::set_program_options(
           "Threshold of NET block production to consider block full; when within threshold of max-block-net-usage block can be produced immediately")
          ("max-scheduled-transaction-time-per-block-ms", boost::program_options::value<int32_t>()->default_value(100),
           "Maximum wall-clock time, in milliseconds, spent retiring scheduled transactions in any block before returning to normal transaction processing.")
+         ("max-scheduled-transaction-scan-per-block", boost::program_options::value<uint32_t>()->default_value(10000),
+          "Maximum number of due scheduled transactions added to the per payer retire queues in any block, 0 for no limit.")
          ("subjective-cpu-leeway-us", boost::program_options::value<int32_t>()->default_value( config::default_subjective_cpu_leeway_us ),
           "Time in microseconds allowed for a transaction that starts with insufficient CPU quota to complete and cover its CPU usage.")
+         ("cpu-cost-prediction", bpo::value<bool>()->default_value(false),
+          "When producing, leave queued transactions whose CPU time predicted from recent executions of the same contract actions does not fit in the remaining block time")
+         ("cpu-cost-prediction-stddevs", bpo::value<double>()->default_value(2.0),
+          "Number of standard deviations added to the mean predicted CPU time of a transaction, see cpu-cost-prediction")
          ("incoming-defer-ratio", bpo::value<double>()->default_value(1.0),
           "ratio between incoming transactions and deferred transactions when both are queued for execution")
          ("incoming-transaction-queue-size-mb", bpo::value<uint16_t>()->default_value( 1024 ),
@@ -723,6 +748,8 @@ void producer_plugin::set_program_options(
           "Disable subjective CPU billing for API transactions")
          ("producer-threads", bpo::value<uint16_t>()->default_value(config::default_controller_thread_pool_size),
           "Number of worker threads in producer thread pool")
+         ("producer-threads-cpus", bpo::value<string>(),
+          "CPUs to bind the producer thread pool to, either a list of CPUs and CPU ranges such as 0-3,8 or node:N for the CPUs of NUMA node N")
          ("snapshots-dir", bpo::value<bfs::path>()->default_value("snapshots"),
           "the location of the snapshots directory (absolute path or relative to application data dir)")
          ;
@@ -837,6 +864,7 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
    my->_max_block_net_usage_threshold_bytes = options.at( "max-block-net-usage-threshold-bytes" ).as<uint32_t>();
 
    my->_max_scheduled_transaction_time_per_block_ms = options.at("max-scheduled-transaction-time-per-block-ms").as<int32_t>();
+   my->_max_scheduled_transaction_scan_per_block = options.at("max-scheduled-transaction-scan-per-block").as<uint32_t>();
 
    if( options.at( "subjective-cpu-leeway-us" ).as<int32_t>() != config::default_subjective_cpu_leeway_us ) {
       chain.set_subjective_cpu_leeway( fc::microseconds( options.at( "subjective-cpu-leeway-us" ).as<int32_t>() ) );
@@ -855,6 +883,15 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
 
    my->_incoming_defer_ratio = options.at("incoming-defer-ratio").as<double>();
 
+   if( options.at("cpu-cost-prediction").as<bool>() ) {
+      const double stddevs = options.at("cpu-cost-prediction-stddevs").as<double>();
+      EOS_ASSERT( stddevs >= 0, plugin_config_exception, "cpu-cost-prediction-stddevs ${s} must be non-negative", ("s", stddevs) );
+      my->_cpu_cost_predictor.set_stddevs( stddevs );
+      ilog( "CPU cost prediction enabled, ${s} standard deviations", ("s", stddevs) );
+   } else {
+      my->_cpu_cost_predictor.disable();
+   }
+
    my->_disable_persist_until_expired = options.at("disable-api-persisted-trx").as<bool>();
    bool disable_subjective_billing = options.at("disable-subjective-billing").as<bool>();
    my->_disable_subjective_p2p_billing = options.at("disable-subjective-p2p-billing").as<bool>();
@@ -879,7 +916,10 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
    auto thread_pool_size = options.at( "producer-threads" ).as<uint16_t>();
    EOS_ASSERT( thread_pool_size > 0, plugin_config_exception,
                "producer-threads ${num} must be greater than 0", ("num", thread_pool_size));
-   my->_thread_pool.emplace( "prod", thread_pool_size );
+   std::vector<uint32_t> thread_pool_cpus;
+   if( options.count( "producer-threads-cpus" ))
+      thread_pool_cpus = parse_cpu_affinity( options.at( "producer-threads-cpus" ).as<string>() );
+   my->_thread_pool.emplace( "prod", thread_pool_size, std::move( thread_pool_cpus ) );
 
    if( options.count( "snapshots-dir" )) {
       auto sd = options.at( "snapshots-dir" ).as<bfs::path>();
@@ -900,6 +940,8 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
       }
    }
 
+   my->_resmon_plugin = app().find_plugin<resource_monitor_plugin>();
+
    my->_incoming_block_subscription = app().get_channel<incoming::channels::block>().subscribe(
          [this](const signed_block_ptr& block) {
       try {
@@ -1526,6 +1568,10 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block() {
       auto head_block_age = now - chain.head_block_time();
       if (head_block_age > fc::seconds(5))
          return start_block_result::waiting_for_block;
+      if (_resmon_plugin && _resmon_plugin->speculative_execution_paused()) {
+         fc_dlog(_log, "Not starting speculative block, paused by resource monitor");
+         return start_block_result::waiting_for_block;
+      }
    }
 
    if (_pending_block_mode == pending_block_mode::producing) {
@@ -1866,6 +1912,12 @@ bool producer_plugin_impl::process_unapplied_trxs( const fc::time_point& deadlin
                continue;
             }
 
+            if( _pending_block_mode == pending_block_mode::producing && !predicted_to_fit( *trx, deadline ) ) {
+               // leave for a later block
+               ++itr;
+               continue;
+            }
+
             auto prev_billed_cpu_time_us = trx->billed_cpu_time_us;
             if(!_subjective_billing.is_disabled() && prev_billed_cpu_time_us > 0 && !rl.is_unlimited_cpu( first_auth )) {
                auto prev_billed_plus100 = prev_billed_cpu_time_us + EOS_PERCENT( prev_billed_cpu_time_us, 100 * config::percent_1 );
@@ -1909,6 +1961,7 @@ bool producer_plugin_impl::process_unapplied_trxs( const fc::time_point& deadlin
                }
             } else {
                fc_dlog( _trx_successful_trace_log, "Subjective unapplied bill for success ${a}: ${b} prev ${t}us", ("a",first_auth)("b",prev_billed_cpu_time_us)("t",trace->elapsed));
+               _cpu_cost_predictor.observe( trx->packed_trx()->get_transaction(), *trace );
                // if db_read_mode SPECULATIVE then trx is in the pending block and not immediately reverted
                _subjective_billing.subjective_bill( trx->id(), trx->packed_trx()->expiration(), first_auth, trace->elapsed,
                                                     chain.get_read_mode() == chain::db_read_mode::SPECULATIVE );
@@ -1945,30 +1998,27 @@ void producer_plugin_impl::process_scheduled_and_incoming_trxs( const fc::time_p
    auto itr = _unapplied_transactions.incoming_begin();
    auto end = _unapplied_transactions.incoming_end();
    const auto& sch_idx = chain.db().get_index<generated_transaction_multi_index,by_delay>();
-   const auto scheduled_trxs_size = sch_idx.size();
-   auto sch_itr = sch_idx.begin();
-   while( sch_itr != sch_idx.end() ) {
-      if( sch_itr->delay_until > pending_block_time) break;    // not scheduled yet
+   const auto& sch_trx_idx = chain.db().get_index<generated_transaction_multi_index,by_trx_id>();
+   _deferred_trx_scheduler.refill( sch_idx, pending_block_time, _max_scheduled_transaction_scan_per_block );
+   const auto scheduled_trxs_size = _deferred_trx_scheduler.size();
+   _deferred_trx_scheduler.process( [&]( const deferred_trx_scheduler::entry& sch ) {
+      using result = deferred_trx_scheduler::result;
       if( exhausted || deadline <= fc::time_point::now() ) {
          exhausted = true;
-         break;
+         return result::stop;
       }
+      auto sch_itr = sch_trx_idx.find( sch.trx_id );
+      if( sch_itr == sch_trx_idx.end() ) return result::remove; // retired or canceled
       if( sch_itr->published >= pending_block_time ) {
-         ++sch_itr;
-         continue; // do not allow schedule and execute in same block
+         return result::keep; // do not allow schedule and execute in same block
       }
 
-      if (blacklist_by_id.find(sch_itr->trx_id) != blacklist_by_id.end()) {
-         ++sch_itr;
-         continue;
+      if (blacklist_by_id.find(sch.trx_id) != blacklist_by_id.end()) {
+         return result::park;
       }
 
-      const transaction_id_type trx_id = sch_itr->trx_id; // make copy since reference could be invalidated
-      const auto sch_expiration = sch_itr->expiration;
-      auto sch_itr_next = sch_itr; // save off next since sch_itr may be invalidated by loop
-      ++sch_itr_next;
-      const auto next_delay_until = sch_itr_next != sch_idx.end() ? sch_itr_next->delay_until : sch_itr->delay_until;
-      const auto next_id = sch_itr_next != sch_idx.end() ? sch_itr_next->id : sch_itr->id;
+      const transaction_id_type trx_id = sch.trx_id; // make copy since reference could be invalidated
+      const auto sch_expiration = sch.expiration;
 
       num_processed++;
 
@@ -1994,7 +2044,7 @@ void producer_plugin_impl::process_scheduled_and_incoming_trxs( const fc::time_p
 
       if (exhausted || deadline <= fc::time_point::now()) {
          exhausted = true;
-         break;
+         return result::stop;
       }
 
       try {
@@ -2010,7 +2060,7 @@ void producer_plugin_impl::process_scheduled_and_incoming_trxs( const fc::time_p
             if (exception_is_exhausted(*trace->except, deadline_is_subjective)) {
                if( block_is_exhausted() ) {
                   exhausted = true;
-                  break;
+                  return result::stop;
                }
                // do not blacklist
             } else {
@@ -2026,15 +2076,15 @@ void producer_plugin_impl::process_scheduled_and_incoming_trxs( const fc::time_p
       incoming_trx_weight += _incoming_defer_ratio;
       if (!pending_incoming_process_limit) incoming_trx_weight = 0.0;
 
-      if( sch_itr_next == sch_idx.end() ) break;
-      sch_itr = sch_idx.lower_bound( boost::make_tuple( next_delay_until, next_id ) );
-   }
+      return sch_trx_idx.find( trx_id ) == sch_trx_idx.end() ? result::remove : result::keep;
+   } );
 
    if( scheduled_trxs_size > 0 ) {
       fc_dlog( _log,
                "Processed ${m} of ${n} scheduled transactions, Applied ${applied}, Failed/Dropped ${failed}",
                ( "m", num_processed )( "n", scheduled_trxs_size )( "applied", num_applied )( "failed", num_failed ) );
    }
+   _deferred_trx_scheduler.report( _log, pending_block_time );
 }
 
 bool producer_plugin_impl::process_incoming_trxs( const fc::time_point& deadline, size_t& pending_incoming_process_limit )
@@ -2077,6 +2127,19 @@ bool producer_plugin_impl::block_is_exhausted() const {
    return false;
 }
 
+bool producer_plugin_impl::predicted_to_fit( const transaction_metadata& trx, const fc::time_point& block_deadline ) {
+   const auto predicted = _cpu_cost_predictor.predict( trx.packed_trx()->get_transaction() );
+   if( !predicted ) return true;
+
+   const chain::controller& chain = chain_plug->chain();
+   const auto& rl = chain.get_resource_limits_manager();
+   const auto remaining = std::min( block_deadline - fc::time_point::now(), fc::microseconds( rl.get_block_cpu_limit() ) );
+   if( *predicted <= remaining ) return true;
+
+   _cpu_cost_predictor.skipped( *predicted );
+   return false;
+}
+
 // Example:
 // --> Start block A (block time x.500) at time x.000
 // -> start_block()
@@ -2331,6 +2394,7 @@ void producer_plugin_impl::produce_block() {
         ("p",new_bs->header.producer)("id",new_bs->id.str().substr(8,16))
         ("n",new_bs->block_num)("t",new_bs->header.timestamp)
         ("count",new_bs->block->transactions.size())("lib",chain.last_irreversible_block_num())("confs", new_bs->header.confirmed));
+   _cpu_cost_predictor.report( _log );
 }
 
 void producer_plugin::log_failed_transaction(const transaction_id_type& trx_id, const char* reason) const {
@@ -0,0 +1,100 @@
+#define BOOST_TEST_MODULE cpu_cost_predictor
+#include <boost/test/included/unit_test.hpp>
+
+#include <eosio/producer_plugin/cpu_cost_predictor.hpp>
+
+#include <eosio/testing/tester.hpp>
+
+namespace {
+
+using namespace eosio;
+using namespace eosio::chain;
+
+transaction make_transaction( const std::vector<std::pair<account_name, action_name>>& acts ) {
+   transaction trx;
+   for( const auto& a : acts ) {
+      trx.actions.emplace_back( vector<permission_level>{{"alice"_n, config::active_name}}, a.first, a.second, bytes{} );
+   }
+   return trx;
+}
+
+// trace with one top level action per entry, each followed by a notification of `elapsed_us` / 2
+transaction_trace make_trace( const transaction& trx, const std::vector<int64_t>& elapsed_us ) {
+   transaction_trace trace;
+   int64_t total = 0;
+   for( size_t i = 0; i < trx.actions.size(); ++i ) {
+      const uint32_t ordinal = trace.action_traces.size() + 1;
+      trace.action_traces.emplace_back( trace, trx.actions[i], trx.actions[i].account, false, ordinal, 0, 0 );
+      trace.action_traces.back().elapsed = fc::microseconds( elapsed_us[i] / 2 );
+      trace.action_traces.emplace_back( trace, trx.actions[i], "bob"_n, false, ordinal + 1, ordinal, ordinal );
+      trace.action_traces.back().elapsed = fc::microseconds( elapsed_us[i] - elapsed_us[i] / 2 );
+      total += elapsed_us[i];
+   }
+   trace.elapsed = fc::microseconds( total );
+   return trace;
+}
+
+BOOST_AUTO_TEST_SUITE( cpu_cost_predictor_test )
+
+BOOST_AUTO_TEST_CASE( predict_test ) {
+   fc::logger log;
+   cpu_cost_predictor predictor;
+   predictor.set_stddevs( 0 );
+
+   const auto transfer = make_transaction( {{"eosio.token"_n, "transfer"_n}} );
+   const auto both = make_transaction( {{"eosio.token"_n, "transfer"_n}, {"dex"_n, "trade"_n}} );
+
+   // nothing is predicted until enough samples are collected
+   BOOST_CHECK( !predictor.predict( transfer ) );
+   for( uint32_t i = 0; i < cpu_cost_predictor::min_samples - 1; ++i ) {
+      predictor.observe( transfer, make_trace( transfer, {100} ) );
+   }
+   BOOST_CHECK( !predictor.predict( transfer ) );
+   predictor.observe( transfer, make_trace( transfer, {100} ) );
+   BOOST_REQUIRE( predictor.predict( transfer ) );
+   // notification time is attributed to the top level action
+   BOOST_CHECK_EQUAL( 100, predictor.predict( transfer )->count() );
+
+   // all actions must be known
+   BOOST_CHECK( !predictor.predict( both ) );
+   for( uint32_t i = 0; i < cpu_cost_predictor::min_samples; ++i ) {
+      predictor.observe( both, make_trace( both, {100, 1000} ) );
+   }
+   BOOST_REQUIRE( predictor.predict( both ) );
+   BOOST_CHECK_EQUAL( 1100, predictor.predict( both )->count() );
+   BOOST_CHECK_EQUAL( 2u, predictor.size() );
+
+   // variance widens the upper bound
+   predictor.observe( transfer, make_trace( transfer, {300} ) );
+   const auto mean_only = predictor.predict( transfer );
+   predictor.set_stddevs( 2 );
+   const auto with_stddevs = predictor.predict( transfer );
+   BOOST_REQUIRE( mean_only && with_stddevs );
+   BOOST_CHECK( mean_only->count() > 100 );
+   BOOST_CHECK( with_stddevs->count() > mean_only->count() );
+
+   predictor.skipped( *with_stddevs );
+   predictor.report( log );
+
+   // failed transactions are not learned from
+   auto failed = make_trace( transfer, {100000} );
+   failed.except = fc::exception();
+   predictor.observe( transfer, failed );
+   BOOST_CHECK_EQUAL( with_stddevs->count(), predictor.predict( transfer )->count() );
+}
+
+BOOST_AUTO_TEST_CASE( disabled_test ) {
+   cpu_cost_predictor predictor;
+   predictor.disable();
+
+   const auto transfer = make_transaction( {{"eosio.token"_n, "transfer"_n}} );
+   for( uint32_t i = 0; i < cpu_cost_predictor::min_samples; ++i ) {
+      predictor.observe( transfer, make_trace( transfer, {100} ) );
+   }
+   BOOST_CHECK( !predictor.predict( transfer ) );
+   BOOST_CHECK_EQUAL( 0u, predictor.size() );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
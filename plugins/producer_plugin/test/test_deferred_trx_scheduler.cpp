@@ -0,0 +1,216 @@
+#define BOOST_TEST_MODULE deferred_trx_scheduler
+#include <boost/test/included/unit_test.hpp>
+
+#include <eosio/producer_plugin/deferred_trx_scheduler.hpp>
+
+#include <eosio/testing/tester.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+namespace {
+
+using namespace eosio;
+using namespace eosio::chain;
+
+// the members of generated_transaction_object used by the scheduler
+struct generated_trx {
+   using id_type = chainbase::oid<generated_trx>;
+   id_type              id;
+   transaction_id_type  trx_id;
+   account_name         payer;
+   fc::time_point       delay_until;
+   fc::time_point       expiration;
+   fc::time_point       published;
+};
+
+struct by_delay;
+struct by_trx_id;
+using generated_trx_index = boost::multi_index_container<
+   generated_trx,
+   boost::multi_index::indexed_by<
+      boost::multi_index::ordered_unique< boost::multi_index::tag<by_delay>,
+         boost::multi_index::composite_key< generated_trx,
+            BOOST_MULTI_INDEX_MEMBER( generated_trx, fc::time_point, delay_until ),
+            BOOST_MULTI_INDEX_MEMBER( generated_trx, generated_trx::id_type, id )
+         >
+      >,
+      boost::multi_index::ordered_unique< boost::multi_index::tag<by_trx_id>,
+         BOOST_MULTI_INDEX_MEMBER( generated_trx, transaction_id_type, trx_id )
+      >
+   >
+>;
+
+struct generated_trxs {
+   generated_trx_index idx;
+   int64_t next_id = 0;
+
+   transaction_id_type add( account_name payer, fc::time_point delay_until, fc::time_point published ) {
+      const auto id = next_id++;
+      const auto trx_id = sha256::hash( std::to_string( id ) );
+      idx.insert( generated_trx{ generated_trx::id_type( id ), trx_id, payer, delay_until, delay_until + fc::hours( 1 ), published } );
+      return trx_id;
+   }
+
+   bool retire( const transaction_id_type& trx_id ) {
+      return idx.get<by_trx_id>().erase( trx_id ) > 0;
+   }
+
+   const auto& by_delay_index() const { return idx.get<by_delay>(); }
+};
+
+using result = deferred_trx_scheduler::result;
+
+BOOST_AUTO_TEST_SUITE( deferred_trx_scheduler_test )
+
+BOOST_AUTO_TEST_CASE( round_robin_test ) {
+   const auto now = fc::time_point::now();
+   generated_trxs trxs;
+   for( int i = 0; i < 10; ++i ) trxs.add( "flooder"_n, now - fc::seconds( 10 ), now - fc::seconds( 20 ) );
+   for( int i = 0; i < 2; ++i ) trxs.add( "alice"_n, now - fc::seconds( 5 ), now - fc::seconds( 20 ) );
+   trxs.add( "bob"_n, now + fc::seconds( 5 ), now - fc::seconds( 20 ) ); // not due yet
+
+   deferred_trx_scheduler scheduler;
+   BOOST_CHECK_EQUAL( 12, scheduler.refill( trxs.by_delay_index(), now, 0 ) );
+   BOOST_CHECK_EQUAL( 12, scheduler.size() );
+   BOOST_CHECK_EQUAL( 2, scheduler.payers() );
+   BOOST_CHECK( scheduler.oldest() == now - fc::seconds( 10 ) );
+
+   // alice is not behind all of the flooder's transactions
+   std::vector<account_name> order;
+   scheduler.process( [&]( const deferred_trx_scheduler::entry& e ) {
+      if( order.size() == 4 ) return result::stop;
+      order.push_back( e.payer );
+      trxs.retire( e.trx_id );
+      return result::remove;
+   } );
+   BOOST_CHECK( order == std::vector<account_name>( { "alice"_n, "flooder"_n, "alice"_n, "flooder"_n } ) );
+   BOOST_CHECK_EQUAL( 8, scheduler.size() );
+   BOOST_CHECK_EQUAL( 1, scheduler.payers() );
+
+   // nothing new is due, the scan resumes after the last transaction it queued
+   BOOST_CHECK_EQUAL( 0, scheduler.refill( trxs.by_delay_index(), now, 0 ) );
+   BOOST_CHECK_EQUAL( 8, scheduler.process( []( const auto& ) { return result::keep; } ) );
+   BOOST_CHECK_EQUAL( 1, scheduler.refill( trxs.by_delay_index(), now + fc::seconds( 5 ), 0 ) );
+   BOOST_CHECK_EQUAL( 9, scheduler.size() );
+}
+
+BOOST_AUTO_TEST_CASE( bounded_scan_test ) {
+   const auto now = fc::time_point::now();
+   generated_trxs trxs;
+   for( int i = 0; i < 25; ++i ) trxs.add( "alice"_n, now - fc::seconds( 1 ), now - fc::seconds( 2 ) );
+   trxs.add( "alice"_n, now, now ); // created by the pending block
+
+   deferred_trx_scheduler scheduler;
+   BOOST_CHECK_EQUAL( 10, scheduler.refill( trxs.by_delay_index(), now, 10 ) );
+   BOOST_CHECK_EQUAL( 10, scheduler.refill( trxs.by_delay_index(), now, 10 ) );
+   BOOST_CHECK_EQUAL( 5, scheduler.refill( trxs.by_delay_index(), now, 10 ) );
+   BOOST_CHECK_EQUAL( 0, scheduler.refill( trxs.by_delay_index(), now, 10 ) );
+   BOOST_CHECK_EQUAL( 25, scheduler.size() );
+
+   // once it is part of the head block it is picked up
+   BOOST_CHECK_EQUAL( 1, scheduler.refill( trxs.by_delay_index(), now + fc::milliseconds( 500 ), 10 ) );
+   BOOST_CHECK_EQUAL( 26, scheduler.size() );
+}
+
+BOOST_AUTO_TEST_CASE( abort_and_fork_test ) {
+   const auto now = fc::time_point::now();
+   generated_trxs trxs;
+   for( int i = 0; i < 4; ++i ) trxs.add( "alice"_n, now - fc::seconds( 1 ), now - fc::seconds( 2 ) );
+
+   deferred_trx_scheduler scheduler;
+   scheduler.on_block( 100 );
+   scheduler.refill( trxs.by_delay_index(), now, 0 );
+
+   auto remove_all = []( const auto& ) { return result::remove; };
+
+   // removed by a pending block that is aborted
+   BOOST_CHECK_EQUAL( 4, scheduler.process( remove_all ) );
+   BOOST_CHECK_EQUAL( 0, scheduler.size() );
+   scheduler.abort_block();
+   BOOST_CHECK_EQUAL( 4, scheduler.size() );
+
+   // removed by a block that becomes the head block
+   scheduler.process( remove_all );
+   scheduler.on_block( 101 );
+   scheduler.abort_block();
+   BOOST_CHECK_EQUAL( 0, scheduler.size() );
+
+   // fork switch, everything is scanned again
+   scheduler.on_block( 101 );
+   BOOST_CHECK_EQUAL( 4, scheduler.refill( trxs.by_delay_index(), now, 0 ) );
+}
+
+BOOST_AUTO_TEST_CASE( park_test ) {
+   const auto now = fc::time_point::now();
+   generated_trxs trxs;
+   const auto id = trxs.add( "alice"_n, now - fc::seconds( 1 ), now - fc::seconds( 2 ) );
+
+   deferred_trx_scheduler scheduler;
+   scheduler.refill( trxs.by_delay_index(), now, 0 );
+   BOOST_CHECK_EQUAL( 1, scheduler.process( []( const auto& ) { return result::park; } ) );
+   BOOST_CHECK_EQUAL( 0, scheduler.size() );
+   BOOST_CHECK_EQUAL( 1, scheduler.parked() );
+
+   // back once its expiration has passed so it can be retired as expired
+   const auto expiration = trxs.idx.get<by_trx_id>().find( id )->expiration;
+   scheduler.refill( trxs.by_delay_index(), expiration, 0 );
+   BOOST_CHECK_EQUAL( 0, scheduler.size() );
+   scheduler.refill( trxs.by_delay_index(), expiration + fc::milliseconds( 500 ), 0 );
+   BOOST_CHECK_EQUAL( 1, scheduler.size() );
+   BOOST_CHECK_EQUAL( 0, scheduler.parked() );
+}
+
+// 1M due deferred transactions of a single flooding payer with a few of other payers in between; every block retires
+// a fixed number of them, the per block overhead must not depend on the size of the backlog
+BOOST_AUTO_TEST_CASE( stress_test ) {
+   const auto now = fc::time_point::now();
+   constexpr uint32_t num_trxs = 1'000'000;
+   constexpr uint32_t max_scan = 10'000;
+   constexpr uint32_t retired_per_block = 1'000;
+   constexpr uint32_t num_blocks = 100;
+
+   generated_trxs trxs;
+   std::set<transaction_id_type> others;
+   for( uint32_t i = 0; i < num_trxs; ++i ) {
+      if( i % ( num_trxs / num_blocks ) == 0 ) {
+         const account_name payer( "payer"_n.to_uint64_t() + others.size() + 1 );
+         others.insert( trxs.add( payer, now - fc::seconds( 60 ), now - fc::seconds( 61 ) ) );
+      }
+      trxs.add( "flooder"_n, now - fc::seconds( 60 ), now - fc::seconds( 61 ) );
+   }
+
+   deferred_trx_scheduler scheduler;
+   fc::microseconds scheduling_time;
+   uint32_t others_retired = 0;
+   for( uint32_t b = 0; b < num_blocks; ++b ) {
+      const auto pending_block_time = now + fc::milliseconds( 500 * b );
+      uint32_t retired = 0;
+      const auto start = fc::time_point::now();
+      const auto scanned = scheduler.refill( trxs.by_delay_index(), pending_block_time, max_scan );
+      const auto visited = scheduler.process( [&]( const deferred_trx_scheduler::entry& e ) {
+         if( retired == retired_per_block ) return result::stop;
+         ++retired;
+         others_retired += others.count( e.trx_id );
+         trxs.retire( e.trx_id );
+         return result::remove;
+      } );
+      scheduling_time += fc::time_point::now() - start;
+      scheduler.on_block( b + 1 );
+
+      BOOST_CHECK_LE( scanned, max_scan );
+      BOOST_CHECK_EQUAL( retired_per_block, visited );
+   }
+
+   BOOST_TEST_MESSAGE( "scheduling overhead per block with " << num_trxs << " deferred transactions: "
+                       << scheduling_time.count() / num_blocks << "us" );
+   BOOST_CHECK_EQUAL( num_trxs + num_blocks - num_blocks * retired_per_block, trxs.idx.size() );
+   // the other payers are not stuck behind the flooder, each is retired in the block that scans it
+   BOOST_CHECK_EQUAL( num_blocks, others_retired );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
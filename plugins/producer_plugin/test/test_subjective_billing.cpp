@@ -5,6 +5,12 @@
 
 #include <eosio/testing/tester.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 namespace {
 
 using namespace eosio;
@@ -160,6 +166,158 @@ BOOST_AUTO_TEST_CASE( subjective_bill_test ) {
 
 }
 
+BOOST_AUTO_TEST_CASE( subjective_bill_concurrent_test ) {
+
+   fc::logger log;
+   const auto now = time_point::now();
+   const std::vector<account_name> accounts{ "a"_n, "b"_n, "c"_n, "d"_n, "eosio"_n, "eosio.token"_n };
+   constexpr uint32_t trxs_per_thread = 1000;
+   constexpr uint32_t num_threads = 4;
+
+   subjective_billing sub_bill;
+   std::vector<std::thread> threads;
+   for( uint32_t t = 0; t < num_threads; ++t ) {
+      threads.emplace_back( [&, t]() {
+         for( uint32_t i = 0; i < trxs_per_thread; ++i ) {
+            const uint32_t n = t * trxs_per_thread + i;
+            // spread expiries over several slots of the expiry wheel
+            sub_bill.subjective_bill( sha256::hash( std::to_string( n ) ), now + fc::milliseconds( n ),
+                                      accounts[n % accounts.size()], fc::microseconds( 1 ), false );
+            sub_bill.get_subjective_bill( accounts[i % accounts.size()], now );
+         }
+      } );
+   }
+   for( auto& t : threads ) t.join();
+
+   constexpr uint32_t total = num_threads * trxs_per_thread;
+   BOOST_CHECK_EQUAL( total, sub_bill.size() );
+   uint64_t billed = 0;
+   for( const auto& a : accounts ) billed += sub_bill.get_subjective_bill( a, now );
+   BOOST_CHECK_EQUAL( total, billed );
+
+   // block inclusion of the even ones, then expire up to the middle
+   for( uint32_t n = 0; n < total; n += 2 ) {
+      sub_bill.remove_subjective_billing( sha256::hash( std::to_string( n ) ), 0 );
+   }
+   BOOST_CHECK_EQUAL( total / 2, sub_bill.size() );
+
+   sub_bill.remove_expired( log, now + fc::milliseconds( total / 2 ), now, fc::time_point::maximum() );
+   BOOST_CHECK_EQUAL( total / 4, sub_bill.size() );
+   billed = 0;
+   for( const auto& a : accounts ) billed += sub_bill.get_subjective_bill( a, now );
+   BOOST_CHECK_EQUAL( total / 2, billed ); // expired ones remain in the decay at full value
+
+   sub_bill.remove_expired( log, now + fc::milliseconds( total ), now, fc::time_point::maximum() );
+   BOOST_CHECK_EQUAL( 0, sub_bill.size() );
+}
+
+BOOST_AUTO_TEST_CASE( subjective_bill_rebilled_test ) {
+
+   fc::logger log;
+   const auto now = time_point::now();
+   const transaction_id_type id = sha256::hash( "1" );
+   account_name a = "a"_n;
+
+   // a transaction removed by a block and billed again after a fork leaves its id in the expiry wheel once per bill
+   subjective_billing sub_bill;
+   for( int i = 0; i < 3; ++i ) {
+      sub_bill.subjective_bill( id, now, a, fc::microseconds( 10 ), false );
+      BOOST_CHECK_EQUAL( 1, sub_bill.size() );
+      sub_bill.remove_subjective_billing( id, 0 );
+      BOOST_CHECK_EQUAL( 0, sub_bill.size() );
+   }
+   sub_bill.subjective_bill( id, now, a, fc::microseconds( 10 ), false );
+
+   BOOST_CHECK( sub_bill.remove_expired( log, now + fc::seconds( 1 ), now, fc::time_point::maximum() ) );
+   BOOST_CHECK_EQUAL( 0, sub_bill.size() );
+   BOOST_CHECK_EQUAL( 10, sub_bill.get_subjective_bill( a, now ) );
+}
+
+
+// Latency of subjective_bill on transaction threads and of on_block and remove_expired on the main thread, with
+// transactions billed at 50k TPS by 4 threads and a block every 500ms including 4 of every 5 of them.
+// disabled by default, run with: test_subjective_billing --run_test=subjective_billing_test/subjective_bill_throughput_benchmark
+BOOST_AUTO_TEST_CASE( subjective_bill_throughput_benchmark, * boost::unit_test::disabled() ) {
+
+   using clock = std::chrono::steady_clock;
+   fc::logger log;
+   constexpr uint32_t tps         = 50'000;
+   constexpr uint32_t seconds     = 10;
+   constexpr uint32_t num_threads = 4;
+   constexpr uint32_t total       = tps * seconds;
+   constexpr auto     block_interval = std::chrono::milliseconds( 500 );
+   const std::vector<account_name> accounts{ "a"_n, "b"_n, "c"_n, "d"_n, "eosio"_n, "eosio.token"_n, "alice"_n, "bob"_n };
+
+   // transactions are packed up front, only the billing is timed
+   std::vector<transaction_receipt> receipts( total );
+   for( uint32_t n = 0; n < total; ++n ) {
+      signed_transaction trx;
+      trx.ref_block_num    = n & 0xffff;
+      trx.ref_block_prefix = n;
+      receipts[n].trx.emplace<packed_transaction>( std::move( trx ), true );
+   }
+   auto id_of = [&]( uint32_t n ) { return std::get<packed_transaction>( receipts[n].trx ).id(); };
+
+   auto report = []( const char* what, std::vector<int64_t>& latencies ) {
+      std::sort( latencies.begin(), latencies.end() );
+      auto pct = [&]( double p ) { return latencies[std::min( latencies.size() - 1, size_t( p * latencies.size() ) )]; };
+      BOOST_TEST_MESSAGE( what << " ns: p50 " << pct( 0.5 ) << ", p99 " << pct( 0.99 ) << ", p99.9 " << pct( 0.999 )
+                          << ", max " << latencies.back() );
+   };
+
+   subjective_billing sub_bill;
+   std::array<std::atomic<uint32_t>, num_threads> billed{};
+   std::array<std::vector<int64_t>, num_threads> bill_latencies;
+   const auto start = clock::now();
+   std::vector<std::thread> threads;
+   for( uint32_t t = 0; t < num_threads; ++t ) {
+      threads.emplace_back( [&, t]() {
+         bill_latencies[t].reserve( total / num_threads );
+         for( uint32_t n = t; n < total; n += num_threads ) {
+            std::this_thread::sleep_until( start + std::chrono::microseconds( uint64_t( n ) * 1'000'000 / tps ) );
+            const auto id = id_of( n );
+            const auto b  = clock::now();
+            sub_bill.subjective_bill( id, fc::time_point::now() + fc::seconds( 1 ), accounts[n % accounts.size()],
+                                      fc::microseconds( 100 ), false );
+            sub_bill.get_subjective_bill( accounts[n % accounts.size()], fc::time_point::now() );
+            bill_latencies[t].push_back( std::chrono::duration_cast<std::chrono::nanoseconds>( clock::now() - b ).count() );
+            billed[t] = n / num_threads + 1;
+         }
+      } );
+   }
+
+   std::vector<int64_t> block_latencies;
+   std::vector<int64_t> expire_latencies;
+   uint32_t included = 0;
+   for( auto next_block = start + block_interval; included < total; next_block += block_interval ) {
+      std::this_thread::sleep_until( next_block );
+      uint32_t hi = total;
+      for( const auto& b : billed ) hi = std::min( hi, b.load() * num_threads );
+      auto bsp = std::make_shared<block_state>();
+      bsp->block = std::make_shared<signed_block>();
+      for( ; included < hi; ++included ) {
+         if( included % 5 != 0 ) bsp->block->transactions.push_back( receipts[included] );
+      }
+
+      auto b = clock::now();
+      sub_bill.on_block( bsp, fc::time_point::now() );
+      block_latencies.push_back( std::chrono::duration_cast<std::chrono::nanoseconds>( clock::now() - b ).count() );
+      b = clock::now();
+      sub_bill.remove_expired( log, fc::time_point::now(), fc::time_point::now(), fc::time_point::maximum() );
+      expire_latencies.push_back( std::chrono::duration_cast<std::chrono::nanoseconds>( clock::now() - b ).count() );
+   }
+   for( auto& t : threads ) t.join();
+   const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>( clock::now() - start ).count();
+
+   std::vector<int64_t> all_bill_latencies;
+   for( const auto& l : bill_latencies ) all_bill_latencies.insert( all_bill_latencies.end(), l.begin(), l.end() );
+   BOOST_TEST_MESSAGE( total << " transactions billed in " << elapsed << " ms, " << block_latencies.size() << " blocks" );
+   report( "subjective_bill and get_subjective_bill", all_bill_latencies );
+   report( "on_block", block_latencies );
+   report( "remove_expired", expire_latencies );
+   BOOST_CHECK( sub_bill.size() <= total / 5 );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
@@ -22,6 +22,11 @@ public:
    // directory monitoring
    void monitor_directory(const bfs::path& path);
 
+   // True while a resource pressure threshold is exceeded and the configured
+   // resource-monitor-pressure-action asks for it. Thread safe.
+   bool speculative_execution_paused() const;
+   bool api_writes_rejected() const;
+
 private:
    std::unique_ptr<class resource_monitor_plugin_impl> my;
 };
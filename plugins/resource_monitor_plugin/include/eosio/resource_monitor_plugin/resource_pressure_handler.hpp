@@ -0,0 +1,308 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <boost/asio.hpp>
+
+#include <appbase/application.hpp>
+#include <eosio/chain/exceptions.hpp>
+
+#include <atomic>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+
+#include <sys/sysmacros.h>
+
+namespace bfs = boost::filesystem;
+
+namespace eosio::resource_monitor {
+   // What to do while any of the resource pressure thresholds is exceeded.
+   enum class pressure_action {
+      warn,              // only log
+      pause_speculative, // producer does not start speculative blocks
+      reject_api_writes, // push_transaction, send_transaction and push_block APIs are rejected
+      shutdown           // graceful shutdown
+   };
+
+   inline std::istream& operator>>(std::istream& in, pressure_action& action) {
+      std::string s;
+      in >> s;
+      if (s == "warn")
+         action = pressure_action::warn;
+      else if (s == "pause-speculative")
+         action = pressure_action::pause_speculative;
+      else if (s == "reject-api-writes")
+         action = pressure_action::reject_api_writes;
+      else if (s == "shutdown")
+         action = pressure_action::shutdown;
+      else
+         in.setstate(std::ios_base::failbit);
+      return in;
+   }
+
+   inline std::ostream& operator<<(std::ostream& osm, pressure_action action) {
+      switch (action) {
+         case pressure_action::warn:              osm << "warn"; break;
+         case pressure_action::pause_speculative: osm << "pause-speculative"; break;
+         case pressure_action::reject_api_writes: osm << "reject-api-writes"; break;
+         case pressure_action::shutdown:          osm << "shutdown"; break;
+      }
+      return osm;
+   }
+
+   // Thresholds of the resources tracked besides file system space, 0 disables a threshold.
+   struct pressure_thresholds {
+      uint64_t rss_bytes {0};              // resident set size of nodeos
+      uint32_t shared_memory_percent {0};  // used part of the chainbase shared memory
+      uint32_t memory_pressure_percent {0};// PSI "some avg10" of /proc/pressure/memory
+      uint32_t io_pressure_percent {0};    // PSI "some avg10" of /proc/pressure/io
+      uint64_t write_bytes_per_sec {0};    // write throughput of any monitored file system
+   };
+
+   /**
+    * Tracks memory and I/O pressure: RSS, chainbase shared memory fill, PSI pressure stall information from
+    * /proc/pressure and the write throughput of the devices of the monitored file systems from /proc/diskstats.
+    *
+    * Sampled periodically like file_space_handler. Where the kernel supports PSI triggers, memory and I/O pressure
+    * also wake the monitor up as soon as they cross their thresholds instead of at the next interval.
+    *
+    * The state is read by other threads through speculative_execution_paused() and api_writes_rejected().
+    */
+   template<typename ResourceProvider>
+   class resource_pressure_handler {
+   public:
+      resource_pressure_handler(ResourceProvider&& resource_provider, boost::asio::io_context& ctx)
+      :resource_provider(std::move(resource_provider)),
+      ctx(ctx),
+      timer{ctx}
+      {
+      }
+
+      void set_sleep_time(uint32_t sleep_time) {
+         sleep_time_in_secs = sleep_time;
+      }
+
+      void set_thresholds(const pressure_thresholds& new_thresholds) {
+         EOS_ASSERT(new_thresholds.shared_memory_percent <= 100 && new_thresholds.memory_pressure_percent <= 100 && new_thresholds.io_pressure_percent <= 100,
+                    chain::plugin_config_exception, "resource pressure percentages must be between 0 and 100");
+         thresholds = new_thresholds;
+      }
+
+      void set_action(pressure_action new_action) {
+         action = new_action;
+      }
+
+      bool is_enabled() const {
+         return thresholds.rss_bytes || thresholds.shared_memory_percent || thresholds.memory_pressure_percent ||
+                thresholds.io_pressure_percent || thresholds.write_bytes_per_sec;
+      }
+
+      // Called from the main thread whenever the chainbase usage may have changed
+      void set_shared_memory_usage(uint64_t used, uint64_t size) {
+         shared_memory_used = used;
+         shared_memory_size = size;
+      }
+
+      // Track the write throughput of the device of the file system containing path_name
+      void add_file_system(const bfs::path& path_name) {
+         struct stat statbuf;
+         auto status = resource_provider.get_stat(path_name.string().c_str(), &statbuf);
+         EOS_ASSERT(status == 0, chain::plugin_config_exception,
+                    "Failed to run stat on ${path} with status ${status}", ("path", path_name.string())("status", status));
+         devices.try_emplace(statbuf.st_dev, device_info{path_name});
+      }
+
+      bool speculative_execution_paused() const { return paused_speculative; }
+      bool api_writes_rejected() const { return rejected_api_writes; }
+
+      // Sample all resources, apply the configured action when any threshold is exceeded
+      // and lift it when none is. Returns true if a threshold is exceeded.
+      bool is_threshold_exceeded(const fc::time_point& now) {
+         std::vector<std::string> exceeded;
+
+         if (thresholds.rss_bytes) {
+            if (auto rss = get_rss_bytes(); rss && *rss > thresholds.rss_bytes) {
+               exceeded.push_back("RSS " + std::to_string(*rss / (1024*1024)) + " MiB");
+            }
+         }
+
+         if (thresholds.shared_memory_percent && shared_memory_size > 0) {
+            const uint64_t used_percent = shared_memory_used * 100 / shared_memory_size;
+            if (used_percent >= thresholds.shared_memory_percent) {
+               exceeded.push_back("shared memory " + std::to_string(used_percent) + "%");
+            }
+         }
+
+         if (thresholds.memory_pressure_percent) {
+            if (auto p = get_pressure("memory"); p && *p >= thresholds.memory_pressure_percent) {
+               exceeded.push_back("memory pressure " + std::to_string(*p) + "%");
+            }
+         }
+
+         if (thresholds.io_pressure_percent) {
+            if (auto p = get_pressure("io"); p && *p >= thresholds.io_pressure_percent) {
+               exceeded.push_back("I/O pressure " + std::to_string(*p) + "%");
+            }
+         }
+
+         if (thresholds.write_bytes_per_sec && !devices.empty()) {
+            const auto written = get_bytes_written();
+            for (auto& [dev, info] : devices) {
+               auto itr = written.find(dev);
+               if (itr == written.end()) continue; // e.g. tmpfs or overlay
+               if (info.last_sample != fc::time_point() && now > info.last_sample && itr->second >= info.bytes_written) {
+                  const uint64_t rate = (itr->second - info.bytes_written) * 1000000 / (now - info.last_sample).count();
+                  if (rate > thresholds.write_bytes_per_sec) {
+                     exceeded.push_back(info.path_name.string() + " writes " + std::to_string(rate / (1024*1024)) + " MiB/s");
+                  }
+               }
+               info.bytes_written = itr->second;
+               info.last_sample = now;
+            }
+         }
+
+         const bool is_exceeded = !exceeded.empty();
+         if (is_exceeded != under_pressure) {
+            under_pressure = is_exceeded;
+            if (is_exceeded) {
+               std::string reasons;
+               for (const auto& e : exceeded) reasons += (reasons.empty() ? "" : ", ") + e;
+               std::stringstream ss; ss << action;
+               wlog("Resource pressure threshold exceeded: ${reasons}, action: ${action}", ("reasons", reasons)("action", ss.str()));
+            } else {
+               ilog("Resource pressure below thresholds");
+            }
+            paused_speculative = is_exceeded && action == pressure_action::pause_speculative;
+            rejected_api_writes = is_exceeded && action == pressure_action::reject_api_writes;
+         }
+         return is_exceeded;
+      }
+
+      void pressure_monitor_loop() {
+         if (is_threshold_exceeded(fc::time_point::now()) && action == pressure_action::shutdown) {
+            wlog("Shutting down");
+            appbase::app().quit(); // This will gracefully stop Nodeos
+            return;
+         }
+
+         timer.expires_from_now( boost::posix_time::seconds( sleep_time_in_secs ));
+
+         timer.async_wait([this](auto& ec) {
+            if ( ec ) {
+               if ( ec != boost::asio::error::operation_aborted ) {
+                  wlog("Exit due to error: ${ec}, message: ${message}",
+                       ("ec", ec.value())
+                       ("message", ec.message()));
+               }
+               return;
+            } else {
+               // Loop over
+               pressure_monitor_loop();
+            }
+         });
+      }
+
+      // Register PSI triggers for the pressure thresholds, each trigger restarts pressure_monitor_loop right away.
+      // Kernels without PSI trigger support (or without the privilege to create them) are only sampled periodically.
+      void watch_pressure_events() {
+         for (const auto& [resource, percent] : { std::pair<std::string, uint32_t>{"memory", thresholds.memory_pressure_percent},
+                                                  std::pair<std::string, uint32_t>{"io", thresholds.io_pressure_percent} }) {
+            if (percent == 0) continue;
+            const uint32_t stall_us = uint64_t(psi_window_us) * percent / 100;
+            int fd = resource_provider.open_pressure_trigger(resource, stall_us, psi_window_us);
+            if (fd < 0) {
+               dlog("PSI trigger not available for ${r}, sampling every ${s} seconds", ("r", resource)("s", sleep_time_in_secs));
+               continue;
+            }
+            auto& trigger = pressure_triggers.emplace_back(std::make_unique<boost::asio::posix::stream_descriptor>(ctx, fd));
+            wait_pressure_event(*trigger, resource);
+         }
+      }
+
+   private:
+      ResourceProvider resource_provider;
+
+      boost::asio::io_context& ctx;
+      boost::asio::deadline_timer timer;
+      std::vector<std::unique_ptr<boost::asio::posix::stream_descriptor>> pressure_triggers;
+
+      uint32_t            sleep_time_in_secs {2};
+      pressure_thresholds thresholds;
+      pressure_action     action {pressure_action::warn};
+      bool                under_pressure {false};
+
+      std::atomic<uint64_t> shared_memory_used {0};
+      std::atomic<uint64_t> shared_memory_size {0};
+      std::atomic<bool>     paused_speculative {false};
+      std::atomic<bool>     rejected_api_writes {false};
+
+      static constexpr uint32_t psi_window_us = 1000000; // PSI trigger window, between 500ms and 10s
+      static constexpr uint64_t sector_size = 512;       // /proc/diskstats always counts 512 byte sectors
+
+      struct device_info {
+         bfs::path      path_name;
+         uint64_t       bytes_written {0};
+         fc::time_point last_sample;
+      };
+      std::map<dev_t, device_info> devices;
+
+      void wait_pressure_event(boost::asio::posix::stream_descriptor& trigger, const std::string& resource) {
+         trigger.async_wait(boost::asio::posix::stream_descriptor::wait_error, [this, &trigger, resource](const boost::system::error_code& ec) {
+            if (ec) return;
+            dlog("${r} pressure event", ("r", resource));
+            timer.cancel();
+            pressure_monitor_loop();
+            if (!appbase::app().is_quiting()) wait_pressure_event(trigger, resource);
+         });
+      }
+
+      std::optional<uint64_t> get_rss_bytes() {
+         // /proc/self/statm: size resident shared text lib data dt, in pages
+         auto content = resource_provider.read_file("/proc/self/statm");
+         if (!content) return {};
+         std::istringstream in(*content);
+         uint64_t size = 0, resident = 0;
+         if (!(in >> size >> resident)) return {};
+         return resident * resource_provider.page_size();
+      }
+
+      // "some avg10" of /proc/pressure/<resource> in percent
+      std::optional<uint32_t> get_pressure(const std::string& resource) {
+         auto content = resource_provider.read_file("/proc/pressure/" + resource);
+         if (!content) return {};
+         std::istringstream in(*content);
+         std::string line;
+         while (std::getline(in, line)) {
+            if (line.rfind("some ", 0) != 0) continue;
+            auto pos = line.find("avg10=");
+            if (pos == std::string::npos) return {};
+            try {
+               return static_cast<uint32_t>(std::stod(line.substr(pos + 6)));
+            } catch (...) {
+               return {};
+            }
+         }
+         return {};
+      }
+
+      // bytes written per device from /proc/diskstats
+      std::map<dev_t, uint64_t> get_bytes_written() {
+         std::map<dev_t, uint64_t> result;
+         auto content = resource_provider.read_file("/proc/diskstats");
+         if (!content) return result;
+         std::istringstream in(*content);
+         std::string line;
+         while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            unsigned int maj = 0, min = 0;
+            std::string name;
+            uint64_t v[7] = {};
+            // major minor name reads merged sectors_read ms_reading writes merged sectors_written
+            if (!(fields >> maj >> min >> name >> v[0] >> v[1] >> v[2] >> v[3] >> v[4] >> v[5] >> v[6])) continue;
+            result[makedev(maj, min)] = v[6] * sector_size;
+         }
+         return result;
+      }
+   };
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <sys/stat.h>
+
+#include <optional>
+#include <string>
+
+namespace eosio::resource_monitor {
+   class system_resource_provider {
+   public:
+      system_resource_provider()
+      {
+      }
+
+      // Wrapper for Linux stat
+      int get_stat(const char *path, struct stat *buf) const;
+
+      // Content of a (usually /proc) file, empty if it cannot be read
+      std::optional<std::string> read_file(const std::string& path) const;
+
+      uint64_t page_size() const;
+
+      // Open /proc/pressure/<resource> with a trigger for stall_us of "some" stall in window_us,
+      // returns the file descriptor to poll for POLLPRI or -1 if not supported
+      int open_pressure_trigger(const std::string& resource, uint32_t stall_us, uint32_t window_us) const;
+   };
+}
@@ -18,6 +18,8 @@
 #include <eosio/resource_monitor_plugin/resource_monitor_plugin.hpp>
 #include <eosio/resource_monitor_plugin/file_space_handler.hpp>
 #include <eosio/resource_monitor_plugin/system_file_space_provider.hpp>
+#include <eosio/resource_monitor_plugin/resource_pressure_handler.hpp>
+#include <eosio/resource_monitor_plugin/system_resource_provider.hpp>
 
 #include <eosio/chain/exceptions.hpp>
 
@@ -25,6 +27,7 @@
 #include <fc/log/logger_config.hpp> // set_os_thread_name
 
 #include <boost/filesystem.hpp>
+#include <boost/signals2/connection.hpp>
 
 #include <thread>
 
@@ -40,7 +43,8 @@ namespace eosio {
 class resource_monitor_plugin_impl {
 public:
    resource_monitor_plugin_impl()
-      :space_handler(system_file_space_provider(), ctx)
+      :space_handler(system_file_space_provider(), ctx),
+      pressure_handler(system_resource_provider(), ctx)
       {
       }
 
@@ -54,6 +58,22 @@ public:
            "Used to indicate nodeos will not shutdown when threshold is exceeded." )
          ( "resource-monitor-warning-interval", bpo::value<uint32_t>()->default_value(def_monitor_warning_interval),
            "Number of resource monitor intervals between two consecutive warnings when the threshold is hit. Should be between 1 and 450" )
+         ( "resource-monitor-rss-threshold-mb", bpo::value<uint64_t>()->default_value(0),
+           "Resident memory of nodeos in MiB above which resource-monitor-pressure-action is taken, 0 to disable" )
+         ( "resource-monitor-shared-memory-threshold", bpo::value<uint32_t>()->default_value(0),
+           "Percentage of used chainbase shared memory above which resource-monitor-pressure-action is taken, 0 to disable" )
+         ( "resource-monitor-memory-pressure-threshold", bpo::value<uint32_t>()->default_value(0),
+           "Percentage of time some tasks stalled on memory over the last 10 seconds (PSI /proc/pressure/memory) above which resource-monitor-pressure-action is taken, 0 to disable" )
+         ( "resource-monitor-io-pressure-threshold", bpo::value<uint32_t>()->default_value(0),
+           "Percentage of time some tasks stalled on I/O over the last 10 seconds (PSI /proc/pressure/io) above which resource-monitor-pressure-action is taken, 0 to disable" )
+         ( "resource-monitor-write-throughput-threshold-mb", bpo::value<uint64_t>()->default_value(0),
+           "Write throughput in MiB/s of the device of any monitored file system above which resource-monitor-pressure-action is taken, 0 to disable" )
+         ( "resource-monitor-pressure-action", bpo::value<pressure_action>()->default_value(pressure_action::warn),
+           "Action while any resource pressure threshold is exceeded, one of:\n"
+           "   \"warn\" - only log a warning\n"
+           "   \"pause-speculative\" - do not execute transactions speculatively, producing is not affected\n"
+           "   \"reject-api-writes\" - reject push_transaction(s), send_transaction and push_block API requests\n"
+           "   \"shutdown\" - gracefully shut down" )
          ;
    }
    
@@ -87,6 +107,16 @@ public:
          "\"resource-monitor-warning-interval\" must be between ${warning_interval_min} and ${warning_interval_max}", ("warning_interval_min", warning_interval_min) ("warning_interval_max", warning_interval_max));
       space_handler.set_warning_interval(warning_interval);
       ilog("Warning interval set to ${warning_interval}", ("warning_interval", warning_interval));
+
+      pressure_thresholds thresholds;
+      thresholds.rss_bytes = options.at("resource-monitor-rss-threshold-mb").as<uint64_t>() * 1024 * 1024;
+      thresholds.shared_memory_percent = options.at("resource-monitor-shared-memory-threshold").as<uint32_t>();
+      thresholds.memory_pressure_percent = options.at("resource-monitor-memory-pressure-threshold").as<uint32_t>();
+      thresholds.io_pressure_percent = options.at("resource-monitor-io-pressure-threshold").as<uint32_t>();
+      thresholds.write_bytes_per_sec = options.at("resource-monitor-write-throughput-threshold-mb").as<uint64_t>() * 1024 * 1024;
+      pressure_handler.set_thresholds(thresholds);
+      pressure_handler.set_sleep_time(interval);
+      pressure_handler.set_action(options.at("resource-monitor-pressure-action").as<pressure_action>());
    }
    
    // Start main thread
@@ -109,9 +139,31 @@ public:
          }
       }
    
+      if ( pressure_handler.is_enabled() ) {
+         for ( auto& dir: directories_registered ) {
+            pressure_handler.add_file_system( dir );
+         }
+
+         // chainbase is only touched on the main thread, sample it there after every block
+         auto& chain = app().get_plugin<chain_plugin>().chain();
+         auto sample_shared_memory = [this, &chain]() {
+            const auto& db = chain.db();
+            const uint64_t size = db.get_segment_manager()->get_size();
+            pressure_handler.set_shared_memory_usage( size - db.get_free_memory(), size );
+         };
+         sample_shared_memory();
+         accepted_block_connection.emplace( chain.accepted_block.connect( [sample_shared_memory]( const auto& ) {
+            sample_shared_memory();
+         } ) );
+      }
+
       monitor_thread = std::thread( [this] {
          fc::set_os_thread_name( "resmon" ); // console_appender uses 9 chars for thread name reporting. 
          space_handler.space_monitor_loop();
+         if ( pressure_handler.is_enabled() ) {
+            pressure_handler.pressure_monitor_loop();
+            pressure_handler.watch_pressure_events();
+         }
    
          ctx.run();
       } );
@@ -121,6 +173,7 @@ public:
    void plugin_shutdown() {
       ilog("shutdown...");
    
+      accepted_block_connection.reset();
       ctx.stop();
    
       // Wait for the thread to end
@@ -134,6 +187,14 @@ public:
       directories_registered.push_back(path);
    }
 
+   bool speculative_execution_paused() const {
+      return pressure_handler.speculative_execution_paused();
+   }
+
+   bool api_writes_rejected() const {
+      return pressure_handler.api_writes_rejected();
+   }
+
 private:
    std::thread               monitor_thread;
    std::vector<bfs::path>    directories_registered;
@@ -155,6 +216,11 @@ private:
 
    using file_space_handler_t = file_space_handler<system_file_space_provider>;
    file_space_handler_t space_handler;
+
+   using resource_pressure_handler_t = resource_pressure_handler<system_resource_provider>;
+   resource_pressure_handler_t pressure_handler;
+
+   std::optional<boost::signals2::scoped_connection> accepted_block_connection;
 };
 
 resource_monitor_plugin::resource_monitor_plugin():my(std::make_unique<resource_monitor_plugin_impl>()) {}
@@ -181,4 +247,12 @@ void resource_monitor_plugin::monitor_directory(const bfs::path& path) {
    my->monitor_directory( path );
 }
 
+bool resource_monitor_plugin::speculative_execution_paused() const {
+   return my->speculative_execution_paused();
+}
+
+bool resource_monitor_plugin::api_writes_rejected() const {
+   return my->api_writes_rejected();
+}
+
 } // namespace
@@ -0,0 +1,38 @@
+#include <eosio/resource_monitor_plugin/system_resource_provider.hpp>
+
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace eosio::resource_monitor {
+   int system_resource_provider::get_stat(const char *path, struct stat *buf) const {
+      return stat(path, buf);
+   }
+
+   std::optional<std::string> system_resource_provider::read_file(const std::string& path) const {
+      // /proc files report a size of 0, so read until EOF instead of by size
+      std::ifstream in(path);
+      if (!in) return {};
+      std::stringstream ss;
+      ss << in.rdbuf();
+      return ss.str();
+   }
+
+   uint64_t system_resource_provider::page_size() const {
+      return sysconf(_SC_PAGESIZE);
+   }
+
+   int system_resource_provider::open_pressure_trigger(const std::string& resource, uint32_t stall_us, uint32_t window_us) const {
+      const std::string path = "/proc/pressure/" + resource;
+      int fd = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+      if (fd < 0) return -1;
+      const std::string trigger = "some " + std::to_string(stall_us) + " " + std::to_string(window_us);
+      if (write(fd, trigger.c_str(), trigger.size() + 1) < 0) {
+         close(fd);
+         return -1;
+      }
+      return fd;
+   }
+}
@@ -0,0 +1,184 @@
+#define BOOST_TEST_MODULE resource_pressure
+#include <boost/test/included/unit_test.hpp>
+
+#include <fc/variant_object.hpp>
+
+#include <eosio/resource_monitor_plugin/resource_pressure_handler.hpp>
+
+using namespace eosio;
+using namespace eosio::resource_monitor;
+
+struct pressure_fixture {
+   // Serves /proc files and stat results from memory
+   struct fake_resource_provider {
+      fake_resource_provider(pressure_fixture& fixture)
+      :fixture(fixture)
+      {}
+
+      int get_stat(const char *path, struct stat *buf) const {
+         auto itr = fixture.devices.find(path);
+         if (itr == fixture.devices.end()) return -1;
+         buf->st_dev = itr->second;
+         return 0;
+      }
+
+      std::optional<std::string> read_file(const std::string& path) const {
+         auto itr = fixture.files.find(path);
+         if (itr == fixture.files.end()) return {};
+         return itr->second;
+      }
+
+      uint64_t page_size() const {
+         return 4096;
+      }
+
+      int open_pressure_trigger(const std::string& resource, uint32_t stall_us, uint32_t window_us) const {
+         return -1;
+      }
+
+      pressure_fixture& fixture;
+   };
+
+   boost::asio::io_context ctx;
+
+   using resource_pressure_handler_t = resource_pressure_handler<fake_resource_provider>;
+   pressure_fixture()
+   : pressure_handler(fake_resource_provider(*this), ctx)
+   {
+   }
+
+   void set_pressure(const std::string& resource, double avg10) {
+      files["/proc/pressure/" + resource] =
+         "some avg10=" + std::to_string(avg10) + " avg60=0.00 avg300=0.00 total=0\n"
+         "full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n";
+   }
+
+   void set_sectors_written(unsigned int maj, unsigned int min, uint64_t sectors) {
+      files["/proc/diskstats"] =
+         "   7       0 loop0 0 0 0 0 0 0 0 0 0 0 0\n"
+         "   " + std::to_string(maj) + "       " + std::to_string(min) + " sda1 100 0 800 10 50 0 " + std::to_string(sectors) + " 20 0 30 30\n";
+   }
+
+   std::map<std::string, std::string> files;
+   std::map<std::string, dev_t>       devices;
+   resource_pressure_handler_t        pressure_handler;
+};
+
+BOOST_AUTO_TEST_SUITE(resource_pressure_tests)
+
+   BOOST_FIXTURE_TEST_CASE(disabled_by_default, pressure_fixture)
+   {
+      BOOST_TEST(!pressure_handler.is_enabled());
+      BOOST_TEST(!pressure_handler.is_threshold_exceeded(fc::time_point::now()));
+   }
+
+   BOOST_FIXTURE_TEST_CASE(rss_threshold, pressure_fixture)
+   {
+      pressure_thresholds t;
+      t.rss_bytes = 100 * 4096;
+      pressure_handler.set_thresholds(t);
+      pressure_handler.set_action(pressure_action::pause_speculative);
+
+      files["/proc/self/statm"] = "500 100 10 1 0 50 0\n";
+      BOOST_TEST(!pressure_handler.is_threshold_exceeded(fc::time_point::now()));
+      BOOST_TEST(!pressure_handler.speculative_execution_paused());
+
+      files["/proc/self/statm"] = "500 101 10 1 0 50 0\n";
+      BOOST_TEST(pressure_handler.is_threshold_exceeded(fc::time_point::now()));
+      BOOST_TEST(pressure_handler.speculative_execution_paused());
+      BOOST_TEST(!pressure_handler.api_writes_rejected());
+
+      // lifted once below the threshold again
+      files["/proc/self/statm"] = "500 99 10 1 0 50 0\n";
+      BOOST_TEST(!pressure_handler.is_threshold_exceeded(fc::time_point::now()));
+      BOOST_TEST(!pressure_handler.speculative_execution_paused());
+   }
+
+   BOOST_FIXTURE_TEST_CASE(shared_memory_threshold, pressure_fixture)
+   {
+      pressure_thresholds t;
+      t.shared_memory_percent = 80;
+      pressure_handler.set_thresholds(t);
+      pressure_handler.set_action(pressure_action::reject_api_writes);
+
+      // not sampled yet
+      BOOST_TEST(!pressure_handler.is_threshold_exceeded(fc::time_point::now()));
+
+      pressure_handler.set_shared_memory_usage(79, 100);
+      BOOST_TEST(!pressure_handler.is_threshold_exceeded(fc::time_point::now()));
+
+      pressure_handler.set_shared_memory_usage(80, 100);
+      BOOST_TEST(pressure_handler.is_threshold_exceeded(fc::time_point::now()));
+      BOOST_TEST(pressure_handler.api_writes_rejected());
+      BOOST_TEST(!pressure_handler.speculative_execution_paused());
+   }
+
+   BOOST_FIXTURE_TEST_CASE(psi_threshold, pressure_fixture)
+   {
+      pressure_thresholds t;
+      t.memory_pressure_percent = 20;
+      t.io_pressure_percent = 40;
+      pressure_handler.set_thresholds(t);
+
+      // kernels without PSI
+      BOOST_TEST(!pressure_handler.is_threshold_exceeded(fc::time_point::now()));
+
+      set_pressure("memory", 19.99);
+      set_pressure("io", 39.5);
+      BOOST_TEST(!pressure_handler.is_threshold_exceeded(fc::time_point::now()));
+
+      set_pressure("io", 40.01);
+      BOOST_TEST(pressure_handler.is_threshold_exceeded(fc::time_point::now()));
+
+      set_pressure("io", 0);
+      set_pressure("memory", 25.0);
+      BOOST_TEST(pressure_handler.is_threshold_exceeded(fc::time_point::now()));
+
+      // warn only
+      BOOST_TEST(!pressure_handler.speculative_execution_paused());
+      BOOST_TEST(!pressure_handler.api_writes_rejected());
+   }
+
+   BOOST_FIXTURE_TEST_CASE(write_throughput_threshold, pressure_fixture)
+   {
+      devices["/data"] = makedev(8, 1);
+      devices["/tmp"] = makedev(0, 50); // tmpfs, not in diskstats
+
+      pressure_thresholds t;
+      t.write_bytes_per_sec = 1024 * 1024;
+      pressure_handler.set_thresholds(t);
+      pressure_handler.add_file_system("/data");
+      pressure_handler.add_file_system("/tmp");
+
+      const auto start = fc::time_point::now();
+      set_sectors_written(8, 1, 1000);
+      BOOST_TEST(!pressure_handler.is_threshold_exceeded(start)); // first sample
+
+      // 1 MiB in 1 second is at the threshold
+      set_sectors_written(8, 1, 1000 + 2048);
+      BOOST_TEST(!pressure_handler.is_threshold_exceeded(start + fc::seconds(1)));
+
+      // 4 MiB in 2 seconds
+      set_sectors_written(8, 1, 1000 + 2048 + 8192);
+      BOOST_TEST(pressure_handler.is_threshold_exceeded(start + fc::seconds(3)));
+   }
+
+   BOOST_FIXTURE_TEST_CASE(invalid_config, pressure_fixture)
+   {
+      pressure_thresholds t;
+      t.shared_memory_percent = 101;
+      BOOST_REQUIRE_THROW(pressure_handler.set_thresholds(t), chain::plugin_config_exception);
+
+      BOOST_REQUIRE_THROW(pressure_handler.add_file_system("/missing"), chain::plugin_config_exception);
+
+      pressure_action action;
+      std::istringstream in("pause-speculative");
+      in >> action;
+      BOOST_TEST(!in.fail());
+      BOOST_TEST((action == pressure_action::pause_speculative));
+      std::istringstream bad("pause");
+      bad >> action;
+      BOOST_TEST(bad.fail());
+   }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -9,12 +9,14 @@
 #include <boost/asio/bind_executor.hpp>
 #include <boost/asio/ip/host_name.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/websocket.hpp>
 #include <boost/signals2/connection.hpp>
 
 using tcp    = boost::asio::ip::tcp;
+using local  = boost::asio::local::stream_protocol;
 namespace ws = boost::beast::websocket;
 
 extern const char* const state_history_plugin_abi;
@@ -53,6 +55,8 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
    string                                                     endpoint_address = "0.0.0.0";
    uint16_t                                                   endpoint_port    = 8080;
    std::unique_ptr<tcp::acceptor>                             acceptor;
+   bfs::path                                                  unix_socket_path;
+   std::unique_ptr<local::acceptor>                           unix_acceptor;
 
    std::optional<chain::block_id_type> get_block_id(uint32_t block_num) {
       std::optional<chain::block_id_type> result;
@@ -75,23 +79,35 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
 
    using get_blocks_request = std::variant<get_blocks_request_v0, get_blocks_request_v1>;
 
-   struct session : std::enable_shared_from_this<session> {
+   struct session_base {
+      std::optional<get_blocks_request> current_request;
+
+      virtual ~session_base() = default;
+      virtual void send_update(const block_state_ptr& block_state) = 0;
+      virtual void close() = 0;
+   };
+
+   /// a websocket session over either a tcp connection or a local (unix domain) connection
+   template <typename SocketType>
+   struct session : session_base, std::enable_shared_from_this<session<SocketType>> {
       std::shared_ptr<state_history_plugin_impl> plugin;
-      std::unique_ptr<ws::stream<tcp::socket>>   socket_stream;
+      std::unique_ptr<ws::stream<SocketType>>    socket_stream;
       bool                                       sending  = false;
       bool                                       sent_abi = false;
       std::vector<std::vector<char>>             send_queue;
-      std::optional<get_blocks_request>          current_request;
       bool                                       need_to_send_update = false;
 
+      using std::enable_shared_from_this<session<SocketType>>::shared_from_this;
+
       session(std::shared_ptr<state_history_plugin_impl> plugin)
           : plugin(std::move(plugin)) {}
 
-      void start(tcp::socket socket) {
+      void start(SocketType socket) {
          fc_ilog(_log, "incoming connection");
-         socket_stream = std::make_unique<ws::stream<tcp::socket>>(std::move(socket));
+         socket_stream = std::make_unique<ws::stream<SocketType>>(std::move(socket));
          socket_stream->binary(true);
-         socket_stream->next_layer().set_option(boost::asio::ip::tcp::no_delay(true));
+         if constexpr (std::is_same_v<SocketType, tcp::socket>)
+            socket_stream->next_layer().set_option(boost::asio::ip::tcp::no_delay(true));
          socket_stream->next_layer().set_option(boost::asio::socket_base::send_buffer_size(1024 * 1024));
          socket_stream->next_layer().set_option(boost::asio::socket_base::receive_buffer_size(1024 * 1024));
          socket_stream->async_accept([self = shared_from_this()](boost::system::error_code ec) {
@@ -306,7 +322,7 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
              *current_request);
       }
 
-      void send_update(const block_state_ptr& block_state) {
+      void send_update(const block_state_ptr& block_state) override {
          need_to_send_update = true;
          if (!send_queue.empty() || !max_messages_in_flight())
             return;
@@ -360,12 +376,12 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
          }
       }
 
-      void close() {
+      void close() override {
          socket_stream->next_layer().close();
          plugin->sessions.erase(this);
       }
    };
-   std::map<session*, std::shared_ptr<session>> sessions;
+   std::map<session_base*, std::shared_ptr<session_base>> sessions;
 
    void listen() {
       boost::system::error_code ec;
@@ -388,25 +404,68 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       check_ec("bind");
       acceptor->listen(boost::asio::socket_base::max_listen_connections, ec);
       check_ec("listen");
-      do_accept();
+      do_accept(*acceptor);
+
+      if (!unix_socket_path.empty())
+         listen_unix();
    }
 
-   void do_accept() {
-      auto socket = std::make_shared<tcp::socket>(app().get_io_service());
-      acceptor->async_accept(*socket, [self = shared_from_this(), socket, this](const boost::system::error_code& ec) {
+   /// local replicas (e.g. rodeos on the same host) may connect over a unix socket, skipping the tcp stack
+   void listen_unix() {
+      boost::system::error_code ec;
+
+      auto check_ec = [&](const char* what) {
+         if (!ec)
+            return;
+         fc_elog(_log, "${w}: ${m}", ("w", what)("m", ec.message()));
+         EOS_ASSERT(false, plugin_exception, "unable to open unix socket ${p}", ("p", unix_socket_path.string()));
+      };
+
+      // a socket file left behind by an unclean shutdown would make bind fail; it is only removed when nothing
+      // accepts connections on it, so a second nodeos cannot take over the socket of a running one
+      auto endpoint = local::endpoint{unix_socket_path.string()};
+      auto status   = boost::filesystem::status(unix_socket_path, ec);
+      if (!ec && status.type() == boost::filesystem::socket_file) {
+         local::socket probe(app().get_io_service());
+         probe.connect(endpoint, ec);
+         if (!ec) {
+            probe.close(ec);
+            ec = boost::asio::error::address_in_use;
+            check_ec("connect");
+         }
+         boost::filesystem::remove(unix_socket_path, ec);
+         check_ec("remove");
+      }
+      ec.clear();
+      unix_acceptor = std::make_unique<local::acceptor>(app().get_io_service());
+      unix_acceptor->open(endpoint.protocol(), ec);
+      check_ec("open");
+      unix_acceptor->bind(endpoint, ec);
+      check_ec("bind");
+      unix_acceptor->listen(boost::asio::socket_base::max_listen_connections, ec);
+      check_ec("listen");
+      fc_ilog(_log, "listening on unix socket ${p}", ("p", unix_socket_path.string()));
+      do_accept(*unix_acceptor);
+   }
+
+   template <typename Acceptor>
+   void do_accept(Acceptor& a) {
+      using socket_type = typename Acceptor::protocol_type::socket;
+      auto socket = std::make_shared<socket_type>(app().get_io_service());
+      a.async_accept(*socket, [self = shared_from_this(), socket, &a, this](const boost::system::error_code& ec) {
          if (stopping)
             return;
          if (ec) {
             if (ec == boost::system::errc::too_many_files_open)
-               catch_and_log([&] { do_accept(); });
+               catch_and_log([&] { do_accept(a); });
             return;
          }
          catch_and_log([&] {
-            auto s            = std::make_shared<session>(self);
+            auto s            = std::make_shared<session<socket_type>>(self);
             sessions[s.get()] = s;
             s->start(std::move(*socket));
          });
-         catch_and_log([&] { do_accept(); });
+         catch_and_log([&] { do_accept(a); });
       });
    }
 
@@ -495,6 +554,9 @@ void state_history_plugin::set_program_options(options_description& cli, options
    options("state-history-endpoint", bpo::value<string>()->default_value("127.0.0.1:8080"),
            "the endpoint upon which to listen for incoming connections. Caution: only expose this port to "
            "your internal network.");
+   options("state-history-unix-socket-path", bpo::value<string>(),
+           "the path (relative to data-dir) to create a unix socket upon which to listen for incoming connections "
+           "from local state history consumers, in addition to state-history-endpoint.");
    options("trace-history-debug-mode", bpo::bool_switch()->default_value(false),
            "enable debug mode for trace history");
    options("context-free-data-compression", bpo::value<string>()->default_value("zlib"), 
@@ -541,6 +603,13 @@ void state_history_plugin::plugin_initialize(const variables_map& options) {
       my->endpoint_port    = std::stoi(port);
       idump((ip_port)(host)(port));
 
+      if (options.count("state-history-unix-socket-path") && !options.at("state-history-unix-socket-path").as<string>().empty()) {
+         bfs::path sock_path = options.at("state-history-unix-socket-path").as<string>();
+         if (sock_path.is_relative())
+            sock_path = app().data_dir() / sock_path;
+         my->unix_socket_path = sock_path;
+      }
+
       if (options.at("delete-state-history").as<bool>()) {
          fc_ilog(_log, "Deleting state history");
          boost::filesystem::remove_all(config.log_dir);
@@ -580,6 +649,11 @@ void state_history_plugin::plugin_shutdown() {
    while (!my->sessions.empty())
       my->sessions.begin()->second->close();
    my->stopping = true;
+   if (my->unix_acceptor) {
+      boost::system::error_code ec;
+      my->unix_acceptor->close(ec);
+      boost::filesystem::remove(my->unix_socket_path, ec);
+   }
 }
 
 void state_history_plugin::handle_sighup() {
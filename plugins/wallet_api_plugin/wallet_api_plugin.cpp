@@ -85,7 +85,10 @@ void wallet_api_plugin::plugin_startup() {
    // lifetime of plugin is lifetime of application
    auto& wallet_mgr = app().get_plugin<wallet_plugin>().get_wallet_manager();
 
-   app().get_plugin<http_plugin>().add_api({
+   // wallet_manager is thread safe, requests are handled on the http threads so that signing runs concurrently and
+   // unlocking a wallet does not hold up the other clients
+   auto& http = app().get_plugin<http_plugin>();
+   const api_description api{
        CALL_WITH_400(wallet, wallet_mgr, set_timeout,
             INVOKE_V_R(wallet_mgr, set_timeout, int64_t), 200),
        //  chain::chain_id_type has an inaccessible default constructor
@@ -115,7 +118,9 @@ void wallet_api_plugin::plugin_startup() {
             INVOKE_R_R_R(wallet_mgr, list_keys, std::string, std::string), 200),
        CALL_WITH_400(wallet, wallet_mgr, get_public_keys,
             INVOKE_R_V(wallet_mgr, get_public_keys), 200)
-   });
+   };
+   for (const auto& call : api)
+      http.add_async_handler(call.first, call.second);
 }
 
 void wallet_api_plugin::plugin_initialize(const variables_map& options) {
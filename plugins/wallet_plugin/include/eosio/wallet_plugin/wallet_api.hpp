@@ -98,6 +98,11 @@ class wallet_api
       /** Returns a signature given the digest and public_key, if this wallet can sign via that public key
        */
       virtual std::optional<signature_type> try_sign_digest( const digest_type digest, const public_key_type public_key ) = 0;
+
+      /** Keeps the session to a device holding the keys open, called periodically while the wallet is unlocked
+       *  and not used by anything else. May lock the wallet when the session is lost.
+       */
+      virtual void keepalive() {}
 };
 
 }}
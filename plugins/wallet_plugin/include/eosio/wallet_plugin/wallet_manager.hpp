@@ -2,9 +2,13 @@
 #include <eosio/chain/transaction.hpp>
 #include <eosio/wallet_plugin/wallet_api.hpp>
 #include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/interprocess/sync/file_lock.hpp>
+#include <atomic>
 #include <chrono>
+#include <mutex>
+#include <shared_mutex>
 
 namespace fc { class variant; }
 
@@ -15,6 +19,10 @@ namespace wallet {
 ///
 /// The name of the wallet is also used as part of the file name by soft_wallet. See wallet_manager::create.
 /// No const methods because timeout may cause lock_all() to be called.
+///
+/// Thread safe, the wallet API is served from the http threads. The public keys of the unlocked wallets are indexed so
+/// signing does not walk the wallets, and each wallet has its own mutex: unlocking or changing a wallet only waits for
+/// the requests using that wallet, and software wallets sign for any number of requests at once.
 class wallet_manager {
 public:
    wallet_manager();
@@ -131,10 +139,42 @@ private:
    void check_timeout();
 
 private:
+   struct managed_wallet {
+      managed_wallet(std::unique_ptr<wallet_api>&& w, bool concurrent_signing)
+         : wallet(std::move(w)), concurrent_signing(concurrent_signing), unlocked(!wallet->is_locked()) {}
+
+      const std::unique_ptr<wallet_api> wallet;
+      const bool                        concurrent_signing; ///< try_sign_digest may run on several threads at once
+      std::shared_mutex                 mtx;                ///< exclusive to change the wallet, shared to sign with it
+      std::atomic<bool>                 unlocked;           ///< updated under mtx, read without it
+      flat_set<public_key_type>         indexed_keys;       ///< keys of the wallet in key_index, guarded by wallets_mtx
+   };
+   using managed_wallet_ptr = std::shared_ptr<managed_wallet>;
+
+   /// @throws wallet_nonexistent_exception if wallet with name not found
+   managed_wallet_ptr find_wallet(const std::string& name) const;
+   std::vector<std::pair<std::string, managed_wallet_ptr>> all_wallets() const;
+   /// Adds or replaces the wallet with name and indexes its keys if it is unlocked, w is not shared yet
+   void add_wallet(const std::string& name, managed_wallet_ptr w);
+   /// Indexes the current keys of w, the caller holds w->mtx exclusively
+   void index_keys(const std::string& name, const managed_wallet_ptr& w);
+   /// Caller holds wallets_mtx exclusively
+   void unindex_keys(const std::string& name, managed_wallet& w);
+   std::optional<signature_type> try_sign_digest(const chain::digest_type& digest, const public_key_type& key);
+   /// Calls keepalive of w under its exclusive lock every keepalive_interval, until w is no longer managed
+   void start_keepalive(const std::string& name, const std::weak_ptr<managed_wallet>& w,
+                        std::shared_ptr<boost::asio::steady_timer> t);
+   static constexpr std::chrono::seconds keepalive_interval{20};
+
    using timepoint_t = std::chrono::time_point<std::chrono::system_clock>;
-   std::map<std::string, std::unique_ptr<wallet_api>> wallets;
+   // lock order: a wallet's mtx may be held when taking wallets_mtx, never the other way around
+   mutable std::shared_mutex wallets_mtx;
+   std::map<std::string, managed_wallet_ptr> wallets;
+   std::map<std::pair<public_key_type, std::string>, managed_wallet_ptr> key_index; ///< key and wallet name, unlocked wallets only
+   std::mutex wallet_files_mtx; ///< serializes create and open of wallet files
+   std::mutex timeout_mtx;
    std::chrono::seconds timeout = std::chrono::seconds::max(); ///< how long to wait before calling lock_all()
-   mutable timepoint_t timeout_time = timepoint_t::max(); ///< when to call lock_all()
+   timepoint_t timeout_time = timepoint_t::max(); ///< when to call lock_all()
    boost::filesystem::path dir = ".";
    boost::filesystem::path lock_path = dir / "wallet.lock";
    std::unique_ptr<boost::interprocess::file_lock> wallet_dir_lock;
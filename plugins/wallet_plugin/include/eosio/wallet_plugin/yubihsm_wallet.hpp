@@ -34,6 +34,8 @@ class yubihsm_wallet final : public wallet_api {
 
       std::optional<signature_type> try_sign_digest(const digest_type digest, const public_key_type public_key) override;
 
+      void keepalive() override;
+
    private:
       std::unique_ptr<detail::yubihsm_wallet_impl> my;
 };
@@ -4,6 +4,7 @@
 #include <eosio/wallet_plugin/se_wallet.hpp>
 #include <eosio/chain/exceptions.hpp>
 #include <boost/algorithm/string.hpp>
+#include <algorithm>
 namespace eosio {
 namespace wallet {
 
@@ -25,7 +26,7 @@ bool valid_filename(const string& name) {
 wallet_manager::wallet_manager() {
 #ifdef __APPLE__
    try {
-      wallets.emplace("SecureEnclave", std::make_unique<se_wallet>());
+      wallets.emplace("SecureEnclave", std::make_shared<managed_wallet>(std::make_unique<se_wallet>(), false));
    } catch(const std::exception& ) {}
 #endif
 }
@@ -37,6 +38,7 @@ wallet_manager::~wallet_manager() {
 }
 
 void wallet_manager::set_timeout(const std::chrono::seconds& t) {
+   std::lock_guard g(timeout_mtx);
    timeout = t;
    auto now = std::chrono::system_clock::now();
    timeout_time = now + timeout;
@@ -45,13 +47,77 @@ void wallet_manager::set_timeout(const std::chrono::seconds& t) {
 }
 
 void wallet_manager::check_timeout() {
-   if (timeout_time != timepoint_t::max()) {
-      const auto& now = std::chrono::system_clock::now();
-      if (now >= timeout_time) {
-         lock_all();
+   bool timed_out = false;
+   {
+      std::lock_guard g(timeout_mtx);
+      if (timeout_time != timepoint_t::max()) {
+         const auto& now = std::chrono::system_clock::now();
+         timed_out = now >= timeout_time;
+         timeout_time = now + timeout;
+      }
+   }
+   if (timed_out) {
+      lock_all();
+   }
+}
+
+wallet_manager::managed_wallet_ptr wallet_manager::find_wallet(const std::string& name) const {
+   std::shared_lock g(wallets_mtx);
+   auto it = wallets.find(name);
+   if (it == wallets.end()) {
+      EOS_THROW(chain::wallet_nonexistent_exception, "Wallet not found: ${w}", ("w", name));
+   }
+   return it->second;
+}
+
+std::vector<std::pair<std::string, wallet_manager::managed_wallet_ptr>> wallet_manager::all_wallets() const {
+   std::shared_lock g(wallets_mtx);
+   return {wallets.begin(), wallets.end()};
+}
+
+void wallet_manager::add_wallet(const std::string& name, managed_wallet_ptr w) {
+   std::unique_lock wg(w->mtx);
+   {
+      std::unique_lock g(wallets_mtx);
+      // If we have name in our map then remove it since we want the emplace below to replace.
+      // This can happen if the wallet file is removed or added while eos-walletd is running.
+      auto it = wallets.find(name);
+      if (it != wallets.end()) {
+         unindex_keys(name, *it->second);
+         wallets.erase(it);
       }
-      timeout_time = now + timeout;
+      wallets.emplace(name, w);
    }
+   index_keys(name, w);
+}
+
+void wallet_manager::index_keys(const std::string& name, const managed_wallet_ptr& w) {
+   flat_set<public_key_type> keys;
+   if (!w->wallet->is_locked()) {
+      keys = w->wallet->list_public_keys();
+   }
+   w->unlocked = !w->wallet->is_locked();
+
+   std::unique_lock g(wallets_mtx);
+   unindex_keys(name, *w);
+   auto it = wallets.find(name);
+   if (it == wallets.end() || it->second != w) {
+      return; // replaced while it was being changed
+   }
+   for (const auto& k : keys) {
+      key_index.emplace(std::make_pair(k, name), w);
+   }
+   w->indexed_keys = std::move(keys);
+}
+
+void wallet_manager::unindex_keys(const std::string& name, managed_wallet& w) {
+   for (const auto& k : w.indexed_keys) {
+      auto it = key_index.find(std::make_pair(k, name));
+      if (it != key_index.end() && it->second.get() == &w) {
+         key_index.erase(it);
+      }
+   }
+   w.indexed_keys.clear();
 }
 
 std::string wallet_manager::create(const std::string& name) {
@@ -61,6 +127,7 @@ std::string wallet_manager::create(const std::string& name) {
 
    auto wallet_filename = dir / (name + file_ext);
 
+   std::lock_guard g(wallet_files_mtx);
    if (fc::exists(wallet_filename)) {
       EOS_THROW(chain::wallet_exist_exception, "Wallet with name: '${n}' already exists at ${path}", ("n", name)("path",fc::path(wallet_filename)));
    }
@@ -77,13 +144,7 @@ std::string wallet_manager::create(const std::string& name) {
    // Explicitly save the wallet file here, to ensure it now exists.
    wallet->save_wallet_file();
 
-   // If we have name in our map then remove it since we want the emplace below to replace.
-   // This can happen if the wallet file is removed while eos-walletd is running.
-   auto it = wallets.find(name);
-   if (it != wallets.end()) {
-      wallets.erase(it);
-   }
-   wallets.emplace(name, std::move(wallet));
+   add_wallet(name, std::make_shared<managed_wallet>(std::move(wallet), true));
 
    return password;
 }
@@ -97,24 +158,19 @@ void wallet_manager::open(const std::string& name) {
    auto wallet = std::make_unique<soft_wallet>(d);
    auto wallet_filename = dir / (name + file_ext);
    wallet->set_wallet_filename(wallet_filename.string());
+   std::lock_guard g(wallet_files_mtx);
    if (!wallet->load_wallet_file()) {
       EOS_THROW(chain::wallet_nonexistent_exception, "Unable to open file: ${f}", ("f", wallet_filename.string()));
    }
 
-   // If we have name in our map then remove it since we want the emplace below to replace.
-   // This can happen if the wallet file is added while eos-walletd is running.
-   auto it = wallets.find(name);
-   if (it != wallets.end()) {
-      wallets.erase(it);
-   }
-   wallets.emplace(name, std::move(wallet));
+   add_wallet(name, std::make_shared<managed_wallet>(std::move(wallet), true));
 }
 
 std::vector<std::string> wallet_manager::list_wallets() {
    check_timeout();
    std::vector<std::string> result;
-   for (const auto& i : wallets) {
-      if (i.second->is_locked()) {
+   for (const auto& i : all_wallets()) {
+      if (!i.second->unlocked) {
          result.emplace_back(i.first);
       } else {
          result.emplace_back(i.first + " *");
@@ -126,124 +182,158 @@ std::vector<std::string> wallet_manager::list_wallets() {
 map<public_key_type,private_key_type> wallet_manager::list_keys(const string& name, const string& pw) {
    check_timeout();
 
-   if (wallets.count(name) == 0)
-      EOS_THROW(chain::wallet_nonexistent_exception, "Wallet not found: ${w}", ("w", name));
-   auto& w = wallets.at(name);
-   if (w->is_locked())
+   auto w = find_wallet(name);
+   std::unique_lock g(w->mtx);
+   if (w->wallet->is_locked())
       EOS_THROW(chain::wallet_locked_exception, "Wallet is locked: ${w}", ("w", name));
-   w->check_password(pw); //throws if bad password
-   return w->list_keys();
+   w->wallet->check_password(pw); //throws if bad password
+   return w->wallet->list_keys();
 }
 
 flat_set<public_key_type> wallet_manager::get_public_keys() {
    check_timeout();
+   std::shared_lock g(wallets_mtx);
    EOS_ASSERT(!wallets.empty(), wallet_not_available_exception, "You don't have any wallet!");
+   bool is_all_wallet_locked = std::none_of(wallets.begin(), wallets.end(), [](const auto& i) { return i.second->unlocked.load(); });
+   EOS_ASSERT(!is_all_wallet_locked, wallet_locked_exception, "You don't have any unlocked wallet!");
    flat_set<public_key_type> result;
-   bool is_all_wallet_locked = true;
-   for (const auto& i : wallets) {
-      if (!i.second->is_locked()) {
-         result.merge(i.second->list_public_keys());
-      }
-      is_all_wallet_locked &= i.second->is_locked();
+   for (const auto& i : key_index) {
+      result.insert(result.end(), i.first.first);
    }
-   EOS_ASSERT(!is_all_wallet_locked, wallet_locked_exception, "You don't have any unlocked wallet!");
    return result;
 }
 
 
 void wallet_manager::lock_all() {
    // no call to check_timeout since we are locking all anyway
-   for (auto& i : wallets) {
-      if (!i.second->is_locked()) {
-         i.second->lock();
+   for (auto& i : all_wallets()) {
+      std::unique_lock g(i.second->mtx);
+      if (!i.second->wallet->is_locked()) {
+         i.second->wallet->lock();
+         index_keys(i.first, i.second);
       }
    }
 }
 
 void wallet_manager::lock(const std::string& name) {
    check_timeout();
-   if (wallets.count(name) == 0) {
-      EOS_THROW(chain::wallet_nonexistent_exception, "Wallet not found: ${w}", ("w", name));
-   }
-   auto& w = wallets.at(name);
-   if (w->is_locked()) {
+   auto w = find_wallet(name);
+   std::unique_lock g(w->mtx);
+   if (w->wallet->is_locked()) {
       return;
    }
-   w->lock();
+   w->wallet->lock();
+   index_keys(name, w);
 }
 
 void wallet_manager::unlock(const std::string& name, const std::string& password) {
    check_timeout();
-   if (wallets.count(name) == 0) {
-      open( name );
+   {
+      std::shared_lock g(wallets_mtx);
+      if (wallets.count(name) == 0) {
+         g.unlock();
+         open( name );
+      }
    }
-   auto& w = wallets.at(name);
-   if (!w->is_locked()) {
+   // only requests using this wallet wait for the password hashing and decryption of its keys
+   auto w = find_wallet(name);
+   std::unique_lock g(w->mtx);
+   if (!w->wallet->is_locked()) {
       EOS_THROW(chain::wallet_unlocked_exception, "Wallet is already unlocked: ${w}", ("w", name));
       return;
    }
-   w->unlock(password);
+   w->wallet->unlock(password);
+   index_keys(name, w);
 }
 
 void wallet_manager::import_key(const std::string& name, const std::string& wif_key) {
    check_timeout();
-   if (wallets.count(name) == 0) {
-      EOS_THROW(chain::wallet_nonexistent_exception, "Wallet not found: ${w}", ("w", name));
-   }
-   auto& w = wallets.at(name);
-   if (w->is_locked()) {
+   auto w = find_wallet(name);
+   std::unique_lock g(w->mtx);
+   if (w->wallet->is_locked()) {
       EOS_THROW(chain::wallet_locked_exception, "Wallet is locked: ${w}", ("w", name));
    }
-   w->import_key(wif_key);
+   w->wallet->import_key(wif_key);
+   index_keys(name, w);
 }
 
 void wallet_manager::remove_key(const std::string& name, const std::string& password, const std::string& key) {
    check_timeout();
-   if (wallets.count(name) == 0) {
-      EOS_THROW(chain::wallet_nonexistent_exception, "Wallet not found: ${w}", ("w", name));
-   }
-   auto& w = wallets.at(name);
-   if (w->is_locked()) {
+   auto w = find_wallet(name);
+   std::unique_lock g(w->mtx);
+   if (w->wallet->is_locked()) {
       EOS_THROW(chain::wallet_locked_exception, "Wallet is locked: ${w}", ("w", name));
    }
-   w->check_password(password); //throws if bad password
-   w->remove_key(key);
+   w->wallet->check_password(password); //throws if bad password
+   w->wallet->remove_key(key);
+   index_keys(name, w);
 }
 
 string wallet_manager::create_key(const std::string& name, const std::string& key_type) {
    check_timeout();
-   if (wallets.count(name) == 0) {
-      EOS_THROW(chain::wallet_nonexistent_exception, "Wallet not found: ${w}", ("w", name));
-   }
-   auto& w = wallets.at(name);
-   if (w->is_locked()) {
+   auto w = find_wallet(name);
+   std::unique_lock g(w->mtx);
+   if (w->wallet->is_locked()) {
       EOS_THROW(chain::wallet_locked_exception, "Wallet is locked: ${w}", ("w", name));
    }
 
    string upper_key_type = boost::to_upper_copy<std::string>(key_type);
-   return w->create_key(upper_key_type);
+   try {
+      auto key = w->wallet->create_key(upper_key_type);
+      index_keys(name, w);
+      return key;
+   } catch (...) {
+      // a hardware wallet locks itself when the device fails
+      index_keys(name, w);
+      throw;
+   }
+}
+
+std::optional<signature_type> wallet_manager::try_sign_digest(const chain::digest_type& digest, const public_key_type& key) {
+   // wallets holding key, in name order
+   std::vector<std::pair<std::string, managed_wallet_ptr>> candidates;
+   {
+      std::shared_lock g(wallets_mtx);
+      for (auto it = key_index.lower_bound(std::make_pair(key, std::string())); it != key_index.end() && it->first.first == key; ++it) {
+         candidates.emplace_back(it->first.second, it->second);
+      }
+   }
+   for (const auto& [name, w] : candidates) {
+      std::optional<signature_type> sig;
+      if (w->concurrent_signing) {
+         std::shared_lock g(w->mtx);
+         if (!w->wallet->is_locked())
+            sig = w->wallet->try_sign_digest(digest, key);
+      } else {
+         std::unique_lock g(w->mtx);
+         if (!w->wallet->is_locked()) {
+            try {
+               sig = w->wallet->try_sign_digest(digest, key);
+            } catch (...) {
+               // a hardware wallet locks itself when the device fails, its keys leave the index with it
+               index_keys(name, w);
+               throw;
+            }
+         }
+      }
+      if (sig)
+         return sig;
+   }
+   return {};
 }
 
 chain::signed_transaction
 wallet_manager::sign_transaction(const chain::signed_transaction& txn, const flat_set<public_key_type>& keys, const chain::chain_id_type& id) {
    check_timeout();
    chain::signed_transaction stxn(txn);
+   const auto digest = stxn.sig_digest(id, stxn.context_free_data);
 
    for (const auto& pk : keys) {
-      bool found = false;
-      for (const auto& i : wallets) {
-         if (!i.second->is_locked()) {
-            std::optional<signature_type> sig = i.second->try_sign_digest(stxn.sig_digest(id, stxn.context_free_data), pk);
-            if (sig) {
-               stxn.signatures.push_back(*sig);
-               found = true;
-               break; // inner for
-            }
-         }
-      }
-      if (!found) {
+      std::optional<signature_type> sig = try_sign_digest(digest, pk);
+      if (!sig) {
          EOS_THROW(chain::wallet_missing_pub_key_exception, "Public key not found in unlocked wallets ${k}", ("k", pk));
       }
+      stxn.signatures.push_back(*sig);
    }
 
    return stxn;
@@ -254,22 +344,46 @@ wallet_manager::sign_digest(const chain::digest_type& digest, const public_key_t
    check_timeout();
 
    try {
-      for (const auto& i : wallets) {
-         if (!i.second->is_locked()) {
-            std::optional<signature_type> sig = i.second->try_sign_digest(digest, key);
-            if (sig)
-               return *sig;
-         }
-      }
+      std::optional<signature_type> sig = try_sign_digest(digest, key);
+      if (sig)
+         return *sig;
    } FC_LOG_AND_RETHROW();
 
    EOS_THROW(chain::wallet_missing_pub_key_exception, "Public key not found in unlocked wallets ${k}", ("k", key));
 }
 
 void wallet_manager::own_and_use_wallet(const string& name, std::unique_ptr<wallet_api>&& wallet) {
-   if(wallets.find(name) != wallets.end())
-      EOS_THROW(wallet_exception, "Tried to use wallet name that already exists.");
-   wallets.emplace(name, std::move(wallet));
+   {
+      std::shared_lock g(wallets_mtx);
+      if(wallets.find(name) != wallets.end())
+         EOS_THROW(wallet_exception, "Tried to use wallet name that already exists.");
+   }
+   // hardware wallets sign one request at a time
+   auto w = std::make_shared<managed_wallet>(std::move(wallet), false);
+   add_wallet(name, w);
+   start_keepalive(name, w, std::make_shared<boost::asio::steady_timer>(appbase::app().get_io_service()));
+}
+
+void wallet_manager::start_keepalive(const std::string& name, const std::weak_ptr<managed_wallet>& weak_w,
+                                     std::shared_ptr<boost::asio::steady_timer> t)
+{
+   t->expires_after(keepalive_interval);
+   t->async_wait([t, this, name, weak_w](const boost::system::error_code& ec)
+   {
+      auto w = weak_w.lock();
+      if(ec || !w)
+         return;
+      {
+         // the session is not used by a request signing at the same time
+         std::unique_lock g(w->mtx);
+         if(!w->wallet->is_locked()) {
+            w->wallet->keepalive();
+            if(w->wallet->is_locked())
+               index_keys(name, w);
+         }
+      }
+      start_keepalive(name, weak_w, t);
+   });
 }
 
 void wallet_manager::start_lock_watch(std::shared_ptr<boost::asio::deadline_timer> t)
@@ -30,8 +30,6 @@ struct yubihsm_wallet_impl {
       lock();
       yh_exit();
       //bizarre, is there no way to destroy a yh_connector??
-
-      ///XXX Probably a race condition on timer shutdown and appbase destruction
    }
 
    bool is_locked() const {
@@ -97,8 +95,6 @@ struct yubihsm_wallet_impl {
          lock();
          throw;
       }
-
-      prime_keepalive_timer();
    }
 
    void lock() {
@@ -114,23 +110,18 @@ struct yubihsm_wallet_impl {
       connector = nullptr;
 
       _keys.clear();
-      keepalive_timer.cancel();
    }
 
-   void prime_keepalive_timer() {
-      keepalive_timer.expires_at(std::chrono::steady_clock::now() + std::chrono::seconds(20));
-      keepalive_timer.async_wait([this](const boost::system::error_code& ec){
-         if(ec || !session)
-            return;
-
-         uint8_t data, resp;
-         yh_cmd resp_cmd;
-         size_t resp_sz = 1;
-         if(yh_send_secure_msg(session, YHC_ECHO, &data, 1, &resp_cmd, &resp, &resp_sz))
-            lock();
-         else
-            prime_keepalive_timer();
-      });
+   // wallet_manager calls this periodically under the wallet's exclusive lock, so no request signs meanwhile
+   void keepalive() {
+      if(!session)
+         return;
+
+      uint8_t data, resp;
+      yh_cmd resp_cmd;
+      size_t resp_sz = 1;
+      if(yh_send_secure_msg(session, YHC_ECHO, &data, 1, &resp_cmd, &resp, &resp_sz))
+         lock();
    }
 
    std::optional<signature_type> try_sign_digest(const digest_type d, const public_key_type public_key) {
@@ -202,7 +193,6 @@ struct yubihsm_wallet_impl {
    yh_capabilities authkey_caps;
    uint16_t authkey_domains;
 
-   boost::asio::steady_timer keepalive_timer{appbase::app().get_io_service()};
    fc::ec_key key = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
 };
 
@@ -265,4 +255,8 @@ std::optional<signature_type> yubihsm_wallet::try_sign_digest(const digest_type
    return my->try_sign_digest(digest, public_key);
 }
 
+void yubihsm_wallet::keepalive() {
+   my->keepalive();
+}
+
 }}
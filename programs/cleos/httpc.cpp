@@ -10,7 +10,11 @@
 
 #include <iostream>
 #include <istream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <ostream>
+#include <sstream>
 #include <string>
 #include <regex>
 #include <boost/algorithm/string.hpp>
@@ -30,9 +34,44 @@ using namespace eosio::chain;
 namespace eosio { namespace client { namespace http {
 
    namespace detail {
+      using unix_socket = boost::asio::local::stream_protocol::socket;
+      using ssl_socket  = boost::asio::ssl::stream<tcp::socket>;
+
+      // An open connection to a server, only one of the sockets is set depending on the url scheme.
+      struct http_connection {
+         std::unique_ptr<boost::asio::ssl::context> ssl_context; // declared first, must outlive ssl_sock
+         std::unique_ptr<unix_socket>               unix_sock;
+         std::unique_ptr<tcp::socket>               tcp_sock;
+         std::unique_ptr<ssl_socket>                ssl_sock;
+      };
+
       class http_context_impl {
          public:
             boost::asio::io_service ios;
+
+            // connections whose last response allowed keep-alive, waiting to be reused for the same server
+            std::unique_ptr<http_connection> acquire_idle_connection(const string& key) {
+               std::lock_guard<std::mutex> g(idle_mtx);
+               auto itr = idle_connections.find(key);
+               if (itr == idle_connections.end() || itr->second.empty())
+                  return {};
+               auto conn = std::move(itr->second.back());
+               itr->second.pop_back();
+               return conn;
+            }
+
+            void release_idle_connection(const string& key, std::unique_ptr<http_connection>&& conn) {
+               std::lock_guard<std::mutex> g(idle_mtx);
+               auto& conns = idle_connections[key];
+               if (conns.size() < max_idle_connections_per_server)
+                  conns.emplace_back(std::move(conn));
+            }
+
+         private:
+            static constexpr size_t max_idle_connections_per_server = 64;
+
+            std::mutex                                                    idle_mtx;
+            std::map<string, std::vector<std::unique_ptr<http_connection>>> idle_connections;
       };
 
       void http_context_deleter::operator()(http_context_impl* p) const {
@@ -52,12 +91,21 @@ namespace eosio { namespace client { namespace http {
          endpoints.emplace_back(boost::asio::ip::make_address(addr), url.resolved_port);
       }
       boost::asio::connect(sock, endpoints);
+      // requests are written in one go, there is nothing for Nagle to coalesce on a kept alive connection
+      sock.set_option(tcp::no_delay(true));
    }
 
+   // keep_alive is set if the connection can carry another request once the response is read,
+   // bytes_written to the number of bytes of the request written to the connection, also when writing fails
    template<class T>
-   std::string do_txrx(T& socket, boost::asio::streambuf& request_buff, unsigned int& status_code) {
+   std::string do_txrx(T& socket, const std::string& request, unsigned int& status_code, bool& keep_alive, size_t& bytes_written) {
+      keep_alive = false;
+
       // Send the request.
-      boost::asio::write(socket, request_buff);
+      boost::system::error_code ec;
+      bytes_written = boost::asio::write(socket, boost::asio::buffer(request), ec);
+      if (ec)
+         throw boost::system::system_error(ec);
 
       // Read the response status line. The response streambuf will automatically
       // grow to accommodate the entire line. The growth may be limited by passing
@@ -81,11 +129,16 @@ namespace eosio { namespace client { namespace http {
       // Process the response headers.
       std::string header;
       int response_content_length = -1;
+      // HTTP/1.1 connections persist unless the server says otherwise, HTTP/1.0 ones only if it asks for it
+      keep_alive = http_version != "HTTP/1.0";
       std::regex clregex(R"xx(^content-length:\s+(\d+))xx", std::regex_constants::icase);
+      std::regex connregex(R"xx(^connection:\s+(close|keep-alive))xx", std::regex_constants::icase);
       while (std::getline(response_stream, header) && header != "\r") {
          std::smatch match;
          if(std::regex_search(header, match, clregex))
             response_content_length = std::stoi(match[1]);
+         else if(std::regex_search(header, match, connregex))
+            keep_alive = boost::iequals(match.str(1), "keep-alive");
       }
 
       // Attempt to read the response body using the length indicated by the
@@ -95,7 +148,8 @@ namespace eosio { namespace client { namespace http {
          if( response_content_length > 0 )
             boost::asio::read(socket, response, boost::asio::transfer_exactly(response_content_length));
       } else {
-         boost::system::error_code ec;
+         // the end of the body is only known by the server closing the connection
+         keep_alive = false;
          boost::asio::read(socket, response, boost::asio::transfer_all(), ec);
          EOS_ASSERT(!ec || ec == boost::asio::ssl::error::stream_truncated, http_exception, "Unable to read http response: ${err}", ("err",ec.message()));
       }
@@ -181,6 +235,78 @@ namespace eosio { namespace client { namespace http {
       }
    }
 
+   string connection_pool_key(const connection_param& cp) {
+      const auto& url = cp.url;
+      if (url.scheme == "unix")
+         return url.scheme + "://" + url.server;
+      return url.scheme + "://" + url.server + ":" + url.port + (url.scheme == "https" && !cp.verify_cert ? "#no-verify" : "");
+   }
+
+   std::unique_ptr<detail::http_connection> open_connection(const connection_param& cp) {
+      const auto& url = cp.url;
+      auto conn = std::make_unique<detail::http_connection>();
+      if(url.scheme == "unix") {
+         conn->unix_sock = std::make_unique<detail::unix_socket>(cp.context->ios);
+         conn->unix_sock->connect(boost::asio::local::stream_protocol::endpoint(url.server));
+      }
+      else if(url.scheme == "http") {
+         conn->tcp_sock = std::make_unique<tcp::socket>(cp.context->ios);
+         do_connect(*conn->tcp_sock, url);
+      }
+      else { //https
+         conn->ssl_context = std::make_unique<boost::asio::ssl::context>(boost::asio::ssl::context::sslv23_client);
+         fc::add_platform_root_cas_to_context(*conn->ssl_context);
+
+         conn->ssl_sock = std::make_unique<detail::ssl_socket>(cp.context->ios, *conn->ssl_context);
+         auto& socket = *conn->ssl_sock;
+         SSL_set_tlsext_host_name(socket.native_handle(), url.server.c_str());
+         if(cp.verify_cert) {
+            socket.set_verify_mode(boost::asio::ssl::verify_peer);
+            socket.set_verify_callback(boost::asio::ssl::rfc2818_verification(url.server));
+         }
+         do_connect(socket.next_layer(), url);
+         socket.handshake(boost::asio::ssl::stream_base::client);
+      }
+      return conn;
+   }
+
+   std::string do_txrx(detail::http_connection& conn, const std::string& request, unsigned int& status_code, bool& keep_alive, size_t& bytes_written) {
+      if(conn.unix_sock)
+         return do_txrx(*conn.unix_sock, request, status_code, keep_alive, bytes_written);
+      if(conn.tcp_sock)
+         return do_txrx(*conn.tcp_sock, request, status_code, keep_alive, bytes_written);
+      return do_txrx(*conn.ssl_sock, request, status_code, keep_alive, bytes_written);
+   }
+
+   // an idle connection has nothing to read; end of stream, an error or unexpected data (e.g. a TLS close_notify)
+   // mean that the server closed it or is about to
+   template<class S>
+   bool is_idle_connection_open(S& sock) {
+      boost::system::error_code ec, blocking_ec;
+      sock.non_blocking(true, ec);
+      if (ec)
+         return false;
+      char c;
+      sock.receive(boost::asio::buffer(&c, 1), boost::asio::socket_base::message_peek, ec);
+      sock.non_blocking(false, blocking_ec);
+      return ec == boost::asio::error::would_block && !blocking_ec;
+   }
+
+   bool is_idle_connection_open(detail::http_connection& conn) {
+      if(conn.unix_sock)
+         return is_idle_connection_open(*conn.unix_sock);
+      if(conn.tcp_sock)
+         return is_idle_connection_open(*conn.tcp_sock);
+      return is_idle_connection_open(conn.ssl_sock->next_layer());
+   }
+
+   void close_connection(detail::http_connection& conn) {
+      if(conn.ssl_sock) {
+         //try and do a clean shutdown; but swallow if this fails (other side could have already gave TCP the ax)
+         try {conn.ssl_sock->shutdown();} catch(...) {}
+      }
+   }
+
    fc::variant do_http_call( const connection_param& cp,
                              const fc::variant& postdata,
                              bool print_request,
@@ -192,14 +318,13 @@ namespace eosio { namespace client { namespace http {
 
    const auto& url = cp.url;
 
-   boost::asio::streambuf request;
-   std::ostream request_stream(&request);
+   std::ostringstream request_stream;
    auto host_header_value = format_host_header(url);
    request_stream << "POST " << url.path << " HTTP/1.1\r\n";
    request_stream << "Host: " << host_header_value << "\r\n";
    request_stream << "content-length: " << postjson.size() << "\r\n";
    request_stream << "Accept: */*\r\n";
-   request_stream << "Connection: close\r\n";
+   request_stream << "Connection: keep-alive\r\n";
    // append more customized headers
    std::vector<string>::iterator itr;
    for (itr = cp.headers.begin(); itr != cp.headers.end(); itr++) {
@@ -207,13 +332,12 @@ namespace eosio { namespace client { namespace http {
    }
    request_stream << "\r\n";
    request_stream << postjson;
+   const std::string request = request_stream.str();
 
    if ( print_request ) {
-      string s(request.size(), '\0');
-      buffer_copy(boost::asio::buffer(s), request.data());
       std::cerr << "REQUEST:" << std::endl
                 << "---------------------" << std::endl
-                << s << std::endl
+                << request << std::endl
                 << "---------------------" << std::endl;
    }
 
@@ -221,32 +345,32 @@ namespace eosio { namespace client { namespace http {
    std::string re;
 
    try {
-      if(url.scheme == "unix") {
-         boost::asio::local::stream_protocol::socket unix_socket(cp.context->ios);
-         unix_socket.connect(boost::asio::local::stream_protocol::endpoint(url.server));
-         re = do_txrx(unix_socket, request, status_code);
-      }
-      else if(url.scheme == "http") {
-         tcp::socket socket(cp.context->ios);
-         do_connect(socket, url);
-         re = do_txrx(socket, request, status_code);
-      }
-      else { //https
-         boost::asio::ssl::context ssl_context(boost::asio::ssl::context::sslv23_client);
-         fc::add_platform_root_cas_to_context(ssl_context);
-
-         boost::asio::ssl::stream<boost::asio::ip::tcp::socket> socket(cp.context->ios, ssl_context);
-         SSL_set_tlsext_host_name(socket.native_handle(), url.server.c_str());
-         if(cp.verify_cert) {
-            socket.set_verify_mode(boost::asio::ssl::verify_peer);
-            socket.set_verify_callback(boost::asio::ssl::rfc2818_verification(url.server));
+      const auto pool_key = connection_pool_key(cp);
+      bool keep_alive = false;
+      size_t bytes_written = 0;
+      // idle connections the server closed in the meantime are dropped before anything is written to them
+      auto conn = cp.context->acquire_idle_connection(pool_key);
+      while(conn && !is_idle_connection_open(*conn))
+         conn = cp.context->acquire_idle_connection(pool_key);
+      if(conn) {
+         try {
+            re = do_txrx(*conn, request, status_code, keep_alive, bytes_written);
+         } catch( const std::exception& ) {
+            // the request is only sent again on a new connection if none of it was written, once any of it was the
+            // server may have processed it
+            if(bytes_written)
+               throw;
+            conn.reset();
          }
-         do_connect(socket.next_layer(), url);
-         socket.handshake(boost::asio::ssl::stream_base::client);
-         re = do_txrx(socket, request, status_code);
-         //try and do a clean shutdown; but swallow if this fails (other side could have already gave TCP the ax)
-         try {socket.shutdown();} catch(...) {}
       }
+      if(!conn) {
+         conn = open_connection(cp);
+         re = do_txrx(*conn, request, status_code, keep_alive, bytes_written);
+      }
+      if(keep_alive)
+         cp.context->release_idle_connection(pool_key, std::move(conn));
+      else
+         close_connection(*conn);
    } catch ( invalid_http_request& e ) {
       e.append_log( FC_LOG_MESSAGE( info, "Please verify this url is valid: ${url}", ("url", url.scheme + "://" + url.server + ":" + url.port + url.path) ) );
       e.append_log( FC_LOG_MESSAGE( info, "If the condition persists, please contact the RPC server administrator for ${server}!", ("server", url.server) ) );
@@ -65,10 +65,16 @@ Options:
 */
 
 #include <pwd.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <regex>
 #include <iostream>
+#include <fstream>
 #include <fc/crypto/hex.hpp>
 #include <fc/variant.hpp>
 #include <fc/io/datastream.hpp>
@@ -77,6 +83,7 @@ Options:
 #include <fc/exception/exception.hpp>
 #include <fc/variant_object.hpp>
 #include <fc/static_variant.hpp>
+#include <fc/scoped_exit.hpp>
 
 #include <eosio/chain/name.hpp>
 #include <eosio/chain/config.hpp>
@@ -343,12 +350,21 @@ string generate_nonce_string() {
 }
 
 chain::action generate_nonce_action() {
-   return chain::action( {}, config::null_account_name, name("nonce"), fc::raw::pack(fc::time_point::now().time_since_epoch().count()));
+   // strictly increasing, transactions built in the same microsecond by push bulk still get distinct nonces
+   static std::atomic<int64_t> last_nonce{0};
+   int64_t nonce = fc::time_point::now().time_since_epoch().count();
+   int64_t prev = last_nonce.load();
+   do {
+      nonce = std::max(nonce, prev + 1);
+   } while( !last_nonce.compare_exchange_weak(prev, nonce) );
+   return chain::action( {}, config::null_account_name, name("nonce"), fc::raw::pack(nonce));
 }
 
 //resolver for ABI serializer to decode actions in proposed transaction in multisig contract
 auto abi_serializer_resolver = [](const name& account) -> std::optional<abi_serializer> {
   static unordered_map<account_name, std::optional<abi_serializer> > abi_cache;
+  static std::mutex abi_cache_mtx; // push bulk resolves from its worker threads
+  std::lock_guard<std::mutex> g(abi_cache_mtx);
   auto it = abi_cache.find( account );
   if ( it == abi_cache.end() ) {
     const auto raw_abi_result = call(get_raw_abi_func, fc::mutable_variant_object("account_name", account));
@@ -381,10 +397,9 @@ void prompt_for_wallet_password(string& pw, const string& name) {
    }
 }
 
-fc::variant determine_required_keys(const signed_transaction& trx) {
+fc::variant determine_required_keys(const signed_transaction& trx, const fc::variant& public_keys) {
    // TODO better error checking
    //wdump((trx));
-   const auto& public_keys = call(wallet_url, wallet_public_keys);
    auto get_arg = fc::mutable_variant_object
            ("transaction", (transaction)trx)
            ("available_keys", public_keys);
@@ -392,48 +407,60 @@ fc::variant determine_required_keys(const signed_transaction& trx) {
    return required_keys["required_keys"];
 }
 
+fc::variant determine_required_keys(const signed_transaction& trx) {
+   return determine_required_keys(trx, call(wallet_url, wallet_public_keys));
+}
+
 void sign_transaction(signed_transaction& trx, fc::variant& required_keys, const chain_id_type& chain_id) {
    fc::variants sign_args = {fc::variant(trx), required_keys, fc::variant(chain_id)};
    const auto& signed_trx = call(wallet_url, wallet_sign_trx, sign_args);
    trx = signed_trx.as<signed_transaction>();
 }
 
-fc::variant push_transaction( signed_transaction& trx, const std::vector<public_key_type>& signing_keys = std::vector<public_key_type>() )
-{
-   auto info = get_info();
-
-   if (trx.signatures.size() == 0) { // #5445 can't change txn content if already signed
-      trx.expiration = info.head_block_time + tx_expiration;
-
-      // Set tapos, default to last irreversible block if it's not specified by the user
-      block_id_type ref_block_id = info.last_irreversible_block_id;
-      try {
-         fc::variant ref_block;
-         if (!tx_ref_block_num_or_id.empty()) {
-            ref_block = call(get_block_func, fc::mutable_variant_object("block_num_or_id", tx_ref_block_num_or_id));
-            ref_block_id = ref_block["id"].as<block_id_type>();
-         }
-      } EOS_RETHROW_EXCEPTIONS(invalid_ref_block_exception, "Invalid reference block num or id: ${block_num_or_id}", ("block_num_or_id", tx_ref_block_num_or_id));
-      trx.set_reference_block(ref_block_id);
-
-      if (tx_force_unique) {
-         trx.context_free_actions.emplace_back( generate_nonce_action() );
+// block referenced for TAPOS, default to last irreversible block if it's not specified by the user
+block_id_type determine_ref_block_id( const eosio::chain_apis::read_only::get_info_results& info ) {
+   block_id_type ref_block_id = info.last_irreversible_block_id;
+   try {
+      fc::variant ref_block;
+      if (!tx_ref_block_num_or_id.empty()) {
+         ref_block = call(get_block_func, fc::mutable_variant_object("block_num_or_id", tx_ref_block_num_or_id));
+         ref_block_id = ref_block["id"].as<block_id_type>();
       }
+   } EOS_RETHROW_EXCEPTIONS(invalid_ref_block_exception, "Invalid reference block num or id: ${block_num_or_id}", ("block_num_or_id", tx_ref_block_num_or_id));
+   return ref_block_id;
+}
 
-      trx.max_cpu_usage_ms = tx_max_cpu_usage;
-      trx.max_net_usage_words = (tx_max_net_usage + 7)/8;
-      trx.delay_sec = delaysec;
+void set_transaction_header( signed_transaction& trx, const eosio::chain_apis::read_only::get_info_results& info, const block_id_type& ref_block_id ) {
+   trx.expiration = info.head_block_time + tx_expiration;
+   trx.set_reference_block(ref_block_id);
+
+   if (tx_force_unique) {
+      trx.context_free_actions.emplace_back( generate_nonce_action() );
    }
 
+   trx.max_cpu_usage_ms = tx_max_cpu_usage;
+   trx.max_net_usage_words = (tx_max_net_usage + 7)/8;
+   trx.delay_sec = delaysec;
+}
+
+// signs trx unless --skip-sign, then broadcasts it unless --dont-broadcast
+// wallet_keys are the public keys of the wallet, they are requested from it when null
+fc::variant sign_and_send_transaction( signed_transaction& trx, const chain_id_type& chain_id,
+                                       const std::vector<public_key_type>& signing_keys,
+                                       const fc::variant& wallet_keys = fc::variant() )
+{
    if (!tx_skip_sign) {
       fc::variant required_keys;
       if (signing_keys.size() > 0) {
          required_keys = fc::variant(signing_keys);
       }
+      else if (!wallet_keys.is_null()) {
+         required_keys = determine_required_keys(trx, wallet_keys);
+      }
       else {
          required_keys = determine_required_keys(trx);
       }
-      sign_transaction(trx, required_keys, info.chain_id);
+      sign_transaction(trx, required_keys, chain_id);
    }
 
    packed_transaction::compression_type compression = to_compression_type( tx_compression );
@@ -464,6 +491,17 @@ fc::variant push_transaction( signed_transaction& trx, const std::vector<public_
    }
 }
 
+fc::variant push_transaction( signed_transaction& trx, const std::vector<public_key_type>& signing_keys = std::vector<public_key_type>() )
+{
+   auto info = get_info();
+
+   if (trx.signatures.size() == 0) { // #5445 can't change txn content if already signed
+      set_transaction_header(trx, info, determine_ref_block_id(info));
+   }
+
+   return sign_and_send_transaction(trx, info.chain_id, signing_keys);
+}
+
 fc::variant push_actions(std::vector<chain::action>&& actions, const std::vector<public_key_type>& signing_keys = std::vector<public_key_type>() ) {
    signed_transaction trx;
    trx.actions = std::forward<decltype(actions)>(actions);
@@ -644,6 +682,148 @@ void send_actions(std::vector<chain::action>&& actions, const std::vector<public
    }
 }
 
+fc::variant bulk_error_result( uint64_t index, const fc::exception& e ) {
+   return fc::mutable_variant_object("index", index)
+         ("error", fc::mutable_variant_object("code", e.code())("name", e.name())("what", e.what())
+                                             ("details", verbose ? e.to_detail_string() : e.to_string()));
+}
+
+// A line of push bulk input is either an action or a transaction (an object with "actions"),
+// action data is given either as JSON serialized with the contract ABI or as hex.
+signed_transaction bulk_line_to_transaction( const fc::variant& line ) {
+   const auto& obj = line.get_object();
+   signed_transaction trx;
+   if( obj.contains("actions") ) {
+      try {
+         trx = line.as<signed_transaction>();
+      } catch( const fc::exception& ) {
+         // unable to convert so try via abi
+         abi_serializer::from_variant( line, trx, abi_serializer_resolver, abi_serializer::create_yield_function( abi_serializer_max_time ) );
+      }
+   } else {
+      fc::mutable_variant_object act_var(obj);
+      if( !obj.contains("authorization") ) {
+         act_var("authorization", get_account_permissions(tx_permission));
+      }
+      chain::action act;
+      abi_serializer::from_variant( fc::variant(act_var), act, abi_serializer_resolver, abi_serializer::create_yield_function( abi_serializer_max_time ) );
+      trx.actions.emplace_back( std::move(act) );
+   }
+   return trx;
+}
+
+// Pushes every line of input as its own transaction. Lines are parsed here, ABIs being resolved on this thread, then
+// up to window transactions are signed and pushed at once by as many workers, over connections kept alive by httpc.
+// A JSON line is written to out for each non blank input line, in completion order, with its zero based line index.
+// Returns the number of lines that failed.
+uint64_t push_bulk( std::istream& in, std::ostream& out, uint32_t window ) {
+   const auto signing_keys = signing_keys_opt.get_keys();
+   fc::variant wallet_keys;
+   if( !tx_skip_sign && signing_keys.empty() ) {
+      wallet_keys = call(wallet_url, wallet_public_keys);
+   }
+
+   // expiration and TAPOS follow the head block, refreshed at most once per second
+   std::mutex info_mtx;
+   auto info = get_info();
+   auto ref_block_id = determine_ref_block_id(info);
+   auto info_time = fc::time_point::now();
+   const auto chain_id = info.chain_id;
+   auto set_header = [&]( signed_transaction& trx ) {
+      std::lock_guard<std::mutex> g(info_mtx);
+      const auto now = fc::time_point::now();
+      if( now - info_time >= fc::seconds(1) ) {
+         info = get_info();
+         if( tx_ref_block_num_or_id.empty() )
+            ref_block_id = info.last_irreversible_block_id;
+         info_time = now;
+      }
+      set_transaction_header(trx, info, ref_block_id);
+   };
+
+   std::mutex out_mtx;
+   std::atomic<uint64_t> failed{0};
+   auto write_result = [&]( const fc::variant& result ) {
+      std::lock_guard<std::mutex> g(out_mtx);
+      out << fc::json::to_string(result, fc::time_point::maximum()) << std::endl;
+   };
+
+   struct bulk_item {
+      uint64_t           index = 0;
+      signed_transaction trx;
+   };
+   std::mutex queue_mtx;
+   std::condition_variable queue_cv;
+   std::deque<bulk_item> queue;
+   bool input_done = false;
+
+   auto work = [&]() {
+      while( true ) {
+         bulk_item item;
+         {
+            std::unique_lock<std::mutex> l(queue_mtx);
+            queue_cv.wait(l, [&]() { return !queue.empty() || input_done; });
+            if( queue.empty() )
+               return;
+            item = std::move(queue.front());
+            queue.pop_front();
+         }
+         queue_cv.notify_all();
+
+         try {
+            if( item.trx.signatures.empty() ) { // #5445 can't change txn content if already signed
+               set_header(item.trx);
+            }
+            auto result = sign_and_send_transaction(item.trx, chain_id, signing_keys, wallet_keys);
+            write_result(fc::mutable_variant_object("index", item.index)("transaction_id", item.trx.id())("result", result));
+         } catch( const fc::exception& e ) {
+            ++failed;
+            write_result(bulk_error_result(item.index, e));
+         } catch( const std::exception& e ) {
+            ++failed;
+            write_result(bulk_error_result(item.index, fc::std_exception_wrapper::from_current_exception(e)));
+         }
+      }
+   };
+
+   {
+      std::vector<std::thread> workers;
+      // the workers drain the queue and exit once the input is done, also when reading it throws
+      auto join_workers = fc::make_scoped_exit([&]() {
+         {
+            std::lock_guard<std::mutex> g(queue_mtx);
+            input_done = true;
+         }
+         queue_cv.notify_all();
+         for( auto& w : workers )
+            w.join();
+      });
+      for( uint32_t i = 0; i < window; ++i )
+         workers.emplace_back(work);
+
+      string line;
+      for( uint64_t index = 0; std::getline(in, line); ++index ) {
+         if( line.find_first_not_of(" \t\r") == string::npos )
+            continue;
+         bulk_item item{index};
+         try {
+            item.trx = bulk_line_to_transaction(fc::json::from_string(line, fc::json::parse_type::relaxed_parser));
+         } catch( const fc::exception& e ) {
+            ++failed;
+            write_result(bulk_error_result(index, e));
+            continue;
+         }
+         {
+            std::unique_lock<std::mutex> l(queue_mtx);
+            queue_cv.wait(l, [&]() { return queue.size() < window; });
+            queue.emplace_back(std::move(item));
+         }
+         queue_cv.notify_all();
+      }
+   }
+   return failed.load();
+}
+
 chain::permission_level to_permission_level(const std::string& s) {
    auto at_pos = s.find('@');
    return permission_level { name(s.substr(0, at_pos)), name(s.substr(at_pos + 1)) };
@@ -3853,6 +4033,34 @@ int main( int argc, char** argv ) {
    });
 
 
+   // push bulk
+   string bulk_input;
+   string bulk_output;
+   uint32_t bulk_window = 16;
+   auto bulkSubcommand = push->add_subcommand("bulk", localized("Push actions or transactions read as JSON lines, each in its own transaction, signing and pushing them concurrently"));
+   bulkSubcommand->add_option("input", bulk_input, localized("The file with one JSON action or transaction per line, '-' to read from stdin"))->required();
+   bulkSubcommand->add_option("--output", bulk_output, localized("The file to write the JSON result line of each input line to, defaults to stdout"));
+   bulkSubcommand->add_option("--window", bulk_window, localized("The maximum number of transactions being signed or pushed at once"), true);
+   add_standard_transaction_options_plus_signing(bulkSubcommand);
+
+   bulkSubcommand->callback([&] {
+      EOSC_ASSERT( bulk_window > 0, "ERROR: --window must be at least 1" );
+      std::ifstream in_file;
+      if( bulk_input != "-" ) {
+         in_file.open(bulk_input);
+         EOSC_ASSERT( !in_file.fail(), "ERROR: Failed to open file \"${p}\"", ("p", bulk_input) );
+      }
+      std::ofstream out_file;
+      if( !bulk_output.empty() ) {
+         out_file.open(bulk_output);
+         EOSC_ASSERT( !out_file.fail(), "ERROR: Failed to create file \"${p}\"", ("p", bulk_output) );
+      }
+      auto failed = push_bulk( bulk_input != "-" ? static_cast<std::istream&>(in_file) : std::cin,
+                               !bulk_output.empty() ? static_cast<std::ostream&>(out_file) : std::cout, bulk_window );
+      EOSC_ASSERT( failed == 0, "ERROR: ${n} line(s) failed, see their results for the errors", ("n", failed) );
+   });
+
+
    // multisig subcommand
    auto msig = app.add_subcommand("multisig", localized("Multisig contract commands"));
    msig->require_subcommand();
@@ -2,9 +2,12 @@
 #include <eosio/chain/abi_serializer.hpp>
 #include <eosio/chain/block_log.hpp>
 #include <eosio/chain/config.hpp>
+#include <eosio/chain/log_catalog.hpp>
 #include <eosio/chain/reversible_block_object.hpp>
+#include <eosio/chain/thread_utils.hpp>
 
 #include <eosio/state_history/log.hpp>
+#include <eosio/state_history/types.hpp>
 
 #include <fc/io/json.hpp>
 #include <fc/filesystem.hpp>
@@ -16,7 +19,14 @@
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/path.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
 #include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
 
 #ifndef _WIN32
 #define FOPEN(p, m) fopen(p, m)
@@ -50,6 +60,8 @@ struct blocklog {
    bool                             trim_log = false;
    bool                             fix_irreversible_blocks = false;
    bool                             smoke_test = false;
+   bool                             in_place = false;
+   bool                             repair_index = false;
    bool                             prune_transactions = false;
    bool                             help               = false;
 };
@@ -178,6 +190,12 @@ void blocklog::set_program_options(options_description& cli)
           "the location of the blocks directory (absolute path or relative to the current directory)")
          ("state-history-dir", bpo::value<bfs::path>()->default_value("state-history"),
            "the location of the state-history directory (absolute path or relative to the current dir)")
+         ("blocks-retained-dir", bpo::value<bfs::path>()->default_value(""),
+          "the location of the retained stride files of a split block log (absolute path or relative to blocks-dir). "
+          "If the value is empty, it is the same as blocks-dir.")
+         ("blocks-archive-dir", bpo::value<bfs::path>()->default_value(""),
+          "the location stride files trimmed as a whole by trim-blocklog with in-place are moved to (absolute path or relative to blocks-dir). "
+          "If the value is empty, they are deleted.")
          ("output-file,o", bpo::value<bfs::path>(),
           "the file to write the output to (absolute or relative path).  If not specified then output is to stdout.")
          ("first,f", bpo::value<uint32_t>(&first_block)->default_value(0),
@@ -192,15 +210,32 @@ void blocklog::set_program_options(options_description& cli)
           "Create blocks.index from blocks.log. Must give 'blocks-dir'. Give 'output-file' relative to current directory or absolute path (default is <blocks-dir>/blocks.index).")
          ("trim-blocklog", bpo::bool_switch(&trim_log)->default_value(false),
           "Trim blocks.log and blocks.index. Must give 'blocks-dir' and 'first and/or 'last'.")
+         ("in-place", bpo::bool_switch(&in_place)->default_value(false),
+          "With trim-blocklog, trim a block log split into stride files in place: only the file containing 'first' or 'last' is "
+          "rewritten or truncated and no copy is kept in the 'old' directory. If interrupted, run the same command again to complete it.")
+         ("repair-index", bpo::bool_switch(&repair_index)->default_value(false),
+          "Rebuild the entries past the last valid one of blocks.index and of the index of each stride file that does not agree with its log.")
          ("fix-irreversible-blocks", bpo::bool_switch(&fix_irreversible_blocks)->default_value(false),
           "When the existing block log is inconsistent with the index, allows fixing the block log and index files automatically - that is, "
           "it will take the highest indexed block if it is valid; otherwise it will repair the block log and reconstruct the index.")
          ("smoke-test", bpo::bool_switch(&smoke_test)->default_value(false),
-          "Quick test that blocks.log and blocks.index are well formed and agree with each other.")
+          "Quick test that blocks.log and blocks.index, and the files of a split block log, are well formed and agree with each other.")
+         ("smoke-test-interval", bpo::value<uint32_t>()->default_value(0),
+          "Test only 1 block out of every n blocks of each file in smoke-test, 1 tests all blocks. 0 tests 8 blocks of each file.")
          ("block-num", bpo::value<uint32_t>()->default_value(0), "The block number which contains the transactions to be pruned")
          ("transaction,t", bpo::value<std::vector<std::string> >()->multitoken(), "The transaction id to be pruned")
+         ("transaction-file", bpo::value<bfs::path>(),
+          "File with the transactions to be pruned, one per line as '<block_num> <transaction id>' or as '<transaction id>'. "
+          "The blocks of transactions listed without block number are located by scanning the blocks between 'first' and 'last'.")
+         ("jobs", bpo::value<uint32_t>()->default_value(4),
+          "Number of threads working on different files or block ranges in parallel in smoke-test, repair-index "
+          "and prune-transactions with 'transaction-file'.")
+         ("prune-journal", bpo::value<bfs::path>(),
+          "The journal of the progress of pruning 'transaction-file' (default is <transaction-file>.journal). "
+          "Running the same command again resumes from it.")
          ("prune-transactions", bpo::bool_switch(&prune_transactions)->default_value(false),
-          "Prune the context free data and signatures from specified transactions of specified block-num.")
+          "Prune the context free data and signatures from specified transactions of specified block-num, "
+          "or from all transactions of 'transaction-file' followed by a verification of the block log.")
          ("help,h", bpo::bool_switch(&help)->default_value(false), "Print this help message and exit.")
          ;
 }
@@ -249,11 +284,14 @@ void fix_irreversible_blocks(bfs::path block_dir) {
    block_log::smoke_test(block_dir, 0);
 }
 
-void smoke_test(bfs::path block_dir) {
+void smoke_test(bfs::path block_dir, bfs::path retained_dir, uint32_t interval, uint32_t jobs) {
    using namespace std;
    cout << "\nSmoke test of blocks.log and blocks.index in directory " << block_dir << '\n';
-   block_log::smoke_test(block_dir, 0);
+   const auto stats = block_log::verify_split_log(block_dir, retained_dir, interval, jobs);
+   const auto usecs = std::max<int64_t>(stats.elapsed.count(), 1);
    cout << "\nno problems found\n"; // if get here there were no exceptions
+   cout << stats.files << " files, " << stats.blocks << " blocks, " << (stats.bytes >> 20) << " MiB in " << usecs / 1000 << " ms: "
+        << stats.blocks * 1000000 / usecs << " blocks/s, " << (stats.bytes >> 20) * 1000000 / usecs << " MiB/s\n";
 }
 
 template <typename Log>
@@ -287,6 +325,390 @@ int prune_transactions(bfs::path block_dir, bfs::path state_history_dir, uint32_
           prune_transactions<state_history_traces_log>("state history traces log", state_history_dir, block_num, ids);
 }
 
+/**
+ * Prunes the transactions listed in a file (see transaction-file) from the block log and the state history traces log.
+ *
+ * The blocks of ids listed without a block number are located by scanning the block log. The blocks are split into
+ * ranges of at most blocks_per_range blocks which never span a log_catalog stride file, and the ranges are scanned,
+ * pruned and verified in parallel, each thread with its own instances of the logs.
+ *
+ * Progress is appended to a journal: the blocks located by the scan, the ranges scanned and the blocks pruned. Running
+ * the same command again after an interruption resumes from the journal instead of starting over.
+ */
+struct bulk_pruner {
+   static constexpr uint32_t blocks_per_range = 100000;
+
+   struct block_range {
+      uint32_t first = 0;
+      uint32_t last  = 0;
+   };
+
+   bfs::path   blocks_dir;
+   bfs::path   retained_dir;
+   bfs::path   state_history_dir;
+   bfs::path   journal_path;
+   uint32_t    jobs       = 1;
+   uint32_t    scan_first = 0;
+   uint32_t    scan_last  = std::numeric_limits<uint32_t>::max();
+
+   std::map<uint32_t, std::vector<transaction_id_type>> located;        // block num -> ids to prune
+   std::set<transaction_id_type>                        unlocated;      // ids without a known block num
+   std::set<uint32_t>                                   pruned_blocks;  // from the journal
+   std::set<std::pair<uint32_t, uint32_t>>              scanned_ranges; // from the journal
+   std::vector<block_range>                             ranges;
+
+   std::vector<std::unique_ptr<block_log>>                       block_logs; // one per job
+   std::vector<std::unique_ptr<eosio::state_history_traces_log>> trace_logs; // one per job, if any
+
+   std::mutex    mtx; // protects located and journal while the jobs run
+   std::ofstream journal;
+
+   static std::optional<uint32_t> to_block_num(const std::string& s) {
+      uint32_t   result = 0;
+      const auto end    = s.data() + s.size();
+      auto [ptr, ec]    = std::from_chars(s.data(), end, result);
+      if (ec != std::errc() || ptr != end)
+         return {};
+      return result;
+   }
+
+   static std::optional<transaction_id_type> to_transaction_id(const std::string& s) {
+      if (s.size() != 64 || !std::all_of(s.begin(), s.end(), [](unsigned char c) { return std::isxdigit(c); }))
+         return {};
+      return transaction_id_type(s);
+   }
+
+   void read_transaction_file(const bfs::path& trx_file) {
+      std::ifstream in(trx_file.generic_string());
+      EOS_ASSERT(in, block_log_exception, "Unable to open transaction file ${f}", ("f", trx_file.generic_string()));
+      std::string line;
+      for (size_t line_num = 1; std::getline(in, line); ++line_num) {
+         std::istringstream fields(line);
+         std::string first, second, extra;
+         if (!(fields >> first) || first[0] == '#')
+            continue;
+         const bool has_block_num = static_cast<bool>(fields >> second);
+         const auto block_num     = has_block_num ? to_block_num(first) : std::optional<uint32_t>(0);
+         const auto id            = to_transaction_id(has_block_num ? second : first);
+         EOS_ASSERT(block_num && id && !(fields >> extra), block_log_exception,
+                    "${f}:${n}: expected a transaction id, optionally preceded by its block number, found \"${l}\"",
+                    ("f", trx_file.generic_string())("n", line_num)("l", line));
+         if (has_block_num)
+            located[*block_num].push_back(*id);
+         else
+            unlocated.insert(*id);
+      }
+      for (const auto& [block_num, ids] : located)
+         for (const auto& id : ids)
+            unlocated.erase(id);
+   }
+
+   void read_journal() {
+      if (!bfs::exists(journal_path))
+         return;
+      std::ifstream in(journal_path.generic_string());
+      EOS_ASSERT(in, block_log_exception, "Unable to open journal ${j}", ("j", journal_path.generic_string()));
+      std::string line;
+      for (size_t line_num = 1; std::getline(in, line); ++line_num) {
+         std::istringstream       fields(line);
+         std::vector<std::string> f;
+         for (std::string field; fields >> field;)
+            f.push_back(std::move(field));
+         if (f.empty())
+            continue;
+
+         std::optional<uint32_t>            a, b;
+         std::optional<transaction_id_type> id;
+         bool                               valid = false;
+         if (f[0] == "located" && f.size() == 3) {
+            a     = to_block_num(f[1]);
+            id    = to_transaction_id(f[2]);
+            valid = a && id;
+         } else if (f[0] == "scanned" && f.size() == 3) {
+            a     = to_block_num(f[1]);
+            b     = to_block_num(f[2]);
+            valid = a && b && *a <= *b;
+         } else if (f[0] == "pruned" && f.size() == 2) {
+            a     = to_block_num(f[1]);
+            valid = a.has_value();
+         }
+         if (!valid) {
+            // the last line may be incomplete when the previous run was killed while writing it, it is redone
+            if (in.eof()) {
+               wlog("ignoring incomplete last line ${n} of journal ${j}: \"${l}\"",
+                    ("n", line_num)("j", journal_path.generic_string())("l", line));
+               break;
+            }
+            EOS_THROW(block_log_exception,
+                      "${j}:${n}: expected \"located <block num> <transaction id>\", \"scanned <first block> <last block>\" "
+                      "or \"pruned <block num>\", found \"${l}\"; remove the journal to start over",
+                      ("j", journal_path.generic_string())("n", line_num)("l", line));
+         }
+
+         if (f[0] == "located") {
+            if (unlocated.erase(*id))
+               located[*a].push_back(*id);
+         } else if (f[0] == "scanned") {
+            scanned_ranges.emplace(*a, *b);
+         } else {
+            pruned_blocks.insert(*a);
+         }
+      }
+      ilog("resuming from journal ${j}: ${p} blocks already pruned, ${s} ranges already scanned",
+           ("j", journal_path.generic_string())("p", pruned_blocks.size())("s", scanned_ranges.size()));
+   }
+
+   void record(const std::string& line) {
+      std::lock_guard<std::mutex> g(mtx);
+      journal << line << '\n';
+      journal.flush();
+   }
+
+   void open_logs() {
+      // opened one after the other, opening a log may repair it or rebuild its index
+      for (uint32_t i = 0; i < jobs; ++i) {
+         block_logs.emplace_back(std::make_unique<block_log>(block_log::config_type{ .log_dir = blocks_dir, .retained_dir = retained_dir }));
+         if (eosio::state_history_traces_log::exists(state_history_dir))
+            trace_logs.emplace_back(std::make_unique<eosio::state_history_traces_log>(eosio::state_history_config{ .log_dir = state_history_dir }));
+      }
+      if (trace_logs.empty())
+         std::cerr << "No state history traces log is found in " << state_history_dir.native() << "\n";
+   }
+
+   void build_ranges() {
+      const auto& log  = *block_logs.front();
+      EOS_ASSERT(log.head(), block_log_exception, "No blocks found in block log");
+      const uint32_t head = log.head()->block_num();
+
+      const bfs::path dir = retained_dir.empty() ? blocks_dir : retained_dir.is_relative() ? blocks_dir / retained_dir : retained_dir;
+      std::vector<block_range> files;
+      for_each_file_in_dir_matches(dir, R"(blocks-\d+-\d+\.log)", [&files](bfs::path p) {
+         block_range file;
+         if (sscanf(p.filename().string().c_str(), "blocks-%u-%u.log", &file.first, &file.last) == 2 && file.first <= file.last)
+            files.push_back(file);
+      });
+      std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+      // same as log_catalog, a file overlapping the previous one is not part of the catalog
+      uint32_t main_first = log.first_block_num();
+      std::vector<block_range> catalog;
+      for (const auto& file : files) {
+         if (!catalog.empty() && file.first <= catalog.back().last)
+            continue;
+         catalog.push_back(file);
+         main_first = file.last + 1;
+      }
+      if (head >= main_first)
+         catalog.push_back({main_first, head});
+
+      for (const auto& file : catalog) {
+         for (uint64_t first = file.first; first <= file.last; first += blocks_per_range) {
+            ranges.push_back({static_cast<uint32_t>(first),
+                              static_cast<uint32_t>(std::min<uint64_t>(file.last, first + blocks_per_range - 1))});
+         }
+      }
+   }
+
+   /// @return number of ids listed with a block num outside of the block log, they are not pruned
+   size_t drop_blocks_outside_log() {
+      size_t dropped = 0;
+      for (auto itr = located.begin(); itr != located.end();) {
+         auto r = std::upper_bound(ranges.begin(), ranges.end(), itr->first,
+                                   [](uint32_t block_num, const block_range& range) { return block_num < range.first; });
+         if (r != ranges.begin() && itr->first <= std::prev(r)->last) {
+            ++itr;
+            continue;
+         }
+         std::cerr << "block " << itr->first << " is not in the block log, its transactions are not pruned\n";
+         dropped += itr->second.size();
+         itr = located.erase(itr);
+      }
+      return dropped;
+   }
+
+   /// run f(job, range) for all ranges on jobs threads
+   template <typename F>
+   void for_each_range(F&& f) {
+      std::atomic<size_t>            next{0};
+      named_thread_pool              pool("prune", jobs);
+      std::vector<std::future<void>> futures;
+      for (uint32_t job = 0; job < jobs; ++job) {
+         futures.emplace_back(async_thread_pool(pool.get_executor(), [&, job]() {
+            for (size_t i = next++; i < ranges.size(); i = next++)
+               f(job, ranges[i]);
+         }));
+      }
+      for (auto& fut : futures)
+         fut.get();
+   }
+
+   static transaction_id_type id_of(const transaction_receipt& receipt) {
+      return std::visit(overloaded{[](const transaction_id_type& id) { return id; },
+                                   [](const packed_transaction& ptx) { return ptx.id(); }},
+                        receipt.trx);
+   }
+
+   void scan() {
+      if (unlocated.empty())
+         return;
+      report_time rt("locating " + std::to_string(unlocated.size()) + " transactions");
+      std::atomic<size_t> found{0};
+      const size_t        to_find = unlocated.size();
+      for_each_range([&](uint32_t job, const block_range& range) {
+         const uint32_t first = std::max(range.first, scan_first);
+         const uint32_t last  = std::min(range.last, scan_last);
+         if (first > last || scanned_ranges.count({first, last}))
+            return;
+         for (uint32_t block_num = first; block_num <= last && found < to_find; ++block_num) {
+            auto block = block_logs[job]->read_signed_block_by_num(block_num);
+            if (!block)
+               continue;
+            for (const auto& receipt : block->transactions) {
+               const auto id = id_of(receipt);
+               if (!unlocated.count(id))
+                  continue;
+               {
+                  std::lock_guard<std::mutex> g(mtx);
+                  located[block_num].push_back(id);
+               }
+               record("located " + std::to_string(block_num) + " " + id.str());
+               ++found;
+            }
+         }
+         if (found < to_find)
+            record("scanned " + std::to_string(first) + " " + std::to_string(last));
+      });
+      for (const auto& [block_num, ids] : located)
+         for (const auto& id : ids)
+            unlocated.erase(id);
+      rt.report();
+   }
+
+   void prune() {
+      report_time         rt("pruning transactions of " + std::to_string(located.size()) + " blocks");
+      std::atomic<size_t> ranges_done{0};
+      for_each_range([&](uint32_t job, const block_range& range) {
+         for (auto itr = located.lower_bound(range.first); itr != located.end() && itr->first <= range.last; ++itr) {
+            const auto block_num = itr->first;
+            if (pruned_blocks.count(block_num))
+               continue;
+            auto ids = itr->second;
+            block_logs[job]->prune_transactions(block_num, ids);
+            if (trace_logs.size()) {
+               auto trace_ids = itr->second;
+               trace_logs[job]->prune_transactions(block_num, trace_ids);
+               if (trace_ids.size()) {
+                  std::lock_guard<std::mutex> g(mtx);
+                  std::cerr << "block " << block_num << " in state history traces log does not contain the following transactions: ";
+                  for (const auto& id : trace_ids)
+                     std::cerr << id.str() << " ";
+                  std::cerr << "\n";
+               }
+            }
+            record("pruned " + std::to_string(block_num));
+         }
+         if (++ranges_done % 100 == 0)
+            ilog("pruned ${n} of ${t} block ranges", ("n", ranges_done.load())("t", ranges.size()));
+      });
+      rt.report();
+   }
+
+   static bool is_pruned(const packed_transaction::prunable_data_type& data) {
+      return std::holds_alternative<packed_transaction::prunable_data_type::none>(data.prunable_data);
+   }
+
+   /// @return the ids of the given block whose traces in the traces log still hold their prunable data, ids without
+   ///         a trace were reported while pruning
+   static std::set<transaction_id_type> unpruned_traces(eosio::state_history_traces_log& log, uint32_t block_num,
+                                                        const std::vector<transaction_id_type>& ids) {
+      std::set<transaction_id_type> result;
+      const auto                    entry = log.get_log_entry(block_num);
+      if (entry.empty())
+         return result;
+      fc::datastream<const char*>                          ds(entry.data(), entry.size());
+      std::vector<eosio::state_history::transaction_trace> traces;
+      fc::raw::unpack(ds, traces);
+      const std::set<transaction_id_type> wanted(ids.begin(), ids.end());
+      for (const auto& trace : traces) {
+         const auto& t = std::get<eosio::state_history::transaction_trace_v0>(trace);
+         if (!t.partial || !wanted.count(t.id))
+            continue;
+         const auto* partial = std::get_if<eosio::state_history::partial_transaction_v1>(&*t.partial);
+         if (!partial || (partial->prunable_data && !is_pruned(*partial->prunable_data)))
+            result.insert(t.id);
+      }
+      return result;
+   }
+
+   void report_unpruned(const char* log_name, uint32_t block_num, const std::set<transaction_id_type>& ids) {
+      std::lock_guard<std::mutex> g(mtx);
+      std::cerr << "block " << block_num << " in " << log_name << " still contains the following unpruned transactions: ";
+      for (const auto& id : ids)
+         std::cerr << id.str() << " ";
+      std::cerr << "\n";
+   }
+
+   /// @return number of ids which are not pruned in the block log or in the state history traces log
+   size_t verify() {
+      report_time         rt("verifying");
+      std::atomic<size_t> unpruned{0};
+      for_each_range([&](uint32_t job, const block_range& range) {
+         for (auto itr = located.lower_bound(range.first); itr != located.end() && itr->first <= range.last; ++itr) {
+            std::set<transaction_id_type> ids(itr->second.begin(), itr->second.end());
+            auto block = block_logs[job]->read_signed_block_by_num(itr->first);
+            if (block) {
+               for (const auto& receipt : block->transactions) {
+                  const auto* ptx = std::get_if<packed_transaction>(&receipt.trx);
+                  if (ptx && is_pruned(ptx->get_prunable_data()))
+                     ids.erase(ptx->id());
+               }
+            }
+            if (ids.size()) {
+               report_unpruned("block log", itr->first, ids);
+               unpruned += ids.size();
+            }
+
+            if (trace_logs.size()) {
+               const auto trace_ids = unpruned_traces(*trace_logs[job], itr->first, itr->second);
+               if (trace_ids.size()) {
+                  report_unpruned("state history traces log", itr->first, trace_ids);
+                  unpruned += trace_ids.size();
+               }
+            }
+         }
+      });
+      rt.report();
+      return unpruned;
+   }
+
+   /// @return 0 if every listed transaction was located and pruned, 1 otherwise
+   int run(const bfs::path& trx_file) {
+      read_transaction_file(trx_file);
+      read_journal();
+      journal.open(journal_path.generic_string(), std::ios::app);
+      EOS_ASSERT(journal, block_log_exception, "Unable to open journal ${j}", ("j", journal_path.generic_string()));
+
+      open_logs();
+      build_ranges();
+      const size_t outside = drop_blocks_outside_log();
+      ilog("${l} blocks with transactions to prune, ${u} transactions to locate, ${r} block ranges on ${j} threads",
+           ("l", located.size())("u", unlocated.size())("r", ranges.size())("j", jobs));
+
+      scan();
+      if (unlocated.size()) {
+         std::cerr << "the following transactions are not found in blocks " << scan_first << " to " << scan_last << ": ";
+         for (const auto& id : unlocated)
+            std::cerr << id.str() << " ";
+         std::cerr << "\n";
+      }
+
+      prune();
+      const size_t unpruned = verify();
+      std::cout << outside << " transactions listed in blocks outside of the block log, " << unlocated.size()
+                << " transactions not found, " << unpruned << " transactions not pruned\n";
+      return outside || unlocated.size() || unpruned ? 1 : 0;
+   }
+};
+
 int main(int argc, char** argv) {
    std::ios::sync_with_stdio(false); // for potential performance boost for large block log files
    options_description cli ("eosio-blocklog command line options");
@@ -301,7 +723,16 @@ int main(int argc, char** argv) {
          return 0;
       }
       if (blog.smoke_test) {
-         smoke_test(vmap.at("blocks-dir").as<bfs::path>());
+         smoke_test(vmap.at("blocks-dir").as<bfs::path>(), vmap.at("blocks-retained-dir").as<bfs::path>(),
+                    vmap.at("smoke-test-interval").as<uint32_t>(), std::max(vmap.at("jobs").as<uint32_t>(), 1u));
+         return 0;
+      }
+      if (blog.repair_index) {
+         report_time rt("repairing index");
+         const auto repaired = block_log::repair_split_log_index(vmap.at("blocks-dir").as<bfs::path>(), vmap.at("blocks-retained-dir").as<bfs::path>(),
+                                                                 std::max(vmap.at("jobs").as<uint32_t>(), 1u));
+         std::cout << repaired << " index files repaired\n";
+         rt.report();
          return 0;
       }
       if (blog.fix_irreversible_blocks) {
@@ -313,6 +744,21 @@ int main(int argc, char** argv) {
             std::cerr << "trim-blocklog does nothing unless specify first and/or last block.";
             return -1;
          }
+         if (blog.in_place) {
+            const auto blocks_dir   = vmap.at("blocks-dir").as<bfs::path>();
+            const auto retained_dir = vmap.at("blocks-retained-dir").as<bfs::path>();
+            report_time rt("trimming split blocklog in place");
+            if (blog.last_block != std::numeric_limits<uint32_t>::max()) {
+               if (block_log::trim_split_log_end(blocks_dir, retained_dir, blog.last_block) != 0)
+                  return -1;
+            }
+            if (blog.first_block != 0) {
+               if (!block_log::trim_split_log_front(blocks_dir, retained_dir, vmap.at("blocks-archive-dir").as<bfs::path>(), blog.first_block))
+                  return -1;
+            }
+            rt.report();
+            return 0;
+         }
          if (blog.last_block != std::numeric_limits<uint32_t>::max()) {
             if (trim_blocklog_end(vmap.at("blocks-dir").as<bfs::path>(), blog.last_block) != 0)
                return -1;
@@ -344,7 +790,32 @@ int main(int argc, char** argv) {
          const auto  state_history_dir = vmap["state-history-dir"].as<bfs::path>();
          const auto  block_num         = vmap["block-num"].as<uint32_t>();
          const auto  ids               = vmap.count("transaction") ? vmap["transaction"].as<std::vector<string>>() : std::vector<string>{};
-         
+
+         if (vmap.count("transaction-file")) {
+            if (block_num != 0 || ids.size()) {
+               std::cerr << "transaction-file cannot be combined with block-num and transaction\n";
+               return -1;
+            }
+            bulk_pruner pruner;
+            pruner.blocks_dir        = blocks_dir;
+            pruner.retained_dir      = vmap["blocks-retained-dir"].as<bfs::path>();
+            pruner.state_history_dir = state_history_dir;
+            pruner.jobs              = vmap["jobs"].as<uint32_t>();
+            pruner.scan_first        = blog.first_block;
+            pruner.scan_last         = blog.last_block;
+            const auto trx_file      = vmap["transaction-file"].as<bfs::path>();
+            pruner.journal_path      = vmap.count("prune-journal") ? vmap["prune-journal"].as<bfs::path>() : bfs::path(trx_file.string() + ".journal");
+            if (pruner.jobs == 0) {
+               std::cerr << "jobs must be at least 1\n";
+               return -1;
+            }
+
+            report_time rt("prune transactions of " + trx_file.string());
+            int ret = pruner.run(trx_file);
+            rt.report();
+            return ret;
+         }
+
          report_time                 rt("prune transactions");
          int ret = prune_transactions(blocks_dir, state_history_dir, block_num, {ids.begin(), ids.end()});
          rt.report();
@@ -19,8 +19,12 @@
 #include <eosio/to_bin.hpp>
 #include <eosio/vm/backend.hpp>
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <stdio.h>
+#include <thread>
 
 using namespace eosio::literals;
 using namespace std::literals;
@@ -56,6 +60,9 @@ inline constexpr int      block_interval_ms   = 500;
 inline constexpr int      block_interval_us   = block_interval_ms * 1000;
 inline constexpr uint32_t billed_cpu_time_use = 2000;
 
+// chains created without a snapshot start from this one instead of genesis when it is set (--base-snapshot)
+static std::string base_snapshot;
+
 // Handle eosio version differences
 namespace {
 template <typename T>
@@ -117,7 +124,8 @@ struct intrinsic_context {
    std::unique_ptr<eosio::chain::apply_context>       apply_context;
 
    intrinsic_context(eosio::chain::controller& control) : control{ control } {
-      static transaction_checktime_factory xxx_timer;
+      // one per thread, tests of a suite run concurrently
+      static thread_local transaction_checktime_factory xxx_timer;
 
       eosio::chain::signed_transaction strx;
       strx.actions.emplace_back();
@@ -160,6 +168,59 @@ protocol_feature_set make_protocol_feature_set() {
    return pfs;
 }
 
+// Read only stream buffer over memory it doesn't own, so that every chain created from a cached snapshot reads the
+// same copy of it
+struct memory_streambuf : std::streambuf {
+   memory_streambuf(const std::string& data) {
+      auto* begin = const_cast<char*>(data.data());
+      setg(begin, begin, begin + data.size());
+   }
+
+   pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+      off_type pos = off;
+      if (dir == std::ios_base::cur)
+         pos += gptr() - eback();
+      else if (dir == std::ios_base::end)
+         pos += egptr() - eback();
+      if (!(which & std::ios_base::in) || pos < 0 || pos > egptr() - eback())
+         return pos_type(off_type(-1));
+      setg(eback(), eback() + pos, egptr());
+      return pos_type(pos);
+   }
+
+   pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+      return seekoff(off_type(pos), std::ios_base::beg, which);
+   }
+};
+
+struct cached_snapshot {
+   std::string                 data;
+   eosio::chain::chain_id_type chain_id;
+};
+
+// Snapshots are read and validated once per process, tests of a suite starting their chains from the same pre-booted
+// state share it
+std::shared_ptr<const cached_snapshot> get_snapshot(const std::string& path) {
+   static std::mutex                                                    mutex;
+   static std::map<std::string, std::shared_ptr<const cached_snapshot>> snapshots;
+
+   std::lock_guard lock(mutex);
+   auto&           result = snapshots[path];
+   if (!result) {
+      std::ifstream file(path, std::ios::in | std::ios::binary);
+      if (!file.is_open())
+         throw std::runtime_error("can not open " + path);
+      std::string                           data{ std::istreambuf_iterator<char>(file), {} };
+      memory_streambuf                      buf(data);
+      std::istream                          strm(&buf);
+      eosio::chain::istream_snapshot_reader reader(strm);
+      reader.validate();
+      auto chain_id = eosio::chain::controller::extract_chain_id(reader);
+      result        = std::make_shared<const cached_snapshot>(cached_snapshot{ std::move(data), chain_id });
+   }
+   return result;
+}
+
 template <typename T>
 using wasm_ptr = eosio::vm::argument_proxy<T*>;
 
@@ -199,21 +260,19 @@ struct test_chain {
       cfg->contracts_console    = true;
       cfg->wasm_runtime         = eosio::chain::wasm_interface::vm_type::eos_vm_jit;
 
-      std::optional<std::ifstream>                           snapshot_file;
+      if (!(snapshot && *snapshot) && !base_snapshot.empty())
+         snapshot = base_snapshot.c_str();
+
+      std::shared_ptr<const cached_snapshot>                 cached;
+      std::optional<memory_streambuf>                        snapshot_buf;
+      std::optional<std::istream>                            snapshot_strm;
       std::shared_ptr<eosio::chain::istream_snapshot_reader> snapshot_reader;
       if (snapshot && *snapshot) {
-         std::optional<eosio::chain::chain_id_type> chain_id;
-         {
-            std::ifstream temp_file(snapshot, (std::ios::in | std::ios::binary));
-            if (!temp_file.is_open())
-               throw std::runtime_error("can not open " + std::string{ snapshot });
-            eosio::chain::istream_snapshot_reader tmp_reader(temp_file);
-            tmp_reader.validate();
-            chain_id = eosio::chain::controller::extract_chain_id(tmp_reader);
-         }
-         snapshot_file.emplace(snapshot, std::ios::in | std::ios::binary);
-         snapshot_reader = std::make_shared<eosio::chain::istream_snapshot_reader>(*snapshot_file);
-         control         = std::make_unique<eosio::chain::controller>(*cfg, make_protocol_feature_set(), *chain_id);
+         cached = get_snapshot(snapshot);
+         snapshot_buf.emplace(cached->data);
+         snapshot_strm.emplace(&*snapshot_buf);
+         snapshot_reader = std::make_shared<eosio::chain::istream_snapshot_reader>(*snapshot_strm);
+         control         = std::make_unique<eosio::chain::controller>(*cfg, make_protocol_feature_set(), cached->chain_id);
       } else {
          control = std::make_unique<eosio::chain::controller>(*cfg, make_protocol_feature_set(),
                                                               genesis.compute_chain_id());
@@ -484,6 +543,7 @@ struct state {
    std::vector<std::unique_ptr<test_chain>>  chains;
    std::vector<std::unique_ptr<test_rodeos>> rodeoses;
    std::optional<uint32_t>                   selected_chain_index;
+   bool                                      interactive = true; ///< false when the output is captured
 };
 
 struct push_trx_args {
@@ -649,7 +709,7 @@ struct callbacks {
          throw ::assert_exception(span_str(msg));
    }
 
-   void prints_l(span<const char> str) { std::cerr.write(str.data(), str.size()); }
+   void prints_l(span<const char> str) { fwrite(str.data(), 1, str.size(), state.files[2].f); }
 
    uint32_t get_args(span<char> dest) {
       memcpy(dest.data(), state.args.data(), std::min(dest.size(), state.args.size()));
@@ -688,7 +748,7 @@ struct callbacks {
       return state.files[file_index];
    }
 
-   bool isatty(int32_t file_index) { return !assert_file(file_index).owns; }
+   bool isatty(int32_t file_index) { return !assert_file(file_index).owns && state.interactive; }
 
    void close_file(int32_t file_index) { assert_file(file_index).close(); }
 
@@ -1231,15 +1291,16 @@ void register_callbacks() {
    rhf_t::add<&callbacks::ripemd160>("env", "ripemd160");
 }
 
-static void run(const char* wasm, const std::vector<std::string>& args) {
+static void run(const char* wasm, const std::vector<std::string>& args, FILE* out, FILE* err, bool interactive) {
    eosio::vm::wasm_allocator wa;
    auto                      code = eosio::vm::read_wasm(wasm);
    backend_t                 backend(code, nullptr);
    ::state                   state{ wasm, wa, backend, eosio::convert_to_bin(args) };
    callbacks                 cb{ state };
+   state.interactive = interactive;
    state.files.emplace_back(stdin, false);
-   state.files.emplace_back(stdout, false);
-   state.files.emplace_back(stderr, false);
+   state.files.emplace_back(out, false);
+   state.files.emplace_back(err, false);
    backend.set_wasm_allocator(&wa);
 
    rhf_t::resolve(backend.get_module());
@@ -1247,19 +1308,127 @@ static void run(const char* wasm, const std::vector<std::string>& args) {
    backend(cb, "env", "start", 0);
 }
 
-const char usage[] = "usage: eosio-tester [-h or --help] [-v or --verbose] file.wasm [args for wasm]\n";
+// returns true if the wasm ran to completion, reports why it did not to err
+static bool run_and_report(const char* wasm, const std::vector<std::string>& args, FILE* out, FILE* err,
+                           bool interactive) {
+   std::string error;
+   try {
+      run(wasm, args, out, err, interactive);
+      return true;
+   } catch (::assert_exception& e) {
+      error = "tester wasm asserted: "s + e.what();
+   } catch (eosio::vm::exception& e) {
+      error = "vm::exception: "s + e.detail();
+   } catch (fc::exception& e) {
+      error = "fc::exception: " + e.to_string();
+   } catch (std::exception& e) {
+      error = "std::exception: "s + e.what();
+   }
+   fprintf(err, "%s\n", error.c_str());
+   return false;
+}
+
+struct suite_result {
+   bool        done    = false;
+   bool        success = false;
+   double      seconds = 0;
+   std::string output;
+};
+
+// Runs each wasm of a suite on its own thread, up to jobs at a time. Every test has its own chains in their own
+// directories, and its stdout and stderr are captured and written in the order of the suite once it is done, so the
+// output doesn't depend on the scheduling. Returns the number of tests that failed.
+static size_t run_suite(const std::vector<std::string>& wasms, uint32_t jobs) {
+   std::vector<suite_result> results(wasms.size());
+   std::atomic<size_t>       next_test{ 0 };
+   std::mutex                mutex;
+   std::condition_variable   cond;
+
+   auto run_tests = [&] {
+      while (true) {
+         const size_t i = next_test++;
+         if (i >= wasms.size())
+            break;
+         suite_result result;
+         auto         start = std::chrono::steady_clock::now();
+         file         captured{ tmpfile() };
+         if (!captured.f) {
+            result.output = "can not create a temporary file to capture the output\n";
+         } else {
+            result.success = run_and_report(wasms[i].c_str(), {}, captured.f, captured.f, false);
+            std::vector<char> buf(4096);
+            rewind(captured.f);
+            for (size_t n; (n = fread(buf.data(), 1, buf.size(), captured.f)) > 0;) result.output.append(buf.data(), n);
+         }
+         result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+         result.done    = true;
+         std::lock_guard lock(mutex);
+         results[i] = std::move(result);
+         cond.notify_all();
+      }
+   };
+
+   auto                     start = std::chrono::steady_clock::now();
+   std::vector<std::thread> threads;
+   for (uint32_t i = 0; i < std::min<size_t>(jobs, wasms.size()); ++i) threads.emplace_back(run_tests);
+
+   size_t failed     = 0;
+   double cumulative = 0;
+   for (size_t i = 0; i < wasms.size(); ++i) {
+      suite_result result;
+      {
+         std::unique_lock lock(mutex);
+         cond.wait(lock, [&] { return results[i].done; });
+         result = std::move(results[i]);
+      }
+      cumulative += result.seconds;
+      failed += !result.success;
+      fwrite(result.output.data(), 1, result.output.size(), stdout);
+      printf("%s %s (%.3f s)\n", result.success ? "PASSED" : "FAILED", wasms[i].c_str(), result.seconds);
+      fflush(stdout);
+   }
+   for (auto& t : threads) t.join();
+
+   auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   printf("%zu of %zu tests passed, %u jobs: %.3f s wall clock, %.3f s of tests, %.2fx speedup\n",
+          wasms.size() - failed, wasms.size(), jobs, wall, cumulative, wall > 0 ? cumulative / wall : 1.0);
+   return failed;
+}
+
+const char usage[] = "usage: eosio-tester [options] file.wasm [args for wasm]\n"
+                     "       eosio-tester [options] --suite file.wasm...\n"
+                     "options:\n"
+                     "  -h, --help                 show this help\n"
+                     "  -v, --verbose              show the log of the chains\n"
+                     "  -j, --jobs N               with --suite, number of tests run at the same time\n"
+                     "                             (default: number of cores)\n"
+                     "  --base-snapshot file       start the chains created without a snapshot from this\n"
+                     "                             snapshot instead of genesis\n"
+                     "  --suite                    run each of the wasm files as a test, without args\n";
 
 int main(int argc, char* argv[]) {
    fc::logger::get(DEFAULT_LOGGER).set_log_level(fc::log_level::off);
 
-   bool show_usage = false;
-   bool error      = false;
-   int  next_arg   = 1;
+   bool     show_usage = false;
+   bool     error      = false;
+   bool     suite      = false;
+   uint32_t jobs       = std::max(1u, std::thread::hardware_concurrency());
+   int      next_arg   = 1;
    while (next_arg < argc && argv[next_arg][0] == '-') {
       if (!strcmp(argv[next_arg], "-h") || !strcmp(argv[next_arg], "--help"))
          show_usage = true;
       else if (!strcmp(argv[next_arg], "-v") || !strcmp(argv[next_arg], "--verbose"))
          fc::logger::get(DEFAULT_LOGGER).set_log_level(fc::log_level::debug);
+      else if (!strcmp(argv[next_arg], "--suite"))
+         suite = true;
+      else if ((!strcmp(argv[next_arg], "-j") || !strcmp(argv[next_arg], "--jobs")) && next_arg + 1 < argc) {
+         jobs = strtoul(argv[++next_arg], nullptr, 10);
+         if (!jobs) {
+            std::cerr << "--jobs must be at least 1\n";
+            error = true;
+         }
+      } else if (!strcmp(argv[next_arg], "--base-snapshot") && next_arg + 1 < argc)
+         base_snapshot = argv[++next_arg];
       else {
          std::cerr << "unknown option: " << argv[next_arg] << "\n";
          error = true;
@@ -1272,19 +1441,9 @@ int main(int argc, char* argv[]) {
       std::cerr << usage;
       return error;
    }
-   try {
-      std::vector<std::string> args{ argv + next_arg + 1, argv + argc };
-      register_callbacks();
-      run(argv[next_arg], args);
-      return 0;
-   } catch (::assert_exception& e) {
-      std::cerr << "tester wasm asserted: " << e.what() << "\n";
-   } catch (eosio::vm::exception& e) {
-      std::cerr << "vm::exception: " << e.detail() << "\n";
-   } catch (fc::exception& e) {
-      std::cerr << "fc::exception: " << e.to_string() << "\n";
-   } catch (std::exception& e) { 
-     std::cerr << "std::exception: " << e.what() << "\n"; 
-   }
-   return 1;
+   register_callbacks();
+   if (suite)
+      return run_suite({ argv + next_arg, argv + argc }, jobs) != 0;
+   std::vector<std::string> args{ argv + next_arg + 1, argv + argc };
+   return !run_and_report(argv[next_arg], args, stdout, stderr, true);
 }
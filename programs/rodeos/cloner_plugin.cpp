@@ -13,6 +13,8 @@
 #include <boost/beast/core.hpp>
 #include <boost/beast/websocket.hpp>
 
+#include <atomic>
+
 namespace b1 {
 
 using namespace appbase;
@@ -38,6 +40,7 @@ struct cloner_config : ship_client::connection_config {
    uint32_t    skip_to     = 0;
    uint32_t    stop_before = 0;
    bool        exit_on_filter_wasm_error = false;
+   uint32_t    snapshot_retention        = 0;
    eosio::name filter_name = {}; // todo: remove
    std::string filter_wasm = {}; // todo: remove
 };
@@ -48,10 +51,28 @@ struct cloner_plugin_impl : std::enable_shared_from_this<cloner_plugin_impl> {
    boost::asio::deadline_timer                                              timer;
    std::function<void(const char* data, uint64_t data_size)>                streamer = {};
 
+   // states at the end of recent blocks; outlives sessions so reconnects keep them
+   std::shared_ptr<chain_kv::revision_snapshots>                            snapshots;
+
+   // replication progress, read by other threads (e.g. wasm-ql) through cloner_plugin::get_replication_status
+   std::atomic<uint32_t>                                                    replica_head     = 0;
+   std::atomic<uint32_t>                                                    source_head      = 0;
+   std::atomic<uint32_t>                                                    source_lib       = 0;
+   std::atomic<int64_t>                                                     last_update_us   = 0;
+
    cloner_plugin_impl() : timer(app().get_io_service()) {}
 
    ~cloner_plugin_impl();
 
+   void update_replication_status(uint32_t block_num, uint32_t head, uint32_t lib, bool report) {
+      replica_head   = block_num;
+      source_head    = head;
+      source_lib     = lib;
+      last_update_us = fc::time_point::now().time_since_epoch().count();
+      if (report)
+         ilog("replication lag: ${l} blocks behind head ${h}", ("l", head > block_num ? head - block_num : 0)("h", head));
+   }
+
    void schedule_retry() {
       timer.expires_from_now(boost::posix_time::seconds(1));
       timer.async_wait([this](auto&) {
@@ -68,7 +89,7 @@ struct cloner_session : ship_client::connection_callbacks, std::enable_shared_fr
    std::shared_ptr<cloner_config>       config;
    std::shared_ptr<chain_kv::database>  db = app().find_plugin<rocksdb_plugin>()->get_db();
    std::shared_ptr<rodeos_db_partition> partition =
-         std::make_shared<rodeos_db_partition>(db, std::vector<char>{}); // todo: prefix
+         std::make_shared<rodeos_db_partition>(db, std::vector<char>{}, my->snapshots); // todo: prefix
 
    std::optional<rodeos_db_snapshot>        rodeos_snapshot;
    std::shared_ptr<ship_client::connection> connection;
@@ -97,7 +118,7 @@ struct cloner_session : ship_client::connection_callbacks, std::enable_shared_fr
       rodeos_snapshot->end_write(true);
       db->flush(true, true);
 
-      connection = std::make_shared<ship_client::connection>(ioc, *config, shared_from_this());
+      connection = ship_client::connection::create(ioc, *config, shared_from_this());
       connection->connect();
    }
 
@@ -175,6 +196,9 @@ struct cloner_session : ship_client::connection_callbacks, std::enable_shared_fr
       }
 
       rodeos_snapshot->end_block(result, false);
+      if (my)
+         my->update_replication_status(result.this_block->block_num, result.head.block_num,
+                                       result.last_irreversible.block_num, write_now);
       return true;
    }
 
@@ -220,11 +244,15 @@ void cloner_plugin::set_program_options(options_description& cli, options_descri
    auto op   = cfg.add_options();
    auto clop = cli.add_options();
    op("clone-connect-to,f", bpo::value<std::string>()->default_value("127.0.0.1:8080"),
-      "State-history endpoint to connect to (nodeos)");
+      "State-history endpoint to connect to (nodeos), either host:port or unix:<path> for a local unix socket");
    clop("clone-skip-to,k", bpo::value<uint32_t>(), "Skip blocks before [arg]");
    clop("clone-stop,x", bpo::value<uint32_t>(), "Stop before block [arg]");
    op("clone-exit-on-filter-wasm-error", bpo::bool_switch()->default_value(false),
       "Shutdown application if filter wasm throws an exception");
+   op("clone-snapshot-retention", bpo::value<uint32_t>()->default_value(0),
+      "Number of recent blocks whose state is kept readable while later blocks are cloned. wasm-ql queries select "
+      "one with the block_num field of send_transaction. Each one pins a rocksdb snapshot, which keeps the data it "
+      "sees from being compacted away.");
    op("telemetry-url", bpo::value<std::string>(),
       "Send Zipkin spans to url. e.g. http://127.0.0.1:9411/api/v2/spans" );
    op("telemetry-service-name", bpo::value<std::string>()->default_value(b1::rodeos::config::rodeos_executable_name),
@@ -244,11 +272,20 @@ void cloner_plugin::plugin_initialize(const variables_map& options) {
 
       auto port               = endpoint.substr(endpoint.find(':') + 1, endpoint.size());
       auto host               = endpoint.substr(0, endpoint.find(':'));
-      my->config->host        = host;
-      my->config->port        = port;
+      if (host == "unix") {
+         if (port.empty())
+            throw std::runtime_error("invalid endpoint: " + endpoint);
+         my->config->unix_path = port;
+      } else {
+         my->config->host     = host;
+         my->config->port     = port;
+      }
       my->config->skip_to     = options.count("clone-skip-to") ? options["clone-skip-to"].as<uint32_t>() : 0;
       my->config->stop_before = options.count("clone-stop") ? options["clone-stop"].as<uint32_t>() : 0;
       my->config->exit_on_filter_wasm_error = options["clone-exit-on-filter-wasm-error"].as<bool>();
+      my->config->snapshot_retention        = options["clone-snapshot-retention"].as<uint32_t>();
+      my->snapshots = std::make_shared<chain_kv::revision_snapshots>(*app().find_plugin<rocksdb_plugin>()->get_db(),
+                                                                     my->config->snapshot_retention);
       if (options.count("filter-name") && options.count("filter-wasm")) {
          my->config->filter_name = eosio::name{ options["filter-name"].as<std::string>() };
          my->config->filter_wasm = options["filter-wasm"].as<std::string>();
@@ -284,4 +321,22 @@ void cloner_plugin::set_streamer(std::function<void(const char* data, uint64_t d
 void cloner_plugin::handle_sighup() {
 }
 
+cloner_plugin::replication_status cloner_plugin::get_replication_status() const {
+   replication_status result;
+   result.replica_head_block_num = my->replica_head;
+   result.source_head_block_num  = my->source_head;
+   result.source_irreversible_block_num = my->source_lib;
+   result.head_block_lag = result.source_head_block_num > result.replica_head_block_num
+                                 ? result.source_head_block_num - result.replica_head_block_num
+                                 : 0;
+   if (my->last_update_us)
+      result.time_since_last_block_ms =
+            (fc::time_point::now().time_since_epoch().count() - my->last_update_us) / 1000;
+   return result;
+}
+
+std::shared_ptr<chain_kv::revision_snapshots> cloner_plugin::get_revision_snapshots() const {
+   return my->snapshots;
+}
+
 } // namespace b1
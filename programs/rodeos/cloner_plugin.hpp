@@ -18,6 +18,21 @@ class cloner_plugin : public appbase::plugin<cloner_plugin> {
 
    void set_streamer(std::function<void(const char* data, uint64_t data_size)> streamer_function);
 
+   struct replication_status {
+      uint32_t replica_head_block_num        = 0;
+      uint32_t source_head_block_num         = 0;
+      uint32_t source_irreversible_block_num = 0;
+      uint32_t head_block_lag                = 0;
+      int64_t  time_since_last_block_ms      = -1;
+   };
+
+   /// thread safe
+   replication_status get_replication_status() const;
+
+   /// States at the end of the recently cloned blocks, set by plugin_initialize. Pass it to a rodeos_db_partition to
+   /// read them through rodeos_db_snapshot{ partition, rodeos::at_block{ block_num } }.
+   std::shared_ptr<chain_kv::revision_snapshots> get_revision_snapshots() const;
+
  private:
    std::shared_ptr<struct cloner_plugin_impl> my;
 };
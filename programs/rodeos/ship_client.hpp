@@ -7,6 +7,7 @@
 #include <abieos.hpp>
 #include <boost/asio/connect.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/websocket.hpp>
 #include <fc/exception/exception.hpp>
@@ -34,6 +35,7 @@ struct connection_callbacks {
 struct connection_config {
    std::string host;
    std::string port;
+   std::string unix_path; // connect over a unix socket instead of host:port when not empty
 };
 
 struct abi_def_skip_table : eosio::abi_def {};
@@ -41,53 +43,36 @@ struct abi_def_skip_table : eosio::abi_def {};
 EOSIO_REFLECT(abi_def_skip_table, version, types, structs, actions, ricardian_clauses, error_messages, abi_extensions,
               variants);
 
+/// protocol handling shared by the tcp and unix socket transports
 struct connection : std::enable_shared_from_this<connection> {
    using error_code  = boost::system::error_code;
    using flat_buffer = boost::beast::flat_buffer;
-   using tcp         = boost::asio::ip::tcp;
    using abi_type    = eosio::abi_type;
 
-   connection_config                            config;
-   std::shared_ptr<connection_callbacks>        callbacks;
-   tcp::resolver                                resolver;
-   boost::beast::websocket::stream<tcp::socket> stream;
-   bool                                         have_abi  = false;
-   abi_def_skip_table                           abi       = {};
-   std::map<std::string, abi_type>              abi_types = {};
+   connection_config                     config;
+   std::shared_ptr<connection_callbacks> callbacks;
+   bool                                  have_abi  = false;
+   abi_def_skip_table                    abi       = {};
+   std::map<std::string, abi_type>       abi_types = {};
 
-   connection(boost::asio::io_context& ioc, const connection_config& config,
-              std::shared_ptr<connection_callbacks> callbacks)
-       : config(config), callbacks(callbacks), resolver(ioc), stream(ioc) {
+   connection(const connection_config& config, std::shared_ptr<connection_callbacks> callbacks)
+       : config(config), callbacks(callbacks) {}
+   virtual ~connection() = default;
 
-      stream.binary(true);
-      stream.read_message_max(10ull * 1024 * 1024 * 1024);
-   }
+   static std::shared_ptr<connection> create(boost::asio::io_context& ioc, const connection_config& config,
+                                             std::shared_ptr<connection_callbacks> callbacks);
 
-   void connect() {
-      ilog("connect to ${h}:${p}", ("h", config.host)("p", config.port));
-      resolver.async_resolve( //
-            config.host, config.port,
-            [self = shared_from_this(), this](error_code ec, tcp::resolver::results_type results) {
-               enter_callback(ec, "resolve", [&] {
-                  boost::asio::async_connect( //
-                        stream.next_layer(), results.begin(), results.end(),
-                        [self = shared_from_this(), this](error_code ec, auto&) {
-                           enter_callback(ec, "connect", [&] {
-                              stream.async_handshake( //
-                                    config.host, "/", [self = shared_from_this(), this](error_code ec) {
-                                       enter_callback(ec, "handshake", [&] { //
-                                          start_read();
-                                       });
-                                    });
-                           });
-                        });
-               });
-            });
-   }
+   virtual void connect() = 0;
 
+ protected:
+   virtual void async_read(flat_buffer& buffer, std::function<void(error_code, size_t)> handler)                 = 0;
+   virtual void async_write(boost::asio::const_buffer buffer, std::function<void(error_code, size_t)> handler) = 0;
+   virtual void close_socket()                                                                                  = 0;
+
+ public:
    void start_read() {
       auto in_buffer = std::make_shared<flat_buffer>();
-      stream.async_read(*in_buffer, [self = shared_from_this(), this, in_buffer](error_code ec, size_t) {
+      async_read(*in_buffer, [self = shared_from_this(), this, in_buffer](error_code ec, size_t) {
          enter_callback(ec, "async_read", [&] {
             if (!have_abi)
                receive_abi(in_buffer);
@@ -162,7 +147,7 @@ struct connection : std::enable_shared_from_this<connection> {
    void send(const ship::request& req) {
       auto bin = std::make_shared<std::vector<char>>();
       eosio::convert_to_bin(req, *bin);
-      stream.async_write(boost::asio::buffer(*bin), [self = shared_from_this(), bin, this](error_code ec, size_t) {
+      async_write(boost::asio::buffer(*bin), [self = shared_from_this(), bin, this](error_code ec, size_t) {
          enter_callback(ec, "async_write", [&] {});
       });
    }
@@ -196,11 +181,89 @@ struct connection : std::enable_shared_from_this<connection> {
 
    void close(bool retry) {
       ilog("closing state-history socket");
-      stream.next_layer().close();
+      close_socket();
       if (callbacks)
          callbacks->closed(retry);
       callbacks.reset();
    }
 }; // connection
 
+template <typename SocketType>
+struct socket_connection : connection {
+   boost::beast::websocket::stream<SocketType> stream;
+
+   socket_connection(boost::asio::io_context& ioc, const connection_config& config,
+                     std::shared_ptr<connection_callbacks> callbacks)
+       : connection(config, std::move(callbacks)), stream(ioc) {
+
+      stream.binary(true);
+      stream.read_message_max(10ull * 1024 * 1024 * 1024);
+   }
+
+   void handshake(const std::string& host) {
+      stream.async_handshake( //
+            host, "/", [self = shared_from_this(), this](error_code ec) {
+               enter_callback(ec, "handshake", [&] { //
+                  start_read();
+               });
+            });
+   }
+
+ protected:
+   void async_read(flat_buffer& buffer, std::function<void(error_code, size_t)> handler) override {
+      stream.async_read(buffer, std::move(handler));
+   }
+
+   void async_write(boost::asio::const_buffer buffer, std::function<void(error_code, size_t)> handler) override {
+      stream.async_write(buffer, std::move(handler));
+   }
+
+   void close_socket() override { stream.next_layer().close(); }
+}; // socket_connection
+
+struct tcp_connection : socket_connection<boost::asio::ip::tcp::socket> {
+   using tcp = boost::asio::ip::tcp;
+
+   tcp::resolver resolver;
+
+   tcp_connection(boost::asio::io_context& ioc, const connection_config& config,
+                  std::shared_ptr<connection_callbacks> callbacks)
+       : socket_connection(ioc, config, std::move(callbacks)), resolver(ioc) {}
+
+   void connect() override {
+      ilog("connect to ${h}:${p}", ("h", config.host)("p", config.port));
+      resolver.async_resolve( //
+            config.host, config.port,
+            [self = shared_from_this(), this](error_code ec, tcp::resolver::results_type results) {
+               enter_callback(ec, "resolve", [&] {
+                  boost::asio::async_connect( //
+                        stream.next_layer(), results.begin(), results.end(),
+                        [self = shared_from_this(), this](error_code ec, auto&) {
+                           enter_callback(ec, "connect", [&] { handshake(config.host); });
+                        });
+               });
+            });
+   }
+}; // tcp_connection
+
+struct unix_connection : socket_connection<boost::asio::local::stream_protocol::socket> {
+   using socket_connection::socket_connection;
+
+   void connect() override {
+      ilog("connect to unix socket ${p}", ("p", config.unix_path));
+      stream.next_layer().async_connect( //
+            boost::asio::local::stream_protocol::endpoint{ config.unix_path },
+            [self = shared_from_this(), this](error_code ec) {
+               enter_callback(ec, "connect", [&] { handshake("localhost"); });
+            });
+   }
+}; // unix_connection
+
+inline std::shared_ptr<connection> connection::create(boost::asio::io_context& ioc, const connection_config& config,
+                                                      std::shared_ptr<connection_callbacks> callbacks) {
+   if (!config.unix_path.empty())
+      return std::make_shared<unix_connection>(ioc, config, std::move(callbacks));
+   return std::make_shared<tcp_connection>(ioc, config, std::move(callbacks));
+}
+
 } // namespace b1::ship_client
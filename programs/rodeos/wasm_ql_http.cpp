@@ -232,6 +232,9 @@ void handle_request(const wasm_ql::http_config& http_config, const wasm_ql::shar
                  "application/json"));
          state_cache.store_state(std::move(thread_state));
          return;
+      } else if (req.target() == "/v1/rodeos/get_replication_status" && http_config.replication_status) {
+         auto status = http_config.replication_status();
+         return send(ok(std::vector<char>(status.begin(), status.end()), "application/json"));
       } else if (req.target() == "/v1/chain/get_required_keys") { // todo: replace with a binary endpoint?
          if (req.method() != http::verb::post)
             return send(
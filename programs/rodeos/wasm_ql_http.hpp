@@ -11,6 +11,8 @@ struct http_config {
    std::string static_dir       = {};
    std::string address          = {};
    std::string port             = {};
+
+   std::function<std::string()> replication_status = {}; // json; served on /v1/rodeos/get_replication_status when set
 };
 
 struct http_server {
@@ -1,9 +1,13 @@
 #include "wasm_ql_plugin.hpp"
+#include "cloner_plugin.hpp"
 #include "wasm_ql_http.hpp"
 
+#include <b1/rodeos/rodeos.hpp>
 #include <b1/rodeos/wasm_ql.hpp>
 #include <fc/exception/exception.hpp>
+#include <fc/io/json.hpp>
 #include <fc/log/logger.hpp>
+#include <fc/variant_object.hpp>
 
 using namespace appbase;
 using namespace b1::rodeos;
@@ -81,6 +85,22 @@ void wasm_ql_plugin::plugin_initialize(const variables_map& options) {
          http_config->allow_origin = options.at("wql-allow-origin").as<std::string>();
       if (options.count("wql-static-dir"))
          http_config->static_dir = options.at("wql-static-dir").as<std::string>();
+      std::shared_ptr<b1::chain_kv::revision_snapshots> snapshots;
+      if (auto cloner = app().find_plugin<cloner_plugin>(); cloner && cloner->get_state() != abstract_plugin::registered) {
+         snapshots = cloner->get_revision_snapshots();
+         http_config->replication_status = [cloner] {
+            auto status = cloner->get_replication_status();
+            return fc::json::to_string(fc::mutable_variant_object()
+                                             ("replica_head_block_num", status.replica_head_block_num)
+                                             ("source_head_block_num", status.source_head_block_num)
+                                             ("source_irreversible_block_num", status.source_irreversible_block_num)
+                                             ("head_block_lag", status.head_block_lag)
+                                             ("time_since_last_block_ms", status.time_since_last_block_ms),
+                                       fc::time_point::maximum());
+         };
+      }
+      // send_transaction with a block_num reads the states kept by the cloner (--clone-snapshot-retention)
+      shared_state->partition = std::make_shared<rodeos_db_partition>(shared_state->db, std::vector<char>{}, snapshots);
    }
    FC_LOG_AND_RETHROW()
 }
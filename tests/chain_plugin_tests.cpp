@@ -19,6 +19,8 @@
 #include <fc/io/json.hpp>
 
 #include <array>
+#include <functional>
+#include <set>
 #include <utility>
 
 #ifdef NON_VALIDATING_TEST
@@ -181,4 +183,71 @@ BOOST_FIXTURE_TEST_CASE( get_info, TESTER ) try {
    BOOST_TEST(*info.last_irreversible_block_time == control->last_irreversible_block_time());
 } FC_LOG_AND_RETHROW() //get_info
 
+BOOST_FIXTURE_TEST_CASE( get_scheduled_transactions_cursor, TESTER ) try {
+   produce_blocks(1);
+
+   // deferred transactions written directly in the state, ten of them due at each time so that the cursor has to
+   // tell them apart by id
+   auto& db = control->mutable_db();
+   const auto start = control->head_block_time() + fc::days(1);
+   std::vector<transaction_id_type> expected;
+   for( uint32_t i = 0; i < 500; ++i ) {
+      const auto& gto = db.create<generated_transaction_object>( [&]( auto& obj ) {
+         obj.trx_id      = fc::sha256::hash( std::to_string(i) );
+         obj.sender      = "alice"_n;
+         obj.sender_id   = i;
+         obj.payer       = "alice"_n;
+         obj.delay_until = start + fc::seconds( i / 10 );
+         obj.expiration  = obj.delay_until + fc::hours(1);
+         obj.published   = control->head_block_time();
+      });
+      expected.push_back( gto.trx_id );
+   }
+
+   chain_apis::read_only plugin(*(this->control), {}, fc::microseconds::maximum());
+   auto page_all = [&]( uint32_t limit, const std::function<void(const string&)>& between_pages ) {
+      std::vector<transaction_id_type> ids;
+      chain_apis::read_only::get_scheduled_transactions_params params;
+      params.limit = limit;
+      for(;;) {
+         auto result = plugin.get_scheduled_transactions( params );
+         for( const auto& trx : result.transactions )
+            ids.push_back( trx["trx_id"].as<transaction_id_type>() );
+         if( result.next_cursor.empty() ) {
+            BOOST_REQUIRE( result.more.empty() );
+            return ids;
+         }
+         between_pages( result.next_cursor );
+         params.cursor = result.next_cursor;
+      }
+   };
+
+   BOOST_CHECK( page_all( 7, []( const string& ) {} ) == expected );
+
+   // the transaction the cursor points to goes away between pages, the next page starts at the one after it
+   std::set<transaction_id_type> removed;
+   auto remove_next = [&]( const string& cursor ) {
+      chain_apis::read_only::get_scheduled_transactions_params params;
+      params.cursor = cursor;
+      params.limit = 1;
+      auto next = plugin.get_scheduled_transactions( params );
+      BOOST_REQUIRE_EQUAL( 1u, next.transactions.size() );
+      const auto id = next.transactions[0]["trx_id"].as<transaction_id_type>();
+      db.remove( db.get<generated_transaction_object, by_trx_id>( id ) );
+      removed.insert( id );
+   };
+   auto remaining = page_all( 7, remove_next );
+   std::vector<transaction_id_type> expected_remaining;
+   std::copy_if( expected.begin(), expected.end(), std::back_inserter(expected_remaining), [&]( const auto& id ) {
+      return !removed.count( id );
+   });
+   BOOST_TEST( !removed.empty() );
+   BOOST_CHECK( remaining == expected_remaining );
+
+   chain_apis::read_only::get_scheduled_transactions_params params;
+   params.cursor = "00";
+   BOOST_CHECK_THROW( plugin.get_scheduled_transactions( params ), transaction_exception );
+
+} FC_LOG_AND_RETHROW() //get_scheduled_transactions_cursor
+
 BOOST_AUTO_TEST_SUITE_END()
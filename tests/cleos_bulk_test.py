@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+import json
+import shlex
+import subprocess
+import time
+import unittest
+
+from testUtils import Utils
+from Cluster import Cluster
+from Node import Node
+from WalletMgr import WalletMgr
+from core_symbol import CORE_SYMBOL
+
+class CleosBulkTest(unittest.TestCase):
+    sleep_s = 1
+    transfers = 200
+    window = 16
+    cluster=Cluster(walletd=True, defproduceraPrvtKey=None)
+    walletMgr=WalletMgr(True)
+    accounts = []
+    cluster.setWalletMgr(walletMgr)
+
+    # kill nodeos and keosd and clean up dir
+    def cleanEnv(self, shouldCleanup: bool) :
+        self.cluster.killall(allInstances=True)
+        if shouldCleanup:
+            self.cluster.cleanup()
+        self.walletMgr.killall(allInstances=True)
+        if shouldCleanup:
+            self.walletMgr.cleanup()
+
+    # start keosd and nodeos
+    def startEnv(self) :
+        account_names = ["alice", "bob"]
+        self.cluster.launch(totalNodes=1)
+        self.walletMgr.launch()
+        testWalletName="testwallet"
+        testWallet=self.walletMgr.create(testWalletName, [self.cluster.eosioAccount, self.cluster.defproduceraAccount])
+        self.cluster.validateAccounts(None)
+        self.accounts=Cluster.createAccountKeys(len(account_names))
+        node = self.cluster.getNode(0)
+        for idx in range(len(account_names)):
+            self.accounts[idx].name =  account_names[idx]
+            self.walletMgr.importKey(self.accounts[idx], testWallet)
+        for account in self.accounts:
+            node.createInitializeAccount(account, self.cluster.eosioAccount, buyRAM=1000000, stakedDeposit=5000000, waitForTransBlock=True, exitOnError=True)
+        time.sleep(self.sleep_s)
+
+    def transfer_line(self, quantity: str, memo: str) -> str:
+        return json.dumps({"account": "eosio.token", "name": "transfer",
+                           "data": {"from": "alice", "to": "bob", "quantity": quantity, "memo": memo}})
+
+    def push_bulk(self, node: Node, lines: list) -> subprocess.CompletedProcess:
+        cmd = "%s %s push bulk - -p alice@active --window %d" % (Utils.EosClientPath, node.eosClientArgs(), self.window)
+        return subprocess.run(shlex.split(cmd), input="\n".join(lines).encode(), stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+
+    def test_PushBulk(self) :
+        node = self.cluster.getNode(0)
+        aliceBalance = node.getAccountEosBalanceStr("alice")
+        bobBalance = node.getAccountEosBalanceStr("bob")
+
+        xferAmount = Node.currencyIntToStr(1, CORE_SYMBOL)
+        lines = [self.transfer_line(xferAmount, "bulk %d" % i) for i in range(self.transfers)]
+        lines.append("")                                                            # blank, skipped
+        lines.append("{not json")                                                   # parse error
+        lines.append(self.transfer_line(Node.currencyIntToStr(10**12, CORE_SYMBOL), "overdrawn")) # fails in the contract
+
+        completed = self.push_bulk(node, lines)
+        self.assertNotEqual(completed.returncode, 0)
+
+        results = [json.loads(l) for l in completed.stdout.decode().splitlines()]
+        self.assertEqual(len(results), self.transfers + 2)
+        byIndex = {r["index"]: r for r in results}
+        self.assertEqual(len(byIndex), len(results))
+        trxIds = set()
+        for i in range(self.transfers):
+            self.assertIn("transaction_id", byIndex[i], byIndex[i])
+            self.assertEqual(byIndex[i]["result"]["transaction_id"], byIndex[i]["transaction_id"])
+            trxIds.add(byIndex[i]["transaction_id"])
+        self.assertEqual(len(trxIds), self.transfers)
+        self.assertNotIn(self.transfers, byIndex)
+        self.assertIn("error", byIndex[self.transfers + 1])
+        self.assertIn("error", byIndex[self.transfers + 2])
+
+        totalAmount = Node.currencyIntToStr(self.transfers, CORE_SYMBOL)
+        self.assertEqual(node.getAccountEosBalanceStr("alice"), Utils.deduceAmount(aliceBalance, totalAmount))
+        self.assertEqual(node.getAccountEosBalanceStr("bob"), Utils.addAmount(bobBalance, totalAmount))
+
+    @classmethod
+    def setUpClass(self):
+        self.cleanEnv(self, shouldCleanup=True)
+        self.startEnv(self)
+
+    @classmethod
+    def tearDownClass(self):
+        self.cleanEnv(self, shouldCleanup=False)   # not cleanup to save log in case for further investigation
+
+if __name__ == "__main__":
+    unittest.main()
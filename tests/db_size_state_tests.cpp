@@ -0,0 +1,333 @@
+#include <boost/test/unit_test.hpp>
+
+#include <eosio/testing/tester.hpp>
+#include <eosio/chain/abi_serializer.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <eosio/db_size_api_plugin/state_size_tracker.hpp>
+
+#include <contracts.hpp>
+
+#include <fc/variant_object.hpp>
+
+#include <algorithm>
+#include <random>
+#include <set>
+
+#include <eosio/testing/backing_store_tester_macros.hpp>
+
+using namespace eosio;
+using namespace eosio::chain;
+using namespace eosio::testing;
+using namespace fc;
+
+BOOST_AUTO_TEST_SUITE(db_size_state_tests)
+
+using backing_store_ts = boost::mpl::list<TESTER, ROCKSDB_TESTER>;
+// testers that can start without a chain, to receive the blocks of another one
+using fork_ts = boost::mpl::list<tester, rocksdb_tester>;
+
+namespace {
+
+// keeps a tracker connected to the blocks of t, like db_size_api_plugin does
+struct connected_tracker {
+   state_size_tracker                tracker;
+   boost::signals2::scoped_connection accepted;
+   boost::signals2::scoped_connection irreversible;
+
+   explicit connected_tracker(base_tester& t)
+      : tracker(*t.control)
+      , accepted(t.control->accepted_block.connect([this](const block_state_ptr& b) { tracker.on_accepted_block(b); }))
+      , irreversible(t.control->irreversible_block.connect([this](const block_state_ptr& b) { tracker.on_irreversible_block(b); })) {}
+};
+
+void check_counts(base_tester& t, const state_size_tracker& tracker) {
+   const auto counted = state_size_tracker::count(*t.control);
+   BOOST_REQUIRE_EQUAL(counted.size(), tracker.table_sizes().size());
+   for (const auto& [key, size] : counted) {
+      auto itr = tracker.table_sizes().find(key);
+      BOOST_REQUIRE(itr != tracker.table_sizes().end());
+      BOOST_TEST_CONTEXT(std::get<0>(key) << " " << std::get<1>(key)) {
+         BOOST_CHECK_EQUAL(size.row_count, itr->second.row_count);
+         BOOST_CHECK_EQUAL(size.secondary_index_row_count, itr->second.secondary_index_row_count);
+         BOOST_CHECK_EQUAL(size.bytes, itr->second.bytes);
+      }
+   }
+}
+
+void transfer(base_tester& t, name from, name to, const std::string& quantity) {
+   t.push_action("eosio.token"_n, "transfer"_n, from, mutable_variant_object()
+                 ("from", from)("to", to)("quantity", quantity)("memo", ""));
+}
+
+// the contracts of incremental_counts_test, with some SYS in each of accs
+void deploy_contracts(base_tester& t, const std::vector<account_name>& accs) {
+   t.create_accounts({ "eosio.token"_n, "test"_n, "kvaddrbook"_n });
+   t.create_accounts(accs);
+   t.set_code(config::system_account_name, contracts::kv_bios_wasm());
+   t.set_abi(config::system_account_name, contracts::kv_bios_abi().data());
+   t.push_action("eosio"_n, "ramkvlimits"_n, "eosio"_n, mutable_variant_object()("k", 1024)("v", 1024)("i", 1024));
+   t.set_code("eosio.token"_n, contracts::eosio_token_wasm());
+   t.set_abi("eosio.token"_n, contracts::eosio_token_abi().data());
+   t.set_code("test"_n, contracts::get_table_seckey_test_wasm());
+   t.set_abi("test"_n, contracts::get_table_seckey_test_abi().data());
+   t.set_code("kvaddrbook"_n, contracts::kv_addr_book_wasm());
+   t.set_abi("kvaddrbook"_n, contracts::kv_addr_book_abi().data());
+   t.produce_block();
+   t.push_action("eosio.token"_n, "create"_n, "eosio.token"_n, mutable_variant_object()
+                 ("issuer", "eosio")("maximum_supply", "1000000000.0000 SYS"));
+   t.push_action("eosio.token"_n, "issue"_n, "eosio"_n, mutable_variant_object()
+                 ("to", "eosio")("quantity", "1000.0000 SYS")("memo", ""));
+   for (auto a : accs)
+      transfer(t, "eosio"_n, a, "100.0000 SYS");
+   t.produce_block();
+}
+
+void add_numobj(base_tester& t, uint64_t input) {
+   t.push_action("test"_n, "addnumobj"_n, "test"_n, mutable_variant_object()("input", input)("nm", "n" + std::to_string(input)));
+}
+
+void upsert_person(base_tester& t, name account, const std::string& street) {
+   t.push_action("kvaddrbook"_n, "upsert"_n, "kvaddrbook"_n, mutable_variant_object()
+                 ("account_name", account)("first_name", account.to_string())("last_name", "last")("street", street)
+                 ("city", "city")("state", "state")("country", "country")("personal_id", account.to_string()));
+}
+
+void delete_person(base_tester& t, name account) {
+   t.push_action("kvaddrbook"_n, "del"_n, "kvaddrbook"_n, mutable_variant_object()("account_name", account));
+}
+
+void push_blocks(base_tester& from, base_tester& to, uint32_t first_block_num) {
+   for (uint32_t n = first_block_num; n <= from.control->head_block_num(); ++n)
+      to.push_block(from.control->fetch_block_by_number(n));
+}
+
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( incremental_counts_test, TESTER_T, backing_store_ts) { try {
+   TESTER_T t;
+   t.produce_blocks(2);
+
+   std::vector<account_name> accs{"inita"_n, "initb"_n, "initc"_n, "initd"_n};
+   t.create_accounts({ "eosio.token"_n, "test"_n, "kvaddrbook"_n });
+   t.create_accounts(accs);
+   t.produce_block();
+
+   connected_tracker ct(t);
+
+   t.set_code(config::system_account_name, contracts::kv_bios_wasm());
+   t.set_abi(config::system_account_name, contracts::kv_bios_abi().data());
+   t.push_action("eosio"_n, "ramkvlimits"_n, "eosio"_n, mutable_variant_object()("k", 1024)("v", 1024)("i", 1024));
+   t.set_code("eosio.token"_n, contracts::eosio_token_wasm());
+   t.set_abi("eosio.token"_n, contracts::eosio_token_abi().data());
+   t.set_code("test"_n, contracts::get_table_seckey_test_wasm());
+   t.set_abi("test"_n, contracts::get_table_seckey_test_abi().data());
+   t.set_code("kvaddrbook"_n, contracts::kv_addr_book_wasm());
+   t.set_abi("kvaddrbook"_n, contracts::kv_addr_book_abi().data());
+   t.produce_block();
+   check_counts(t, ct.tracker);
+
+   t.push_action("eosio.token"_n, "create"_n, "eosio.token"_n, mutable_variant_object()
+                 ("issuer", "eosio")("maximum_supply", "1000000000.0000 SYS"));
+   t.push_action("eosio.token"_n, "issue"_n, "eosio"_n, mutable_variant_object()
+                 ("to", "eosio")("quantity", "1000.0000 SYS")("memo", ""));
+   for (auto a : accs)
+      transfer(t, "eosio"_n, a, "100.0000 SYS");
+   t.push_action("kvaddrbook"_n, "test"_n, "kvaddrbook"_n, mutable_variant_object());
+   t.produce_block();
+   check_counts(t, ct.tracker);
+
+   // rows created, modified and removed over several blocks, some of them in the same block
+   for (uint64_t i = 0; i < 20; ++i) {
+      t.push_action("test"_n, "addnumobj"_n, "test"_n, mutable_variant_object()("input", i)("nm", "n" + std::to_string(i)));
+      transfer(t, accs[i % accs.size()], accs[(i + 1) % accs.size()], "1.0000 SYS");
+      if (i % 5 == 0) {
+         const auto a = accs[i % accs.size()];
+         transfer(t, a, "eosio"_n, t.get_currency_balance("eosio.token"_n, symbol(4, "SYS"), a).to_string());
+         t.push_action("eosio.token"_n, "close"_n, a, mutable_variant_object()("owner", a)("symbol", "4,SYS"));
+         t.push_action("eosio.token"_n, "open"_n, "eosio"_n, mutable_variant_object()
+                       ("owner", a)("symbol", "4,SYS")("ram_payer", "eosio"));
+         transfer(t, "eosio"_n, a, "10.0000 SYS");
+      }
+      if (i == 7)
+         t.push_action("kvaddrbook"_n, "del"_n, "kvaddrbook"_n, mutable_variant_object()("account_name", "steve"));
+      if (i % 3 == 0) {
+         t.produce_block();
+         check_counts(t, ct.tracker);
+      }
+   }
+   t.produce_blocks(3);
+   check_counts(t, ct.tracker);
+   BOOST_CHECK_EQUAL(t.control->head_block_num(), ct.tracker.block_num());
+
+   // a tracker counting the state from scratch, as after a restart or a snapshot, agrees. A block is being built, so
+   // it only counts at the next one.
+   connected_tracker fresh(t);
+   BOOST_CHECK_EQUAL(0u, fresh.tracker.block_num());
+   t.produce_block();
+   BOOST_CHECK_EQUAL(t.control->head_block_num(), fresh.tracker.block_num());
+   BOOST_CHECK(fresh.tracker.table_sizes() == ct.tracker.table_sizes());
+
+   auto tables = ct.tracker.get_table_sizes({"eosio.token"_n, {}, 10});
+   BOOST_REQUIRE_EQUAL(2u, tables.rows.size());
+   BOOST_CHECK_EQUAL("accounts"_n, tables.rows[0].table);
+   BOOST_CHECK_EQUAL(int64_t(accs.size() + 1), tables.rows[0].size.row_count);
+   BOOST_CHECK_EQUAL("stat"_n, tables.rows[1].table);
+   BOOST_CHECK_EQUAL(1, tables.rows[1].size.row_count);
+   BOOST_CHECK_EQUAL("", tables.more);
+
+   auto numobjs = ct.tracker.get_table_sizes({"test"_n, "numobjs"_n, 1});
+   BOOST_REQUIRE_EQUAL(1u, numobjs.rows.size());
+   BOOST_CHECK_EQUAL(20, numobjs.rows[0].size.row_count);
+   BOOST_CHECK_GT(numobjs.rows[0].size.secondary_index_row_count, 0);
+
+   // kv rows have no table
+   auto kv = ct.tracker.get_table_sizes({"kvaddrbook"_n, {}, 10});
+   BOOST_REQUIRE_EQUAL(1u, kv.rows.size());
+   BOOST_CHECK_EQUAL(name(), kv.rows[0].table);
+   BOOST_CHECK_GT(kv.rows[0].size.row_count, 0);
+
+   // pages cover every contract once, in order
+   std::vector<name> paged;
+   get_contract_sizes_params params{{}, 2};
+   for (;;) {
+      auto page = ct.tracker.get_contract_sizes(params);
+      BOOST_CHECK_EQUAL(t.control->head_block_num(), page.block_num);
+      for (const auto& r : page.rows)
+         paged.push_back(r.contract);
+      if (page.more.empty())
+         break;
+      params.lower_bound = name(page.more);
+   }
+   BOOST_CHECK(std::is_sorted(paged.begin(), paged.end()));
+   BOOST_CHECK(std::adjacent_find(paged.begin(), paged.end()) == paged.end());
+   for (auto c : {"eosio.token"_n, "test"_n, "kvaddrbook"_n})
+      BOOST_CHECK(std::find(paged.begin(), paged.end(), c) != paged.end());
+
+} FC_LOG_AND_RETHROW() }
+
+// random mix of rows created, modified and removed in the chainbase tables, the kv table and their secondary indices
+BOOST_AUTO_TEST_CASE_TEMPLATE( random_workload_counts_test, TESTER_T, backing_store_ts) { try {
+   TESTER_T t;
+   t.produce_blocks(2);
+   std::vector<account_name> accs{"inita"_n, "initb"_n, "initc"_n, "initd"_n, "inite"_n, "initf"_n};
+   connected_tracker ct(t);
+   deploy_contracts(t, accs);
+   check_counts(t, ct.tracker);
+
+   const uint32_t seed = std::random_device{}();
+   BOOST_TEST_MESSAGE("random_workload_counts_test seed " << seed);
+   std::mt19937 rng(seed);
+   auto pick = [&](size_t n) { return std::uniform_int_distribution<size_t>(0, n - 1)(rng); };
+
+   uint64_t next_input = 0;
+   uint64_t next_memo  = 0;
+   for (uint32_t block = 0; block < 30; ++block) {
+      // the same action twice in a block would be a duplicate transaction, each account is closed or has its
+      // person changed at most once per block
+      std::set<std::pair<size_t, name>> changed;
+      const size_t num_actions = pick(8);
+      for (size_t i = 0; i < num_actions; ++i) {
+         const auto a  = accs[pick(accs.size())];
+         const auto op = pick(5);
+         if (op >= 2 && !changed.emplace(std::min<size_t>(op, 3), a).second)
+            continue;
+         switch (op) {
+         case 0:
+            add_numobj(t, next_input++);
+            break;
+         case 1: {
+            const auto to = accs[pick(accs.size())];
+            t.push_action("eosio.token"_n, "transfer"_n, a, mutable_variant_object()
+                          ("from", a)("to", to == a ? "eosio"_n : to)("quantity", "0.0001 SYS")("memo", std::to_string(next_memo++)));
+            break;
+         }
+         case 2:
+            // the balance row is removed and created again by another payer
+            transfer(t, a, "eosio"_n, t.get_currency_balance("eosio.token"_n, symbol(4, "SYS"), a).to_string());
+            t.push_action("eosio.token"_n, "close"_n, a, mutable_variant_object()("owner", a)("symbol", "4,SYS"));
+            t.push_action("eosio.token"_n, "open"_n, "eosio"_n, mutable_variant_object()
+                          ("owner", a)("symbol", "4,SYS")("ram_payer", "eosio"));
+            transfer(t, "eosio"_n, a, "10.0000 SYS");
+            break;
+         case 3:
+            upsert_person(t, a, "street " + std::to_string(pick(1000)));
+            break;
+         default:
+            delete_person(t, a);
+            break;
+         }
+      }
+      t.produce_block();
+      check_counts(t, ct.tracker);
+   }
+   BOOST_CHECK_EQUAL(t.control->head_block_num(), ct.tracker.block_num());
+} FC_LOG_AND_RETHROW() }
+
+// Blocks of a branch are rolled back when the controller switches to a longer one. A tracker started after the fork
+// point cannot roll back past the block it started from and counts the state again.
+BOOST_AUTO_TEST_CASE_TEMPLATE( fork_switch_counts_test, TESTER_T, fork_ts) { try {
+   TESTER_T t;
+   t.produce_blocks(2);
+   std::vector<account_name> accs{"inita"_n, "initb"_n, "initc"_n, "initd"_n};
+   deploy_contracts(t, accs);
+
+   // several producers keep the blocks of a single slot reversible
+   const std::vector<account_name> producers{"proda"_n, "prodb"_n, "prodc"_n, "prodd"_n, "prode"_n};
+   t.create_accounts(producers);
+   t.produce_block();
+   t.set_producers(producers);
+   for (uint32_t n = 0; n < 400 && !(t.control->head_block_producer() == "prode"_n && t.control->pending_block_producer() == "proda"_n); ++n)
+      t.produce_block();
+   BOOST_REQUIRE(t.control->pending_block_producer() == "proda"_n);
+
+   TESTER_T other(setup_policy::none);
+   push_blocks(t, other, 2);
+
+   connected_tracker ct(t);
+   for (uint64_t i = 0; i < 5; ++i)
+      add_numobj(t, i);
+   upsert_person(t, "inita"_n, "main street");
+   t.produce_block();
+   const uint32_t fork_block_num = t.control->head_block_num();
+   push_blocks(t, other, fork_block_num);
+   check_counts(t, ct.tracker);
+
+   // this branch rolls back rows created, modified and removed
+   for (uint32_t i = 0; i < 2; ++i) {
+      add_numobj(t, 100 + i);
+      transfer(t, accs[i], accs[i + 1], "1.0000 SYS");
+      delete_person(t, "inita"_n);
+      t.produce_block();
+      check_counts(t, ct.tracker);
+   }
+   connected_tracker late(t);
+   for (uint32_t i = 0; i < 3; ++i) {
+      add_numobj(t, 200 + i);
+      upsert_person(t, accs[i], "side street");
+      t.produce_block();
+      check_counts(t, ct.tracker);
+   }
+   check_counts(t, late.tracker);
+   BOOST_REQUIRE_EQUAL(fork_block_num + 5, t.control->head_block_num());
+   BOOST_REQUIRE(t.control->head_block_producer() == "proda"_n);
+
+   // the other branch skips the rest of the slot of proda and is longer
+   auto b = other.produce_block(fc::milliseconds(config::block_interval_ms * 12));
+   BOOST_REQUIRE(b->producer == "prodb"_n);
+   for (uint32_t i = 0; i < 6; ++i) {
+      add_numobj(other, 300 + i);
+      transfer(other, accs[i % accs.size()], "eosio"_n, "2.0000 SYS");
+      upsert_person(other, accs[i % accs.size()], "other street");
+      other.produce_block();
+   }
+   push_blocks(other, t, fork_block_num + 1);
+   BOOST_REQUIRE(t.control->head_block_id() == other.control->head_block_id());
+
+   check_counts(t, ct.tracker);
+   check_counts(t, late.tracker);
+   BOOST_CHECK_EQUAL(t.control->head_block_num(), ct.tracker.block_num());
+   BOOST_CHECK_EQUAL(t.control->head_block_num(), late.tracker.block_num());
+   BOOST_CHECK(late.tracker.table_sizes() == ct.tracker.table_sizes());
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -12,6 +12,9 @@ from TestHelper import TestHelper
 from TestHelper import AppArgs
 from testUtils import BlockLogAction
 import json
+import os
+import re
+import subprocess
 import sys
 import signal
 import time
@@ -30,6 +33,12 @@ import time
 # state history traces log has actually been pruned. We rely on the 
 # unittests/state_history_tests.cpp to perform this test. 
 #
+# Finally, the producer is restarted with a block log split into stride
+# files and more transactions with context free data are pruned in bulk
+# with --transaction-file on several threads, locating the blocks of the
+# transactions listed without one, resuming from a partial journal and
+# checking that the verification pass reports what was left unpruned.
+#
 ###############################################################
 
 # Parse command line arguments
@@ -188,6 +197,87 @@ try:
 
     assert (not headAdvanced) or (fvnPost2Info["head_block_num"] < cfTrxBlockNum), "the full validation node is still syncing"
 
+    #
+    #  bulk prune transactions spread over the stride files of a split block log
+    #
+    blocksLogStride = 20
+    producerNode.kill(signal.SIGTERM)
+    isRelaunchSuccess = producerNode.relaunch(addSwapFlags={"--blocks-log-stride": str(blocksLogStride)})
+    assert isRelaunchSuccess, "Fail to relaunch producer node with a split block log"
+
+    bulkTrxs = []
+    for i in range(6):
+        trx["context_free_data"] = ["a1b2c3", "{:06x}".format(i)]
+        (success, trans) = producerNode.pushTransaction(trx, permissions="payloadless", opts=None)
+        assert success and trans, "Failed to push transaction with context free data"
+        bulkTrxs.append((int(trans["processed"]["block_num"]), trans["transaction_id"]))
+        producerNode.waitForBlock(bulkTrxs[-1][0] + blocksLogStride, timeout=WaitSpec.calculate(), errorContext="producerNode head did not advance")
+    producerNode.waitForBlock(bulkTrxs[-1][0], blockType=BlockType.lib, timeout=WaitSpec.calculate(), errorContext="producerNode LIB did not advance")
+    producerNode.kill(signal.SIGTERM)
+
+    nodeDataDir = Utils.getNodeDataDir(producerNodeIndex)
+    blocksDir = os.path.join(nodeDataDir, "blocks")
+    strideFiles = [f for f in os.listdir(blocksDir) if re.match(r"blocks-\d+-\d+\.log$", f)]
+    assert len(strideFiles) >= 3, "the block log of the producer is not split into stride files: {}".format(os.listdir(blocksDir))
+
+    def bulkPrune(trxFile, journal, extraArgs=""):
+        cmd = "{} --blocks-dir {} --state-history-dir {}/state-history --prune-transactions --transaction-file {} --prune-journal {} --jobs 3 {}".format(
+            Utils.EosBlockLogPath, blocksDir, nodeDataDir, trxFile, journal, extraArgs)
+        if Utils.Debug: Utils.Print("cmd: %s" % (cmd))
+        result = subprocess.run(cmd.split(), stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        out = result.stdout.decode("utf-8")
+        err = result.stderr.decode("utf-8")
+        counts = re.search(r"(\d+) transactions listed in blocks outside of the block log, (\d+) transactions not found, (\d+) transactions not pruned", out)
+        assert counts, "eosio-blocklog did not report its counts, stdout: {}, stderr: {}".format(out, err)
+        return (result.returncode, [int(c) for c in counts.groups()], err)
+
+    # the first half is listed with its block number, the blocks of the second half are located by scanning the log
+    trxFile = os.path.join(nodeDataDir, "prune-transactions.txt")
+    with open(trxFile, "w") as f:
+        f.write("# transactions to prune\n")
+        for (blockNum, trxId) in bulkTrxs[:3]:
+            f.write("{} {}\n".format(blockNum, trxId))
+        for (blockNum, trxId) in bulkTrxs[3:]:
+            f.write("{}\n".format(trxId))
+
+    # a journal left by an interrupted run: one id already located, one block wrongly recorded as pruned and an
+    # incomplete last line. The verification pass has to find the block that was skipped.
+    Utils.Print("bulk prune resuming from a partial journal")
+    journal = os.path.join(nodeDataDir, "prune-transactions.journal")
+    with open(journal, "w") as f:
+        f.write("located {} {}\n".format(bulkTrxs[3][0], bulkTrxs[3][1]))
+        f.write("pruned {}\n".format(bulkTrxs[0][0]))
+        f.write("pruned")
+    (returnCode, counts, err) = bulkPrune(trxFile, journal)
+    assert returnCode == 1, "bulk prune returned {} instead of 1 with a block left unpruned".format(returnCode)
+    assert counts[0] == 0 and counts[1] == 0 and counts[2] > 0, "unexpected counts {} with a block left unpruned".format(counts)
+    assert bulkTrxs[0][1] in err, "the transaction left unpruned is not reported: {}".format(err)
+    with open(journal) as f:
+        prunedBlocks = set(int(m.group(1)) for m in re.finditer(r"^pruned (\d+)$", f.read(), re.MULTILINE))
+    assert prunedBlocks >= set(blockNum for (blockNum, trxId) in bulkTrxs), "the journal does not record all pruned blocks: {}".format(prunedBlocks)
+
+    Utils.Print("bulk prune with a new journal")
+    os.remove(journal)
+    (returnCode, counts, err) = bulkPrune(trxFile, journal)
+    assert returnCode == 0 and counts == [0, 0, 0], "bulk prune returned {} with counts {}: {}".format(returnCode, counts, err)
+
+    # an id that is not in the scanned blocks fails the run with exit code 1, however many ids are missing
+    Utils.Print("bulk prune of transactions that are not in the block log")
+    missingFile = os.path.join(nodeDataDir, "prune-missing.txt")
+    with open(missingFile, "w") as f:
+        for i in range(300):
+            f.write("{:064x}\n".format(i + 1))
+    (returnCode, counts, err) = bulkPrune(missingFile, os.path.join(nodeDataDir, "prune-missing.journal"),
+                                          "--first {} --last {}".format(bulkTrxs[0][0], bulkTrxs[-1][0]))
+    assert returnCode == 1 and counts == [0, 300, 0], "bulk prune returned {} with counts {}".format(returnCode, counts)
+
+    isRelaunchSuccess = producerNode.relaunch()
+    assert isRelaunchSuccess, "Fail to relaunch producer node after bulk pruning"
+    for (blockNum, trxId) in bulkTrxs:
+        trans = producerNode.getTransaction(trxId)
+        assert trans, "Failed to get transaction {} from the producer node".format(trxId)
+        assert trans["trx"]["receipt"]["trx"][1]["prunable_data"]["prunable_data"][0] == 1, "transaction {} has not been pruned".format(trxId)
+
     testSuccessful = True
 finally:
     TestHelper.shutdown(cluster, walletMgr, testSuccessful, killEosInstances, killWallet, keepLogs, killAll, dumpErrorDetails)
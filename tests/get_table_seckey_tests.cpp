@@ -19,6 +19,8 @@
 #include <fc/io/json.hpp>
 
 #include <array>
+#include <atomic>
+#include <thread>
 #include <utility>
 
 #include <eosio/testing/backing_store_tester_macros.hpp>
@@ -168,4 +170,189 @@ BOOST_AUTO_TEST_CASE_TEMPLATE( get_table_next_key_reverse_test, TESTER_T, backin
 
 } FC_LOG_AND_RETHROW() } /// get_scope_test
 
+BOOST_AUTO_TEST_CASE( get_table_mirrored_seckey_test ) { try {
+   TESTER t;
+   t.create_account("test"_n);
+
+   t.set_code( "test"_n, contracts::get_table_seckey_test_wasm() );
+   t.set_abi( "test"_n, contracts::get_table_seckey_test_abi().data() );
+   t.produce_block();
+
+   using mirror_t = chain_apis::secondary_index_mirror;
+   mirror_t mirror(*t.control, { mirror_t::index_spec::from_string("test:numobjs:2:i64"),
+                                 mirror_t::index_spec::from_string("test:numobjs:6:name") });
+   auto c1 = t.control->applied_transaction.connect([&](std::tuple<const transaction_trace_ptr&, const packed_transaction_ptr&> x) {
+      mirror.cache_transaction_trace(std::get<0>(x));
+   });
+   auto c2 = t.control->accepted_block.connect([&](const block_state_ptr& blk) {
+      mirror.commit_block(blk);
+   });
+
+   t.push_action("test"_n, "addnumobj"_n, "test"_n, mutable_variant_object()("input", 2)("nm", "a"));
+   t.push_action("test"_n, "addnumobj"_n, "test"_n, mutable_variant_object()("input", 5)("nm", "b"));
+   t.push_action("test"_n, "addnumobj"_n, "test"_n, mutable_variant_object()("input", 7)("nm", "c"));
+   t.push_action("test"_n, "addnumobj"_n, "test"_n, mutable_variant_object()("input", 8)("nm", "1111"));
+   t.produce_block();
+
+   chain_apis::read_only plugin(*(t.control), {}, fc::microseconds::maximum());
+   chain_apis::read_only mirrored(*(t.control), {}, fc::microseconds::maximum());
+   mirrored.set_secondary_index_mirror(&mirror);
+
+   chain_apis::read_only::get_table_rows_params params{};
+   params.json = true;
+   params.code = "test"_n;
+   params.scope = "test";
+   params.table = "numobjs"_n;
+
+   auto check_same = [&]() {
+      auto expected = plugin.get_table_rows(params);
+      auto actual = mirrored.get_table_rows(params);
+      BOOST_REQUIRE_EQUAL(fc::json::to_string(expected.rows, fc::time_point::maximum()), fc::json::to_string(actual.rows, fc::time_point::maximum()));
+      BOOST_REQUIRE_EQUAL(expected.more, actual.more);
+      BOOST_REQUIRE_EQUAL(expected.next_key, actual.next_key);
+      // as served on the http threads
+      auto served = mirrored.get_mirrored_table_rows(params);
+      BOOST_REQUIRE(served);
+      BOOST_REQUIRE_EQUAL(fc::json::to_string(expected.rows, fc::time_point::maximum()), fc::json::to_string(served->rows, fc::time_point::maximum()));
+      BOOST_REQUIRE_EQUAL(expected.more, served->more);
+      BOOST_REQUIRE_EQUAL(expected.next_key, served->next_key);
+      return actual.rows.size();
+   };
+
+   for( auto reverse : { false, true } ) {
+      params.reverse = reverse;
+
+      params.key_type = "i64";
+      params.index_position = "2";
+      params.lower_bound = "";
+      params.upper_bound = "";
+      params.limit = 10;
+      BOOST_REQUIRE_EQUAL(4u, check_same());
+      params.limit = 2;
+      BOOST_REQUIRE_EQUAL(2u, check_same());
+      params.lower_bound = "5";
+      params.upper_bound = "7";
+      BOOST_REQUIRE_EQUAL(2u, check_same());
+
+      params.key_type = "name";
+      params.index_position = "6";
+      params.limit = 10;
+      params.lower_bound = "a";
+      params.upper_bound = "c";
+      BOOST_REQUIRE_EQUAL(3u, check_same());
+      params.limit = 1;
+      BOOST_REQUIRE_EQUAL(1u, check_same());
+   }
+
+   // rows added after the mirror was built are picked up when their block is committed
+   t.push_action("test"_n, "addnumobj"_n, "test"_n, mutable_variant_object()("input", 9)("nm", "2222"));
+   t.produce_block();
+   params.reverse = false;
+   params.key_type = "i64";
+   params.index_position = "2";
+   params.lower_bound = "";
+   params.upper_bound = "";
+   params.limit = 10;
+   BOOST_REQUIRE_EQUAL(5u, check_same());
+
+   // other indices are left to the main thread
+   params.index_position = "3";
+   BOOST_REQUIRE(!mirrored.get_mirrored_table_rows(params));
+   params.index_position = "2";
+   BOOST_REQUIRE(!plugin.get_mirrored_table_rows(params));
+
+   // a reader thread queries the mirror while blocks are committed
+   std::atomic<bool> done = false;
+   std::atomic<uint32_t> bad_reads = 0;
+   std::atomic<uint32_t> reads = 0;
+   std::thread reader([&, params]() {
+      while( !done ) {
+         try {
+            auto served = mirrored.get_mirrored_table_rows(params);
+            if( !served || served->rows.size() < 5 || served->rows.size() > 10 ) ++bad_reads;
+         } catch( ... ) {
+            ++bad_reads;
+         }
+         ++reads;
+      }
+   });
+   for( uint32_t i = 0; i < 5; ++i ) {
+      t.push_action("test"_n, "addnumobj"_n, "test"_n, mutable_variant_object()("input", 10 + i)("nm", "x" + std::to_string(i + 1)));
+      t.produce_block();
+   }
+   while( !reads ) std::this_thread::yield();
+   done = true;
+   reader.join();
+   BOOST_REQUIRE_EQUAL(0u, bad_reads.load());
+   BOOST_REQUIRE_EQUAL(10u, check_same());
+
+} FC_LOG_AND_RETHROW() } /// get_table_mirrored_seckey_test
+
+BOOST_AUTO_TEST_CASE( get_table_mirrored_seckey_fork_test ) { try {
+   TESTER t;
+   t.create_accounts( {"test"_n, "dan"_n, "sam"_n, "pam"_n} );
+   t.set_code( "test"_n, contracts::get_table_seckey_test_wasm() );
+   t.set_abi( "test"_n, contracts::get_table_seckey_test_abi().data() );
+   t.produce_block();
+   t.set_producers( {"dan"_n, "sam"_n, "pam"_n} );
+   t.produce_blocks(30);
+
+   using mirror_t = chain_apis::secondary_index_mirror;
+   mirror_t mirror(*t.control, { mirror_t::index_spec::from_string("test:numobjs:2:i64") });
+   auto c1 = t.control->applied_transaction.connect([&](std::tuple<const transaction_trace_ptr&, const packed_transaction_ptr&> x) {
+      mirror.cache_transaction_trace(std::get<0>(x));
+   });
+   auto c2 = t.control->accepted_block.connect([&](const block_state_ptr& blk) {
+      mirror.commit_block(blk);
+   });
+   auto c3 = t.control->irreversible_block.connect([&](const block_state_ptr& blk) {
+      mirror.irreversible_block(blk);
+   });
+
+   t.push_action("test"_n, "addnumobj"_n, "test"_n, mutable_variant_object()("input", 1)("nm", "a"));
+   t.produce_block();
+
+   tester t2(setup_policy::none);
+   while( t2.control->fork_db_pending_head_block_num() < t.control->fork_db_pending_head_block_num() ) {
+      t2.push_block( t.control->fetch_block_by_number( t2.control->fork_db_pending_head_block_num() + 1 ) );
+   }
+   const auto fork_block_num = t.control->head_block_num();
+
+   // rows added and then dropped with the blocks of the shorter fork
+   t.push_action("test"_n, "addnumobj"_n, "test"_n, mutable_variant_object()("input", 2)("nm", "b"));
+   t.push_action("test"_n, "addnumobj"_n, "test"_n, mutable_variant_object()("input", 3)("nm", "c"));
+   t.produce_blocks(12);
+
+   t2.push_action("test"_n, "addnumobj"_n, "test"_n, mutable_variant_object()("input", 4)("nm", "d"));
+   t2.produce_block();
+   t2.produce_blocks(11 + 12);
+
+   for( uint32_t start = fork_block_num + 1, end = t2.control->head_block_num(); start <= end; ++start ) {
+      t.push_block( t2.control->fetch_block_by_number( start ) );
+   }
+   BOOST_REQUIRE_EQUAL(t2.control->head_block_id(), t.control->head_block_id());
+
+   chain_apis::read_only plugin(*(t.control), {}, fc::microseconds::maximum());
+   chain_apis::read_only mirrored(*(t.control), {}, fc::microseconds::maximum());
+   mirrored.set_secondary_index_mirror(&mirror);
+
+   chain_apis::read_only::get_table_rows_params params{};
+   params.json = true;
+   params.code = "test"_n;
+   params.scope = "test";
+   params.table = "numobjs"_n;
+   params.key_type = "i64";
+   params.index_position = "2";
+   params.limit = 10;
+   for( auto reverse : { false, true } ) {
+      params.reverse = reverse;
+      auto expected = plugin.get_table_rows(params);
+      auto actual = mirrored.get_table_rows(params);
+      BOOST_REQUIRE_EQUAL(2u, actual.rows.size());
+      BOOST_REQUIRE_EQUAL(fc::json::to_string(expected.rows, fc::time_point::maximum()), fc::json::to_string(actual.rows, fc::time_point::maximum()));
+      BOOST_REQUIRE_EQUAL(expected.more, actual.more);
+   }
+
+} FC_LOG_AND_RETHROW() } /// get_table_mirrored_seckey_fork_test
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -8,6 +8,8 @@
 #include <eosio/chain/exceptions.hpp>
 #include <eosio/chain/wast_to_wasm.hpp>
 #include <eosio/chain_plugin/chain_plugin.hpp>
+#include <eosio/chain/backing_store/chain_kv_payer.hpp>
+#include <eosio/chain/backing_store/db_key_value_format.hpp>
 
 #include <contracts.hpp>
 
@@ -19,6 +21,8 @@
 #include <fc/io/json.hpp>
 
 #include <array>
+#include <functional>
+#include <set>
 #include <utility>
 
 #include <eosio/testing/backing_store_tester_macros.hpp>
@@ -706,4 +710,132 @@ BOOST_AUTO_TEST_CASE_TEMPLATE( get_table_next_key_test, TESTER_T, backing_store_
 
 } FC_LOG_AND_RETHROW() } /// get_table_next_key_test
 
+namespace {
+   // writes a table of code/scope directly in the state, there are too many of them to create them through a contract
+   void set_scope_table( TESTER& t, backing_store_type backing_store, name code, name scope, name table, bool present ) {
+      if( backing_store == backing_store_type::CHAINBASE ) {
+         auto& db = t.control->mutable_db();
+         if( present ) {
+            db.create<table_id_object>( [&]( auto& obj ) {
+               obj.code  = code;
+               obj.scope = scope;
+               obj.table = table;
+               obj.payer = code;
+            });
+         } else {
+            db.remove( db.get<table_id_object, by_code_scope_table>( std::make_tuple( code, scope, table ) ) );
+         }
+      } else {
+         auto session = t.control->kv_db().get_kv_undo_stack()->top();
+         const auto key = backing_store::db_key_value_format::create_full_prefix_key( code, scope, table,
+                                                                                      backing_store::db_key_value_format::key_type::table );
+         if( present )
+            session.write( key, backing_store::payer_payload( code, nullptr, 0 ).as_payload() );
+         else
+            session.erase( key );
+      }
+   }
+
+   using scope_table = std::pair<name, name>;
+
+   // pages through the scopes of code with cursors, limit rows at a time
+   std::vector<scope_table> page_scopes( const eosio::chain_apis::read_only& plugin,
+                                         eosio::chain_apis::read_only::get_table_by_scope_params params,
+                                         const std::function<void(const std::string&)>& between_pages = {} ) {
+      std::vector<scope_table> rows;
+      for(;;) {
+         auto result = plugin.get_table_by_scope( params );
+         BOOST_REQUIRE_LE( result.rows.size(), params.limit );
+         for( const auto& row : result.rows )
+            rows.emplace_back( row.scope, row.table );
+         if( result.next_cursor.empty() ) {
+            BOOST_REQUIRE( result.more.empty() );
+            return rows;
+         }
+         BOOST_REQUIRE( !result.more.empty() );
+         if( between_pages )
+            between_pages( result.next_cursor );
+         params.cursor = result.next_cursor;
+      }
+   }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE( get_scope_cursor_test, TESTER_T, backing_store_ts) { try {
+   TESTER_T t;
+   t.create_accounts({ "eosio.token"_n });
+   t.produce_block();
+
+   eosio::chain_apis::read_only plugin(*(t.control), {}, fc::microseconds::maximum());
+   const auto backing_store = plugin.get_backing_store();
+
+   // every scope has an accounts table, every third one a stat table as well, so that pages end within a scope
+   const uint64_t scope_count = 20000;
+   std::vector<scope_table> expected;
+   for( uint64_t i = 1; i <= scope_count; ++i ) {
+      const name scope{ i * 1000 };
+      set_scope_table( t, backing_store, "eosio.token"_n, scope, "accounts"_n, true );
+      expected.emplace_back( scope, "accounts"_n );
+      if( i % 3 == 0 ) {
+         set_scope_table( t, backing_store, "eosio.token"_n, scope, "stat"_n, true );
+         expected.emplace_back( scope, "stat"_n );
+      }
+   }
+
+   eosio::chain_apis::read_only::get_table_by_scope_params params{ "eosio.token"_n };
+   params.limit = 7;
+   BOOST_CHECK( page_scopes( plugin, params ) == expected );
+
+   params.limit = 1000;
+   BOOST_CHECK( page_scopes( plugin, params ) == expected );
+
+   params.reverse = true;
+   params.limit = 7;
+   BOOST_CHECK( page_scopes( plugin, params ) == std::vector<scope_table>( expected.rbegin(), expected.rend() ) );
+   params.reverse = false;
+
+   // a filter on the table and a lower bound still apply when resuming
+   params.table = "stat"_n;
+   params.lower_bound = std::to_string( 3000 * 1000 );
+   std::vector<scope_table> stats;
+   std::copy_if( expected.begin(), expected.end(), std::back_inserter(stats), [&]( const auto& r ) {
+      return r.second == "stat"_n && r.first >= name{ 3000 * 1000 };
+   });
+   BOOST_CHECK( page_scopes( plugin, params ) == stats );
+   params.table = name{};
+   params.lower_bound.clear();
+
+   // removing the row a cursor points to neither repeats nor skips any of the others
+   std::set<scope_table> removed;
+   auto remove_next = [&]( const std::string& cursor ) {
+      auto next = plugin.get_table_by_scope( [&]{ auto p = params; p.cursor = cursor; p.limit = 1; return p; }() );
+      BOOST_REQUIRE_EQUAL( 1u, next.rows.size() );
+      if( removed.size() < 100 ) {
+         set_scope_table( t, backing_store, "eosio.token"_n, next.rows[0].scope, next.rows[0].table, false );
+         removed.emplace( next.rows[0].scope, next.rows[0].table );
+      }
+   };
+   params.limit = 50;
+   auto remaining = page_scopes( plugin, params, remove_next );
+   std::vector<scope_table> expected_remaining;
+   std::copy_if( expected.begin(), expected.end(), std::back_inserter(expected_remaining), [&]( const auto& r ) {
+      return !removed.count( r );
+   });
+   BOOST_CHECK_EQUAL( 100u, removed.size() );
+   BOOST_CHECK( remaining == expected_remaining );
+
+   // a cursor of another code or direction is rejected
+   auto result = plugin.get_table_by_scope( params );
+   BOOST_REQUIRE( !result.next_cursor.empty() );
+   params.cursor = result.next_cursor;
+   params.reverse = true;
+   BOOST_CHECK_THROW( plugin.get_table_by_scope( params ), contract_table_query_exception );
+   params.reverse = false;
+   params.code = "eosio"_n;
+   BOOST_CHECK_THROW( plugin.get_table_by_scope( params ), contract_table_query_exception );
+   params.code = "eosio.token"_n;
+   params.cursor = "not a cursor";
+   BOOST_CHECK_THROW( plugin.get_table_by_scope( params ), contract_table_query_exception );
+
+} FC_LOG_AND_RETHROW() } /// get_scope_cursor_test
+
 BOOST_AUTO_TEST_SUITE_END()
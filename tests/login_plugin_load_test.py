@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+import json
+import os
+import shutil
+import threading
+import time
+import unittest
+import urllib.error
+import urllib.request
+from datetime import datetime, timedelta
+
+from testUtils import Utils
+from TestHelper import TestHelper
+from Node import Node
+
+###############################################################
+# login_plugin_load_test
+#
+# Floods the login_plugin endpoints from several client threads while sampling the latency of
+# /v1/chain/get_info, and checks that get_info stays responsive compared to an idle node.
+#
+###############################################################
+
+class LoginPluginLoadTest(unittest.TestCase):
+    sleep_s = 2
+    base_url = "http://%s:%s/v1/" % (TestHelper.LOCAL_HOST, TestHelper.DEFAULT_PORT)
+    node_id = 1
+    nodeos = Node(TestHelper.LOCAL_HOST, TestHelper.DEFAULT_PORT, node_id)
+    data_dir = Utils.getNodeDataDir(node_id)
+    flood_threads = 8
+    flood_s = 10
+    samples = 200
+    # get_info may get slower under the flood, but it must not be starved by it
+    max_p99_s = 0.5
+
+    # make a fresh data dir
+    def createDataDir(self):
+        if os.path.exists(self.data_dir):
+            shutil.rmtree(self.data_dir)
+        os.makedirs(self.data_dir)
+
+    # kill nodeos and clean up dir
+    def cleanEnv(self) :
+        Node.killAllNodeos()
+        if os.path.exists(self.data_dir):
+            shutil.rmtree(self.data_dir)
+        time.sleep(self.sleep_s)
+
+    # start nodeos with login_plugin
+    def startEnv(self) :
+        self.createDataDir(self)
+        nodeos_plugins = (" --plugin %s --plugin %s --plugin %s --plugin %s ") % ("eosio::producer_plugin",
+                                                                                  "eosio::chain_api_plugin",
+                                                                                  "eosio::http_plugin",
+                                                                                  "eosio::login_plugin")
+        nodeos_flags = (" --data-dir=%s --http-validate-host=%s --verbose-http-errors "
+                        "--max-login-timeout=60 ") % (self.data_dir, "false")
+        start_nodeos_cmd = ("%s -e -p eosio %s %s ") % (Utils.EosServerPath, nodeos_plugins, nodeos_flags)
+        self.nodeos.launchCmd(start_nodeos_cmd, self.node_id)
+        time.sleep(self.sleep_s)
+
+    def post(self, path, body=None):
+        data = json.dumps(body).encode() if body is not None else None
+        try:
+            with urllib.request.urlopen(self.base_url + path, data=data, timeout=10) as response:
+                return json.loads(response.read())
+        except urllib.error.HTTPError as e:
+            return json.loads(e.read())
+
+    # latency in seconds of each of `count` sequential get_info calls
+    def sampleGetInfo(self, count):
+        latencies = []
+        for _ in range(count):
+            start = time.monotonic()
+            ret_json = self.post("chain/get_info")
+            latencies.append(time.monotonic() - start)
+            self.assertIn("head_block_num", ret_json)
+            time.sleep(0.01)
+        return sorted(latencies)
+
+    def report(self, name, latencies):
+        pct = lambda p: latencies[min(len(latencies) - 1, int(len(latencies) * p))]
+        Utils.Print("%s: p50 %.1fms, p99 %.1fms, max %.1fms" % (name, pct(0.5) * 1000, pct(0.99) * 1000,
+                                                                latencies[-1] * 1000))
+        return pct(0.99)
+
+    # start a login request and finalize it again; the server key doubles as the client key so the shared secret
+    # can be derived, and without signatures the authorization check on the main thread fails
+    def flood(self, stop, counts, errors):
+        while not stop.is_set():
+            try:
+                expiration = (datetime.utcnow() + timedelta(seconds=30)).strftime("%Y-%m-%dT%H:%M:%S")
+                started = self.post("login/start_login_request", {"expiration_time": expiration})
+                server_key = started["server_ephemeral_pub_key"]
+                finalized = self.post("login/finalize_login_request", {
+                    "server_ephemeral_pub_key": server_key,
+                    "client_ephemeral_pub_key": server_key,
+                    "permission": {"actor": "eosio", "permission": "active"},
+                    "data": "",
+                    "signatures": []})
+                if finalized.get("error") != "keys do not satisfy permission":
+                    errors.append(finalized)
+                # an unknown key is rejected on the http thread
+                missing = self.post("login/finalize_login_request", {
+                    "server_ephemeral_pub_key": server_key,
+                    "client_ephemeral_pub_key": server_key,
+                    "permission": {"actor": "eosio", "permission": "active"},
+                    "data": "",
+                    "signatures": []})
+                if missing.get("error") != "server_ephemeral_pub_key expired or not found":
+                    errors.append(missing)
+                counts.append(1)
+            except Exception as e:
+                errors.append(str(e))
+
+    def test_LoginFlood(self) :
+        idle_p99 = self.report("get_info idle", self.sampleGetInfo(self.samples))
+
+        stop = threading.Event()
+        counts = []
+        errors = []
+        threads = [threading.Thread(target=self.flood, args=(stop, counts, errors)) for _ in range(self.flood_threads)]
+        for t in threads:
+            t.start()
+        try:
+            time.sleep(1)
+            deadline = time.monotonic() + self.flood_s
+            latencies = []
+            while time.monotonic() < deadline:
+                latencies += self.sampleGetInfo(10)
+            flood_p99 = self.report("get_info under login flood", sorted(latencies))
+        finally:
+            stop.set()
+            for t in threads:
+                t.join()
+
+        Utils.Print("%d login requests started and finalized by %d threads" % (len(counts), self.flood_threads))
+        self.assertEqual(errors[:5], [])
+        self.assertGreater(len(counts), 0)
+        self.assertLess(flood_p99, max(self.max_p99_s, 10 * idle_p99))
+
+        # the node keeps producing under the flood
+        ret_json = self.post("chain/get_info")
+        self.assertGreater(ret_json["head_block_num"], 1)
+
+    @classmethod
+    def setUpClass(self):
+        self.cleanEnv(self)
+        self.startEnv(self)
+
+    @classmethod
+    def tearDownClass(self):
+        self.cleanEnv(self)
+
+if __name__ == "__main__":
+    unittest.main()
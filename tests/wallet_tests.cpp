@@ -6,6 +6,9 @@
 #include <eosio/chain/authority.hpp>
 #include <eosio/chain/exceptions.hpp>
 
+#include <atomic>
+#include <thread>
+
 namespace eosio {
 
 BOOST_AUTO_TEST_SUITE(wallet_tests)
@@ -263,6 +266,182 @@ BOOST_AUTO_TEST_CASE(wallet_manager_create_test) {
 }
 
 
+/// Load test of the wallet manager: clients sign concurrently with the keys of many wallets while other clients lock
+/// and unlock some of them
+BOOST_AUTO_TEST_CASE(wallet_manager_concurrent_signing_test)
+{ try {
+   using namespace eosio::wallet;
+
+   constexpr uint32_t num_wallets = 16;
+   constexpr uint32_t keys_per_wallet = 8;
+   constexpr uint32_t num_signers = 8;
+   constexpr uint32_t signs_per_signer = 500;
+
+   auto wallet_name = [](uint32_t i) { return "concurrent" + std::to_string(i); };
+   auto remove_wallet_files = [&]() {
+      for (uint32_t i = 0; i < num_wallets; ++i)
+         if (fc::exists(wallet_name(i) + ".wallet")) fc::remove(wallet_name(i) + ".wallet");
+   };
+   remove_wallet_files();
+
+   wallet_manager wm;
+   std::vector<std::string> passwords;
+   std::vector<public_key_type> keys; // keys_per_wallet keys of each wallet in turn
+   for (uint32_t i = 0; i < num_wallets; ++i) {
+      passwords.push_back(wm.create(wallet_name(i)));
+      for (uint32_t k = 0; k < keys_per_wallet; ++k)
+         keys.emplace_back(wm.create_key(wallet_name(i), "K1"));
+   }
+   BOOST_CHECK_EQUAL(keys.size(), wm.get_public_keys().size());
+
+   // Boost.Test is not thread safe, the threads only count
+   std::atomic<bool>     done = false;
+   std::atomic<uint32_t> signed_count = 0;
+   std::atomic<uint32_t> missing_count = 0; // keys of a wallet that was locked at the time
+   std::atomic<uint32_t> error_count = 0;   // includes missing keys of the wallets nobody locks
+   std::atomic<uint32_t> toggle_count = 0;
+
+   // the odd wallets are locked and unlocked again and again
+   std::thread toggler([&]() {
+      try {
+         while (!done) {
+            for (uint32_t i = 1; i < num_wallets; i += 2) {
+               wm.lock(wallet_name(i));
+               wm.unlock(wallet_name(i), passwords[i]);
+               ++toggle_count;
+            }
+         }
+      } catch (...) {
+         ++error_count;
+      }
+   });
+
+   const auto start = fc::time_point::now();
+   std::vector<std::thread> signers;
+   for (uint32_t s = 0; s < num_signers; ++s) {
+      signers.emplace_back([&, s]() {
+         for (uint32_t n = 0; n < signs_per_signer; ++n) {
+            const auto digest = fc::sha256::hash(std::to_string(s) + " " + std::to_string(n));
+            const uint32_t key_index = (s * 7 + n * 13) % keys.size();
+            const auto& key = keys[key_index];
+            try {
+               if (public_key_type(wm.sign_digest(digest, key), digest) == key)
+                  ++signed_count;
+               else
+                  ++error_count;
+            } catch (const wallet_missing_pub_key_exception&) {
+               if ((key_index / keys_per_wallet) % 2 == 1)
+                  ++missing_count;
+               else
+                  ++error_count;
+            } catch (...) {
+               ++error_count;
+            }
+         }
+      });
+   }
+   for (auto& t : signers)
+      t.join();
+   const auto elapsed = fc::time_point::now() - start;
+   done = true;
+   toggler.join();
+
+   BOOST_CHECK_EQUAL(0u, error_count.load());
+   BOOST_CHECK_EQUAL(num_signers * signs_per_signer, signed_count.load() + missing_count.load());
+   BOOST_CHECK_GT(toggle_count.load(), 0u);
+   BOOST_TEST_MESSAGE( num_signers << " clients signed " << signed_count.load() << " digests with keys of "
+                       << num_wallets << " wallets in " << elapsed.count() << "us, " << toggle_count.load()
+                       << " wallets were locked and unlocked meanwhile" );
+
+   // every wallet is unlocked again, with all its keys indexed
+   BOOST_CHECK_EQUAL(keys.size(), wm.get_public_keys().size());
+   chain::signed_transaction trx;
+   auto chain_id = genesis_state().compute_chain_id();
+   flat_set<public_key_type> pubkeys(keys.begin(), keys.end());
+   trx = wm.sign_transaction(trx, pubkeys, chain_id);
+   flat_set<public_key_type> pks;
+   trx.get_signature_keys(chain_id, fc::time_point::maximum(), pks);
+   BOOST_CHECK(pks == pubkeys);
+
+   wm.lock_all();
+   BOOST_CHECK_THROW(wm.get_public_keys(), wallet_locked_exception);
+   BOOST_CHECK_THROW(wm.sign_digest(fc::sha256::hash(std::string("locked")), keys[0]), wallet_missing_pub_key_exception);
+
+   remove_wallet_files();
+} FC_LOG_AND_RETHROW() }
+
+namespace {
+
+using namespace eosio::wallet;
+
+/// A device backed wallet that locks itself when the device fails, like the YubiHSM wallet
+struct device_wallet final : wallet_api {
+   private_key_type key = private_key_type::generate();
+   bool locked = true;
+   bool device_fails = false;
+
+   private_key_type get_private_key(public_key_type) const override { FC_THROW("not available"); }
+   bool is_locked() const override { return locked; }
+   void lock() override { locked = true; }
+   void unlock(string) override { locked = false; }
+   void check_password(string) override {}
+   void set_password(string) override {}
+   map<public_key_type, private_key_type> list_keys() override { FC_THROW("not available"); }
+   flat_set<public_key_type> list_public_keys() override {
+      return locked ? flat_set<public_key_type>{} : flat_set<public_key_type>{key.get_public_key()};
+   }
+   bool import_key(string) override { return false; }
+   bool remove_key(string) override { return false; }
+   string create_key(string) override {
+      if (device_fails) {
+         locked = true;
+         FC_THROW("device failure");
+      }
+      return key.get_public_key().to_string();
+   }
+   std::optional<signature_type> try_sign_digest(const digest_type digest, const public_key_type public_key) override {
+      if (locked || public_key != key.get_public_key())
+         return {};
+      if (device_fails) {
+         locked = true;
+         FC_THROW("device failure");
+      }
+      return key.sign(digest);
+   }
+};
+
+} // namespace
+
+/// A wallet that locks itself while it is used leaves the key index with it
+BOOST_AUTO_TEST_CASE(wallet_manager_device_failure_test)
+{ try {
+   using namespace eosio::wallet;
+
+   wallet_manager wm;
+   auto owned = std::make_unique<device_wallet>();
+   auto& device = *owned;
+   const auto key = device.key.get_public_key();
+   wm.own_and_use_wallet("device", std::move(owned));
+   wm.unlock("device", "");
+   BOOST_CHECK(wm.get_public_keys() == flat_set<public_key_type>{key});
+
+   const auto digest = fc::sha256::hash(std::string("device"));
+   BOOST_CHECK(public_key_type(wm.sign_digest(digest, key), digest) == key);
+
+   device.device_fails = true;
+   BOOST_CHECK_THROW(wm.sign_digest(digest, key), fc::exception);
+   BOOST_CHECK(wm.list_wallets() == std::vector<std::string>{"device"}); // not unlocked
+   BOOST_CHECK_THROW(wm.get_public_keys(), wallet_locked_exception);
+   BOOST_CHECK_THROW(wm.sign_digest(digest, key), wallet_missing_pub_key_exception);
+
+   device.device_fails = false;
+   wm.unlock("device", "");
+   BOOST_CHECK(wm.get_public_keys() == flat_set<public_key_type>{key});
+   device.device_fails = true;
+   BOOST_CHECK_THROW(wm.create_key("device", "R1"), fc::exception);
+   BOOST_CHECK_THROW(wm.get_public_keys(), wallet_locked_exception);
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } // namespace eos
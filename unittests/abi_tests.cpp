@@ -18,6 +18,7 @@
 
 #include <boost/test/framework.hpp>
 
+#include <contracts.hpp>
 #include <deep_nested.abi.hpp>
 #include <large_nested.abi.hpp>
 
@@ -3670,4 +3671,120 @@ BOOST_AUTO_TEST_CASE(signed_transaction_extensions_tests)
                           fc_exception_message_starts_with("Transaction contained deferred_transaction_generation and transaction_extensions that did not match") );
 }
 
+
+namespace {
+
+const char* plan_nested_abi = R"({
+   "version": "eosio::abi/1.1",
+   "structs": [
+      {"name": "node", "base": "", "fields": [
+         {"name": "value", "type": "uint32"},
+         {"name": "next", "type": "node?"}
+      ]},
+      {"name": "tree", "base": "node", "fields": [
+         {"name": "children", "type": "tree[]"},
+         {"name": "tag", "type": "v1$"}
+      ]}
+   ],
+   "variants": [
+      {"name": "v1", "types": ["name", "node"]}
+   ]
+})";
+
+struct plan_sample {
+   std::string      name;
+   abi_serializer   abis;
+   type_name        type;
+   std::string      json;
+};
+
+abi_serializer::yield_function_t plan_yield() { return abi_serializer::create_yield_function( max_serialization_time ); }
+
+std::vector<plan_sample> plan_samples() {
+   auto make_abi = []( const std::vector<char>& abi_json ) {
+      return abi_serializer( fc::json::from_string( std::string( abi_json.begin(), abi_json.end() ) ).as<abi_def>(), plan_yield() );
+   };
+   std::vector<plan_sample> samples;
+   samples.push_back( { "eosio.token transfer", make_abi( contracts::eosio_token_abi() ), "transfer",
+                        R"({"from":"alice","to":"bob","quantity":"1.0000 SYS","memo":"for the coffee"})" } );
+   samples.push_back( { "eosio.system voteproducer", make_abi( contracts::eosio_system_abi() ), "voteproducer",
+                        R"({"voter":"alice","proxy":"","producers":["proda","prodb","prodc","prodd","prode"]})" } );
+   samples.push_back( { "eosio.system newaccount", make_abi( contracts::eosio_system_abi() ), "newaccount",
+                        R"({"creator":"eosio","name":"alice","owner":{"threshold":1,"keys":[],"accounts":[{"permission":{"actor":"bob","permission":"active"},"weight":1}],"waits":[]},)"
+                        R"("active":{"threshold":2,"keys":[],"accounts":[{"permission":{"actor":"bob","permission":"active"},"weight":1},{"permission":{"actor":"carol","permission":"owner"},"weight":1}],"waits":[{"wait_sec":3600,"weight":1}]}})" } );
+   samples.push_back( { "nested tree", abi_serializer( fc::json::from_string( plan_nested_abi ).as<abi_def>(), plan_yield() ), "tree",
+                        R"({"value":1,"next":{"value":2,"next":null},"children":[{"value":3,"next":null,"children":[],"tag":["name","leaf"]},)"
+                        R"({"value":4,"next":{"value":5,"next":{"value":6,"next":null}},"children":[{"value":7,"next":null,"children":[],"tag":["node",{"value":8,"next":null}]}],"tag":["name","inner"]}],"tag":["name","root"]})" } );
+   return samples;
+}
+
+} // namespace
+
+// binary_to_variant goes through the plan compiled by set_abi, it must give the same results, recursion depths and
+// error messages as resolving the type names for every value
+BOOST_AUTO_TEST_CASE(binary_to_variant_plan)
+{ try {
+   auto yield = plan_yield;
+   for( auto& s : plan_samples() ) {
+      BOOST_TEST_CONTEXT( s.name ) {
+         auto bin = s.abis.variant_to_binary( s.type, fc::json::from_string( s.json ), yield() );
+         BOOST_CHECK_EQUAL( s.json, fc::json::to_string( s.abis.binary_to_variant( s.type, bin, yield() ), fc::time_point::maximum() ) );
+
+         // copies have a plan of their own, they decode after the abi_serializer they were copied from is gone
+         auto original = std::make_unique<abi_serializer>( s.abis );
+         abi_serializer copied( *original );
+         abi_serializer assigned;
+         assigned = *original;
+         original.reset();
+         BOOST_CHECK_EQUAL( s.json, fc::json::to_string( copied.binary_to_variant( s.type, bin, yield() ), fc::time_point::maximum() ) );
+         BOOST_CHECK_EQUAL( s.json, fc::json::to_string( assigned.binary_to_variant( s.type, bin, yield() ), fc::time_point::maximum() ) );
+      }
+   }
+
+   // each node takes 3 levels of recursion (type, struct, optional field): 10 nodes are below max_recursion_depth, 11 are not
+   abi_serializer abis( fc::json::from_string( plan_nested_abi ).as<abi_def>(), yield() );
+   auto nodes = []( uint32_t n ) {
+      bytes bin;
+      for( uint32_t i = 0; i < n; ++i ) {
+         bin.insert( bin.end(), { char( i ), 0, 0, 0, char( i + 1 < n ) } );
+      }
+      return bin;
+   };
+   auto v = abis.binary_to_variant( "node", nodes( 10 ), yield() );
+   for( uint32_t i = 0; i < 9; ++i ) v = fc::variant( v["next"] );
+   BOOST_CHECK_EQUAL( 9u, v["value"].as_uint64() );
+   BOOST_CHECK( v["next"].is_null() );
+   BOOST_CHECK_THROW( abis.binary_to_variant( "node", nodes( 11 ), yield() ), abi_recursion_depth_exception );
+
+   // errors are reported by the plan with their path, also by a copy whose original is gone
+   using eosio::testing::fc_exception_message_is;
+   auto original = std::make_unique<abi_serializer>( abis );
+   abi_serializer copied( *original );
+   original.reset();
+   for( auto* a : { &abis, &copied } ) {
+      BOOST_CHECK_EXCEPTION( a->binary_to_variant( "tree", fc::variant( "01000000000100000000000002" ).as<bytes>(), yield() ),
+                             unpack_exception, fc_exception_message_is( "Unpacked invalid tag (2) for variant 'tree.children[0].tag'" ) );
+      BOOST_CHECK_EXCEPTION( a->binary_to_variant( "tree", fc::variant( "01000000010000000001" ).as<bytes>(), yield() ),
+                             unpack_exception, fc_exception_message_is( "Stream unexpectedly ended; unable to unpack field 'value' of struct 'tree.next.next'" ) );
+   }
+} FC_LOG_AND_RETHROW() }
+
+// binary_to_variant of eosio.token, eosio.system and nested samples
+// disabled by default, run with: unit_test --run_test=abi_tests/binary_to_variant_plan_benchmark
+BOOST_AUTO_TEST_CASE(binary_to_variant_plan_benchmark, * boost::unit_test::disabled())
+{ try {
+   constexpr uint32_t iterations = 100000;
+   for( auto& s : plan_samples() ) {
+      auto bin = s.abis.variant_to_binary( s.type, fc::json::from_string( s.json ), plan_yield() );
+      const auto start = fc::time_point::now();
+      for( uint32_t i = 0; i < iterations; ++i ) {
+         auto v = s.abis.binary_to_variant( s.type, bin, plan_yield() );
+         BOOST_REQUIRE( v.is_object() );
+      }
+      const auto elapsed = fc::time_point::now() - start;
+      BOOST_TEST_MESSAGE( s.name << ": " << iterations << " binary_to_variant of " << bin.size() << " bytes in "
+                                 << elapsed.count() << "us, " << double( elapsed.count() ) * 1000 / iterations << "ns each" );
+   }
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -128,6 +128,56 @@ BOOST_FIXTURE_TEST_CASE( test_transfer, currency_tester ) try {
    }
 } FC_LOG_AND_RETHROW() /// test_transfer
 
+BOOST_FIXTURE_TEST_CASE( test_transfer_compact_notification_traces, currency_tester ) try {
+   create_accounts( {"alice"_n} );
+   produce_block();
+
+   auto trace = push_action("eosio.token"_n, "transfer"_n, mutable_variant_object()
+      ("from", eosio_token)
+      ("to",   "alice")
+      ("quantity", "100.0000 CUR")
+      ("memo", "fund Alice")
+   );
+   produce_block();
+
+   // the trace returned to the caller is always complete
+   BOOST_REQUIRE_EQUAL( 2u, trace->action_traces.size() );
+   const auto& first_receiver = trace->action_traces[0];
+   const auto& notified       = trace->action_traces[1];
+   BOOST_REQUIRE_EQUAL( notified.receiver, "alice"_n );
+   BOOST_REQUIRE( fc::raw::pack( notified.act ) == fc::raw::pack( first_receiver.act ) );
+
+   tester replica(setup_policy::none);
+   replica.control->set_trace_consumers( false );
+
+   transaction_trace_ptr replica_trace;
+   auto c = replica.control->applied_transaction.connect( [&](std::tuple<const transaction_trace_ptr&, const packed_transaction_ptr&> x) {
+      auto& t = std::get<0>(x);
+      if( t && t->id == trace->id ) {
+         replica_trace = t;
+      }
+   } );
+
+   while( replica.control->head_block_num() < control->head_block_num() ) {
+      replica.push_block( control->fetch_block_by_number( replica.control->head_block_num() + 1 ) );
+   }
+   c.disconnect();
+
+   BOOST_REQUIRE( replica_trace );
+   BOOST_REQUIRE_EQUAL( 2u, replica_trace->action_traces.size() );
+   auto& compact = replica_trace->action_traces[1];
+   BOOST_REQUIRE_EQUAL( compact.receiver, "alice"_n );
+   BOOST_REQUIRE_EQUAL( compact.act.account, "eosio.token"_n );
+   BOOST_REQUIRE_EQUAL( compact.act.name, "transfer"_n );
+   BOOST_REQUIRE( compact.act.data.empty() );
+   BOOST_REQUIRE( compact.act.authorization.empty() );
+   BOOST_REQUIRE( compact.receipt );
+   BOOST_REQUIRE_EQUAL( compact.receipt->act_digest, notified.receipt->act_digest );
+
+   materialize_action_traces( *replica_trace );
+   BOOST_REQUIRE( fc::raw::pack( replica_trace->action_traces[1].act ) == fc::raw::pack( notified.act ) );
+} FC_LOG_AND_RETHROW() /// test_transfer_compact_notification_traces
+
 BOOST_FIXTURE_TEST_CASE( test_duplicate_transfer, currency_tester ) {
    create_accounts( {"alice"_n} );
 
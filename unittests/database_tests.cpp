@@ -1,4 +1,6 @@
 #include <eosio/chain/global_property_object.hpp>
+#include <eosio/chain/transaction_dedup_index.hpp>
+#include <eosio/chain/transaction_object.hpp>
 #include <eosio/testing/tester.hpp>
 
 #include <fc/crypto/digest.hpp>
@@ -81,4 +83,166 @@ BOOST_AUTO_TEST_SUITE(database_tests)
       } FC_LOG_AND_RETHROW()
    }
 
+   // Undo layers of the transaction dedup index follow the semantics of chainbase sessions
+   BOOST_AUTO_TEST_CASE(transaction_dedup_index_undo) {
+      try {
+         transaction_dedup_index idx;
+         auto id = [](uint32_t n) { return fc::sha256::hash(std::to_string(n)); };
+         const fc::time_point_sec t0(1000);
+
+         idx.set_revision(10);
+         BOOST_TEST(idx.insert(id(1), t0));
+         BOOST_TEST(idx.insert(id(2), t0 + 1));
+         BOOST_TEST(!idx.insert(id(1), t0 + 2));
+
+         // block session with a nested transaction session that is squashed and one that is undone
+         idx.start_session();
+         BOOST_TEST(idx.revision() == 11);
+         BOOST_TEST(idx.remove_expired(fc::time_point(t0) + fc::microseconds(1)) == 1u);
+         BOOST_TEST(!idx.contains(id(1)));
+         idx.start_session();
+         BOOST_TEST(idx.insert(id(3), t0 + 1));
+         idx.squash();
+         idx.start_session();
+         BOOST_TEST(idx.insert(id(4), t0 + 1));
+         idx.undo();
+         BOOST_TEST(idx.revision() == 11);
+         BOOST_TEST(idx.contains(id(3)));
+         BOOST_TEST(!idx.contains(id(4)));
+
+         // popping the block restores the expired id and drops the inserted one
+         idx.undo();
+         BOOST_TEST(idx.revision() == 10);
+         BOOST_TEST(idx.contains(id(1)));
+         BOOST_TEST(idx.contains(id(2)));
+         BOOST_TEST(!idx.contains(id(3)));
+
+         std::vector<transaction_id_type> order;
+         idx.walk([&](const transaction_dedup_index::row& r) { order.push_back(r.trx_id); });
+         BOOST_TEST(order.size() == 2u);
+         BOOST_TEST((order[0] == id(1) && order[1] == id(2)));
+
+         // committed layers can no longer be undone
+         idx.start_session();
+         BOOST_TEST(idx.insert(id(5), t0 + 5));
+         idx.start_session();
+         BOOST_TEST(idx.insert(id(6), t0 + 6));
+         idx.commit(11);
+         BOOST_TEST(idx.undo_depth() == 1u);
+
+         // undo layers survive a write and read
+         fc::temp_directory tempdir;
+         const auto path = tempdir.path() / transaction_dedup_index::file_name;
+         idx.write(path);
+         transaction_dedup_index copy;
+         copy.read(path);
+         BOOST_TEST(copy.revision() == 12);
+         BOOST_TEST(copy.size() == idx.size());
+         copy.undo();
+         BOOST_TEST(copy.contains(id(5)));
+         BOOST_TEST(!copy.contains(id(6)));
+
+         // rows are walked in insertion order like the ids of the transaction_multi_index, not by expiration
+         BOOST_TEST(copy.insert(id(7), t0));
+         order.clear();
+         copy.walk([&](const transaction_dedup_index::row& r) { order.push_back(r.trx_id); });
+         BOOST_TEST(order.size() == 4u);
+         BOOST_TEST((order[0] == id(1) && order[1] == id(2) && order[2] == id(5) && order[3] == id(7)));
+
+         // expiring everything empties the index
+         BOOST_TEST(copy.remove_expired(fc::time_point(t0 + 10)) == 4u);
+         BOOST_TEST(copy.size() == 0u);
+      } FC_LOG_AND_RETHROW()
+   }
+
+
+   // Insert, lookup and expiry cost with 1M unexpired ids, in the transaction dedup index and in the
+   // transaction_multi_index of a state database.
+   // disabled by default, run with: unit_test --run_test=database_tests/transaction_dedup_index_benchmark
+   BOOST_AUTO_TEST_CASE(transaction_dedup_index_benchmark, * boost::unit_test::disabled()) {
+      try {
+         constexpr uint32_t live_ids = 1'000'000;
+         constexpr uint32_t window   = 3600; // seconds over which expirations are spread
+         constexpr uint32_t per_sec  = live_ids / window;
+         constexpr uint32_t seconds  = 600;  // seconds of steady state, expiring and inserting per_sec ids each
+         const fc::time_point_sec t0(1000);
+         auto id = [](uint64_t n) { return fc::sha256::hash(reinterpret_cast<const char*>(&n), sizeof(n)); };
+         auto report = [](const char* what, const char* op, fc::microseconds elapsed, uint64_t count) {
+            BOOST_TEST_MESSAGE( what << " " << op << ": " << elapsed.count() * 1000 / count << " ns per id" );
+         };
+
+         // ids are hashed up front so that only the indices are timed
+         std::vector<transaction_id_type> ids;
+         ids.reserve( live_ids + uint64_t(per_sec) * seconds );
+         for( uint64_t n = 0; n < ids.capacity(); ++n ) ids.push_back( id(n) );
+         std::vector<transaction_id_type> misses;
+         misses.reserve( live_ids );
+         for( uint64_t n = 0; n < live_ids; ++n ) misses.push_back( id(n + ids.size()) );
+
+         {
+            transaction_dedup_index idx;
+            auto start = fc::time_point::now();
+            for( uint32_t n = 0; n < live_ids; ++n ) idx.insert( ids[n], t0 + n / per_sec );
+            report( "dedup index", "insert", fc::time_point::now() - start, live_ids );
+
+            uint32_t found = 0;
+            start = fc::time_point::now();
+            for( uint32_t n = 0; n < live_ids; ++n ) found += idx.contains( ids[n] );
+            for( uint32_t n = 0; n < live_ids; ++n ) found += idx.contains( misses[n] );
+            report( "dedup index", "lookup", fc::time_point::now() - start, 2 * live_ids );
+            BOOST_TEST( found == live_ids );
+
+            size_t expired = 0;
+            uint32_t next = live_ids;
+            start = fc::time_point::now();
+            for( uint32_t sec = 0; sec < seconds; ++sec ) {
+               expired += idx.remove_expired( fc::time_point( t0 + sec + 1 ) );
+               for( uint32_t n = 0; n < per_sec; ++n ) idx.insert( ids[next++], t0 + window + sec );
+            }
+            report( "dedup index", "expire and insert", fc::time_point::now() - start, expired + uint64_t(per_sec) * seconds );
+            BOOST_TEST( idx.size() + expired == next );
+         }
+
+         {
+            fc::temp_directory tempdir;
+            chainbase::database db( tempdir.path(), chainbase::database::read_write, 1024ull * 1024 * 1024 );
+            db.add_index<transaction_multi_index>();
+            auto& transaction_idx = db.get_mutable_index<transaction_multi_index>();
+            const auto& dedupe_index = transaction_idx.indices().get<by_expiration>();
+            auto create = [&](const transaction_id_type& trx_id, fc::time_point_sec expiration) {
+               db.create<transaction_object>([&](auto& t) {
+                  t.expiration = expiration;
+                  t.trx_id = trx_id;
+               });
+            };
+
+            auto start = fc::time_point::now();
+            for( uint32_t n = 0; n < live_ids; ++n ) create( ids[n], t0 + n / per_sec );
+            report( "transaction_multi_index", "insert", fc::time_point::now() - start, live_ids );
+
+            uint32_t found = 0;
+            start = fc::time_point::now();
+            for( uint32_t n = 0; n < live_ids; ++n ) found += db.find<transaction_object, by_trx_id>( ids[n] ) != nullptr;
+            for( uint32_t n = 0; n < live_ids; ++n ) found += db.find<transaction_object, by_trx_id>( misses[n] ) != nullptr;
+            report( "transaction_multi_index", "lookup", fc::time_point::now() - start, 2 * live_ids );
+            BOOST_TEST( found == live_ids );
+
+            size_t expired = 0;
+            uint32_t next = live_ids;
+            start = fc::time_point::now();
+            for( uint32_t sec = 0; sec < seconds; ++sec ) {
+               // as clear_expired_input_transactions
+               const auto now = fc::time_point( t0 + sec + 1 );
+               while( !dedupe_index.empty() && now > fc::time_point( dedupe_index.begin()->expiration ) ) {
+                  transaction_idx.remove( *dedupe_index.begin() );
+                  ++expired;
+               }
+               for( uint32_t n = 0; n < per_sec; ++n ) create( ids[next++], t0 + window + sec );
+            }
+            report( "transaction_multi_index", "expire and insert", fc::time_point::now() - start, expired + uint64_t(per_sec) * seconds );
+            BOOST_TEST( transaction_idx.indices().size() + expired == next );
+         }
+      } FC_LOG_AND_RETHROW()
+   }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -1,6 +1,9 @@
 #include <eosio/testing/tester.hpp>
 #include <eosio/chain/backing_store/db_key_value_format.hpp>
 #include <eosio/chain/backing_store/db_key_value_iter_store.hpp>
+#include <eosio/chain/backing_store/db_chainbase_iter_store.hpp>
+#include <eosio/chain/backing_store/db_combined.hpp>
+#include <eosio/chain/backing_store/rocksdb_profile.hpp>
 #include <b1/session/rocks_session.hpp>
 
 #include <boost/test/unit_test.hpp>
@@ -1136,4 +1139,214 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(itr_cache_test, KEY_SUITE, key_suite) {
 }
 
 
+BOOST_AUTO_TEST_CASE(itr_cache_invalidation_test) {
+   db_key_value_iter_store<uint64_t> key_cache;
+   using key_type = db_key_value_iter_store<uint64_t>::secondary_obj_type;
+   const auto t1_itr = key_cache.cache_table({ name{0}, name{0}, name{0} });
+
+   // a removed iterator stays invalid, the same object gets a new iterator
+   const key_type key_1 = { .table_ei = t1_itr, .secondary = 0x5, .primary = 0x1, .payer = name{0x0} };
+   const auto key_1_itr = key_cache.add(key_1);
+   key_cache.remove(key_1_itr);
+   key_cache.remove(key_1_itr); // removing again is a no-op
+   BOOST_CHECK_EQUAL(key_cache.invalid_iterator(), key_cache.find(key_1));
+   const auto key_1_readd_itr = key_cache.add(key_1);
+   BOOST_CHECK_LT(key_1_itr, key_1_readd_itr);
+   BOOST_CHECK_EXCEPTION(
+      key_cache.get( key_1_itr ), eosio::chain::table_operation_not_permitted,
+      eosio::testing::fc_exception_message_is( "dereference of deleted object" )
+   );
+   key_cache.swap(key_1_itr, 0x6, name{0x1}); // no-op on a removed iterator
+   validate_get(key_cache, key_1, key_1_readd_itr);
+
+   // swapping onto an object that already has an iterator keeps that iterator for it
+   const key_type key_2 = { .table_ei = t1_itr, .secondary = 0x7, .primary = 0x1, .payer = name{0x0} };
+   const auto key_2_itr = key_cache.add(key_2);
+   key_cache.swap(key_2_itr, key_1.secondary, key_1.payer);
+   BOOST_CHECK_EQUAL(key_1_readd_itr, key_cache.find(key_1));
+   BOOST_CHECK(key_cache.get(key_2_itr).secondary == key_1.secondary);
+   BOOST_CHECK_EQUAL(key_cache.invalid_iterator(), key_cache.find(key_2));
+   // and removing it forgets the object, as the iterator of an object is unique
+   key_cache.remove(key_2_itr);
+   BOOST_CHECK_EQUAL(key_cache.invalid_iterator(), key_cache.find(key_1));
+   BOOST_CHECK(key_cache.get(key_1_readd_itr).secondary == key_1.secondary);
+   key_cache.remove(key_1_readd_itr);
+
+   // iterators survive the growth of the index and removal of their neighbors
+   constexpr uint64_t num_keys = 1000;
+   std::vector<int> itrs;
+   for (uint64_t i = 0; i < num_keys; ++i) {
+      itrs.push_back(key_cache.add({ .table_ei = t1_itr, .secondary = i, .primary = i, .payer = name{i} }));
+   }
+   for (uint64_t i = 1; i < num_keys; i += 2) {
+      key_cache.remove(itrs[i]);
+   }
+   for (uint64_t i = 0; i < num_keys; ++i) {
+      const key_type key = { .table_ei = t1_itr, .secondary = i, .primary = i, .payer = name{i} };
+      if (i % 2) {
+         BOOST_CHECK_EQUAL(key_cache.invalid_iterator(), key_cache.find(key));
+      } else {
+         validate_get(key_cache, key, itrs[i]);
+      }
+   }
+   BOOST_CHECK_EQUAL(itrs.back() + 1, key_cache.add({ .table_ei = t1_itr, .secondary = 1, .primary = 1, .payer = name{} }));
+}
+
+BOOST_AUTO_TEST_CASE(itr_cache_float_test) {
+   db_key_value_iter_store<float64_t> double_cache;
+   const auto t1_itr = double_cache.cache_table({ name{0}, name{0}, name{0} });
+   // -0 and +0 are the same secondary key
+   const auto pos_zero_itr = double_cache.add({ .table_ei = t1_itr, .secondary = to_softfloat64(0.0), .primary = 0x1, .payer = name{} });
+   BOOST_CHECK_EQUAL(pos_zero_itr, double_cache.find({ .table_ei = t1_itr, .secondary = to_softfloat64(-0.0), .primary = 0x1, .payer = name{} }));
+   BOOST_CHECK_EQUAL(double_cache.invalid_iterator(), double_cache.find({ .table_ei = t1_itr, .secondary = to_softfloat64(1.0), .primary = 0x1, .payer = name{} }));
+
+   db_key_value_iter_store<float128_t> long_double_cache;
+   const auto t2_itr = long_double_cache.cache_table({ name{0}, name{0}, name{0} });
+   const auto neg_zero_itr = long_double_cache.add({ .table_ei = t2_itr, .secondary = to_softfloat128(-0.0), .primary = 0x1, .payer = name{} });
+   BOOST_CHECK_EQUAL(neg_zero_itr, long_double_cache.find({ .table_ei = t2_itr, .secondary = to_softfloat128(0.0), .primary = 0x1, .payer = name{} }));
+}
+
+BOOST_AUTO_TEST_CASE(chainbase_itr_cache_test) {
+   db_chainbase_iter_store<uint64_t> cache;
+   std::vector<uint64_t> objs(100);
+   std::vector<int> itrs;
+   for (const auto& obj : objs) {
+      itrs.push_back(cache.add(obj));
+   }
+   for (size_t i = 0; i < objs.size(); ++i) {
+      BOOST_CHECK_EQUAL(static_cast<int>(i), itrs[i]);
+      BOOST_CHECK_EQUAL(itrs[i], cache.add(objs[i]));
+      BOOST_CHECK_EQUAL(&objs[i], &cache.get(itrs[i]));
+   }
+   cache.remove(itrs[10]);
+   BOOST_CHECK_EXCEPTION(
+      cache.get( itrs[10] ), eosio::chain::table_operation_not_permitted,
+      eosio::testing::fc_exception_message_is( "dereference of deleted object" )
+   );
+   BOOST_CHECK_EQUAL(static_cast<int>(objs.size()), cache.add(objs[10]));
+   BOOST_CHECK_EQUAL(itrs[11], cache.add(objs[11]));
+   BOOST_CHECK_EXCEPTION(
+      cache.get( static_cast<int>(objs.size()) + 1 ), eosio::chain::invalid_table_iterator,
+      eosio::testing::fc_exception_message_is( "iterator out of range" )
+   );
+}
+
+// the iterator store work of a contract scanning a table with db_next_i64, db_get_i64 and db_update_i64
+BOOST_AUTO_TEST_CASE(itr_cache_scan_benchmark) {
+   constexpr uint64_t num_rows = 10000;
+   constexpr uint32_t num_scans = 100;
+   fc::microseconds elapsed;
+   for (uint32_t scan = 0; scan < num_scans; ++scan) {
+      db_key_value_iter_store<uint64_t> key_cache;
+      const auto start = fc::time_point::now();
+      const auto t1_itr = key_cache.cache_table({ name{"contract"_n}, name{"scope"_n}, name{"table"_n} });
+      for (uint64_t i = 0; i < num_rows; ++i) {
+         const auto itr = key_cache.add({ .table_ei = t1_itr, .secondary = 0, .primary = i, .payer = name{"payer"_n} });
+         const auto& obj = key_cache.get(itr);
+         key_cache.get_table(obj);
+         key_cache.swap(itr, 0, name{"payer2"_n});
+      }
+      elapsed += fc::time_point::now() - start;
+      BOOST_REQUIRE_EQUAL(static_cast<int>(num_rows - 1), key_cache.find({ .table_ei = t1_itr, .secondary = 0, .primary = num_rows - 1, .payer = name{} }));
+   }
+   BOOST_TEST_MESSAGE( "iterator store overhead of a " << num_rows << " row table scan: "
+                       << elapsed.count() / num_scans << "us" );
+}
+
+BOOST_AUTO_TEST_CASE(prefix_extractor_test) {
+   using namespace eosio::chain::backing_store;
+   using extractor = db_key_value_prefix_extractor;
+   const extractor table_level(extractor::level::table);
+   const extractor contract_level(extractor::level::contract);
+   auto slice = [](const eosio::session::shared_bytes& b) { return rocksdb::Slice(b.data(), b.size()); };
+
+   const name contract{"contract"_n};
+   const auto prim_1 = db_key_value_format::create_full_key(db_key_value_format::create_primary_key(name{1}, name{2}, 3), contract);
+   const auto prim_2 = db_key_value_format::create_full_key(db_key_value_format::create_primary_key(name{1}, name{2}, 4), contract);
+   const auto sec = db_key_value_format::create_full_key(db_key_value_format::create_secondary_key(name{1}, name{2}, uint64_t(5), 3), contract);
+   const auto table = db_key_value_format::create_full_key(db_key_value_format::create_table_key(name{1}, name{2}), contract);
+   const auto other_table = db_key_value_format::create_full_key(db_key_value_format::create_primary_key(name{1}, name{3}, 3), contract);
+   const auto other_contract = db_key_value_format::create_full_key(db_key_value_format::create_primary_key(name{1}, name{2}, 3), name{"other"_n});
+
+   for (const auto& key : { prim_1, prim_2, sec, table, other_table, other_contract }) {
+      BOOST_REQUIRE(table_level.InDomain(slice(key)));
+      BOOST_REQUIRE(contract_level.InDomain(slice(key)));
+      BOOST_CHECK_EQUAL(extractor::table_prefix_size, table_level.Transform(slice(key)).size());
+      BOOST_CHECK_EQUAL(extractor::contract_prefix_size, contract_level.Transform(slice(key)).size());
+      // a prefix is its own prefix
+      const auto prefix = table_level.Transform(slice(key));
+      BOOST_REQUIRE(table_level.InDomain(prefix));
+      BOOST_CHECK(table_level.Transform(prefix) == prefix);
+   }
+
+   // every key type of a table shares the table prefix
+   BOOST_CHECK(table_level.Transform(slice(prim_1)) == table_level.Transform(slice(prim_2)));
+   BOOST_CHECK(table_level.Transform(slice(prim_1)) == table_level.Transform(slice(sec)));
+   BOOST_CHECK(table_level.Transform(slice(prim_1)) == table_level.Transform(slice(table)));
+   BOOST_CHECK(table_level.Transform(slice(prim_1)) != table_level.Transform(slice(other_table)));
+   BOOST_CHECK(contract_level.Transform(slice(prim_1)) == contract_level.Transform(slice(other_table)));
+   BOOST_CHECK(contract_level.Transform(slice(prim_1)) != contract_level.Transform(slice(other_contract)));
+
+   // KV API keys have no scope or table
+   std::string kv_key(1, rocksdb_contract_kv_prefix);
+   kv_key.append(std::string(8, 'c')).append("key");
+   BOOST_REQUIRE(table_level.InDomain(kv_key));
+   BOOST_CHECK_EQUAL(extractor::contract_prefix_size, table_level.Transform(kv_key).size());
+
+   // too short or not written by the DB and KV APIs
+   const auto pre_type = db_key_value_format::create_full_key_prefix(prim_1, db_key_value_format::end_of_prefix::pre_type);
+   BOOST_CHECK(table_level.InDomain(slice(pre_type)));
+   BOOST_CHECK(!table_level.InDomain(rocksdb::Slice(pre_type.data(), extractor::table_prefix_size - 1)));
+   BOOST_CHECK(contract_level.InDomain(rocksdb::Slice(pre_type.data(), extractor::contract_prefix_size)));
+   BOOST_CHECK(!table_level.InDomain(rocksdb::Slice(pre_type.data(), 1)));
+   BOOST_CHECK(!table_level.InDomain(std::string(30, '\x13')));
+}
+
+// session iterators have to walk past the end of a table to find its end, whatever the profile
+BOOST_AUTO_TEST_CASE(prefix_profile_iteration_test) {
+   using namespace eosio::chain::backing_store;
+   using eosio::chain::persistent_storage_profile;
+   for (auto profile : { persistent_storage_profile::DEFAULT, persistent_storage_profile::TABLE_PREFIX,
+                         persistent_storage_profile::CONTRACT_PREFIX }) {
+      fc::temp_directory tempdir;
+      rocksdb::Options options;
+      options.create_if_missing = true;
+      configure_persistent_storage_profile(options, profile, 8 * 1024 * 1024);
+      rocksdb::DB* p;
+      BOOST_REQUIRE(rocksdb::DB::Open(options, (tempdir.path() / "chain-kv").string(), &p).ok());
+      auto rdb = std::shared_ptr<rocksdb::DB>{ p };
+      auto session = eosio::session::make_session(rdb, 16);
+
+      const name contract{"contract"_n};
+      const eosio::session::shared_bytes value("v", 1);
+      auto primary = [&](uint64_t table, uint64_t id) {
+         return db_key_value_format::create_full_key(db_key_value_format::create_primary_key(name{1}, name{table}, id), contract);
+      };
+      session.write(primary(1, 1), value);
+      session.write(primary(3, 1), value);
+      BOOST_REQUIRE(rdb->Flush(rocksdb::FlushOptions()).ok());
+      session.write(primary(5, 1), value);
+
+      // an existing key, the next one is in another table, in another file
+      auto itr = session.lower_bound(primary(1, 1));
+      BOOST_REQUIRE(itr != session.end());
+      BOOST_CHECK((*itr).first == primary(1, 1));
+      ++itr;
+      BOOST_REQUIRE(itr != session.end());
+      BOOST_CHECK((*itr).first == primary(3, 1));
+
+      // seeks into empty tables
+      itr = session.lower_bound(primary(2, 0));
+      BOOST_REQUIRE(itr != session.end());
+      BOOST_CHECK((*itr).first == primary(3, 1));
+      itr = session.lower_bound(primary(4, 0));
+      BOOST_REQUIRE(itr != session.end());
+      BOOST_CHECK((*itr).first == primary(5, 1));
+
+      BOOST_CHECK(session.read(primary(3, 1)));
+      BOOST_CHECK(!session.read(primary(3, 2)));
+      BOOST_CHECK(!session.read(primary(4, 1)));
+   }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
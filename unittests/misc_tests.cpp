@@ -3,6 +3,7 @@
 #include <eosio/chain/authority_checker.hpp>
 #include <eosio/chain/types.hpp>
 #include <eosio/chain/thread_utils.hpp>
+#include <eosio/chain/monotonic_arena.hpp>
 #include <eosio/chain/block_log.hpp>
 #include <eosio/testing/tester.hpp>
 
@@ -11,6 +12,8 @@
 #include <appbase/execution_priority_queue.hpp>
 #include <fc/bitutil.hpp>
 
+#include <algorithm>
+#include <chrono>
 #include <thread>
 
 #include <boost/test/unit_test.hpp>
@@ -1398,6 +1401,156 @@ BOOST_AUTO_TEST_CASE(bad_alloc_test) {
    BOOST_CHECK( ptr == nullptr );
 }
 
+BOOST_AUTO_TEST_CASE(cpu_affinity_test) { try {
+   BOOST_CHECK( parse_cpu_affinity( "" ).empty() );
+   BOOST_CHECK( parse_cpu_affinity( "3" ) == std::vector<uint32_t>({3}) );
+   BOOST_CHECK( parse_cpu_affinity( "0-2, 8,1,10-11" ) == std::vector<uint32_t>({0,1,2,8,10,11}) );
+   BOOST_CHECK_THROW( parse_cpu_affinity( "2-1" ), plugin_config_exception );
+   BOOST_CHECK_THROW( parse_cpu_affinity( "a" ), plugin_config_exception );
+   BOOST_CHECK_THROW( parse_cpu_affinity( "1,,2" ), plugin_config_exception );
+   BOOST_CHECK_THROW( parse_cpu_affinity( "node:x" ), plugin_config_exception );
+   // a node without topology information leaves placement to the operating system
+   BOOST_CHECK( parse_cpu_affinity( "node:99999" ).empty() );
+
+   // cpu 0 always exists, tasks still run when bound
+   named_thread_pool thread_pool( "misc", 2, {0} );
+   auto fut = async_thread_pool( thread_pool.get_executor(), []() { return 42; } );
+   BOOST_CHECK_EQUAL( fut.get(), 42 );
+   thread_pool.stop();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(thread_pool_priority_test) { try {
+   named_thread_pool thread_pool( "misc", 1 );
+
+   // hold the only thread so the following tasks queue up
+   std::promise<void> release;
+   auto blocked = async_thread_pool( thread_pool, named_thread_pool::priority::medium,
+                                     [f = release.get_future().share()]() { f.wait(); } );
+
+   std::mutex mtx;
+   std::vector<int> order;
+   std::vector<std::future<void>> futs;
+   auto record = [&]( int n ) { return [&, n]() { std::lock_guard<std::mutex> g( mtx ); order.push_back( n ); }; };
+   futs.emplace_back( async_thread_pool( thread_pool, named_thread_pool::priority::low,    record( 1 ) ) );
+   futs.emplace_back( async_thread_pool( thread_pool, named_thread_pool::priority::medium, record( 2 ) ) );
+   futs.emplace_back( async_thread_pool( thread_pool, named_thread_pool::priority::low,    record( 3 ) ) );
+   futs.emplace_back( async_thread_pool( thread_pool, named_thread_pool::priority::high,   record( 4 ) ) );
+   futs.emplace_back( async_thread_pool( thread_pool, named_thread_pool::priority::high,   record( 5 ) ) );
+
+   release.set_value();
+   blocked.get();
+   for( auto& f : futs ) f.get();
+
+   BOOST_CHECK( order == std::vector<int>({4, 5, 2, 1, 3}) );
+   thread_pool.stop();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(thread_pool_stop_test) { try {
+   named_thread_pool thread_pool( "misc", 1 );
+
+   // queued behind a running task when the pool is stopped
+   std::promise<void> release;
+   auto blocked = async_thread_pool( thread_pool, named_thread_pool::priority::medium,
+                                     [f = release.get_future().share()]() { f.wait(); } );
+   auto queued = async_thread_pool( thread_pool, named_thread_pool::priority::low, []() { return 1; } );
+   std::thread stopper( [&]() { thread_pool.stop(); } );
+   std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+   release.set_value();
+   stopper.join();
+   blocked.get();
+   BOOST_REQUIRE( queued.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready );
+   BOOST_CHECK_EQUAL( queued.get(), 1 );
+
+   // posted after the pool was stopped, run by the next stop
+   auto late = async_thread_pool( thread_pool, named_thread_pool::priority::high, []() { return 2; } );
+   thread_pool.stop();
+   BOOST_REQUIRE( late.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready );
+   BOOST_CHECK_EQUAL( late.get(), 2 );
+} FC_LOG_AND_RETHROW() }
+
+// Latency from submission to start of short high priority tasks while the pool is saturated with bulk low priority
+// tasks, with priority lanes and with the FIFO io_context the pool used before.
+// disabled by default, run with: unit_test --run_test=misc_tests/thread_pool_latency_benchmark
+BOOST_AUTO_TEST_CASE(thread_pool_latency_benchmark, * boost::unit_test::disabled()) { try {
+   constexpr size_t   num_threads = 4;
+   constexpr size_t   num_bulk    = 20000;
+   constexpr size_t   num_samples = 2000;
+   constexpr auto     bulk_work   = std::chrono::microseconds( 200 );
+   constexpr auto     interval    = std::chrono::microseconds( 500 );
+   using clock = std::chrono::steady_clock;
+
+   auto spin = []( std::chrono::microseconds d ) {
+      const auto until = clock::now() + d;
+      while( clock::now() < until )
+         ;
+   };
+
+   auto run = [&]( const char* name, bool prioritized ) {
+      named_thread_pool thread_pool( "bench", num_threads );
+      std::vector<std::future<void>> bulk;
+      bulk.reserve( num_bulk );
+      for( size_t i = 0; i < num_bulk; ++i ) {
+         if( prioritized )
+            bulk.emplace_back( async_thread_pool( thread_pool, named_thread_pool::priority::low, [&]() { spin( bulk_work ); } ) );
+         else
+            bulk.emplace_back( async_thread_pool( thread_pool.get_executor(), [&]() { spin( bulk_work ); } ) );
+      }
+
+      std::vector<std::future<clock::duration>> samples;
+      samples.reserve( num_samples );
+      for( size_t i = 0; i < num_samples; ++i ) {
+         const auto submitted = clock::now();
+         auto measure = [submitted]() { return clock::now() - submitted; };
+         if( prioritized )
+            samples.emplace_back( async_thread_pool( thread_pool, named_thread_pool::priority::high, measure ) );
+         else
+            samples.emplace_back( async_thread_pool( thread_pool.get_executor(), measure ) );
+         std::this_thread::sleep_for( interval );
+      }
+
+      std::vector<int64_t> latencies;
+      latencies.reserve( num_samples );
+      for( auto& f : samples ) latencies.push_back( std::chrono::duration_cast<std::chrono::microseconds>( f.get() ).count() );
+      for( auto& f : bulk ) f.get();
+      thread_pool.stop();
+
+      std::sort( latencies.begin(), latencies.end() );
+      auto pct = [&]( double p ) { return latencies[std::min( latencies.size() - 1, size_t( p * latencies.size() ) )]; };
+      BOOST_TEST_MESSAGE( name << " latency us: p50 " << pct( 0.5 ) << ", p99 " << pct( 0.99 ) << ", p99.9 " << pct( 0.999 )
+                          << ", max " << latencies.back() );
+   };
+
+   run( "fifo", false );
+   run( "priority", true );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(monotonic_arena_test) { try {
+   monotonic_arena arena;
+
+   arena_vector<uint32_t> small( (arena_allocator<uint32_t>(arena)) );
+   for( uint32_t i = 0; i < 64; ++i ) small.push_back( i );
+   BOOST_CHECK_EQUAL( 0u, arena.heap_bytes() );
+
+   arena_flat_set<name> accounts( (arena_allocator<name>(arena)) );
+   accounts.insert( "bob"_n );
+   accounts.insert( "alice"_n );
+   accounts.insert( "bob"_n );
+   BOOST_REQUIRE_EQUAL( 2u, accounts.size() );
+   BOOST_CHECK_EQUAL( *accounts.begin(), "alice"_n );
+
+   void* odd = arena.allocate( 1, 1 );
+   void* aligned = arena.allocate( sizeof(uint64_t), alignof(uint64_t) );
+   BOOST_CHECK( odd != aligned );
+   BOOST_CHECK_EQUAL( 0u, reinterpret_cast<uintptr_t>(aligned) % alignof(uint64_t) );
+
+   // spills to the heap once the inline storage is exhausted
+   arena_vector<char> large( (arena_allocator<char>(arena)) );
+   large.resize( 2 * monotonic_arena::inline_size, 'x' );
+   BOOST_CHECK( arena.heap_bytes() > 0 );
+   BOOST_CHECK_EQUAL( 'x', large.back() );
+   for( uint32_t i = 0; i < 64; ++i ) BOOST_CHECK_EQUAL( i, small[i] );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } // namespace eosio
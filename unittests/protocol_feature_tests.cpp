@@ -100,6 +100,106 @@ BOOST_AUTO_TEST_CASE( activate_and_restart ) try {
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_AUTO_TEST_CASE( builtin_activation_mask_test ) try {
+   tester c( setup_policy::none );
+
+   // a manager of its own, driven directly, against a reference of the activation block of each builtin feature
+   auto pfs = c.control->get_protocol_feature_manager().get_protocol_feature_set(); // make copy of protocol feature set
+   protocol_feature_manager pfm( std::move( pfs ), []() -> fc::logger* { return nullptr; } );
+   pfm.init( c.control->mutable_db() );
+
+   std::vector<builtin_protocol_feature_t> builtins;
+   for( uint32_t i = 0; pfm.get_builtin_digest( static_cast<builtin_protocol_feature_t>(i) ); ++i )
+      builtins.push_back( static_cast<builtin_protocol_feature_t>(i) );
+   BOOST_REQUIRE_GE( builtins.size(), 8u );
+   BOOST_REQUIRE_LE( builtins.size(), protocol_feature_manager::max_builtin_protocol_features );
+
+   std::map<builtin_protocol_feature_t, uint32_t> reference;
+   auto activate = [&]( size_t i, uint32_t block_num ) {
+      pfm.activate_feature( *pfm.get_builtin_digest( builtins[i] ), block_num );
+      reference[builtins[i]] = block_num;
+   };
+   auto pop_to = [&]( uint32_t block_num ) {
+      pfm.popped_blocks_to( block_num );
+      for( auto itr = reference.begin(); itr != reference.end(); )
+         itr = itr->second > block_num ? reference.erase( itr ) : std::next( itr );
+   };
+   auto check = [&]() {
+      for( uint32_t block_num = 0; block_num < 40; ++block_num ) {
+         for( auto f : builtins ) {
+            auto itr = reference.find( f );
+            BOOST_TEST_CONTEXT( "block " << block_num << " feature " << static_cast<uint32_t>(f) ) {
+               BOOST_CHECK_EQUAL( itr != reference.end() && itr->second <= block_num, pfm.is_builtin_activated( f, block_num ) );
+            }
+         }
+      }
+      BOOST_CHECK( !pfm.is_builtin_activated( static_cast<builtin_protocol_feature_t>(builtins.size()), 100 ) );
+   };
+
+   check();
+   activate( 0, 10 );
+   activate( 1, 10 );
+   activate( 2, 12 );
+   activate( 3, 15 );
+   activate( 4, 20 );
+   check();
+
+   // a fork switch pops the blocks after the fork point and applies the other branch
+   pop_to( 14 );
+   check();
+   activate( 5, 16 );
+   activate( 3, 16 );
+   check();
+
+   pop_to( 10 );
+   check();
+   pop_to( 9 );
+   check();
+   activate( 6, 9 );
+   activate( 7, 30 );
+   check();
+
+   // a manager loaded from the chain state, as on a restart or a snapshot load, agrees with the one of the controller
+   tester full( setup_policy::full );
+   full.produce_block();
+   const auto& chain_pfm = full.control->get_protocol_feature_manager();
+   auto loaded_pfs = chain_pfm.get_protocol_feature_set();
+   protocol_feature_manager loaded( std::move( loaded_pfs ), []() -> fc::logger* { return nullptr; } );
+   loaded.init( full.control->mutable_db() );
+   for( uint32_t block_num = 0; block_num <= full.control->head_block_num() + 1; ++block_num ) {
+      BOOST_CHECK_EQUAL( chain_pfm.activated_builtins_at( block_num ), loaded.activated_builtins_at( block_num ) );
+   }
+   for( auto f : builtins )
+      BOOST_CHECK( full.control->is_builtin_activated( f ) );
+
+} FC_LOG_AND_RETHROW()
+
+// the feature checks apply_context, transaction_context and the intrinsics make for each action
+// disabled by default, run with: unit_test --run_test=protocol_feature_tests/builtin_activation_check_benchmark
+BOOST_AUTO_TEST_CASE( builtin_activation_check_benchmark, * boost::unit_test::disabled() ) try {
+   tester c( setup_policy::full );
+   c.produce_block();
+
+   const builtin_protocol_feature_t per_action[] = {
+      builtin_protocol_feature_t::forward_setcode, builtin_protocol_feature_t::ram_restrictions,
+      builtin_protocol_feature_t::action_return_value, builtin_protocol_feature_t::restrict_action_to_self,
+      builtin_protocol_feature_t::no_duplicate_deferred_id, builtin_protocol_feature_t::replace_deferred,
+      builtin_protocol_feature_t::only_bill_first_authorizer, builtin_protocol_feature_t::configurable_wasm_limits,
+      builtin_protocol_feature_t::fix_linkauth_restriction
+   };
+   constexpr uint32_t num_actions = 1000000;
+   size_t activated = 0;
+   const auto start = fc::time_point::now();
+   for( uint32_t i = 0; i < num_actions; ++i ) {
+      for( auto f : per_action )
+         activated += c.control->is_builtin_activated( f );
+   }
+   const auto elapsed = fc::time_point::now() - start;
+   BOOST_REQUIRE_EQUAL( num_actions * std::size(per_action), activated );
+   BOOST_TEST_MESSAGE( "feature checks of " << num_actions << " actions: " << elapsed.count() << "us" );
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_CASE( double_preactivation ) try {
    tester c( setup_policy::preactivate_feature_and_new_bios );
    const auto& pfm = c.control->get_protocol_feature_manager();
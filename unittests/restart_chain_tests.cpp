@@ -1,8 +1,13 @@
+#include <algorithm>
 #include <sstream>
 
 #include <eosio/chain/block_log.hpp>
+#include <eosio/chain/reversible_block_journal.hpp>
+#include <eosio/chain/reversible_block_object.hpp>
 #include <eosio/chain/global_property_object.hpp>
 #include <eosio/chain/snapshot.hpp>
+#include <eosio/chain/transaction_dedup_index.hpp>
+#include <eosio/chain/transaction_object.hpp>
 #include <eosio/testing/tester.hpp>
 
 #include <boost/mpl/list.hpp>
@@ -570,4 +575,261 @@ BOOST_AUTO_TEST_CASE(test_trim_blocklog_front_v3) {
    trim_blocklog_front(3);
 }
 
+BOOST_AUTO_TEST_CASE(test_trim_split_log_in_place) {
+   namespace bfs = boost::filesystem;
+   fc::temp_directory temp_dir;
+
+   tester chain(
+         temp_dir,
+         [](controller::config& config) {
+            config.blog.stride             = 20;
+            config.blog.max_retained_files = 10;
+         },
+         true);
+   chain.produce_blocks(150);
+   chain.close();
+
+   auto blocks_dir = chain.get_config().blog.log_dir;
+   BOOST_REQUIRE(bfs::exists( blocks_dir / "blocks-41-60.log" ));
+   BOOST_REQUIRE(bfs::exists( blocks_dir / "blocks-121-140.log" ));
+
+   // only the file containing the first block to keep is rewritten
+   BOOST_CHECK(block_log::trim_split_log_front(blocks_dir, bfs::path(), bfs::path("archive"), 50));
+   BOOST_CHECK(bfs::exists( blocks_dir / "archive" / "blocks-1-20.log" ));
+   BOOST_CHECK(bfs::exists( blocks_dir / "archive" / "blocks-21-40.index" ));
+   BOOST_CHECK(!bfs::exists( blocks_dir / "blocks-41-60.log" ));
+   BOOST_CHECK(bfs::exists( blocks_dir / "blocks-50-60.log" ));
+   BOOST_CHECK(bfs::exists( blocks_dir / "blocks-50-60.index" ));
+   BOOST_CHECK(block_log::trim_split_log_front(blocks_dir, bfs::path(), bfs::path("archive"), 50)); // already trimmed
+   BOOST_CHECK(bfs::exists( blocks_dir / "blocks-50-60.log" ));
+
+   // the file containing the last block to keep is truncated and becomes blocks.log
+   BOOST_CHECK_EQUAL(0, block_log::trim_split_log_end(blocks_dir, bfs::path(), 105));
+   BOOST_CHECK(!bfs::exists( blocks_dir / "blocks-101-120.log" ));
+   BOOST_CHECK(!bfs::exists( blocks_dir / "blocks-121-140.log" ));
+   BOOST_CHECK_EQUAL(0, block_log::trim_split_log_end(blocks_dir, bfs::path(), 105)); // running it again is harmless
+
+   auto stats = block_log::verify_split_log(blocks_dir, bfs::path(), 1, 4);
+   BOOST_CHECK_EQUAL(4u, stats.files); // 50-60, 61-80, 81-100 and blocks.log with 101-105
+   BOOST_CHECK_EQUAL(105u - 50u + 1u, stats.blocks);
+
+   // an index missing its last entries is completed, the others are left alone
+   bfs::resize_file(blocks_dir / "blocks-61-80.index", 5 * sizeof(uint64_t));
+   BOOST_CHECK_THROW(block_log::verify_split_log(blocks_dir, bfs::path(), 1, 4), block_log_exception);
+   BOOST_CHECK_EQUAL(1u, block_log::repair_split_log_index(blocks_dir, bfs::path(), 2));
+   BOOST_CHECK_EQUAL(0u, block_log::repair_split_log_index(blocks_dir, bfs::path(), 2));
+   BOOST_REQUIRE_NO_THROW(block_log::verify_split_log(blocks_dir, bfs::path(), 1, 4));
+
+   block_log blog({ .log_dir = blocks_dir });
+   BOOST_CHECK_EQUAL(50u, blog.first_block_num());
+   BOOST_CHECK_EQUAL(105u, blog.head()->block_num());
+   BOOST_CHECK_EQUAL(70u, blog.read_signed_block_by_num(70)->block_num());
+}
+
+BOOST_AUTO_TEST_CASE(test_reversible_block_journal) {
+   tester chain;
+   std::vector<signed_block_ptr> blocks;
+   for( int i = 0; i < 10; ++i )
+      blocks.push_back( chain.produce_block() );
+
+   fc::temp_directory temp_dir;
+   const auto dir = temp_dir.path() / "reversible";
+   {
+      reversible_block_journal journal( dir );
+      BOOST_REQUIRE( journal.empty() );
+      for( const auto& b : blocks )
+         journal.append( *b, b->calculate_id() );
+      BOOST_REQUIRE_EQUAL( journal.size(), blocks.size() );
+      BOOST_CHECK_EQUAL( journal.first_block_num(), blocks.front()->block_num() );
+      BOOST_CHECK_EQUAL( journal.last_block_num(), blocks.back()->block_num() );
+      BOOST_CHECK( *journal.block_id( blocks[3]->block_num() ) == blocks[3]->calculate_id() );
+      BOOST_CHECK( journal.read_block( blocks[3]->block_num() )->calculate_id() == blocks[3]->calculate_id() );
+      BOOST_CHECK( !journal.block_id( blocks.back()->block_num() + 1 ) );
+
+      // fork: replace the last two blocks
+      journal.remove_after( blocks[7]->block_num() );
+      BOOST_CHECK_EQUAL( journal.last_block_num(), blocks[7]->block_num() );
+      journal.append( *blocks[8], blocks[8]->calculate_id() );
+
+      // irreversible
+      journal.remove_through( blocks[2]->block_num() );
+      BOOST_CHECK_EQUAL( journal.first_block_num(), blocks[3]->block_num() );
+   }
+   {
+      // the front is not persisted, everything still in the file is recovered
+      reversible_block_journal journal( dir );
+      BOOST_CHECK_EQUAL( journal.first_block_num(), blocks[0]->block_num() );
+      BOOST_CHECK_EQUAL( journal.last_block_num(), blocks[8]->block_num() );
+      BOOST_CHECK( journal.read_block( blocks[8]->block_num() )->calculate_id() == blocks[8]->calculate_id() );
+   }
+   const auto good_size = fc::file_size( dir / reversible_block_journal::file_name );
+   {
+      // simulate a crash in the middle of an append
+      fc::cfile f;
+      f.set_file_path( dir / reversible_block_journal::file_name );
+      f.open( fc::cfile::update_rw_mode );
+      f.seek_end( 0 );
+      const auto packed = fc::raw::pack( *blocks[9] );
+      f.write( reinterpret_cast<const char*>(&reversible_block_journal::magic_number), sizeof(uint32_t) );
+      f.write( packed.data(), packed.size() / 2 );
+      f.close();
+   }
+   {
+      reversible_block_journal journal( dir );
+      BOOST_CHECK_EQUAL( journal.last_block_num(), blocks[8]->block_num() );
+      BOOST_CHECK_EQUAL( fc::file_size( dir / reversible_block_journal::file_name ), good_size );
+      journal.append( *blocks[9], blocks[9]->calculate_id() );
+      BOOST_CHECK_EQUAL( journal.last_block_num(), blocks[9]->block_num() );
+
+      journal.remove_through( blocks[9]->block_num() );
+      BOOST_CHECK( journal.empty() );
+      BOOST_CHECK_EQUAL( fc::file_size( dir / reversible_block_journal::file_name ), 0u );
+   }
+}
+
+BOOST_AUTO_TEST_CASE(test_restart_with_reversible_block_journal) {
+   fc::temp_directory temp_dir;
+   tester chain( temp_dir, []( controller::config& cfg ) { cfg.reversible_blocks_journal = true; }, true );
+   chain.produce_blocks( 10 );
+   const auto head_id = chain.control->head_block_id();
+   BOOST_CHECK( reversible_block_journal::exists( chain.get_config().blog.log_dir / config::reversible_blocks_dir_name ) );
+   BOOST_CHECK( chain.control->fetch_block_by_number( chain.control->head_block_num() )->calculate_id() == head_id );
+   const auto* journal = chain.control->reversible_journal();
+   BOOST_REQUIRE( journal );
+   if( !journal->empty() )
+      BOOST_CHECK_EQUAL( journal->last_block_num(), chain.control->head_block_num() );
+
+   chain.close();
+   chain.open();
+   BOOST_CHECK( chain.control->head_block_id() == head_id );
+   chain.produce_blocks( 2 );
+}
+
+// Time commit_block spends keeping a reversible block and dropping it once irreversible, in the journal and in the
+// reversible blocks database, with as many reversible blocks as on a network of 21 producers.
+// disabled by default, run with: unit_test --run_test=restart_chain_tests/reversible_block_storage_benchmark
+BOOST_AUTO_TEST_CASE(reversible_block_storage_benchmark, * boost::unit_test::disabled()) try {
+   constexpr uint32_t num_blocks        = 1000;
+   constexpr uint32_t trxs_per_block    = 20;
+   constexpr uint32_t reversible_window = 330;
+
+   tester chain;
+   std::vector<signed_block_ptr> blocks;
+   std::vector<block_id_type>    ids;
+   const std::string chars = "abcdefghijklmnopqrstuvwxyz12345";
+   for( uint32_t n = 0; n < num_blocks * trxs_per_block; ++n ) {
+      std::string acc = "bench";
+      for( uint32_t v = n, i = 0; i < 4; ++i, v /= chars.size() ) acc += chars[v % chars.size()];
+      chain.create_account( name( acc ) );
+      if( n % trxs_per_block == trxs_per_block - 1 ) {
+         blocks.push_back( chain.produce_block() );
+         ids.push_back( blocks.back()->calculate_id() );
+      }
+   }
+
+   auto report = []( const char* what, std::vector<int64_t>& latencies ) {
+      std::sort( latencies.begin(), latencies.end() );
+      auto pct = [&]( double p ) { return latencies[std::min( latencies.size() - 1, size_t( p * latencies.size() ) )]; };
+      BOOST_TEST_MESSAGE( what << " us per block: p50 " << pct( 0.5 ) << ", p99 " << pct( 0.99 ) << ", max " << latencies.back() );
+   };
+   std::vector<int64_t> latencies;
+   latencies.reserve( blocks.size() );
+
+   {
+      fc::temp_directory temp_dir;
+      reversible_block_journal journal( temp_dir.path() );
+      for( size_t i = 0; i < blocks.size(); ++i ) {
+         const auto start = fc::time_point::now();
+         journal.append( *blocks[i], ids[i] );
+         if( i >= reversible_window ) journal.remove_through( blocks[i - reversible_window]->block_num() );
+         latencies.push_back( (fc::time_point::now() - start).count() );
+      }
+      report( "reversible block journal", latencies );
+   }
+
+   latencies.clear();
+   {
+      fc::temp_directory temp_dir;
+      chainbase::database db( temp_dir.path(), chainbase::database::read_write, config::default_reversible_cache_size );
+      db.add_index<reversible_block_index>();
+      const auto& rbi = db.get_index<reversible_block_index, by_num>();
+      for( size_t i = 0; i < blocks.size(); ++i ) {
+         const auto start = fc::time_point::now();
+         db.create<reversible_block_object>( [&]( auto& ubo ) {
+            ubo.blocknum = blocks[i]->block_num();
+            ubo.set_block( blocks[i] );
+         });
+         if( i >= reversible_window ) {
+            const auto lib = blocks[i - reversible_window]->block_num();
+            for( auto itr = rbi.begin(); itr != rbi.end() && itr->blocknum <= lib; itr = rbi.begin() )
+               db.remove( *itr );
+         }
+         latencies.push_back( (fc::time_point::now() - start).count() );
+      }
+      report( "reversible blocks database", latencies );
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE(test_restart_with_transaction_dedup_index) try {
+   fc::temp_directory temp_dir;
+   tester chain( temp_dir, []( controller::config& cfg ) { cfg.transaction_dedup_index = true; }, true );
+   const auto dedup_file = chain.get_config().state_dir / transaction_dedup_index::file_name;
+   BOOST_CHECK( fc::exists( dedup_file ) );
+   chain.produce_blocks( 2 );
+
+   auto trace = chain.create_account( "alice"_n );
+   chain.produce_block();
+   BOOST_CHECK( chain.control->is_known_unexpired_transaction( trace->id ) );
+   BOOST_CHECK( !chain.control->db().find<transaction_object, by_trx_id>( trace->id ) );
+
+   chain.close();
+   BOOST_CHECK( fc::exists( dedup_file ) );
+
+   // the ids are not in the state database, so it cannot be opened without the dedup index
+   BOOST_CHECK_THROW( tester( temp_dir, []( controller::config& cfg ) { cfg.transaction_dedup_index = false; }, false ),
+                      database_exception );
+
+   // nor without the file that holds them
+   const auto saved_file = temp_dir.path() / "transaction_dedup.saved";
+   fc::rename( dedup_file, saved_file );
+   BOOST_CHECK_THROW( tester( temp_dir, []( controller::config& cfg ) { cfg.transaction_dedup_index = true; }, false ),
+                      database_exception );
+   fc::rename( saved_file, dedup_file );
+
+   // the file stays while the node runs, marking that the ids are kept outside of the state database
+   chain.open();
+   BOOST_CHECK( fc::exists( dedup_file ) );
+   BOOST_CHECK( chain.control->is_known_unexpired_transaction( trace->id ) );
+
+   chain.produce_block( fc::seconds( 2 * tester::DEFAULT_EXPIRATION_DELTA ) );
+   chain.produce_block();
+   BOOST_CHECK( !chain.control->is_known_unexpired_transaction( trace->id ) );
+} FC_LOG_AND_RETHROW()
+
+// a node keeping the ids in the dedup index writes the same transaction_object rows to snapshots as one that does not
+BOOST_AUTO_TEST_CASE(test_transaction_dedup_index_integrity_hash) try {
+   fc::temp_directory dedup_dir;
+   fc::temp_directory other_dir;
+   tester chain( dedup_dir, []( controller::config& cfg ) { cfg.transaction_dedup_index = true; }, true );
+   tester other( other_dir, []( controller::config& cfg ) { cfg.transaction_dedup_index = false; }, true );
+
+   chain.create_account( "alice"_n );
+   // inserted after the id of alice's account, but expires before it
+   chain.push_action( config::system_account_name, "updateauth"_n, "alice"_n, fc::mutable_variant_object()
+      ("account", "alice")
+      ("permission", "first")
+      ("parent", "active")
+      ("auth", authority( chain.get_public_key( "alice"_n, "first" ) )),
+      1 );
+   chain.produce_block();
+   for( uint32_t n = 1; n <= chain.control->head_block_num(); ++n ) {
+      if( n > other.control->head_block_num() ) {
+         other.push_block( chain.control->fetch_block_by_number( n ) );
+      }
+   }
+
+   BOOST_REQUIRE( chain.control->head_block_id() == other.control->head_block_id() );
+   BOOST_CHECK_EQUAL( chain.control->calculate_integrity_hash().str(), other.control->calculate_integrity_hash().str() );
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()